@@ -8,7 +8,9 @@
 #include "StateFile.hxx"
 #include "Stats.hxx"
 #include "client/List.hxx"
+#include "client/Threads.hxx"
 #include "input/cache/Manager.hxx"
+#include "PictureCache.hxx"
 
 #ifdef ENABLE_CURL
 #include "RemoteTagCache.hxx"
@@ -16,6 +18,7 @@
 #endif
 
 #ifdef ENABLE_DATABASE
+#include "client/CommandPool.hxx"
 #include "db/DatabaseError.hxx"
 #include "db/Interface.hxx"
 #include "db/update/Service.hxx"
@@ -48,6 +51,11 @@ Instance::~Instance() noexcept
 #endif
 
 #ifdef ENABLE_DATABASE
+	/* no command may access the database after it has been
+	   closed */
+	if (command_pool)
+		command_pool->Stop();
+
 	delete update;
 
 	if (database != nullptr) {
@@ -126,6 +134,7 @@ Instance::OnDatabaseModified() noexcept
 	/* propagate the change to all subsystems */
 
 	stats_invalidate();
+	InvalidateQueryCaches();
 
 	for (auto &partition : partitions)
 		partition.DatabaseModified(*database);
@@ -214,6 +223,9 @@ Instance::FlushCaches() noexcept
 {
 	if (input_cache)
 		input_cache->Flush();
+
+	if (picture_cache)
+		picture_cache->Flush();
 }
 
 void
@@ -26,8 +26,15 @@ class NeighborGlue;
 #ifdef ENABLE_DATABASE
 #include "db/DatabaseListener.hxx"
 #include "db/Ptr.hxx"
+#include "db/QueryCache.hxx"
+#include "tag/Type.hxx"
+
+#include <string>
+#include <vector>
 
 class Storage;
+class TagCountMap;
+template<typename Key> class RecursiveMap;
 class UpdateService;
 #ifdef ENABLE_INOTIFY
 class InotifyUpdate;
@@ -38,6 +45,7 @@ class InotifyUpdate;
 #include <list>
 
 class ClientList;
+class ClientThreads;
 struct Partition;
 class AudioOutputControl;
 class StateFile;
@@ -45,6 +53,8 @@ class RemoteTagCache;
 class StickerDatabase;
 class StickerCleanupService;
 class InputCacheManager;
+class PictureCache;
+class CommandPool;
 
 /**
  * A utility class which, when used as the first base class, ensures
@@ -91,6 +101,12 @@ struct Instance final
 
 	std::unique_ptr<InputCacheManager> input_cache;
 
+	/**
+	 * Caches pictures for "readpicture" and "albumart"; nullptr
+	 * if disabled.
+	 */
+	std::unique_ptr<PictureCache> picture_cache;
+
 	/**
 	 * Monitor for global idle events to be broadcasted to all
 	 * partitions.
@@ -102,6 +118,16 @@ struct Instance final
 #endif
 
 #ifdef ENABLE_DATABASE
+	/**
+	 * Executes expensive database commands in worker threads;
+	 * nullptr if disabled or if the database is not thread-safe.
+	 *
+	 * This is declared before #client_list because pending jobs
+	 * are owned by clients and need to be removed from the pool
+	 * when the clients get destroyed.
+	 */
+	std::unique_ptr<CommandPool> command_pool;
+
 	DatabasePtr database;
 
 	/**
@@ -112,6 +138,19 @@ struct Instance final
 
 	UpdateService *update = nullptr;
 
+	/**
+	 * Caches "count group" results of the whole #database; see
+	 * PrintSongCount().
+	 */
+	DatabaseQueryCache<TagType, TagCountMap> count_group_cache{4 * 1024 * 1024};
+
+	/**
+	 * Caches "list" results without a filter; see
+	 * PrintUniqueTags().
+	 */
+	DatabaseQueryCache<std::vector<TagType>,
+			   RecursiveMap<std::string>> unique_tags_cache{16 * 1024 * 1024};
+
 #ifdef ENABLE_INOTIFY
 	std::unique_ptr<InotifyUpdate> inotify_update;
 #endif
@@ -121,6 +160,15 @@ struct Instance final
 	std::unique_ptr<RemoteTagCache> remote_tag_cache;
 #endif
 
+	/**
+	 * Threads which perform socket I/O for clients; nullptr if
+	 * disabled (then it's done by the main thread).
+	 *
+	 * This is declared before #client_list because the clients
+	 * unregister their sockets from these threads.
+	 */
+	std::unique_ptr<ClientThreads> client_threads;
+
 	std::unique_ptr<ClientList> client_list;
 
 	std::list<Partition> partitions;
@@ -200,6 +248,15 @@ struct Instance final
 	 * music_directory was configured).
 	 */
 	const Database &GetDatabaseOrThrow() const;
+
+	/**
+	 * Discard the results of expensive database queries.  Call
+	 * this after the database has been modified.
+	 */
+	void InvalidateQueryCaches() noexcept {
+		count_group_cache.Clear();
+		unique_tags_cache.Clear();
+	}
 #endif
 
 #ifdef ENABLE_SQLITE
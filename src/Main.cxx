@@ -13,6 +13,7 @@
 #include "Listen.hxx"
 #include "client/Config.hxx"
 #include "client/List.hxx"
+#include "client/Threads.hxx"
 #include "command/AllCommands.hxx"
 #include "Partition.hxx"
 #include "tag/Config.hxx"
@@ -22,6 +23,7 @@
 #include "input/Init.hxx"
 #include "input/cache/Config.hxx"
 #include "input/cache/Manager.hxx"
+#include "PictureCache.hxx"
 #include "event/Loop.hxx"
 #include "event/Call.hxx"
 #include "fs/AllocatedPath.hxx"
@@ -52,6 +54,7 @@
 #include "db/Features.hxx" // for ENABLE_DATABASE
 #ifdef ENABLE_DATABASE
 #include "db/update/Service.hxx"
+#include "client/CommandPool.hxx"
 #include "db/Configured.hxx"
 #include "db/DatabasePlugin.hxx"
 #include "db/plugins/simple/SimpleDatabasePlugin.hxx"
@@ -207,6 +210,15 @@ glue_db_init_and_load(Instance &instance, const ConfigData &config)
 
 	instance.database = std::move(db);
 
+	if (instance.database->GetPlugin().IsThreadSafe()) {
+		const unsigned n_threads =
+			config.GetUnsigned(ConfigOption::COMMAND_THREADS, 2);
+		if (n_threads > 0)
+			instance.command_pool =
+				std::make_unique<CommandPool>(instance.event_loop,
+							      n_threads);
+	}
+
 	auto *sdb = dynamic_cast<SimpleDatabase *>(instance.database.get());
 	if (sdb == nullptr)
 		return true;
@@ -349,12 +361,25 @@ MainConfigured(const CommandLineOptions &options,
 		raw_config.GetPositive(ConfigOption::MAX_CONN, 100);
 	instance.client_list = std::make_unique<ClientList>(max_clients);
 
+	if (const unsigned client_threads =
+	    raw_config.GetUnsigned(ConfigOption::CLIENT_THREADS, 0);
+	    client_threads > 0)
+		instance.client_threads =
+			std::make_unique<ClientThreads>(client_threads);
+
 	const auto *input_cache_config = raw_config.GetBlock(ConfigBlockOption::INPUT_CACHE);
 	if (input_cache_config != nullptr) {
 		const InputCacheConfig c(*input_cache_config);
 		instance.input_cache = std::make_unique<InputCacheManager>(c);
 	}
 
+	const auto *picture_cache_config = raw_config.GetBlock(ConfigBlockOption::PICTURE_CACHE);
+	const auto picture_cache = picture_cache_config != nullptr
+		? PictureCacheConfig{*picture_cache_config}
+		: PictureCacheConfig{};
+	if (picture_cache.size > 0)
+		instance.picture_cache = std::make_unique<PictureCache>(picture_cache);
+
 	initialize_decoder_and_player(instance,
 				      raw_config, partition_config);
 
@@ -430,6 +455,9 @@ MainConfigured(const CommandLineOptions &options,
 	instance.io_thread.Start();
 	instance.rtio_thread.Start();
 
+	if (instance.client_threads)
+		instance.client_threads->Start();
+
 #ifdef ENABLE_NEIGHBOR_PLUGINS
 	if (instance.neighbors != nullptr)
 		instance.neighbors->Open();
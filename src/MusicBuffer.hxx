@@ -7,15 +7,12 @@
 #include "MusicChunk.hxx"
 #include "MusicChunkPtr.hxx"
 #include "util/SliceBuffer.hxx"
-#include "thread/Mutex.hxx"
 
 /**
- * An allocator for #MusicChunk objects.
+ * An allocator for #MusicChunk objects.  All methods are thread-safe
+ * and lock-free.
  */
 class MusicBuffer {
-	/** a mutex which protects #buffer */
-	mutable Mutex mutex;
-
 	SliceBuffer<MusicChunk> buffer;
 
 public:
@@ -24,14 +21,17 @@ public:
 	 *
 	 * @param num_chunks the number of #MusicChunk reserved in
 	 * this buffer
+	 * @param chunk_size the size of each #MusicChunk in bytes
+	 * (including the header); must be between #MIN_CHUNK_SIZE
+	 * and #MAX_CHUNK_SIZE
 	 */
-	explicit MusicBuffer(unsigned num_chunks);
+	explicit MusicBuffer(unsigned num_chunks,
+			     std::size_t chunk_size=DEFAULT_CHUNK_SIZE);
 
 #ifndef NDEBUG
 	/**
-	 * Check whether the buffer is empty.  This call is not
-	 * protected with the mutex, and may only be used while this
-	 * object is inaccessible to other threads.
+	 * Check whether the buffer is empty.  This may only be used
+	 * while this object is inaccessible to other threads.
 	 */
 	bool IsEmptyUnsafe() const {
 		return buffer.empty();
@@ -39,7 +39,6 @@ public:
 #endif
 
 	bool IsFull() const noexcept {
-		const std::scoped_lock protect{mutex};
 		return buffer.IsFull();
 	}
 
@@ -53,6 +52,31 @@ public:
 		return buffer.GetCapacity();
 	}
 
+	/**
+	 * Returns the number of data bytes which fit into each
+	 * #MusicChunk (see MusicChunk::capacity).
+	 */
+	[[gnu::pure]]
+	std::size_t GetChunkCapacity() const noexcept {
+		return buffer.GetSliceSize() - sizeof(MusicChunk);
+	}
+
+	/**
+	 * Returns the highest number of chunks which were allocated
+	 * at the same time.
+	 */
+	unsigned GetHighWaterMark() const noexcept {
+		return buffer.GetHighWaterMark();
+	}
+
+	/**
+	 * Returns the number of Allocate() calls which failed because
+	 * the buffer was full.
+	 */
+	unsigned long GetAllocationFailures() const noexcept {
+		return buffer.GetAllocationFailures();
+	}
+
 	/**
 	 * Allocates a chunk from the buffer.  When it is not used anymore,
 	 * call Return().
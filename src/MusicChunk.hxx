@@ -17,7 +17,18 @@
 #include <memory>
 #include <span>
 
-static constexpr size_t CHUNK_SIZE = 4096;
+/**
+ * The default size of a #MusicChunk in bytes (including the
+ * #MusicChunkInfo header).
+ */
+static constexpr size_t DEFAULT_CHUNK_SIZE = 4096;
+
+/**
+ * The limits for the "audio_chunk_size" setting.  The upper limit is
+ * imposed by the 16 bit MusicChunkInfo::length field.
+ */
+static constexpr size_t MIN_CHUNK_SIZE = 1024;
+static constexpr size_t MAX_CHUNK_SIZE = 64 * 1024;
 
 struct AudioFormat;
 struct Tag;
@@ -97,10 +108,16 @@ struct MusicChunkInfo {
 /**
  * A chunk of music data.  Its format is defined by the
  * MusicPipe::Push() caller.
+ *
+ * The data (probably PCM) is stored right after this object; its
+ * size is chosen by the #MusicBuffer at runtime.
  */
 struct MusicChunk : MusicChunkInfo {
-	/** the data (probably PCM) */
-	std::byte data[CHUNK_SIZE - sizeof(MusicChunkInfo)];
+	/** the size of the data buffer following this object */
+	const uint16_t capacity;
+
+	explicit MusicChunk(std::size_t _capacity) noexcept
+		:capacity(_capacity) {}
 
 	/**
 	 * Prepares appending to the music chunk.  Returns a buffer
@@ -129,8 +146,17 @@ struct MusicChunk : MusicChunkInfo {
 	bool Expand(AudioFormat af, size_t length) noexcept;
 
 	std::span<const std::byte> ReadData() const noexcept {
-		return {data, length};
+		return {GetData(), length};
+	}
+
+private:
+	std::byte *GetData() noexcept {
+		return reinterpret_cast<std::byte *>(this + 1);
+	}
+
+	const std::byte *GetData() const noexcept {
+		return reinterpret_cast<const std::byte *>(this + 1);
 	}
 };
 
-static_assert(sizeof(MusicChunk) == CHUNK_SIZE, "Wrong size");
+static_assert(sizeof(MusicChunk) < MIN_CHUNK_SIZE);
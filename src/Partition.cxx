@@ -4,17 +4,15 @@
 #include "config.h"
 #include "Partition.hxx"
 #include "Instance.hxx"
-#include "Log.hxx"
 #include "config/PartitionConfig.hxx"
-#include "lib/fmt/ExceptionFormatter.hxx"
 #include "song/DetachedSong.hxx"
 #include "protocol/IdleFlags.hxx"
 #include "client/Listener.hxx"
 #include "client/Client.hxx"
-#include "input/cache/Manager.hxx"
-#include "util/Domain.hxx"
+#include "input/cache/Prefetcher.hxx"
 
-static constexpr Domain cache_domain("cache");
+#include <string>
+#include <vector>
 
 Partition::Partition(Instance &_instance,
 		     const char *_name,
@@ -31,6 +29,10 @@ Partition::Partition(Instance &_instance,
 	    instance.input_cache.get(),
 	    config.player)
 {
+	if (instance.input_cache)
+		prefetcher = std::make_unique<InputCachePrefetcher>(instance.event_loop,
+								    *instance.input_cache);
+
 	UpdateEffectiveReplayGainMode();
 }
 
@@ -43,42 +45,35 @@ Partition::BeginShutdown() noexcept
 	listener.reset();
 }
 
-static void
-PrefetchSong(InputCacheManager &cache, const char *uri) noexcept
-{
-	if (cache.Contains(uri))
-		return;
-
-	FmtDebug(cache_domain, "Prefetch {:?}", uri);
-
-	try {
-		cache.Prefetch(uri);
-	} catch (...) {
-		FmtError(cache_domain,
-			 "Prefetch {:?} failed: {}",
-			 uri, std::current_exception());
-	}
-}
-
-static void
-PrefetchSong(InputCacheManager &cache, const DetachedSong &song) noexcept
-{
-	PrefetchSong(cache, song.GetURI());
-}
-
 inline void
 Partition::PrefetchQueue() noexcept
 {
-	if (!instance.input_cache)
+	if (!prefetcher)
 		return;
 
-	auto &cache = *instance.input_cache;
-
-	int next = playlist.GetNextPosition();
-	if (next >= 0)
-		PrefetchSong(cache, playlist.queue.Get(next));
+	const auto &queue = playlist.queue;
+	const unsigned max_songs = prefetcher->GetMaxSongs();
+
+	/* walk the queue in playback order, starting after the
+	   current song */
+	std::vector<std::string> uris;
+	for (int order = playlist.current;
+	     order >= 0 && uris.size() < max_songs;) {
+		const int next = queue.GetNextOrder(order);
+		if (next < 0 || next == playlist.current)
+			/* end of queue, or back at the current song */
+			break;
+
+		if (next < order && queue.random)
+			/* the queue will be shuffled again when
+			   wrapping around */
+			break;
+
+		uris.emplace_back(queue.GetOrder(next).GetURI());
+		order = next;
+	}
 
-	// TODO: prefetch more songs
+	prefetcher->Schedule(std::move(uris));
 }
 
 void
@@ -152,12 +147,14 @@ void
 Partition::OnQueueModified() noexcept
 {
 	EmitIdle(IDLE_PLAYLIST);
+	PrefetchQueue();
 }
 
 void
 Partition::OnQueueOptionsChanged() noexcept
 {
 	EmitIdle(IDLE_OPTIONS);
+	PrefetchQueue();
 }
 
 void
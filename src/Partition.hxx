@@ -28,6 +28,7 @@ struct RangeArg;
 class MultipleOutputs;
 class SongLoader;
 class ClientListener;
+class InputCachePrefetcher;
 class Client;
 struct ClientPerPartitionListHook;
 
@@ -65,6 +66,12 @@ struct Partition final : QueueListener, PlayerListener, MixerListener {
 
 	PlayerControl pc;
 
+	/**
+	 * Loads upcoming songs into the input cache; nullptr if the
+	 * input cache is disabled.
+	 */
+	std::unique_ptr<InputCachePrefetcher> prefetcher;
+
 	ReplayGainMode replay_gain_mode = ReplayGainMode::OFF;
 
 	Partition(Instance &_instance,
@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "PictureCache.hxx"
+#include "config/Block.hxx"
+#include "config/Parser.hxx"
+
+#include <algorithm> // for std::min()
+#include <cassert>
+#include <functional> // for std::hash
+
+static constexpr std::size_t KILOBYTE = 1024;
+static constexpr std::size_t MEGABYTE = 1024 * KILOBYTE;
+
+PictureCacheConfig::PictureCacheConfig() noexcept
+	:size(16 * MEGABYTE), max_item_size(4 * MEGABYTE)
+{
+}
+
+PictureCacheConfig::PictureCacheConfig(const ConfigBlock &block)
+	:PictureCacheConfig()
+{
+	if (const auto *param = block.GetBlockParam("size"))
+		size = param->With([](const char *s){
+			return ParseSize(s);
+		});
+
+	if (const auto *param = block.GetBlockParam("max_item_size"))
+		max_item_size = param->With([](const char *s){
+			return ParseSize(s);
+		});
+}
+
+class PictureCache::Item final
+	: public IntrusiveListHook<>,
+	  public IntrusiveHashSetHook<>
+{
+	const std::string uri;
+	const std::chrono::system_clock::time_point mtime;
+
+public:
+	/**
+	 * nullptr if the file has no picture.
+	 */
+	const std::shared_ptr<const CachedPicture> picture;
+
+	Item(Key key, std::shared_ptr<const CachedPicture> &&_picture) noexcept
+		:uri(key.uri), mtime(key.mtime),
+		 picture(std::move(_picture)) {}
+
+	Key GetKey() const noexcept {
+		return {uri, mtime};
+	}
+
+	/**
+	 * The number of bytes accounted for this item.
+	 */
+	std::size_t GetSize() const noexcept {
+		std::size_t size = sizeof(*this) + uri.size();
+		if (picture)
+			size += sizeof(*picture) + picture->mime_type.size() +
+				picture->data.size();
+		return size;
+	}
+};
+
+std::size_t
+PictureCache::Key::Hash::operator()(const Key &key) const noexcept
+{
+	return std::hash<std::string_view>{}(key.uri) ^
+		std::size_t(key.mtime.time_since_epoch().count());
+}
+
+inline PictureCache::Key
+PictureCache::ItemGetKey::operator()(const Item &item) const noexcept
+{
+	return item.GetKey();
+}
+
+PictureCache::PictureCache(const PictureCacheConfig &config) noexcept
+	:max_size(config.size),
+	 max_item_size(std::min(config.max_item_size, config.size))
+{
+}
+
+PictureCache::~PictureCache() noexcept
+{
+	Flush();
+}
+
+void
+PictureCache::Flush() noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	while (!lru.empty())
+		Delete(lru.front());
+}
+
+PictureCache::Stats
+PictureCache::GetStats() const noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	return {
+		.n_items = lru.size(),
+		.n_bytes = total_size,
+		.n_hits = n_hits,
+		.n_misses = n_misses,
+	};
+}
+
+std::pair<bool, std::shared_ptr<const CachedPicture>>
+PictureCache::Find(Key key) noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	auto i = items.find(key);
+	if (i == items.end()) {
+		++n_misses;
+		return {false, nullptr};
+	}
+
+	++n_hits;
+
+	/* mark as "most recently used" */
+	lru.erase(lru.iterator_to(*i));
+	lru.push_back(*i);
+
+	return {true, i->picture};
+}
+
+void
+PictureCache::Add(Key key, std::shared_ptr<const CachedPicture> picture) noexcept
+{
+	if (picture && picture->data.size() > max_item_size)
+		return;
+
+	auto *item = new Item(key, std::move(picture));
+	const std::size_t size = item->GetSize();
+	if (size > max_size) {
+		delete item;
+		return;
+	}
+
+	const std::scoped_lock lock{mutex};
+
+	if (items.find(key) != items.end()) {
+		/* another thread has added this item meanwhile */
+		delete item;
+		return;
+	}
+
+	/* evict the least recently used items */
+	while (!lru.empty() && total_size + size > max_size)
+		Delete(lru.front());
+
+	total_size += size;
+	items.insert(*item);
+	lru.push_back(*item);
+}
+
+void
+PictureCache::Delete(Item &item) noexcept
+{
+	const std::size_t size = item.GetSize();
+	assert(total_size >= size);
+	total_size -= size;
+
+	lru.erase(lru.iterator_to(item));
+	items.erase(items.iterator_to(item));
+	delete &item;
+}
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_PICTURE_CACHE_HXX
+#define MPD_PICTURE_CACHE_HXX
+
+#include "thread/Mutex.hxx"
+#include "util/AllocatedArray.hxx"
+#include "util/IntrusiveHashSet.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+struct ConfigBlock;
+
+struct PictureCacheConfig {
+	/**
+	 * The maximum total size of all cached pictures in bytes.
+	 * 0 disables the cache.
+	 */
+	std::size_t size;
+
+	/**
+	 * Pictures larger than this are not cached.
+	 */
+	std::size_t max_item_size;
+
+	/**
+	 * Initialize with the default values.
+	 */
+	PictureCacheConfig() noexcept;
+
+	explicit PictureCacheConfig(const ConfigBlock &block);
+};
+
+/**
+ * A picture which was extracted from a song file (for
+ * "readpicture") or loaded from a cover file (for "albumart").
+ */
+struct CachedPicture {
+	/**
+	 * The MIME type; empty if unknown.
+	 */
+	std::string mime_type;
+
+	AllocatedArray<std::byte> data;
+};
+
+/**
+ * An in-memory LRU cache for pictures, shared by all clients.  This
+ * avoids parsing a song file again for each chunk requested by
+ * "readpicture" (and by each client).
+ *
+ * Items are identified by the URI and the modification time of the
+ * file; a modified file therefore gets a new item, and the old one
+ * expires eventually.
+ *
+ * This class is thread-safe.
+ */
+class PictureCache {
+	class Item;
+
+	const std::size_t max_size, max_item_size;
+
+	mutable Mutex mutex;
+
+	std::size_t total_size = 0;
+
+	uint_least64_t n_hits = 0, n_misses = 0;
+
+public:
+	struct Key {
+		std::string_view uri;
+		std::chrono::system_clock::time_point mtime;
+
+		friend constexpr bool operator==(const Key &,
+						 const Key &) noexcept = default;
+
+		struct Hash {
+			[[gnu::pure]]
+			std::size_t operator()(const Key &key) const noexcept;
+		};
+	};
+
+	struct Stats {
+		std::size_t n_items, n_bytes;
+		uint_least64_t n_hits, n_misses;
+	};
+
+private:
+	struct ItemGetKey {
+		[[gnu::pure]]
+		Key operator()(const Item &item) const noexcept;
+	};
+
+	/**
+	 * All items; the least recently used one is at the front.
+	 */
+	IntrusiveList<Item, IntrusiveListBaseHookTraits<Item>,
+		      IntrusiveListOptions{.constant_time_size = true}> lru;
+
+	IntrusiveHashSet<Item, 1021,
+			 IntrusiveHashSetOperators<Item, ItemGetKey,
+						   Key::Hash,
+						   std::equal_to<Key>>> items;
+
+public:
+	explicit PictureCache(const PictureCacheConfig &config) noexcept;
+	~PictureCache() noexcept;
+
+	PictureCache(const PictureCache &) = delete;
+	PictureCache &operator=(const PictureCache &) = delete;
+
+	std::size_t GetMaxItemSize() const noexcept {
+		return max_item_size;
+	}
+
+	/**
+	 * Look up a picture.  On a cache miss, the given function is
+	 * invoked (without holding a lock) to load it, and the result
+	 * is added to the cache, even if it is nullptr (i.e. the file
+	 * has no picture).
+	 *
+	 * Throws on error (whatever the function throws).
+	 *
+	 * @return the picture or nullptr if the file has no picture
+	 */
+	template<typename F>
+	std::shared_ptr<const CachedPicture> Get(Key key, F &&load) {
+		if (auto [found, picture] = Find(key); found)
+			return picture;
+
+		std::shared_ptr<const CachedPicture> picture = load();
+		Add(key, picture);
+		return picture;
+	}
+
+	/**
+	 * Remove all items.
+	 */
+	void Flush() noexcept;
+
+	[[gnu::pure]]
+	Stats GetStats() const noexcept;
+
+private:
+	/**
+	 * @return true and the picture if the item was found
+	 */
+	std::pair<bool, std::shared_ptr<const CachedPicture>> Find(Key key) noexcept;
+
+	void Add(Key key, std::shared_ptr<const CachedPicture> picture) noexcept;
+
+	void Delete(Item &item) noexcept;
+};
+
+#endif
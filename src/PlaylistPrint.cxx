@@ -33,6 +33,20 @@ playlist_print_info(Response &r, const playlist &playlist, RangeArg range)
 	queue_print_info(r, queue, range.start, range.end);
 }
 
+CommandResult
+playlist_stream_info(Response &r, const playlist &playlist, RangeArg range)
+{
+	const Queue &queue = playlist.queue;
+
+	if (!range.CheckClip(queue.GetLength()))
+		throw PlaylistError::BadRange();
+
+	if (range.IsEmpty())
+		return CommandResult::OK;
+
+	return queue_stream_info(r, queue, range.start, range.end);
+}
+
 void
 playlist_print_id(Response &r, const playlist &playlist,
 		  unsigned id)
@@ -4,6 +4,8 @@
 #ifndef MPD_PLAYLIST_PRINT_HXX
 #define MPD_PLAYLIST_PRINT_HXX
 
+#include "command/CommandResult.hxx"
+
 #include <cstdint>
 
 struct playlist;
@@ -28,6 +30,15 @@ playlist_print_uris(Response &r, const playlist &playlist);
 void
 playlist_print_info(Response &r, const playlist &playlist, RangeArg range);
 
+/**
+ * Like playlist_print_info(), but large responses are sent in
+ * portions (see Response::Stream()).
+ *
+ * Throws #PlaylistError if the range is invalid.
+ */
+CommandResult
+playlist_stream_info(Response &r, const playlist &playlist, RangeArg range);
+
 /**
  * Sends the song with the specified id to the client.
  *
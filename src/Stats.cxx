@@ -4,12 +4,15 @@
 #include "Stats.hxx"
 #include "player/Control.hxx"
 #include "client/Response.hxx"
+#include "command/AllCommands.hxx"
 #include "Partition.hxx"
 #include "Instance.hxx"
 #include "db/Features.hxx" // for ENABLE_DATABASE
 #include "db/Selection.hxx"
 #include "db/Interface.hxx"
 #include "db/Stats.hxx"
+#include "tag/Pool.hxx"
+#include "PictureCache.hxx"
 #include "Log.hxx"
 #include "time/ChronoUtil.hxx"
 #include "util/Math.hxx"
@@ -114,6 +117,25 @@ stats_print(Response &r, const Partition &partition)
 	      std::chrono::duration_cast<std::chrono::seconds>(uptime).count(),
 	      lround(partition.pc.GetTotalPlayTime().count()));
 
+	const auto tag_pool = tag_pool_get_stats();
+	r.Fmt("tag_pool_items: {}\n"
+	      "tag_pool_bytes: {}\n"
+	      "tag_pool_collisions: {}\n"
+	      "tag_pool_lock_waits: {}\n",
+	      tag_pool.n_items, tag_pool.n_bytes,
+	      tag_pool.n_collisions, tag_pool.n_lock_waits);
+
+	if (const auto *picture_cache = partition.instance.picture_cache.get()) {
+		const auto s = picture_cache->GetStats();
+		r.Fmt("picture_cache_items: {}\n"
+		      "picture_cache_bytes: {}\n"
+		      "picture_cache_hits: {}\n"
+		      "picture_cache_misses: {}\n",
+		      s.n_items, s.n_bytes, s.n_hits, s.n_misses);
+	}
+
+	command_stats_print(r);
+
 #ifdef ENABLE_DATABASE
 	const Database *db = partition.instance.GetDatabase();
 	if (db != nullptr)
@@ -12,6 +12,7 @@
 #include "client/Client.hxx"
 #include "protocol/Ack.hxx"
 #include "fs/AllocatedPath.hxx"
+#include "fs/FileInfo.hxx"
 #include "input/InputStream.hxx"
 #include "util/ScopeExit.hxx"
 #include "util/StringCompare.hxx"
@@ -146,3 +147,38 @@ TagScanAny(Client &client, const char *uri, TagHandler &handler)
 
 	std::unreachable();
 }
+
+std::chrono::system_clock::time_point
+GetSongModificationTime(Client &client, const char *uri) noexcept
+try {
+	const auto located_uri = LocateUri(UriPluginKind::INPUT, uri, &client
+#ifdef ENABLE_DATABASE
+					   , nullptr
+#endif
+					   );
+	switch (located_uri.type) {
+	case LocatedUri::Type::ABSOLUTE:
+		break;
+
+	case LocatedUri::Type::RELATIVE:
+#ifdef ENABLE_DATABASE
+		if (const auto *db = client.GetDatabase()) {
+			const auto *song = db->GetSong(located_uri.canonical_uri);
+			if (song != nullptr) {
+				AtScopeExit(db, song) { db->ReturnSong(song); };
+				return song->mtime;
+			}
+		}
+#endif
+		break;
+
+	case LocatedUri::Type::PATH:
+		if (FileInfo fi; GetFileInfo(located_uri.path, fi))
+			return fi.GetModificationTime();
+		break;
+	}
+
+	return std::chrono::system_clock::time_point::min();
+} catch (...) {
+	return std::chrono::system_clock::time_point::min();
+}
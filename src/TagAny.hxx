@@ -4,6 +4,8 @@
 #ifndef MPD_TAG_ANY_HXX
 #define MPD_TAG_ANY_HXX
 
+#include <chrono>
+
 class Client;
 class TagHandler;
 
@@ -17,4 +19,16 @@ class TagHandler;
 void
 TagScanAny(Client &client, const char *uri, TagHandler &handler);
 
+/**
+ * Determine the modification time of the song file specified by the
+ * given URI (see TagScanAny()).  For songs in the database, this is
+ * the time stamp recorded by the last database update.
+ *
+ * @return the modification time or
+ * std::chrono::system_clock::time_point::min() if it is unknown (e.g.
+ * for remote files)
+ */
+std::chrono::system_clock::time_point
+GetSongModificationTime(Client &client, const char *uri) noexcept;
+
 #endif
@@ -21,11 +21,25 @@ public:
 	virtual ~BackgroundCommand() = default;
 
 	/**
-	 * Cancel command execution.  After this method returns, the
-	 * object will be deleted.  It will be called from the
+	 * Cancel command execution.  It will be called from the
 	 * #Client's #EventLoop thread.
+	 *
+	 * @return true if the object may be deleted now; false if it
+	 * is still busy in another thread which cannot be
+	 * interrupted; it will then discard its response and call
+	 * Client::OnBackgroundCommandFinished() when done (and
+	 * Cancel() may be called again meanwhile)
 	 */
-	virtual void Cancel() noexcept = 0;
+	virtual bool Cancel() noexcept = 0;
+
+	/**
+	 * The client's output buffer has become empty.  Commands
+	 * which generate their response in portions (see
+	 * #ResponseProducer) use this to generate the next one.  It
+	 * is not allowed to write to the client from within this
+	 * method.
+	 */
+	virtual void OnOutputDrained() noexcept {}
 };
 
 #endif
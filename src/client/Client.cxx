@@ -9,13 +9,19 @@
 #include "protocol/IdleFlags.hxx"
 #include "config.h"
 
+#include <cassert>
+
 Client::~Client() noexcept
 {
-	if (FullyBufferedSocket::IsDefined())
-		FullyBufferedSocket::Close();
+	if (ThreadedSocket::IsDefined())
+		ThreadedSocket::Close();
 
 	if (background_command) {
-		background_command->Cancel();
+		/* the CommandPool has been stopped already, so
+		   nothing can be running anymore */
+		[[maybe_unused]] const bool cancelled =
+			background_command->Cancel();
+		assert(cancelled);
 		background_command.reset();
 	}
 }
@@ -39,11 +45,19 @@ Client::OnBackgroundCommandFinished() noexcept
 
 	background_command.reset();
 
-	/* just in case OnSocketInput() has returned
-	   InputResult::PAUSE meanwhile */
-	ResumeInput();
+	if (IsExpired()) {
+		/* the client was closed while the command was
+		   running; finish that now (see Close()) */
+		timeout_event.Schedule(Event::Duration::zero());
+		return;
+	}
 
 	timeout_event.Schedule(client_timeout);
+
+	/* just in case OnSocketInput() has returned
+	   InputResult::PAUSE meanwhile; this may destroy the
+	   client */
+	ResumeInput();
 }
 
 void
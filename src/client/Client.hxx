@@ -11,7 +11,7 @@
 #include "db/Features.hxx" // for ENABLE_DATABASE
 #include "input/LastInputStream.hxx"
 #include "tag/Mask.hxx"
-#include "event/FullyBufferedSocket.hxx"
+#include "event/ThreadedSocket.hxx"
 #include "event/CoarseTimerEvent.hxx"
 #include "util/IntrusiveList.hxx"
 
@@ -35,7 +35,7 @@ class Storage;
 class BackgroundCommand;
 
 class Client final
-	: public IClient, FullyBufferedSocket
+	: public IClient, ThreadedSocket
 {
 	friend struct ClientPerPartitionListHook;
 	friend class ClientList;
@@ -120,19 +120,23 @@ private:
 	ProtocolFeature protocol_feature = ProtocolFeature::None();
 
 public:
-	Client(EventLoop &loop, Partition &partition,
+	/**
+	 * @param io_loop the #EventLoop which performs socket I/O;
+	 * may be different from #loop (see #ThreadedSocket)
+	 */
+	Client(EventLoop &loop, EventLoop &io_loop, Partition &partition,
 	       UniqueSocketDescriptor fd, int uid,
 	       unsigned _permission,
 	       std::string &&_name) noexcept;
 
 	~Client() noexcept;
 
-	using FullyBufferedSocket::GetEventLoop;
-	using FullyBufferedSocket::GetOutputMaxSize;
+	using ThreadedSocket::GetEventLoop;
+	using ThreadedSocket::GetOutputMaxSize;
 
 	[[gnu::pure]]
 	bool IsExpired() const noexcept {
-		return !FullyBufferedSocket::IsDefined();
+		return !ThreadedSocket::IsDefined();
 	}
 
 	void Close() noexcept;
@@ -214,7 +218,9 @@ public:
 	/**
 	 * Called by the current #BackgroundCommand when it has
 	 * finished, after sending the response.  This method then
-	 * deletes the #BackgroundCommand.
+	 * deletes the #BackgroundCommand.  If the client has been
+	 * closed while the command was running, closing is completed
+	 * now.
 	 */
 	void OnBackgroundCommandFinished() noexcept;
 
@@ -288,10 +294,11 @@ private:
 
 	CommandResult ProcessLine(char *line) noexcept;
 
-	/* virtual methods from class BufferedSocket */
+	/* virtual methods from class ThreadedSocket */
 	InputResult OnSocketInput(std::span<std::byte> src) noexcept override;
 	void OnSocketError(std::exception_ptr ep) noexcept override;
 	void OnSocketClosed() noexcept override;
+	void OnSocketOutputDrained() noexcept override;
 
 	/* callback for TimerEvent */
 	void OnTimeout() noexcept;
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "CommandPool.hxx"
+#include "thread/Name.hxx"
+
+#include <cassert>
+
+CommandPool::CommandPool(EventLoop &event_loop, unsigned n_threads)
+	:defer_suspended(event_loop, BIND_THIS_METHOD(OnDeferredSuspended))
+{
+	assert(n_threads > 0);
+
+	try {
+		for (unsigned i = 0; i < n_threads; ++i) {
+			threads.emplace_front(BIND_THIS_METHOD(WorkerThread));
+			threads.front().Start();
+		}
+	} catch (...) {
+		/* the first Thread object was never started */
+		threads.pop_front();
+		Stop();
+		throw;
+	}
+}
+
+CommandPool::~CommandPool() noexcept
+{
+	Stop();
+
+	assert(queue.empty());
+	assert(suspend_handlers.empty());
+	assert(n_suspended == 0);
+}
+
+void
+CommandPool::Stop() noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		quit = true;
+		worker_cond.notify_all();
+	}
+
+	for (auto &i : threads)
+		i.Join();
+
+	threads.clear();
+}
+
+void
+CommandPool::Push(Job &job) noexcept
+{
+	const std::scoped_lock lock{mutex};
+	assert(job.state == Job::State::IDLE);
+
+	job.state = Job::State::QUEUED;
+	queue.push_back(job);
+	worker_cond.notify_one();
+}
+
+bool
+CommandPool::Cancel(Job &job) noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	switch (job.state) {
+	case Job::State::IDLE:
+		break;
+
+	case Job::State::QUEUED:
+		queue.erase(queue.iterator_to(job));
+		job.state = Job::State::IDLE;
+		break;
+
+	case Job::State::RUNNING:
+		return false;
+	}
+
+	return true;
+}
+
+bool
+CommandPool::Suspend(SuspendHandler &handler) noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	++n_suspended;
+
+	if (n_running == 0)
+		return true;
+
+	suspend_handlers.push_back(handler);
+	return false;
+}
+
+void
+CommandPool::CancelSuspend(SuspendHandler &handler) noexcept
+{
+	const std::scoped_lock lock{mutex};
+	assert(n_suspended > 0);
+
+	suspend_handlers.erase(suspend_handlers.iterator_to(handler));
+
+	if (--n_suspended == 0)
+		worker_cond.notify_all();
+}
+
+void
+CommandPool::Resume() noexcept
+{
+	const std::scoped_lock lock{mutex};
+	assert(n_suspended > 0);
+
+	if (--n_suspended == 0)
+		worker_cond.notify_all();
+}
+
+void
+CommandPool::OnDeferredSuspended() noexcept
+{
+	std::unique_lock lock{mutex};
+
+	while (n_running == 0 && !suspend_handlers.empty()) {
+		auto &handler = suspend_handlers.pop_front();
+
+		lock.unlock();
+		handler.OnCommandPoolSuspended();
+		lock.lock();
+	}
+}
+
+void
+CommandPool::WorkerThread() noexcept
+{
+	SetThreadName("command");
+
+	std::unique_lock lock{mutex};
+
+	while (true) {
+		worker_cond.wait(lock, [this]{
+			return quit || (n_suspended == 0 && !queue.empty());
+		});
+
+		if (quit)
+			break;
+
+		Job &job = queue.pop_front();
+		job.state = Job::State::RUNNING;
+		++n_running;
+
+		lock.unlock();
+		job.Run();
+		lock.lock();
+
+		--n_running;
+		job.state = Job::State::IDLE;
+		job.Finish();
+
+		if (n_running == 0 && !suspend_handlers.empty())
+			defer_suspended.Schedule();
+	}
+}
@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include "event/InjectEvent.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <cstdint>
+#include <forward_list>
+
+/**
+ * A bounded pool of threads which execute (read-only) client
+ * commands, so they don't block the main #EventLoop.
+ *
+ * @see PooledCommand
+ */
+class CommandPool final {
+public:
+	/**
+	 * A job which can be submitted to the #CommandPool.
+	 */
+	class Job : public IntrusiveListHook<> {
+		friend class CommandPool;
+
+		enum class State : uint_least8_t {
+			IDLE,
+			QUEUED,
+			RUNNING,
+		};
+
+		/**
+		 * Protected by CommandPool::mutex.
+		 */
+		State state = State::IDLE;
+
+	protected:
+		~Job() noexcept = default;
+
+		/**
+		 * Execute the job.  This is called in a worker thread
+		 * without holding a lock.
+		 */
+		virtual void Run() noexcept = 0;
+
+		/**
+		 * Run() has returned.  This is called in the worker
+		 * thread while holding the pool's mutex; it must not
+		 * block.  After this method returns, the pool does
+		 * not access the object anymore.
+		 */
+		virtual void Finish() noexcept = 0;
+	};
+
+	/**
+	 * An operation which needs the pool to be idle, e.g. because
+	 * it destroys objects which may be in use by a job (such as
+	 * a mounted database).  See Suspend().
+	 */
+	class SuspendHandler : public IntrusiveListHook<> {
+	protected:
+		~SuspendHandler() noexcept = default;
+
+	public:
+		/**
+		 * All running jobs have finished, and no new job
+		 * will be started until Resume() is called.  This is
+		 * called in the #EventLoop thread.
+		 */
+		virtual void OnCommandPoolSuspended() noexcept = 0;
+	};
+
+private:
+	std::forward_list<Thread> threads;
+
+	Mutex mutex;
+
+	/**
+	 * Signalled when a new job is queued or when the pool shall
+	 * quit.
+	 */
+	Cond worker_cond;
+
+	/**
+	 * Invokes the #SuspendHandler instances in the #EventLoop
+	 * thread after the last running job has finished.
+	 */
+	InjectEvent defer_suspended;
+
+	/**
+	 * Jobs which have not been picked up by a worker yet.
+	 */
+	IntrusiveList<Job> queue;
+
+	/**
+	 * Suspend() callers which wait for the running jobs to
+	 * finish.
+	 */
+	IntrusiveList<SuspendHandler> suspend_handlers;
+
+	/**
+	 * The number of jobs currently being run by a worker.
+	 */
+	unsigned n_running = 0;
+
+	/**
+	 * The number of Suspend() calls which have not yet been
+	 * undone by Resume() or CancelSuspend().  While this is
+	 * non-zero, workers don't start new jobs.
+	 */
+	unsigned n_suspended = 0;
+
+	bool quit = false;
+
+public:
+	/**
+	 * Throws on error.
+	 *
+	 * @param event_loop the #EventLoop which invokes
+	 * SuspendHandler::OnCommandPoolSuspended()
+	 */
+	CommandPool(EventLoop &event_loop, unsigned n_threads);
+
+	~CommandPool() noexcept;
+
+	CommandPool(const CommandPool &) = delete;
+	CommandPool &operator=(const CommandPool &) = delete;
+
+	/**
+	 * Stop all worker threads (after waiting for running jobs to
+	 * finish).  Jobs which are still queued will never be run,
+	 * but they may still be cancelled.
+	 */
+	void Stop() noexcept;
+
+	/**
+	 * Submit a new job.
+	 */
+	void Push(Job &job) noexcept;
+
+	/**
+	 * Cancel the given job: if it has not been started yet, it is
+	 * removed from the queue.  A running job cannot be
+	 * interrupted, and this method does not wait for it;
+	 * Job::Finish() will be called as usual.
+	 *
+	 * @return true if the pool does not access the job anymore,
+	 * false if it is still running
+	 */
+	bool Cancel(Job &job) noexcept;
+
+	/**
+	 * Don't start new jobs.  This method does not wait for
+	 * running jobs to finish.
+	 *
+	 * @return true if no job is running, i.e. the pool is
+	 * suspended already; false if the #SuspendHandler will be
+	 * invoked later (unless CancelSuspend() is called)
+	 */
+	bool Suspend(SuspendHandler &handler) noexcept;
+
+	/**
+	 * Undo a Suspend() call whose #SuspendHandler has not been
+	 * invoked yet.
+	 */
+	void CancelSuspend(SuspendHandler &handler) noexcept;
+
+	/**
+	 * Undo a Suspend() call which has returned true or whose
+	 * #SuspendHandler has been invoked.
+	 */
+	void Resume() noexcept;
+
+private:
+	/* the worker thread function */
+	void WorkerThread() noexcept;
+
+	/* callback for #defer_suspended */
+	void OnDeferredSuspended() noexcept;
+};
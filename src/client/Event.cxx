@@ -2,6 +2,7 @@
 // Copyright The Music Player Daemon Project
 
 #include "Client.hxx"
+#include "BackgroundCommand.hxx"
 #include "Domain.hxx"
 #include "lib/fmt/ExceptionFormatter.hxx"
 #include "Log.hxx"
@@ -19,3 +20,10 @@ Client::OnSocketClosed() noexcept
 {
 	SetExpired();
 }
+
+void
+Client::OnSocketOutputDrained() noexcept
+{
+	if (background_command)
+		background_command->OnOutputDrained();
+}
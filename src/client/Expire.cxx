@@ -12,12 +12,12 @@ Client::SetExpired() noexcept
 	if (IsExpired())
 		return;
 
-	if (background_command) {
-		background_command->Cancel();
+	/* if the command is still running in another thread, it
+	   keeps this object alive until it finishes; see Close() */
+	if (background_command && background_command->Cancel())
 		background_command.reset();
-	}
 
-	FullyBufferedSocket::Close();
+	ThreadedSocket::Close();
 	timeout_event.Schedule(Event::Duration::zero());
 }
 
@@ -5,6 +5,7 @@
 #include "Config.hxx"
 #include "Domain.hxx"
 #include "List.hxx"
+#include "Threads.hxx"
 #include "BackgroundCommand.hxx"
 #include "Partition.hxx"
 #include "Instance.hxx"
@@ -25,12 +26,13 @@ using std::string_view_literals::operator""sv;
 
 static constexpr auto GREETING = "OK MPD " PROTOCOL_VERSION "\n"sv;
 
-Client::Client(EventLoop &_loop, Partition &_partition,
+Client::Client(EventLoop &_loop, EventLoop &io_loop,
+	       Partition &_partition,
 	       UniqueSocketDescriptor _fd,
 	       int _uid, unsigned _permission,
 	       std::string &&_name) noexcept
-	:FullyBufferedSocket(_fd.Release(), _loop,
-			     16384, client_max_output_buffer_size),
+	:ThreadedSocket(_fd.Release(), _loop, io_loop,
+			16384, client_max_output_buffer_size),
 	 name(std::move(_name)),
 	 timeout_event(_loop, BIND_THIS_METHOD(OnTimeout)),
 	 partition(&_partition),
@@ -75,7 +77,12 @@ client_new(EventLoop &loop, Partition &partition,
 
 	const int uid = cred.IsDefined() ? static_cast<int>(cred.GetUid()) : -1;
 
-	auto *client = new Client(loop, partition, std::move(fd), uid,
+	auto &io_loop = partition.instance.client_threads
+		? partition.instance.client_threads->Next()
+		: loop;
+
+	auto *client = new Client(loop, io_loop,
+				  partition, std::move(fd), uid,
 				  permission,
 				  MakeClientName(remote_address, cred));
 
@@ -86,11 +93,25 @@ client_new(EventLoop &loop, Partition &partition,
 void
 Client::Close() noexcept
 {
+	if (background_command) {
+		if (!background_command->Cancel()) {
+			/* a worker thread is still executing a
+			   command which accesses this object;
+			   OnBackgroundCommandFinished() will
+			   resume closing it */
+			if (ThreadedSocket::IsDefined())
+				ThreadedSocket::Close();
+			return;
+		}
+
+		background_command.reset();
+	}
+
 	partition->instance.client_list->Remove(*this);
 	partition->clients.erase(partition->clients.iterator_to(*this));
 
-	if (FullyBufferedSocket::IsDefined())
-		FullyBufferedSocket::Close();
+	if (ThreadedSocket::IsDefined())
+		ThreadedSocket::Close();
 
 	FmtInfo(client_domain, "[{}] disconnected", name);
 	delete this;
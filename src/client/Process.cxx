@@ -23,7 +23,7 @@ Client::ProcessCommandList(bool list_ok,
 		char *cmd = &*i.begin();
 
 		FmtDebug(client_domain, "process command {:?}", cmd);
-		auto ret = command_process(*this, n++, cmd);
+		auto ret = command_process(*this, n++, cmd, false);
 		FmtDebug(client_domain, "command returned {}", unsigned(ret));
 		if (IsExpired())
 			return CommandResult::CLOSE;
@@ -128,7 +128,7 @@ Client::ProcessLine(char *line) noexcept
 			FmtDebug(client_domain,
 				 "[{}] process command {:?}",
 				 name, line);
-			auto ret = command_process(*this, 0, line);
+			auto ret = command_process(*this, 0, line, true);
 			FmtDebug(client_domain,
 				 "[{}] command returned {}",
 				 name, unsigned(ret));
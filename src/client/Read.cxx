@@ -9,7 +9,7 @@
 
 #include <cstring>
 
-BufferedSocket::InputResult
+ThreadedSocket::InputResult
 Client::OnSocketInput(std::span<std::byte> src) noexcept
 {
 	if (background_command)
@@ -22,7 +22,7 @@ Client::OnSocketInput(std::span<std::byte> src) noexcept
 
 	timeout_event.Schedule(client_timeout);
 
-	BufferedSocket::ConsumeInput(newline + 1 - p);
+	ThreadedSocket::ConsumeInput(newline + 1 - p);
 
 	/* skip whitespace at the end of the line */
 	char *end = StripRight(p, newline);
@@ -6,30 +6,74 @@
 
 #include <fmt/format.h>
 
+#include <cassert>
+
+#include <string.h>
+
 TagMask
 Response::GetTagMask() const noexcept
 {
 	return GetClient().tag_mask;
 }
 
+bool
+Response::IsBatchFull() const noexcept
+{
+	/* generate at most half of the output buffer at a time, so
+	   the rest of the buffer can still hold data which has not
+	   been sent yet */
+	return streaming_allowed &&
+		n_written >= client.GetOutputMaxSize() / 2;
+}
+
+CommandResult
+Response::Stream(std::unique_ptr<ResponseProducer> _producer)
+{
+	assert(!producer);
+
+	if (_producer->Produce(*this))
+		return CommandResult::OK;
+
+	/* IsBatchFull() cannot return true if streaming is not
+	   allowed */
+	assert(streaming_allowed);
+
+	producer = std::move(_producer);
+	return CommandResult::BACKGROUND;
+}
+
 bool
 Response::Write(const void *data, size_t length) noexcept
 {
+	n_written += length;
+
+	if (buffer != nullptr) {
+		/* stop collecting once the client's output buffer
+		   limit has been exceeded; Client::Write() will fail
+		   later, just like it would have without the
+		   buffer */
+		if (buffer->size() > client.GetOutputMaxSize())
+			return false;
+
+		buffer->append((const char *)data, length);
+		return true;
+	}
+
 	return client.Write(data, length);
 }
 
 bool
 Response::Write(const char *data) noexcept
 {
-	return client.Write(data);
+	return Write(data, strlen(data));
 }
 
 bool
 Response::VFmt(fmt::string_view format_str, fmt::format_args args) noexcept
 {
-	fmt::memory_buffer buffer;
-	fmt::vformat_to(std::back_inserter(buffer), format_str, args);
-	return Write(buffer.data(), buffer.size());
+	fmt::memory_buffer fmt_buffer;
+	fmt::vformat_to(std::back_inserter(fmt_buffer), format_str, args);
+	return Write(fmt_buffer.data(), fmt_buffer.size());
 }
 
 bool
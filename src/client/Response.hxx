@@ -3,12 +3,16 @@
 
 #pragma once
 
+#include "ResponseProducer.hxx"
 #include "protocol/Ack.hxx"
+#include "command/CommandResult.hxx"
 
 #include <fmt/core.h>
 
 #include <cstddef>
+#include <memory>
 #include <span>
+#include <string>
 
 class Client;
 class TagMask;
@@ -27,10 +31,41 @@ class Response {
 	 */
 	const char *command = "";
 
+	/**
+	 * If this is set, then the response is collected in this
+	 * buffer instead of being written to the client.  This
+	 * allows running a command in another thread; the caller is
+	 * responsible for passing the buffer to Client::Write() in
+	 * the main thread later.
+	 */
+	std::string *const buffer = nullptr;
+
+	/**
+	 * The number of bytes written by this object so far.
+	 */
+	std::size_t n_written = 0;
+
+	/**
+	 * May Stream() defer the rest of the response?  This is only
+	 * possible outside of command lists.
+	 */
+	bool streaming_allowed = false;
+
+	/**
+	 * The producer which shall generate the rest of the response;
+	 * see Stream().
+	 */
+	std::unique_ptr<ResponseProducer> producer;
+
 public:
 	Response(Client &_client, unsigned _list_index) noexcept
 		:client(_client), list_index(_list_index) {}
 
+	Response(Client &_client, unsigned _list_index,
+		 std::string &_buffer) noexcept
+		:client(_client), list_index(_list_index),
+		 buffer(&_buffer) {}
+
 	Response(const Response &) = delete;
 	Response &operator=(const Response &) = delete;
 
@@ -55,6 +90,36 @@ public:
 		command = _command;
 	}
 
+	void AllowStreaming() noexcept {
+		streaming_allowed = true;
+	}
+
+	/**
+	 * Has enough data been written to this response, i.e. shall a
+	 * #ResponseProducer stop and wait until the client has
+	 * consumed it?  Always returns false if streaming is not
+	 * allowed.
+	 */
+	[[gnu::pure]]
+	bool IsBatchFull() const noexcept;
+
+	/**
+	 * Generate the response with the given #ResponseProducer.
+	 * The first portion is generated right away; if that does
+	 * not complete the response, the producer is stored in this
+	 * object (see TakeProducer()) and #CommandResult::BACKGROUND
+	 * is returned.  The caller is then responsible for calling
+	 * the producer again after the client has consumed the
+	 * response.
+	 *
+	 * Throws on error.
+	 */
+	CommandResult Stream(std::unique_ptr<ResponseProducer> _producer);
+
+	std::unique_ptr<ResponseProducer> TakeProducer() noexcept {
+		return std::move(producer);
+	}
+
 	bool Write(const void *data, size_t length) noexcept;
 	bool Write(const char *data) noexcept;
 
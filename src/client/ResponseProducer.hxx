@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+class Response;
+
+/**
+ * Generates a response in portions, each time the client has
+ * consumed the previous one.  This allows sending responses which
+ * are larger than the client's output buffer, and the memory used by
+ * each client remains bounded, no matter how large the response is.
+ *
+ * Since the underlying data may be modified between two portions,
+ * implementations must remember their position in a way that
+ * survives such modifications.
+ *
+ * @see Response::Stream()
+ */
+class ResponseProducer {
+public:
+	virtual ~ResponseProducer() noexcept = default;
+
+	/**
+	 * Write the next portion of the response.  Implementations
+	 * should stop as soon as Response::IsBatchFull() returns
+	 * true.  This may be called in a worker thread if the command
+	 * is executed by the #CommandPool.
+	 *
+	 * Throws on error.
+	 *
+	 * @return true if the response is complete, false if this
+	 * method shall be called again
+	 */
+	virtual bool Produce(Response &r) = 0;
+};
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "StreamingCommand.hxx"
+#include "Client.hxx"
+#include "Response.hxx"
+#include "command/CommandError.hxx"
+
+StreamingCommand::StreamingCommand(Client &_client, const char *_command,
+				   std::unique_ptr<ResponseProducer> &&_producer) noexcept
+	:client(_client), command(_command),
+	 producer(std::move(_producer)),
+	 defer_produce(client.GetEventLoop(),
+		       BIND_THIS_METHOD(OnDeferredProduce))
+{
+}
+
+bool
+StreamingCommand::Cancel() noexcept
+{
+	defer_produce.Cancel();
+	return true;
+}
+
+void
+StreamingCommand::OnOutputDrained() noexcept
+{
+	/* we're not allowed to write to the client from inside
+	   OnOutputDrained(), so defer this */
+	defer_produce.Schedule();
+}
+
+void
+StreamingCommand::OnDeferredProduce() noexcept
+{
+	Response r(client, 0);
+	r.SetCommand(command);
+	r.AllowStreaming();
+
+	try {
+		if (!producer->Produce(r))
+			/* wait until the client has consumed this
+			   portion */
+			return;
+
+		client.WriteOK();
+	} catch (...) {
+		PrintError(r, std::current_exception());
+	}
+
+	/* delete this object */
+	client.OnBackgroundCommandFinished();
+}
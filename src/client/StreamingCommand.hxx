@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include "BackgroundCommand.hxx"
+#include "ResponseProducer.hxx"
+#include "event/DeferEvent.hxx"
+
+#include <memory>
+
+class Client;
+
+/**
+ * A #BackgroundCommand which calls a #ResponseProducer each time the
+ * client's output buffer has been drained, until the response is
+ * complete.  It runs in the main thread.
+ */
+class StreamingCommand final : public BackgroundCommand {
+	Client &client;
+
+	/**
+	 * The command name, used for error messages.
+	 */
+	const char *const command;
+
+	const std::unique_ptr<ResponseProducer> producer;
+
+	DeferEvent defer_produce;
+
+public:
+	StreamingCommand(Client &_client, const char *_command,
+			 std::unique_ptr<ResponseProducer> &&_producer) noexcept;
+
+	/* virtual methods from class BackgroundCommand */
+	bool Cancel() noexcept override;
+	void OnOutputDrained() noexcept override;
+
+private:
+	void OnDeferredProduce() noexcept;
+};
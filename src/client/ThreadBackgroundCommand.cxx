@@ -47,7 +47,7 @@ ThreadBackgroundCommand::DeferredFinish() noexcept
 	client.OnBackgroundCommandFinished();
 }
 
-void
+bool
 ThreadBackgroundCommand::Cancel() noexcept
 {
 	CancelThread();
@@ -56,4 +56,5 @@ ThreadBackgroundCommand::Cancel() noexcept
 	/* cancel the InjectEvent, just in case the Thread has
 	   meanwhile finished execution */
 	defer_finish.Cancel();
+	return true;
 }
@@ -37,7 +37,7 @@ public:
 		thread.Start();
 	}
 
-	void Cancel() noexcept final;
+	bool Cancel() noexcept final;
 
 private:
 	void _Run() noexcept;
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "Threads.hxx"
+
+#include <cassert>
+
+ClientThreads::ClientThreads(unsigned n) noexcept
+{
+	assert(n > 0);
+
+	for (unsigned i = 0; i < n; ++i)
+		threads.emplace_front();
+
+	next = threads.begin();
+}
+
+void
+ClientThreads::Start()
+{
+	for (auto &i : threads)
+		i.Start();
+}
+
+EventLoop &
+ClientThreads::Next() noexcept
+{
+	auto &loop = next->GetEventLoop();
+
+	if (++next == threads.end())
+		next = threads.begin();
+
+	return loop;
+}
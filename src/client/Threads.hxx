@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include "event/Thread.hxx"
+
+#include <forward_list>
+
+/**
+ * A set of threads which perform socket I/O for clients (see
+ * #ThreadedSocket), so the main thread only needs to execute
+ * commands.  New clients are assigned round-robin.
+ */
+class ClientThreads {
+	std::forward_list<EventThread> threads;
+
+	/**
+	 * The thread which gets the next client.
+	 */
+	std::forward_list<EventThread>::iterator next;
+
+public:
+	/**
+	 * @param n the number of threads; must be positive
+	 */
+	explicit ClientThreads(unsigned n) noexcept;
+
+	void Start();
+
+	/**
+	 * Choose the #EventLoop for a new client.
+	 */
+	EventLoop &Next() noexcept;
+};
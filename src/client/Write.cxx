@@ -9,5 +9,5 @@ bool
 Client::Write(const void *data, size_t length) noexcept
 {
 	/* if the client is going to be closed, do nothing */
-	return !IsExpired() && FullyBufferedSocket::Write(data, length);
+	return !IsExpired() && ThreadedSocket::Write(data, length);
 }
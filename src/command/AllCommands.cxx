@@ -25,11 +25,21 @@
 #include "Instance.hxx"
 #include "client/Client.hxx"
 #include "client/Response.hxx"
+#include "client/StreamingCommand.hxx"
 #include "db/Features.hxx" // for ENABLE_DATABASE
 #include "util/Tokenizer.hxx"
 #include "util/StaticVector.hxx"
 #include "util/StringAPI.hxx"
 
+#ifdef ENABLE_DATABASE
+#include "client/BackgroundCommand.hxx"
+#include "client/CommandPool.hxx"
+#include "client/ResponseProducer.hxx"
+#include "db/DatabaseLock.hxx"
+#include "event/InjectEvent.hxx"
+#include "util/ScopeExit.hxx"
+#endif
+
 #ifdef ENABLE_SQLITE
 #include "StickerCommands.hxx"
 #endif
@@ -38,6 +48,14 @@
 
 #include <cassert>
 #include <iterator>
+#include <memory>
+
+#ifdef ENABLE_DATABASE
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#endif
 
 #include <string.h>
 
@@ -246,6 +264,212 @@ command_available([[maybe_unused]] const Partition &partition,
 	return true;
 }
 
+#ifdef ENABLE_DATABASE
+
+/**
+ * May this command be executed in the #CommandPool?  This is only
+ * allowed for commands which are expensive, which only read from
+ * the database and which do not modify any other state.
+ *
+ * "searchplaylist" is not on this list because it loads songs with
+ * Database::GetSong(), which is not thread-safe.
+ */
+[[gnu::pure]]
+static bool
+command_pooled(const struct command *cmd) noexcept
+{
+	return StringIsEqual(cmd->cmd, "count") ||
+		StringIsEqual(cmd->cmd, "find") ||
+		StringIsEqual(cmd->cmd, "list") ||
+		StringIsEqual(cmd->cmd, "listall") ||
+		StringIsEqual(cmd->cmd, "listallinfo") ||
+		StringIsEqual(cmd->cmd, "search") ||
+		StringIsEqual(cmd->cmd, "searchcount");
+}
+
+/**
+ * Latency statistics of one command.  Only the main thread accesses
+ * these.
+ */
+struct CommandStats {
+	uint_least64_t n_calls = 0;
+
+	std::chrono::steady_clock::duration total_time{},
+		max_time{};
+
+	void Add(std::chrono::steady_clock::duration duration) noexcept {
+		++n_calls;
+		total_time += duration;
+		if (duration > max_time)
+			max_time = duration;
+	}
+};
+
+static CommandStats command_stats[num_commands];
+
+static void
+AddCommandStats(const struct command &cmd,
+		std::chrono::steady_clock::time_point start_time) noexcept
+{
+	command_stats[&cmd - commands].Add(std::chrono::steady_clock::now()
+					   - start_time);
+}
+
+/**
+ * Executes a command in the #CommandPool.  The response is collected
+ * in a buffer and then written to the client in the main thread.
+ * If the command streams its response (see #ResponseProducer), the
+ * job is resubmitted to the pool each time the client has consumed
+ * a portion.
+ */
+class PooledCommand final : public BackgroundCommand, CommandPool::Job {
+	Client &client;
+	CommandPool &pool;
+
+	const struct command &cmd;
+
+	const std::chrono::steady_clock::time_point start_time =
+		std::chrono::steady_clock::now();
+
+	/**
+	 * Copies of the arguments, because the client's input buffer
+	 * will be reused.
+	 */
+	const std::vector<std::string> args;
+
+	InjectEvent defer_finish;
+
+	/**
+	 * Generates the rest of the response if the command has
+	 * returned #CommandResult::BACKGROUND.
+	 */
+	std::unique_ptr<ResponseProducer> producer;
+
+	/**
+	 * The response; it is written to the client by
+	 * DeferredFinish().
+	 */
+	std::string output;
+
+	CommandResult result = CommandResult::ERROR;
+
+	/**
+	 * Are we waiting for the client to consume the previous
+	 * portion of the response?
+	 */
+	bool waiting_for_drain = false;
+
+	/**
+	 * Has Cancel() been called while the job was running?  Then
+	 * DeferredFinish() discards the response.
+	 */
+	bool cancelled = false;
+
+public:
+	PooledCommand(Client &_client, CommandPool &_pool,
+		      const struct command &_cmd, Request _args) noexcept
+		:client(_client), pool(_pool), cmd(_cmd),
+		 args(_args.begin(), _args.end()),
+		 defer_finish(client.GetEventLoop(),
+			      BIND_THIS_METHOD(DeferredFinish)) {}
+
+	void Start() noexcept {
+		pool.Push(*this);
+	}
+
+	/* virtual methods from class BackgroundCommand */
+	bool Cancel() noexcept override {
+		if (!pool.Cancel(*this)) {
+			/* a worker is executing the command; don't
+			   wait for it, let DeferredFinish() clean
+			   up */
+			cancelled = true;
+			return false;
+		}
+
+		/* cancel the InjectEvent, just in case the job has
+		   meanwhile finished execution */
+		defer_finish.Cancel();
+		return true;
+	}
+
+	void OnOutputDrained() noexcept override {
+		if (waiting_for_drain) {
+			waiting_for_drain = false;
+			pool.Push(*this);
+		}
+	}
+
+private:
+	void DeferredFinish() noexcept {
+		if (cancelled) {
+			/* delete this object; this lets the Client
+			   finish closing itself */
+			client.OnBackgroundCommandFinished();
+			return;
+		}
+
+		client.Write(output);
+		output.clear();
+
+		if (result == CommandResult::BACKGROUND) {
+			assert(producer);
+
+			/* continue in OnOutputDrained() */
+			waiting_for_drain = true;
+			return;
+		}
+
+		AddCommandStats(cmd, start_time);
+
+		if (result == CommandResult::OK)
+			client.WriteOK();
+
+		/* delete this object */
+		client.OnBackgroundCommandFinished();
+	}
+
+	CommandResult Invoke(Response &r) {
+		if (producer)
+			return producer->Produce(r)
+				? CommandResult::OK
+				: CommandResult::BACKGROUND;
+
+		StaticVector<const char *, COMMAND_ARGV_MAX> argv;
+		for (const auto &i : args)
+			argv.push_back(i.c_str());
+
+		auto _result = cmd.handler(client, Request{argv}, r);
+		if (_result == CommandResult::BACKGROUND)
+			producer = r.TakeProducer();
+		return _result;
+	}
+
+	/* virtual methods from class CommandPool::Job */
+	void Run() noexcept override {
+		/* this query may take a long time; don't let it
+		   starve the update thread */
+		const ScopeDatabaseYield yield;
+
+		Response r(client, 0, output);
+		r.SetCommand(cmd.cmd);
+		r.AllowStreaming();
+
+		try {
+			result = Invoke(r);
+		} catch (...) {
+			PrintError(r, std::current_exception());
+			result = CommandResult::ERROR;
+		}
+	}
+
+	void Finish() noexcept override {
+		defer_finish.Schedule();
+	}
+};
+
+#endif
+
 static CommandResult
 PrintAvailableCommands(Response &r, const Partition &partition,
 		     unsigned permission) noexcept
@@ -375,8 +599,39 @@ command_checked_lookup(Response &r, unsigned permission,
 	return cmd;
 }
 
+/**
+ * Invoke the command handler.  Expensive commands may be offloaded
+ * to the #CommandPool.
+ */
+static CommandResult
+command_invoke(Client &client, const struct command &cmd,
+	       Request args, Response &r,
+	       [[maybe_unused]] bool allow_background)
+{
+#ifdef ENABLE_DATABASE
+	if (!command_pooled(&cmd))
+		return cmd.handler(client, args, r);
+
+	if (allow_background) {
+		if (auto *pool = client.GetInstance().command_pool.get()) {
+			auto c = std::make_unique<PooledCommand>(client, *pool,
+								 cmd, args);
+			c->Start();
+			client.SetBackgroundCommand(std::move(c));
+			return CommandResult::BACKGROUND;
+		}
+	}
+
+	const auto start_time = std::chrono::steady_clock::now();
+	AtScopeExit(&cmd, start_time) { AddCommandStats(cmd, start_time); };
+#endif
+
+	return cmd.handler(client, args, r);
+}
+
 CommandResult
-command_process(Client &client, unsigned num, char *line) noexcept
+command_process(Client &client, unsigned num, char *line,
+		bool allow_background) noexcept
 {
 	Response r(client, num);
 
@@ -430,9 +685,40 @@ command_process(Client &client, unsigned num, char *line) noexcept
 		if (cmd == nullptr)
 			return CommandResult::ERROR;
 
-		return cmd->handler(client, args, r);
+		if (allow_background)
+			r.AllowStreaming();
+
+		const auto result = command_invoke(client, *cmd, args, r,
+						   allow_background);
+		if (result == CommandResult::BACKGROUND)
+			if (auto producer = r.TakeProducer())
+				client.SetBackgroundCommand(std::make_unique<StreamingCommand>(client, cmd->cmd, std::move(producer)));
+
+		return result;
 	} catch (...) {
 		PrintError(r, std::current_exception());
 		return CommandResult::ERROR;
 	}
 }
+
+void
+command_stats_print([[maybe_unused]] Response &r) noexcept
+{
+#ifdef ENABLE_DATABASE
+	using std::chrono::microseconds;
+	using std::chrono::duration_cast;
+
+	for (unsigned i = 0; i < num_commands; ++i) {
+		const auto &stats = command_stats[i];
+		if (stats.n_calls == 0)
+			continue;
+
+		r.Fmt("command_{0}_calls: {1}\n"
+		      "command_{0}_time_us: {2}\n"
+		      "command_{0}_max_time_us: {3}\n",
+		      commands[i].cmd, stats.n_calls,
+		      duration_cast<microseconds>(stats.total_time).count(),
+		      duration_cast<microseconds>(stats.max_time).count());
+	}
+#endif
+}
@@ -7,11 +7,26 @@
 #include "CommandResult.hxx"
 
 class Client;
+class Response;
 
 void
 command_init() noexcept;
 
+/**
+ * Parse and execute one command line.
+ *
+ * @param allow_background may the command be executed in
+ * background (i.e. return #CommandResult::BACKGROUND)?  This is not
+ * possible inside a command list
+ */
 CommandResult
-command_process(Client &client, unsigned num, char *line) noexcept;
+command_process(Client &client, unsigned num, char *line,
+		bool allow_background) noexcept;
+
+/**
+ * Print per-command statistics for the "stats" command.
+ */
+void
+command_stats_print(Response &r) noexcept;
 
 #endif
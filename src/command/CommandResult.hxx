@@ -26,7 +26,9 @@ enum class CommandResult {
 	IDLE,
 
 	/**
-	 * A #BackgroundCommand has been installed.
+	 * A #BackgroundCommand has been installed (or will be
+	 * installed by the caller for a #ResponseProducer, see
+	 * Response::Stream()).
 	 */
 	BACKGROUND,
 
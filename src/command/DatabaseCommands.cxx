@@ -142,9 +142,18 @@ handle_match(Client &client, Request args, Response &r, bool fold_case)
 	SongFilter filter;
 	const auto selection = ParseDatabaseSelection(args, fold_case, filter);
 
-	db_selection_print(r, client.GetPartition(),
-			   selection, true, false);
-	return CommandResult::OK;
+	if (selection.sort != TAG_NUM_OF_ITEM_TYPES ||
+	    !selection.window.IsAll()) {
+		/* streaming would restart the query (and sort the
+		   whole result again) for each portion; sorted and
+		   windowed results are usually small anyway */
+		db_selection_print(r, client.GetPartition(),
+				   selection, true, false);
+		return CommandResult::OK;
+	}
+
+	return db_selection_stream(r, selection, std::move(filter),
+				   true, false);
 }
 
 CommandResult
@@ -268,15 +277,13 @@ handle_searchcount(Client &client, Request args, Response &r)
 }
 
 CommandResult
-handle_listall(Client &client, Request args, Response &r)
+handle_listall([[maybe_unused]] Client &client, Request args, Response &r)
 {
 	/* default is root directory */
 	const auto uri = args.GetOptional(0, "");
 
-	db_selection_print(r, client.GetPartition(),
-			   DatabaseSelection(uri, true),
-			   false, false);
-	return CommandResult::OK;
+	return db_selection_stream(r, DatabaseSelection(uri, true), {},
+				   false, false);
 }
 
 static CommandResult
@@ -387,13 +394,11 @@ handle_list(Client &client, Request args, Response &r)
 }
 
 CommandResult
-handle_listallinfo(Client &client, Request args, Response &r)
+handle_listallinfo([[maybe_unused]] Client &client, Request args, Response &r)
 {
 	/* default is root directory */
 	const auto uri = args.GetOptional(0, "");
 
-	db_selection_print(r, client.GetPartition(),
-			   DatabaseSelection(uri, true),
-			   true, false);
-	return CommandResult::OK;
+	return db_selection_stream(r, DatabaseSelection(uri, true), {},
+				   true, false);
 }
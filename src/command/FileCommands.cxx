@@ -5,6 +5,8 @@
 #include "Request.hxx"
 #include "protocol/Ack.hxx"
 #include "client/Client.hxx"
+#include "Instance.hxx"
+#include "PictureCache.hxx"
 #include "client/Response.hxx"
 #include "util/CharUtil.hxx"
 #include "util/OffsetPointer.hxx"
@@ -127,8 +129,14 @@ handle_read_comments(Client &client, Request args, Response &r)
 	return CommandResult::OK;
 }
 
+static constexpr auto art_names = std::array {
+	"cover.png",
+	"cover.jpg",
+	"cover.webp",
+};
+
 /**
- * Searches for the files listed in #artnames in the UTF8 folder
+ * Searches for the files listed in #art_names in the UTF8 folder
  * URI #directory. This can be a local path or protocol-based
  * URI that #InputStream supports. Returns the first successfully
  * opened file or #nullptr on failure.
@@ -136,12 +144,6 @@ handle_read_comments(Client &client, Request args, Response &r)
 static InputStreamPtr
 find_stream_art(std::string_view directory, Mutex &mutex)
 {
-	static constexpr auto art_names = std::array {
-		"cover.png",
-		"cover.jpg",
-		"cover.webp",
-	};
-
 	for(const auto name : art_names) {
 		std::string art_file = PathTraitsUTF8::Build(directory, name);
 
@@ -156,6 +158,88 @@ find_stream_art(std::string_view directory, Mutex &mutex)
 	return nullptr;
 }
 
+/**
+ * Load the whole file into a #CachedPicture.
+ *
+ * Throws on error.
+ */
+static std::shared_ptr<const CachedPicture>
+LoadArtFile(const char *uri, std::size_t size)
+{
+	Mutex mutex;
+	auto is = InputStream::OpenReady(uri, mutex);
+
+	auto picture = std::make_shared<CachedPicture>();
+	if (const char *mime_type = is->GetMimeType())
+		picture->mime_type = mime_type;
+
+	picture->data.ResizeDiscard(size);
+	is->LockReadFull(picture->data);
+	return picture;
+}
+
+/**
+ * Look up the cover file in the #PictureCache; load it into the
+ * cache if it is not there yet.  This is only possible for local
+ * files, because only those have a cheap modification time.
+ *
+ * Throws on error.
+ *
+ * @return the picture or nullptr if the file is not eligible for
+ * caching (e.g. remote or too large)
+ */
+static std::shared_ptr<const CachedPicture>
+GetCachedStreamArt(PictureCache &cache, std::string_view directory)
+{
+	if (!PathTraitsUTF8::IsAbsolute(directory))
+		return nullptr;
+
+	for (const auto name : art_names) {
+		std::string art_file = PathTraitsUTF8::Build(directory, name);
+
+		FileInfo fi;
+		if (!GetFileInfo(AllocatedPath::FromUTF8(art_file), fi) ||
+		    !fi.IsRegular())
+			continue;
+
+		if (fi.GetSize() > cache.GetMaxItemSize())
+			return nullptr;
+
+		return cache.Get({art_file, fi.GetModificationTime()}, [&]{
+			return LoadArtFile(art_file.c_str(), fi.GetSize());
+		});
+	}
+
+	return nullptr;
+}
+
+/**
+ * Send a chunk of the given picture to the client.
+ *
+ * @return false if the offset is too large
+ */
+static bool
+PrintPicture(Response &r, const char *mime_type,
+	     std::span<const std::byte> buffer, size_t offset) noexcept
+{
+	if (offset > buffer.size())
+		return false;
+
+	r.Fmt("size: {}\n", buffer.size());
+
+	if (mime_type != nullptr)
+		r.Fmt("type: {}\n", mime_type);
+
+	buffer = buffer.subspan(offset);
+
+	const std::size_t binary_limit = r.GetClient().binary_limit;
+	if (buffer.size() > binary_limit)
+		buffer = buffer.first(binary_limit);
+
+	r.WriteBinary(buffer);
+	return true;
+}
+
 static CommandResult
 read_stream_art(Response &r, const std::string_view art_directory,
 		size_t offset)
@@ -163,6 +247,17 @@ read_stream_art(Response &r, const std::string_view art_directory,
 	// TODO: eliminate this const_cast
 	auto &client = const_cast<Client &>(r.GetClient());
 
+	if (auto *cache = client.GetInstance().picture_cache.get()) {
+		if (const auto picture = GetCachedStreamArt(*cache, art_directory)) {
+			if (!PrintPicture(r, nullptr, picture->data, offset)) {
+				r.Error(ACK_ERROR_ARG, "Offset too large");
+				return CommandResult::ERROR;
+			}
+
+			return CommandResult::OK;
+		}
+	}
+
 	/* to avoid repeating the search for each chunk request by the
 	   same client, use the #LastInputStream class to cache the
 	   #InputStream instance */
@@ -337,26 +432,68 @@ public:
 
 		found = true;
 
-		if (offset > buffer.size()) {
+		if (!PrintPicture(response, mime_type, buffer, offset))
 			bad_offset = true;
-			return;
-		}
+	}
+};
 
-		    response.Fmt("size: {}\n", buffer.size());
+/**
+ * A #TagHandler which copies the first picture into a
+ * #CachedPicture.
+ */
+class CopyPictureHandler final : public NullTagHandler {
+	std::shared_ptr<CachedPicture> picture;
 
-		if (mime_type != nullptr)
-			response.Fmt("type: {}\n", mime_type);
+public:
+	CopyPictureHandler() noexcept
+		:NullTagHandler(WANT_PICTURE) {}
 
-		buffer = buffer.subspan(offset);
+	std::shared_ptr<const CachedPicture> GetPicture() && noexcept {
+		return std::move(picture);
+	}
 
-		const std::size_t binary_limit = response.GetClient().binary_limit;
-		if (buffer.size() > binary_limit)
-			buffer = buffer.first(binary_limit);
+	void OnPicture(const char *mime_type,
+		       std::span<const std::byte> buffer) noexcept override {
+		if (picture)
+			/* only use the first picture */
+			return;
 
-		response.WriteBinary(buffer);
+		picture = std::make_shared<CachedPicture>();
+		if (mime_type != nullptr)
+			picture->mime_type = mime_type;
+		picture->data = buffer;
 	}
 };
 
+/**
+ * Implementation of "readpicture" using the #PictureCache.
+ *
+ * @return false if the song is not eligible for caching (because
+ * its modification time is unknown)
+ */
+static bool
+ReadCachedPicture(Client &client, PictureCache &cache,
+		  const char *uri, size_t offset, Response &r)
+{
+	const auto mtime = GetSongModificationTime(client, uri);
+	if (mtime == std::chrono::system_clock::time_point::min())
+		return false;
+
+	const auto picture = cache.Get({uri, mtime}, [&]{
+		CopyPictureHandler handler;
+		TagScanAny(client, uri, handler);
+		return std::move(handler).GetPicture();
+	});
+
+	if (picture &&
+	    !PrintPicture(r,
+			  picture->mime_type.empty() ? nullptr : picture->mime_type.c_str(),
+			  picture->data, offset))
+		throw ProtocolError(ACK_ERROR_ARG, "Bad file offset");
+
+	return true;
+}
+
 CommandResult
 handle_read_picture(Client &client, Request args, Response &r)
 {
@@ -365,6 +502,11 @@ handle_read_picture(Client &client, Request args, Response &r)
 	const char *const uri = args.front();
 	const size_t offset = args.ParseUnsigned(1);
 
+	if (auto *cache = client.GetInstance().picture_cache.get();
+	    cache != nullptr &&
+	    ReadCachedPicture(client, *cache, uri, offset, r))
+		return CommandResult::OK;
+
 	PrintPictureHandler handler(r, offset);
 	TagScanAny(client, uri, handler);
 	handler.RethrowError();
@@ -253,20 +253,18 @@ handle_playlistinfo(Client &client, Request args, Response &r)
 {
 	RangeArg range = args.ParseOptional(0, RangeArg::All());
 
-	playlist_print_info(r, client.GetPlaylist(), range);
-	return CommandResult::OK;
+	return playlist_stream_info(r, client.GetPlaylist(), range);
 }
 
 CommandResult
 handle_playlistid(Client &client, Request args, Response &r)
 {
-	if (!args.empty()) {
-		unsigned id = args.ParseUnsigned(0);
-		playlist_print_id(r, client.GetPlaylist(), id);
-	} else {
-		playlist_print_info(r, client.GetPlaylist(), RangeArg::All());
-	}
+	if (args.empty())
+		return playlist_stream_info(r, client.GetPlaylist(),
+					    RangeArg::All());
 
+	unsigned id = args.ParseUnsigned(0);
+	playlist_print_id(r, client.GetPlaylist(), id);
 	return CommandResult::OK;
 }
 
@@ -344,7 +344,7 @@ private:
 	std::string ValidateUri(const char *uri) override {
 		PlaylistVector playlists = ListPlaylistFiles();
 
-		const ScopeDatabaseLock protect;
+		const ScopeDatabaseReadLock protect;
 		if (!playlists.exists(uri))
 			throw std::invalid_argument(fmt::format("no such playlist: {:?}", uri));
 
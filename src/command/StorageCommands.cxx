@@ -8,6 +8,8 @@
 #include "fs/Traits.hxx"
 #include "client/Client.hxx"
 #include "client/Response.hxx"
+#include "client/BackgroundCommand.hxx"
+#include "client/CommandPool.hxx"
 #include "Instance.hxx"
 #include "storage/Registry.hxx"
 #include "storage/CompositeStorage.hxx"
@@ -17,6 +19,7 @@
 #include "db/update/Service.hxx"
 #include "TimePrint.hxx"
 #include "protocol/IdleFlags.hxx"
+#include "util/ScopeExit.hxx"
 
 #include <fmt/format.h>
 
@@ -199,6 +202,7 @@ handle_mount(Client &client, Request args, Response &r)
 
 		// TODO: call Instance::OnDatabaseModified()?
 		// TODO: trigger database update?
+		instance.InvalidateQueryCaches();
 		instance.EmitIdle(IDLE_DATABASE);
 
 		if (need_update) {
@@ -212,25 +216,15 @@ handle_mount(Client &client, Request args, Response &r)
 	return CommandResult::OK;
 }
 
-CommandResult
-handle_unmount(Client &client, Request args, Response &r)
+/**
+ * The second half of handle_unmount().  If there is a
+ * #CommandPool, it must be suspended, because a command running in a
+ * worker thread may be visiting the mounted database.
+ */
+static CommandResult
+Unmount(Instance &instance, const char *local_uri, Response &r) noexcept
 {
-	auto &instance = client.GetInstance();
-
-	Storage *_composite = instance.storage;
-	if (_composite == nullptr) {
-		r.Error(ACK_ERROR_NO_EXIST, "No database");
-		return CommandResult::ERROR;
-	}
-
-	CompositeStorage &composite = *(CompositeStorage *)_composite;
-
-	const char *const local_uri = args.front();
-
-	if (*local_uri == 0) {
-		r.Error(ACK_ERROR_ARG, "Bad mount point");
-		return CommandResult::ERROR;
-	}
+	CompositeStorage &composite = *(CompositeStorage *)instance.storage;
 
 #ifdef ENABLE_DATABASE
 	if (instance.update != nullptr)
@@ -240,9 +234,11 @@ handle_unmount(Client &client, Request args, Response &r)
 		instance.update->CancelMount(local_uri);
 
 	if (auto *db = dynamic_cast<SimpleDatabase *>(instance.GetDatabase())) {
-		if (db->Unmount(local_uri))
+		if (db->Unmount(local_uri)) {
 			// TODO: call Instance::OnDatabaseModified()?
+			instance.InvalidateQueryCaches();
 			instance.EmitIdle(IDLE_DATABASE);
+		}
 	}
 #endif
 
@@ -256,6 +252,87 @@ handle_unmount(Client &client, Request args, Response &r)
 	return CommandResult::OK;
 }
 
+#ifdef ENABLE_DATABASE
+
+/**
+ * Waits until the #CommandPool is idle, and then performs the
+ * "unmount" command.  This avoids blocking the main loop while a
+ * worker thread finishes a long-running query.
+ */
+class UnmountCommand final
+	: public BackgroundCommand, public CommandPool::SuspendHandler
+{
+	Client &client;
+	CommandPool &pool;
+
+	const std::string local_uri;
+
+public:
+	UnmountCommand(Client &_client, CommandPool &_pool,
+		       const char *_local_uri) noexcept
+		:client(_client), pool(_pool), local_uri(_local_uri) {}
+
+	/* virtual methods from class BackgroundCommand */
+	bool Cancel() noexcept override {
+		pool.CancelSuspend(*this);
+		return true;
+	}
+
+private:
+	/* virtual methods from class CommandPool::SuspendHandler */
+	void OnCommandPoolSuspended() noexcept override {
+		Response r(client, 0);
+		r.SetCommand("unmount");
+
+		if (Unmount(client.GetInstance(), local_uri.c_str(),
+			    r) == CommandResult::OK)
+			client.WriteOK();
+
+		pool.Resume();
+
+		/* delete this object */
+		client.OnBackgroundCommandFinished();
+	}
+};
+
+#endif
+
+CommandResult
+handle_unmount(Client &client, Request args, Response &r)
+{
+	auto &instance = client.GetInstance();
+
+	if (instance.storage == nullptr) {
+		r.Error(ACK_ERROR_NO_EXIST, "No database");
+		return CommandResult::ERROR;
+	}
+
+	const char *const local_uri = args.front();
+
+	if (*local_uri == 0) {
+		r.Error(ACK_ERROR_ARG, "Bad mount point");
+		return CommandResult::ERROR;
+	}
+
+#ifdef ENABLE_DATABASE
+	if (auto *pool = instance.command_pool.get()) {
+		auto c = std::make_unique<UnmountCommand>(client, *pool,
+							  local_uri);
+		if (!pool->Suspend(*c)) {
+			/* wait for the running commands in the
+			   background */
+			client.SetBackgroundCommand(std::move(c));
+			return CommandResult::BACKGROUND;
+		}
+
+		AtScopeExit(pool) { pool->Resume(); };
+		return Unmount(instance, local_uri, r);
+	}
+#endif
+
+	return Unmount(instance, local_uri, r);
+}
+
 bool
 mount_commands_available(Instance &instance) noexcept
 {
@@ -42,6 +42,8 @@ enum class ConfigOption {
 	VOLUME_NORMALIZATION,
 	SAMPLERATE_CONVERTER,
 	AUDIO_BUFFER_SIZE,
+	AUDIO_CHUNK_SIZE,
+	DECODE_AHEAD,
 	BUFFER_BEFORE_PLAY,
 	HTTP_PROXY_HOST,
 	HTTP_PROXY_PORT,
@@ -59,6 +61,9 @@ enum class ConfigOption {
 	GAPLESS_MP3_PLAYBACK,
 	AUTO_UPDATE,
 	AUTO_UPDATE_DEPTH,
+	UPDATE_THREADS,
+	COMMAND_THREADS,
+	CLIENT_THREADS,
 
 	MIXRAMP_ANALYZER,
 
@@ -70,6 +75,7 @@ enum class ConfigBlockOption {
 	DECODER,
 	INPUT,
 	INPUT_CACHE,
+	PICTURE_CACHE,
 	ARCHIVE_PLUGIN,
 	PLAYLIST_PLUGIN,
 	RESAMPLER,
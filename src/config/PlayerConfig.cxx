@@ -10,16 +10,31 @@
 #include "Log.hxx"
 #include "MusicChunk.hxx"
 
-static constexpr
-size_t MIN_BUFFER_SIZE = std::max(CHUNK_SIZE * 32,
-				  64 * KILOBYTE);
+static size_t
+GetChunkSize(const ConfigData &config)
+{
+	return config.With(ConfigOption::AUDIO_CHUNK_SIZE, [](const char *s){
+		if (s == nullptr)
+			return DEFAULT_CHUNK_SIZE;
+
+		size_t result = ParseSize(s, KILOBYTE);
+		if (result < MIN_CHUNK_SIZE || result > MAX_CHUNK_SIZE)
+			throw FmtRuntimeError("chunk size {:?} must be between {} and {} bytes",
+					      s, MIN_CHUNK_SIZE, MAX_CHUNK_SIZE);
+
+		return result;
+	});
+}
 
 static unsigned
-GetBufferChunks(const ConfigData &config)
+GetBufferChunks(const ConfigData &config, size_t chunk_size)
 {
+	const size_t MIN_BUFFER_SIZE = std::max(chunk_size * 32,
+						64 * KILOBYTE);
+
 	size_t buffer_size = PlayerConfig::DEFAULT_BUFFER_SIZE;
 	if (auto *param = config.GetParam(ConfigOption::AUDIO_BUFFER_SIZE)) {
-		buffer_size = param->With([](const char *s){
+		buffer_size = param->With([MIN_BUFFER_SIZE](const char *s){
 			size_t result = ParseSize(s, KILOBYTE);
 			if (result <= 0)
 				throw FmtRuntimeError("buffer size {:?} is not a "
@@ -35,7 +50,7 @@ GetBufferChunks(const ConfigData &config)
 		});
 	}
 
-	unsigned buffer_chunks = buffer_size / CHUNK_SIZE;
+	unsigned buffer_chunks = buffer_size / chunk_size;
 	if (buffer_chunks >= 1 << 15)
 		throw FmtRuntimeError("buffer size {:?} is too big",
 				      buffer_size);
@@ -44,7 +59,8 @@ GetBufferChunks(const ConfigData &config)
 }
 
 PlayerConfig::PlayerConfig(const ConfigData &config)
-	:buffer_chunks(GetBufferChunks(config)),
+	:chunk_size(GetChunkSize(config)),
+	 buffer_chunks(GetBufferChunks(config, chunk_size)),
 	 audio_format(config.With(ConfigOption::AUDIO_OUTPUT_FORMAT, [](const char *s){
 		 if (s == nullptr)
 			 return AudioFormat::Undefined();
@@ -52,6 +68,7 @@ PlayerConfig::PlayerConfig(const ConfigData &config)
 		 return ParseAudioFormat(s, true);
 	 })),
 	 replay_gain(config),
-	 mixramp_analyzer(config.GetBool(ConfigOption::MIXRAMP_ANALYZER, false))
+	 mixramp_analyzer(config.GetBool(ConfigOption::MIXRAMP_ANALYZER, false)),
+	 decode_ahead(config.GetBool(ConfigOption::DECODE_AHEAD, false))
 {
 }
@@ -5,6 +5,7 @@
 
 #include "pcm/AudioFormat.hxx"
 #include "ReplayGainConfig.hxx"
+#include "MusicChunk.hxx"
 
 struct ConfigData;
 
@@ -14,6 +15,12 @@ static constexpr size_t MEGABYTE = 1024 * KILOBYTE;
 struct PlayerConfig {
 	static constexpr size_t DEFAULT_BUFFER_SIZE = 8 * MEGABYTE;
 
+	/**
+	 * The "audio_chunk_size" setting: the size of each
+	 * #MusicChunk in bytes.
+	 */
+	std::size_t chunk_size = DEFAULT_CHUNK_SIZE;
+
 	unsigned buffer_chunks = DEFAULT_BUFFER_SIZE;
 
 	/**
@@ -25,6 +32,13 @@ struct PlayerConfig {
 
 	bool mixramp_analyzer = false;
 
+	/**
+	 * The "decode_ahead" setting: decode the next song in a
+	 * second decoder thread while the current one is still being
+	 * decoded.
+	 */
+	bool decode_ahead = false;
+
 	PlayerConfig() = default;
 
 	explicit PlayerConfig(const ConfigData &config);
@@ -40,6 +40,8 @@ const ConfigTemplate config_param_templates[] = {
 	{ "volume_normalization" },
 	{ "samplerate_converter" },
 	{ "audio_buffer_size" },
+	{ "audio_chunk_size" },
+	{ "decode_ahead" },
 	{ "buffer_before_play", false, true },
 	{ "http_proxy_host", false, true },
 	{ "http_proxy_port", false, true },
@@ -57,6 +59,9 @@ const ConfigTemplate config_param_templates[] = {
 	{ "gapless_mp3_playback", false, true },
 	{ "auto_update" },
 	{ "auto_update_depth" },
+	{ "update_threads" },
+	{ "command_threads" },
+	{ "client_threads" },
 	{ "mixramp_analyzer" },
 };
 
@@ -71,6 +76,7 @@ const ConfigTemplate config_block_templates[] = {
 	{ "decoder", true },
 	{ "input", true },
 	{ "input_cache" },
+	{ "picture_cache" },
 	{ "archive_plugin", true },
 	{ "playlist_plugin", true },
 	{ "resampler" },
@@ -2,10 +2,13 @@
 // Copyright The Music Player Daemon Project
 
 #include "Count.hxx"
+#include "QueryCache.hxx"
 #include "Selection.hxx"
 #include "Interface.hxx"
 #include "Partition.hxx"
+#include "Instance.hxx"
 #include "client/Response.hxx"
+#include "song/Filter.hxx"
 #include "song/LightSong.hxx"
 #include "tag/Tag.hxx"
 #include "tag/VisitFallback.hxx"
@@ -27,6 +30,21 @@ struct SearchStats {
 class TagCountMap : public std::map<std::string, SearchStats, std::less<>> {
 };
 
+/**
+ * Estimate the memory used by a #TagCountMap (for the
+ * #DatabaseQueryCache budget).
+ */
+[[gnu::pure]]
+static std::size_t
+GetMemorySize(const TagCountMap &map) noexcept
+{
+	std::size_t size = sizeof(map);
+	for (const auto &[key, stats] : map)
+		size += EstimateMapNodeSize<TagCountMap>() +
+			EstimateStringHeapSize(key);
+	return size;
+}
+
 static void
 PrintSearchStats(Response &r, const SearchStats &stats) noexcept
 {
@@ -101,13 +119,22 @@ PrintSongCount(Response &r, const Partition &partition, const char *name,
 		/* group by the specified tag: store counts in a
 		   std::map */
 
-		TagCountMap map;
+		const auto collect = [&]{
+			TagCountMap map;
 
-		const auto f = [&map,group](const auto &song)
-			{ return GroupCountVisitor(map, group, song); };
+			const auto f = [&map,group](const auto &song)
+				{ return GroupCountVisitor(map, group, song); };
 
-		db.Visit(selection, f);
+			db.Visit(selection, f);
+			return map;
+		};
 
-		Print(r, group, map);
+		if (*name == 0 && (filter == nullptr || filter->IsEmpty())) {
+			/* counts of the whole database are cached */
+			auto &cache = partition.instance.count_group_cache;
+			Print(r, group, *cache.Get(group, collect,
+						   GetMemorySize));
+		} else
+			Print(r, group, collect());
 	}
 }
@@ -3,8 +3,11 @@
 
 #include "DatabaseLock.hxx"
 
-Mutex db_mutex;
+SharedMutex db_mutex;
+unsigned db_generation;
+thread_local bool db_mutex_yield = false;
 
 #ifndef NDEBUG
 ThreadId db_mutex_holder;
+thread_local bool db_mutex_shared = false;
 #endif
@@ -5,29 +5,80 @@
  *
  * Support for locking data structures from the database, for safe
  * multi-threading.
+ *
+ * The lock is a reader/writer lock: code which only reads the
+ * database (e.g. database queries from clients) obtains a shared
+ * lock with #ScopeDatabaseReadLock, which allows many readers to
+ * traverse the tree concurrently.  Code which modifies the tree
+ * (e.g. the update thread) obtains an exclusive lock with
+ * #ScopeDatabaseLock and should hold it only for short periods of
+ * time, never while doing I/O.
+ *
+ * While the update thread waits for the exclusive lock, threads
+ * which run long queries (see #ScopeDatabaseYield) cannot obtain new
+ * shared locks, so they cannot starve the updater.  All other
+ * threads (e.g. the main thread) only wait while the updater
+ * actually holds the lock, which is always brief; they are never
+ * held up by a long query which the updater is waiting for.  Shared
+ * locks must never be nested.
  */
 
 #ifndef MPD_DB_LOCK_HXX
 #define MPD_DB_LOCK_HXX
 
-#include "thread/Mutex.hxx"
+#include "thread/SharedMutex.hxx"
 
 #include <cassert>
 
-extern Mutex db_mutex;
+extern SharedMutex db_mutex;
+
+/**
+ * Incremented each time the exclusive lock is released, i.e. after
+ * each (potential) modification of the database.  This allows
+ * detecting whether cached data derived from the database is stale.
+ * Protected by #db_mutex.
+ */
+extern unsigned db_generation;
+
+/**
+ * Shall shared locks obtained by the current thread yield to a
+ * writer which is waiting for the exclusive lock?  See
+ * #ScopeDatabaseYield.
+ */
+extern thread_local bool db_mutex_yield;
 
 #ifndef NDEBUG
 
 #include "thread/Id.hxx"
 
+/**
+ * The thread which holds the exclusive lock.
+ */
 extern ThreadId db_mutex_holder;
 
 /**
- * Does the current thread hold the database lock?
+ * Does the current thread hold a shared lock?
+ */
+extern thread_local bool db_mutex_shared;
+
+/**
+ * Does the current thread hold the database lock (shared or
+ * exclusive)?
  */
 [[gnu::pure]]
 static inline bool
 holding_db_lock() noexcept
+{
+	return db_mutex_shared || db_mutex_holder.IsInside();
+}
+
+/**
+ * Does the current thread hold the exclusive database lock, i.e. is
+ * it allowed to modify the database?
+ */
+[[gnu::pure]]
+static inline bool
+holding_db_write_lock() noexcept
 {
 	return db_mutex_holder.IsInside();
 }
@@ -35,8 +86,8 @@ holding_db_lock() noexcept
 #endif
 
 /**
- * Obtain the global database lock.  This is needed before
- * dereferencing a #song or #directory.  It is not recursive.
+ * Obtain the global database lock exclusively.  This is needed
+ * before modifying a #song or #directory.  It is not recursive.
  */
 static inline void
 db_lock(void)
@@ -57,14 +108,49 @@ db_lock(void)
 static inline void
 db_unlock(void)
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 #ifndef NDEBUG
 	db_mutex_holder = ThreadId::Null();
 #endif
 
+	++db_generation;
+
 	db_mutex.unlock();
 }
 
+/**
+ * Obtain a shared database lock.  This is needed before
+ * dereferencing a #song or #directory.  It is not recursive.
+ */
+static inline void
+db_lock_shared() noexcept
+{
+	assert(!holding_db_lock());
+
+	if (db_mutex_yield)
+		db_mutex.lock_shared();
+	else
+		db_mutex.lock_shared_eager();
+
+#ifndef NDEBUG
+	db_mutex_shared = true;
+#endif
+}
+
+/**
+ * Release a shared database lock.
+ */
+static inline void
+db_unlock_shared() noexcept
+{
+	assert(db_mutex_shared);
+#ifndef NDEBUG
+	db_mutex_shared = false;
+#endif
+
+	db_mutex.unlock_shared();
+}
+
 class ScopeDatabaseLock {
 	bool locked = true;
 
@@ -89,6 +175,58 @@ public:
 	}
 };
 
+/**
+ * Obtain a shared database lock in the current scope.  Use this for
+ * code which does not modify the database.
+ */
+class ScopeDatabaseReadLock {
+	bool locked = true;
+
+public:
+	ScopeDatabaseReadLock() noexcept {
+		db_lock_shared();
+	}
+
+	~ScopeDatabaseReadLock() noexcept {
+		if (locked)
+			db_unlock_shared();
+	}
+
+	/**
+	 * Unlock the mutex now, making the destructor a no-op.
+	 */
+	void unlock() noexcept {
+		assert(locked);
+
+		db_unlock_shared();
+		locked = false;
+	}
+};
+
+/**
+ * Let shared locks obtained by the current thread in this scope
+ * yield to a waiting writer (i.e. the update thread).  This is used
+ * by threads which may run long queries; without it, back-to-back
+ * queries could starve the updater.
+ */
+class ScopeDatabaseYield {
+	const bool old_value;
+
+public:
+	ScopeDatabaseYield() noexcept
+		:old_value(db_mutex_yield)
+	{
+		db_mutex_yield = true;
+	}
+
+	~ScopeDatabaseYield() noexcept {
+		db_mutex_yield = old_value;
+	}
+
+	ScopeDatabaseYield(const ScopeDatabaseYield &) = delete;
+	ScopeDatabaseYield &operator=(const ScopeDatabaseYield &) = delete;
+};
+
 /**
  * Unlock the database while in the current scope.
  */
@@ -103,4 +241,18 @@ public:
 	}
 };
 
+/**
+ * Release the shared database lock while in the current scope.
+ */
+class ScopeDatabaseReadUnlock {
+public:
+	ScopeDatabaseReadUnlock() noexcept {
+		db_unlock_shared();
+	}
+
+	~ScopeDatabaseReadUnlock() noexcept {
+		db_lock_shared();
+	}
+};
+
 #endif
@@ -2,11 +2,15 @@
 // Copyright The Music Player Daemon Project
 
 #include "DatabasePrint.hxx"
+#include "QueryCache.hxx"
 #include "Selection.hxx"
 #include "SongPrint.hxx"
 #include "TimePrint.hxx"
+#include "client/Client.hxx"
 #include "client/Response.hxx"
+#include "client/ResponseProducer.hxx"
 #include "Partition.hxx"
+#include "Instance.hxx"
 #include "song/LightSong.hxx"
 #include "tag/Names.hxx"
 #include "tag/Tag.hxx"
@@ -16,10 +20,14 @@
 #include "fs/Traits.hxx"
 #include "time/ChronoUtil.hxx"
 #include "util/RecursiveMap.hxx"
+#include "song/Filter.hxx"
 
 #include <fmt/format.h>
 
+#include <cassert>
 #include <functional>
+#include <memory>
+#include <vector>
 
 [[gnu::pure]]
 static const char *
@@ -126,33 +134,182 @@ PrintPlaylistFull(Response &r, bool base,
 		time_print(r, "Last-Modified", playlist.mtime);
 }
 
-void
-db_selection_print(Response &r, Partition &partition,
-		   const DatabaseSelection &selection,
-		   bool full, bool base)
+namespace {
+
+/**
+ * Thrown by the visitor to stop the database walk after a portion of
+ * the response has been printed.
+ */
+struct StopPrint {};
+
+/**
+ * Counts the items passed to the visitor, to be able to skip the
+ * ones which have already been printed by a previous call.
+ */
+class PrintCursor {
+	const Response &r;
+
+	/**
+	 * The number of items to skip.
+	 */
+	const unsigned skip;
+
+	/**
+	 * Stop after Response::IsBatchFull() returns true?
+	 */
+	const bool stream;
+
+	unsigned position = 0;
+
+public:
+	PrintCursor(const Response &_r, unsigned _skip, bool _stream) noexcept
+		:r(_r), skip(_skip), stream(_stream) {}
+
+	unsigned GetPosition() const noexcept {
+		return position;
+	}
+
+	/**
+	 * Shall the current item be printed?  Call this before
+	 * printing it.
+	 */
+	bool Begin() noexcept {
+		return position++ >= skip;
+	}
+
+	/**
+	 * Call this after an item has been printed.
+	 */
+	void End() const {
+		if (stream && r.IsBatchFull())
+			throw StopPrint{};
+	}
+
+	auto Wrap(auto f) noexcept {
+		return [this, f](const auto &...args){
+			if (Begin()) {
+				f(args...);
+				End();
+			}
+		};
+	}
+};
+
+} // anonymous namespace
+
+/**
+ * @param skip the number of items which have already been printed;
+ * on return, the number of items printed so far (only if the
+ * response is incomplete)
+ * @param stream stop when the response has reached
+ * Response::IsBatchFull()?
+ * @return true if the response is complete
+ */
+static bool
+PrintSelection(Response &r, const Database &db,
+	       const DatabaseSelection &selection,
+	       bool full, bool base,
+	       unsigned &skip, bool stream)
 {
-	const Database &db = partition.GetDatabaseOrThrow();
+	PrintCursor cursor{r, skip, stream};
 
 	const auto d = selection.filter == nullptr
-		? [&,base](const auto &dir)
+		? cursor.Wrap([&r,full,base](const LightDirectory &dir)
 			{ return full ?
 				PrintDirectoryFull(r, base, dir) :
-				PrintDirectoryBrief(r, base, dir); }
+				PrintDirectoryBrief(r, base, dir); })
 		: VisitDirectory();
 
-	VisitSong s = [&,base](const auto &song)
+	VisitSong s = cursor.Wrap([&r,full,base](const LightSong &song)
 		{ return full ?
 			PrintSongFull(r, base, song) :
-			PrintSongBrief(r, base, song); };
+			PrintSongBrief(r, base, song); });
 
 	const auto p = selection.filter == nullptr
-		? [&,base](const auto &playlist, const auto &dir)
+		? cursor.Wrap([&r,full,base](const PlaylistInfo &playlist,
+					     const LightDirectory &dir)
 			{ return full ?
 				PrintPlaylistFull(r, base, playlist, dir) :
-				PrintPlaylistBrief(r, base, playlist, dir); }
+				PrintPlaylistBrief(r, base, playlist, dir); })
 		: VisitPlaylist();
 
-	db.Visit(selection, d, s, p);
+	try {
+		db.Visit(selection, d, s, p);
+	} catch (const StopPrint &) {
+		skip = cursor.GetPosition();
+		return false;
+	}
+
+	return true;
+}
+
+void
+db_selection_print(Response &r, Partition &partition,
+		   const DatabaseSelection &selection,
+		   bool full, bool base)
+{
+	const Database &db = partition.GetDatabaseOrThrow();
+
+	unsigned skip = 0;
+	PrintSelection(r, db, selection, full, base, skip, false);
+}
+
+namespace {
+
+/**
+ * Prints the result of a database selection in portions.  Between
+ * two portions, the database lock is released and the walk starts
+ * over, skipping the items which have already been printed.  This
+ * is cheap compared to formatting them, and the portions are large.
+ * If the database gets modified meanwhile, some items may be
+ * duplicated or missing, but the response remains well-formed.
+ */
+class DatabasePrintProducer final : public ResponseProducer {
+	SongFilter filter;
+
+	DatabaseSelection selection;
+
+	const bool full, base;
+
+	/**
+	 * The number of items which have already been printed.
+	 */
+	unsigned position = 0;
+
+public:
+	DatabasePrintProducer(const DatabaseSelection &_selection,
+			      SongFilter &&_filter,
+			      bool _full, bool _base) noexcept
+		:filter(std::move(_filter)), selection(_selection),
+		 full(_full), base(_base)
+	{
+		if (selection.filter != nullptr)
+			selection.filter = &filter;
+	}
+
+	/* virtual methods from class ResponseProducer */
+	bool Produce(Response &r) override {
+		const auto &partition = r.GetClient().GetPartition();
+		const Database &db = partition.GetDatabaseOrThrow();
+
+		return PrintSelection(r, db, selection, full, base,
+				      position, true);
+	}
+};
+
+} // anonymous namespace
+
+CommandResult
+db_selection_stream(Response &r, const DatabaseSelection &selection,
+		    SongFilter &&filter,
+		    bool full, bool base)
+{
+	assert(selection.sort == TAG_NUM_OF_ITEM_TYPES);
+	assert(selection.window.IsAll());
+
+	return r.Stream(std::make_unique<DatabasePrintProducer>(selection,
+								std::move(filter),
+								full, base));
 }
 
 static void
@@ -175,6 +332,22 @@ PrintSongUris(Response &r, Partition &partition,
 	db.Visit(selection, f);
 }
 
+/**
+ * Estimate the memory used by a #RecursiveMap (for the
+ * #DatabaseQueryCache budget).
+ */
+[[gnu::pure]]
+static std::size_t
+GetMemorySize(const RecursiveMap<std::string> &map) noexcept
+{
+	std::size_t size = sizeof(map);
+	for (const auto &[key, child] : map)
+		size += EstimateMapNodeSize<RecursiveMap<std::string>>() +
+			EstimateStringHeapSize(key) +
+			GetMemorySize(child) - sizeof(child);
+	return size;
+}
+
 static void
 PrintUniqueTags(Response &r, std::span<const TagType> tag_types,
 		const RecursiveMap<std::string> &map,
@@ -208,6 +381,19 @@ PrintUniqueTags(Response &r, Partition &partition,
 
 	const DatabaseSelection selection("", true, filter);
 
+	if (filter == nullptr || filter->IsEmpty()) {
+		/* results without a filter are cached, because
+		   clients tend to request them often (e.g. "list
+		   albumartist") */
+		auto &cache = partition.instance.unique_tags_cache;
+		const auto map = cache.Get({tag_types.begin(), tag_types.end()}, [&]{
+			return db.CollectUniqueTags(selection, tag_types);
+		}, GetMemorySize);
+
+		PrintUniqueTags(r, tag_types, *map, window);
+		return;
+	}
+
 	PrintUniqueTags(r, tag_types,
 			db.CollectUniqueTags(selection, tag_types),
 			window);
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include "command/CommandResult.hxx"
+
 #include <cstdint>
 #include <span>
 
@@ -22,6 +24,21 @@ db_selection_print(Response &r, Partition &partition,
 		   const DatabaseSelection &selection,
 		   bool full, bool base);
 
+/**
+ * Like db_selection_print(), but large responses are sent in
+ * portions (see Response::Stream()).  Each portion restarts the
+ * query, therefore this must not be used with a sorted or windowed
+ * #DatabaseSelection.
+ *
+ * @param filter the filter which #DatabaseSelection::filter points
+ * to (if that is not nullptr); it is moved into the
+ * #ResponseProducer
+ */
+CommandResult
+db_selection_stream(Response &r, const DatabaseSelection &selection,
+		    SongFilter &&filter,
+		    bool full, bool base);
+
 void
 PrintSongUris(Response &r, Partition &partition,
 	      const SongFilter *filter);
@@ -19,6 +19,7 @@ protected:
 
 public:
 	using std::list<PlaylistInfo>::empty;
+	using std::list<PlaylistInfo>::size;
 	using std::list<PlaylistInfo>::begin;
 	using std::list<PlaylistInfo>::end;
 	using std::list<PlaylistInfo>::push_back;
@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_DB_QUERY_CACHE_HXX
+#define MPD_DB_QUERY_CACHE_HXX
+
+#include "thread/Mutex.hxx"
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+
+/**
+ * A small cache for the results of expensive database queries which
+ * aggregate over all songs (e.g. "list" and "count group" without a
+ * filter).  Its owner must call Clear() after the database has been
+ * modified.
+ *
+ * The memory used by the cache is limited by a byte budget; the
+ * least recently used results are evicted to make room for new
+ * ones, and results which exceed the whole budget are not cached at
+ * all.
+ *
+ * This class is thread-safe.  The value type may be incomplete
+ * except where Get() is called.
+ */
+template<typename K, typename V>
+class DatabaseQueryCache {
+	static constexpr std::size_t MAX_ITEMS = 32;
+
+	struct Item {
+		std::shared_ptr<const V> value;
+
+		/**
+		 * The estimated memory usage of #value.
+		 */
+		std::size_t size;
+
+		/**
+		 * The #use_counter value of the most recent lookup;
+		 * used to find the least recently used item.
+		 */
+		unsigned last_used;
+	};
+
+	/**
+	 * The byte budget.
+	 */
+	const std::size_t max_size;
+
+	Mutex mutex;
+
+	/**
+	 * Incremented by Clear(), so Get() can discard results which
+	 * were calculated before the database was modified.
+	 */
+	unsigned generation = 0;
+
+	unsigned use_counter = 0;
+
+	/**
+	 * The sum of all Item::size values.
+	 */
+	std::size_t total_size = 0;
+
+	std::map<K, Item> items;
+
+public:
+	explicit DatabaseQueryCache(std::size_t _max_size) noexcept
+		:max_size(_max_size) {}
+
+	DatabaseQueryCache(const DatabaseQueryCache &) = delete;
+	DatabaseQueryCache &operator=(const DatabaseQueryCache &) = delete;
+
+	/**
+	 * Discard all cached results.
+	 */
+	void Clear() noexcept {
+		const std::scoped_lock lock{mutex};
+		items.clear();
+		total_size = 0;
+		++generation;
+	}
+
+	/**
+	 * Look up a cached result.  On a cache miss, the given
+	 * function is invoked (without holding a lock) to calculate
+	 * the result, which is then added to the cache.
+	 *
+	 * Throws on error (whatever the function throws).
+	 *
+	 * @param f a function which calculates the result
+	 * @param get_size a function which estimates the memory
+	 * used by a result
+	 */
+	template<typename F, typename S>
+	std::shared_ptr<const V> Get(const K &key, F &&f, S &&get_size) {
+		unsigned current;
+
+		{
+			const std::scoped_lock lock{mutex};
+
+			if (auto i = items.find(key); i != items.end()) {
+				i->second.last_used = ++use_counter;
+				return i->second.value;
+			}
+
+			current = generation;
+		}
+
+		auto value = std::make_shared<const V>(f());
+		const std::size_t size = get_size(*value);
+
+		const std::scoped_lock lock{mutex};
+
+		/* don't add the result if the database has been
+		   modified meanwhile */
+		if (generation == current && size <= max_size &&
+		    !items.contains(key)) {
+			EvictLocked(size);
+			items.emplace(key, Item{value, size, ++use_counter});
+			total_size += size;
+		}
+
+		return value;
+	}
+
+private:
+	/**
+	 * Evict the least recently used items until a new item of
+	 * the given size fits.
+	 */
+	void EvictLocked(std::size_t size) noexcept {
+		while (!items.empty() &&
+		       (items.size() >= MAX_ITEMS ||
+			total_size + size > max_size)) {
+			const auto lru = std::min_element(items.begin(), items.end(),
+							  [](const auto &a, const auto &b){
+								  return a.second.last_used < b.second.last_used;
+							  });
+			total_size -= lru->second.size;
+			items.erase(lru);
+		}
+	}
+};
+
+/**
+ * Estimate the heap memory occupied by one node of the given
+ * std::map type (for a #DatabaseQueryCache budget).
+ */
+template<typename Map>
+constexpr std::size_t
+EstimateMapNodeSize() noexcept
+{
+	/* value plus three pointers and the color of the
+	   red-black tree node */
+	return sizeof(typename Map::value_type) + 4 * sizeof(void *);
+}
+
+/**
+ * Estimate the heap memory occupied by the given string, not
+ * counting the object itself (for a #DatabaseQueryCache budget).
+ */
+[[gnu::pure]]
+inline std::size_t
+EstimateStringHeapSize(const std::string &s) noexcept
+{
+	const char *const object = (const char *)&s;
+	if (s.data() >= object && s.data() < object + sizeof(s))
+		/* small string optimization */
+		return 0;
+
+	return s.capacity() + 1;
+}
+
+#endif
@@ -6,11 +6,62 @@
 #include "song/LightSong.hxx"
 #include "song/Filter.hxx"
 #include "tag/Sort.hxx"
+#include "tag/Type.hxx"
 
 #include <algorithm>
 #include <cassert>
 #include <utility>
 
+namespace {
+
+/**
+ * The attributes of a song which are relevant for sorting; this
+ * allows comparing #LightSong and #DetachedSong instances.
+ */
+struct SortKey {
+	const Tag &tag;
+	std::chrono::system_clock::time_point mtime, added;
+
+	explicit SortKey(const LightSong &song) noexcept
+		:tag(song.tag), mtime(song.mtime), added(song.added) {}
+
+	explicit SortKey(const DetachedSong &song) noexcept
+		:tag(song.GetTag()),
+		 mtime(song.GetLastModified()), added(song.GetAdded()) {}
+};
+
+} // anonymous namespace
+
+[[gnu::pure]]
+static bool
+IsBefore(TagType sort, bool descending,
+	 const SortKey &a, const SortKey &b) noexcept
+{
+	if (sort == TagType(SORT_TAG_LAST_MODIFIED))
+		return descending
+			? a.mtime > b.mtime
+			: a.mtime < b.mtime;
+	else if (sort == TagType(SORT_TAG_ADDED))
+		return descending
+			? a.added > b.added
+			: a.added < b.added;
+	else
+		return CompareTags(sort, descending, a.tag, b.tag);
+}
+
+struct DatabaseVisitorHelper::SortItem {
+	DetachedSong song;
+
+	/**
+	 * The position in the unsorted result; used to make the sort
+	 * stable.
+	 */
+	unsigned position;
+
+	SortItem(const LightSong &_song, unsigned _position) noexcept
+		:song(_song), position(_position) {}
+};
+
 DatabaseVisitorHelper::DatabaseVisitorHelper(DatabaseSelection _selection,
 					     VisitSong &visit_song) noexcept
 	:selection(std::move(_selection))
@@ -22,13 +73,22 @@ DatabaseVisitorHelper::DatabaseVisitorHelper(DatabaseSelection _selection,
 	if (selection.sort != TAG_NUM_OF_ITEM_TYPES) {
 		/* the client has asked us to sort the result; this is
 		   pretty expensive, because instead of streaming the
-		   result to the client, we need to copy it all into
-		   this std::vector, and then sort it */
+		   result to the client, we need to copy it into this
+		   std::vector, and then sort it */
 
 		original_visit_song = std::move(visit_song);
-		visit_song = [this](const auto &song){
-			songs.emplace_back(song);
-		};
+
+		if (selection.window.IsOpenEnded())
+			visit_song = [this](const auto &song){
+				songs.emplace_back(song, counter++);
+			};
+		else
+			/* with a window, we only need to keep the
+			   songs up to the end of the window, no
+			   matter how large the whole result is */
+			visit_song = [this](const auto &song){
+				CollectTop(song);
+			};
 	} else if (selection.window != RangeArg::All()) {
 		original_visit_song = std::move(visit_song);
 		visit_song = [this](const auto &song){
@@ -40,6 +100,52 @@ DatabaseVisitorHelper::DatabaseVisitorHelper(DatabaseSelection _selection,
 
 DatabaseVisitorHelper::~DatabaseVisitorHelper() noexcept = default;
 
+inline bool
+DatabaseVisitorHelper::IsBefore(const SortItem &a,
+				const SortItem &b) const noexcept
+{
+	const SortKey ka{a.song}, kb{b.song};
+
+	if (::IsBefore(selection.sort, selection.descending, ka, kb))
+		return true;
+
+	if (::IsBefore(selection.sort, selection.descending, kb, ka))
+		return false;
+
+	return a.position < b.position;
+}
+
+inline void
+DatabaseVisitorHelper::CollectTop(const LightSong &song)
+{
+	const unsigned position = counter++;
+
+	const auto cmp = [this](const SortItem &a, const SortItem &b){
+		return IsBefore(a, b);
+	};
+
+	if (songs.size() < selection.window.end) {
+		songs.emplace_back(song, position);
+		std::push_heap(songs.begin(), songs.end(), cmp);
+		return;
+	}
+
+	if (songs.empty())
+		/* empty window */
+		return;
+
+	/* the heap is full; replace its last song if the new one
+	   sorts before it (on a tie, the new one loses because it
+	   comes later) */
+	if (!::IsBefore(selection.sort, selection.descending,
+			SortKey{song}, SortKey{songs.front().song}))
+		return;
+
+	std::pop_heap(songs.begin(), songs.end(), cmp);
+	songs.back() = SortItem{song, position};
+	std::push_heap(songs.begin(), songs.end(), cmp);
+}
+
 void
 DatabaseVisitorHelper::Commit()
 {
@@ -49,32 +155,12 @@ DatabaseVisitorHelper::Commit()
 
 	assert(original_visit_song);
 
-	/* sort the song collection */
-	const auto sort = selection.sort;
-	const auto descending = selection.descending;
-
-	if (sort == TagType(SORT_TAG_LAST_MODIFIED))
-		std::stable_sort(songs.begin(), songs.end(),
-				 [descending](const DetachedSong &a, const DetachedSong &b){
-					 return descending
-						 ? a.GetLastModified() > b.GetLastModified()
-						 : a.GetLastModified() < b.GetLastModified();
-				 });
-	else if (sort == TagType(SORT_TAG_ADDED))
-		std::stable_sort(songs.begin(), songs.end(),
-				 [descending](const DetachedSong &a, const DetachedSong &b){
-					 return descending
-						 ? a.GetAdded() > b.GetAdded()
-						 : a.GetAdded() < b.GetAdded();
-				 });
-	else
-		std::stable_sort(songs.begin(), songs.end(),
-				 [sort, descending](const DetachedSong &a,
-						    const DetachedSong &b){
-					 return CompareTags(sort, descending,
-							    a.GetTag(),
-							    b.GetTag());
-				 });
+	/* sort the song collection; the "position" makes this a
+	   total order, which is equivalent to a stable sort */
+	std::sort(songs.begin(), songs.end(),
+		  [this](const SortItem &a, const SortItem &b){
+			  return IsBefore(a, b);
+		  });
 
 	/* apply the "window" */
 	if (selection.window.end < songs.size())
@@ -88,6 +174,6 @@ DatabaseVisitorHelper::Commit()
 		    std::next(songs.begin(), selection.window.start));
 
 	/* now pass all songs to the original visitor callback */
-	for (const auto &song : songs)
-		original_visit_song((LightSong)song);
+	for (const auto &i : songs)
+		original_visit_song((LightSong)i.song);
 }
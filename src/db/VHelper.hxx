@@ -10,6 +10,7 @@
 #include <vector>
 
 class DetachedSong;
+struct LightSong;
 
 /**
  * This class helps implementing Database::Visit() by emulating
@@ -23,12 +24,18 @@ class DetachedSong;
 class DatabaseVisitorHelper {
 	const DatabaseSelection selection;
 
+	struct SortItem;
+
 	/**
 	 * If the plugin can't sort, then this container will collect
 	 * all songs, sort them and report them to the visitor in
 	 * Commit().
+	 *
+	 * If the "window" has an end, then only the first songs up to
+	 * the end of the window are kept, organized as a heap with the
+	 * song which sorts last at the front.
 	 */
-	std::vector<DetachedSong> songs;
+	std::vector<SortItem> songs;
 
 	VisitSong original_visit_song;
 
@@ -49,6 +56,16 @@ public:
 	~DatabaseVisitorHelper() noexcept;
 
 	void Commit();
+
+private:
+	/**
+	 * Sorting with a "window" end: add the song to the #songs
+	 * heap if it is among the first ones.
+	 */
+	void CollectTop(const LightSong &song);
+
+	[[gnu::pure]]
+	bool IsBefore(const SortItem &a, const SortItem &b) const noexcept;
 };
 
 #endif
@@ -0,0 +1,714 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "BinarySave.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "io/BufferedOutputStream.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+#include "tag/Names.hxx"
+#include "tag/ParseName.hxx"
+#include "tag/Pool.hxx"
+#include "tag/Settings.hxx"
+#include "tag/Tag.hxx"
+#include "fs/Charset.hxx"
+#include "time/ChronoUtil.hxx"
+#include "util/SpanCast.hxx"
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * File layout (all integers in host byte order):
+ *
+ * - BinaryHeader
+ * - string table: null-terminated strings, referred to by their
+ *   byte offset; offset 0 is always the empty string
+ * - BinaryTagType array (n_tag_types)
+ * - BinaryTagItem array (n_tag_items)
+ * - the root BinaryDirectory, followed recursively by its
+ *   children, its songs (each BinarySong followed by an array of
+ *   tag item indices) and its playlists
+ */
+
+static constexpr std::array<char, 8> BINARY_DB_MAGIC{
+	'M', 'P', 'D', '_', 'B', 'I', 'N', '\n',
+};
+
+static constexpr uint32_t BINARY_DB_FORMAT = 1;
+
+/**
+ * This value allows detecting a file written by a host with a
+ * different byte order.
+ */
+static constexpr uint32_t BINARY_DB_BYTE_ORDER = 0x01020304;
+
+/**
+ * A time stamp value which means "unknown".
+ */
+static constexpr int64_t BINARY_DB_NO_TIME = std::numeric_limits<int64_t>::min();
+
+namespace {
+
+struct BinaryHeader {
+	std::array<char, 8> magic;
+	uint32_t format, byte_order;
+
+	/**
+	 * String offset of the filesystem charset name.
+	 */
+	uint32_t fs_charset;
+
+	uint32_t strings_size;
+	uint32_t n_tag_types, n_tag_items;
+};
+
+/**
+ * One entry of the tag type table.  The "type" field of
+ * #BinaryTagItem is an index into this table, which makes the file
+ * independent of the numeric #TagType values.
+ */
+struct BinaryTagType {
+	uint32_t name;
+	uint32_t enabled;
+};
+
+struct BinaryTagItem {
+	uint32_t value;
+	uint32_t type;
+};
+
+enum BinaryDirectoryType : uint32_t {
+	BINARY_DIRECTORY_REGULAR,
+	BINARY_DIRECTORY_ARCHIVE,
+	BINARY_DIRECTORY_CONTAINER,
+	BINARY_DIRECTORY_PLAYLIST,
+};
+
+struct BinaryDirectory {
+	uint32_t name;
+	uint32_t type;
+	int64_t mtime;
+	uint32_t n_children, n_songs, n_playlists, reserved;
+};
+
+static constexpr uint8_t BINARY_SONG_IN_PLAYLIST = 0x1;
+static constexpr uint8_t BINARY_SONG_HAS_PLAYLIST = 0x2;
+
+struct BinarySong {
+	uint32_t filename, target;
+	int64_t mtime, added;
+	uint32_t start_ms, end_ms;
+	int32_t duration_ms;
+	uint32_t sample_rate;
+	uint8_t sample_format, channels, flags, reserved;
+
+	/**
+	 * The number of tag item indices (uint32_t) following this
+	 * record.
+	 */
+	uint32_t n_items;
+};
+
+static_assert(sizeof(BinaryHeader) == 32);
+static_assert(sizeof(BinaryTagType) == 8);
+static_assert(sizeof(BinaryTagItem) == 8);
+static_assert(sizeof(BinaryDirectory) == 32);
+static_assert(sizeof(BinarySong) == 48);
+
+struct BinaryPlaylist {
+	uint32_t name, reserved;
+	int64_t mtime;
+};
+
+static_assert(sizeof(BinaryPlaylist) == 16);
+
+} // anonymous namespace
+
+[[gnu::const]]
+static uint32_t
+ExportDirectoryType(unsigned device) noexcept
+{
+	switch (device) {
+	case DEVICE_INARCHIVE:
+		return BINARY_DIRECTORY_ARCHIVE;
+
+	case DEVICE_CONTAINER:
+		return BINARY_DIRECTORY_CONTAINER;
+
+	case DEVICE_PLAYLIST:
+		return BINARY_DIRECTORY_PLAYLIST;
+
+	default:
+		return BINARY_DIRECTORY_REGULAR;
+	}
+}
+
+[[gnu::const]]
+static unsigned
+ImportDirectoryType(uint32_t type) noexcept
+{
+	switch (type) {
+	case BINARY_DIRECTORY_ARCHIVE:
+		return DEVICE_INARCHIVE;
+
+	case BINARY_DIRECTORY_CONTAINER:
+		return DEVICE_CONTAINER;
+
+	case BINARY_DIRECTORY_PLAYLIST:
+		return DEVICE_PLAYLIST;
+
+	default:
+		return 0;
+	}
+}
+
+[[gnu::const]]
+static int64_t
+ExportTime(std::chrono::system_clock::time_point t) noexcept
+{
+	return IsNegative(t)
+		? BINARY_DB_NO_TIME
+		: std::chrono::system_clock::to_time_t(t);
+}
+
+[[gnu::const]]
+static std::chrono::system_clock::time_point
+ImportTime(int64_t t) noexcept
+{
+	return t == BINARY_DB_NO_TIME
+		? std::chrono::system_clock::time_point::min()
+		: std::chrono::system_clock::from_time_t(t);
+}
+
+bool
+db_is_binary(std::span<const std::byte> src) noexcept
+{
+	return src.size() >= BINARY_DB_MAGIC.size() &&
+		std::memcmp(src.data(), BINARY_DB_MAGIC.data(),
+			    BINARY_DB_MAGIC.size()) == 0;
+}
+
+namespace {
+
+/**
+ * Collects all distinct strings into one buffer.
+ */
+class BinaryStringTable {
+	std::unordered_map<std::string_view, uint32_t> map;
+
+	/* offset 0 is the empty string */
+	std::string data{'\0'};
+
+public:
+	uint32_t Add(std::string_view s) {
+		if (s.empty())
+			return 0;
+
+		auto [i, inserted] = map.try_emplace(s, data.size());
+		if (inserted) {
+			if (data.size() + s.size() >= std::numeric_limits<uint32_t>::max())
+				throw std::runtime_error("Database too large");
+
+			data.append(s);
+			data.push_back('\0');
+		}
+
+		return i->second;
+	}
+
+	[[gnu::pure]]
+	uint32_t Get(std::string_view s) const noexcept {
+		if (s.empty())
+			return 0;
+
+		auto i = map.find(s);
+		assert(i != map.end());
+		return i->second;
+	}
+
+	std::string_view GetData() const noexcept {
+		return data;
+	}
+};
+
+class BinaryDatabaseWriter {
+	BinaryStringTable strings;
+
+	/**
+	 * Maps (value << 8 | type) to an index into #tag_items.
+	 */
+	std::unordered_map<uint_least64_t, uint32_t> tag_item_map;
+
+	std::vector<BinaryTagItem> tag_items;
+
+	/**
+	 * A buffer for WriteSong().
+	 */
+	std::vector<uint32_t> song_items;
+
+public:
+	/**
+	 * Add all strings and tag items of the given #Directory to
+	 * the tables.
+	 */
+	void Collect(const Directory &directory);
+
+	void Write(BufferedOutputStream &os, const Directory &root);
+
+private:
+	void CollectSong(const Song &song);
+
+	[[gnu::pure]]
+	uint32_t GetTagItem(const TagItem &item) const noexcept;
+
+	void WriteDirectory(BufferedOutputStream &os,
+			    const Directory &directory);
+	void WriteSong(BufferedOutputStream &os, const Song &song);
+
+	static uint_least64_t TagItemKey(uint32_t value, TagType type) noexcept {
+		return (uint_least64_t(value) << 8) | type;
+	}
+};
+
+inline void
+BinaryDatabaseWriter::CollectSong(const Song &song)
+{
+	strings.Add(song.filename);
+	strings.Add(song.target);
+
+	for (const auto &i : song.tag) {
+		const uint32_t value = strings.Add(i.value);
+		if (tag_item_map.try_emplace(TagItemKey(value, i.type),
+					     tag_items.size()).second)
+			tag_items.push_back({value, i.type});
+	}
+}
+
+void
+BinaryDatabaseWriter::Collect(const Directory &directory)
+{
+	for (const auto &child : directory.children) {
+		if (child.IsMount())
+			continue;
+
+		strings.Add(child.GetName());
+		Collect(child);
+	}
+
+	for (const auto &song : directory.songs)
+		CollectSong(song);
+
+	for (const auto &pi : directory.playlists)
+		strings.Add(pi.name);
+}
+
+inline uint32_t
+BinaryDatabaseWriter::GetTagItem(const TagItem &item) const noexcept
+{
+	auto i = tag_item_map.find(TagItemKey(strings.Get(item.value),
+					      item.type));
+	assert(i != tag_item_map.end());
+	return i->second;
+}
+
+inline void
+BinaryDatabaseWriter::WriteSong(BufferedOutputStream &os, const Song &song)
+{
+	song_items.clear();
+	for (const auto &i : song.tag)
+		song_items.push_back(GetTagItem(i));
+
+	uint8_t flags = 0;
+	if (song.in_playlist)
+		flags |= BINARY_SONG_IN_PLAYLIST;
+	if (song.tag.has_playlist)
+		flags |= BINARY_SONG_HAS_PLAYLIST;
+
+	const BinarySong record{
+		.filename = strings.Get(song.filename),
+		.target = strings.Get(song.target),
+		.mtime = ExportTime(song.mtime),
+		.added = ExportTime(song.added),
+		.start_ms = song.start_time.ToMS(),
+		.end_ms = song.end_time.ToMS(),
+		.duration_ms = song.tag.duration.ToMS(),
+		.sample_rate = song.audio_format.sample_rate,
+		.sample_format = static_cast<uint8_t>(song.audio_format.format),
+		.channels = song.audio_format.channels,
+		.flags = flags,
+		.reserved = 0,
+		.n_items = static_cast<uint32_t>(song_items.size()),
+	};
+
+	os.WriteT(record);
+	os.Write(std::as_bytes(std::span{song_items}));
+}
+
+void
+BinaryDatabaseWriter::WriteDirectory(BufferedOutputStream &os,
+				     const Directory &directory)
+{
+	uint32_t n_children = 0;
+	for (const auto &child : directory.children)
+		if (!child.IsMount())
+			++n_children;
+
+	const BinaryDirectory record{
+		.name = directory.IsRoot() ? 0 : strings.Get(directory.GetName()),
+		.type = ExportDirectoryType(directory.device),
+		.mtime = ExportTime(directory.mtime),
+		.n_children = n_children,
+		.n_songs = static_cast<uint32_t>(directory.songs.size()),
+		.n_playlists = static_cast<uint32_t>(directory.playlists.size()),
+		.reserved = 0,
+	};
+
+	os.WriteT(record);
+
+	for (const auto &child : directory.children)
+		if (!child.IsMount())
+			WriteDirectory(os, child);
+
+	for (const auto &song : directory.songs)
+		WriteSong(os, song);
+
+	for (const auto &pi : directory.playlists) {
+		const BinaryPlaylist playlist{
+			.name = strings.Get(pi.name),
+			.reserved = 0,
+			.mtime = ExportTime(pi.mtime),
+		};
+
+		os.WriteT(playlist);
+	}
+}
+
+void
+BinaryDatabaseWriter::Write(BufferedOutputStream &os, const Directory &root)
+{
+	const uint32_t fs_charset = strings.Add(GetFSCharset());
+
+	std::array<BinaryTagType, TAG_NUM_OF_ITEM_TYPES> tag_types;
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		tag_types[i] = {
+			strings.Add(tag_item_names[i]),
+			IsTagEnabled(i),
+		};
+
+	const auto string_data = strings.GetData();
+
+	const BinaryHeader header{
+		.magic = BINARY_DB_MAGIC,
+		.format = BINARY_DB_FORMAT,
+		.byte_order = BINARY_DB_BYTE_ORDER,
+		.fs_charset = fs_charset,
+		.strings_size = static_cast<uint32_t>(string_data.size()),
+		.n_tag_types = static_cast<uint32_t>(tag_types.size()),
+		.n_tag_items = static_cast<uint32_t>(tag_items.size()),
+	};
+
+	os.WriteT(header);
+	os.Write(string_data);
+	os.Write(std::as_bytes(std::span{tag_types}));
+	os.Write(std::as_bytes(std::span{tag_items}));
+
+	WriteDirectory(os, root);
+}
+
+} // anonymous namespace
+
+void
+db_save_binary(BufferedOutputStream &os, const Directory &root)
+{
+	BinaryDatabaseWriter writer;
+	writer.Collect(root);
+	writer.Write(os, root);
+}
+
+/**
+ * Copy the element at the given index out of a (possibly unaligned)
+ * buffer.
+ */
+template<typename T>
+static T
+LoadElement(std::span<const std::byte> src, std::size_t i) noexcept
+{
+	T value;
+	std::memcpy(&value, src.data() + i * sizeof(value), sizeof(value));
+	return value;
+}
+
+namespace {
+
+/**
+ * Reads records from a memory buffer, checking for buffer overruns.
+ */
+class BinaryReader {
+	std::span<const std::byte> src;
+
+public:
+	explicit constexpr BinaryReader(std::span<const std::byte> _src) noexcept
+		:src(_src) {}
+
+	bool empty() const noexcept {
+		return src.empty();
+	}
+
+	std::span<const std::byte> ReadBytes(std::size_t size) {
+		if (src.size() < size)
+			throw std::runtime_error("Database corrupted");
+
+		auto result = src.first(size);
+		src = src.subspan(size);
+		return result;
+	}
+
+	template<typename T>
+	T Read() {
+		T value;
+		std::memcpy(&value, ReadBytes(sizeof(value)).data(),
+			    sizeof(value));
+		return value;
+	}
+
+	template<typename T>
+	std::span<const std::byte> ReadArray(std::size_t n) {
+		if (n > src.size() / sizeof(T))
+			throw std::runtime_error("Database corrupted");
+
+		return ReadBytes(n * sizeof(T));
+	}
+};
+
+class BinaryDatabaseLoader {
+	BinaryReader reader;
+
+	std::string_view strings;
+
+	/**
+	 * The #TagItem for each entry of the file's tag item table,
+	 * each holding one tag pool reference.  Songs obtain more
+	 * references with tag_pool_dup_item(), which is cheaper than
+	 * a hash lookup.  The value is nullptr if the tag type is not
+	 * supported by this MPD version.
+	 */
+	std::vector<TagItem *> tag_items;
+
+public:
+	explicit BinaryDatabaseLoader(std::span<const std::byte> src) noexcept
+		:reader(src) {}
+
+	~BinaryDatabaseLoader() noexcept;
+
+	void Load(Directory &root, bool ignore_config_mismatches);
+
+private:
+	[[gnu::pure]]
+	const char *GetString(uint32_t offset) const {
+		if (offset >= strings.size())
+			throw std::runtime_error("Database corrupted");
+
+		return strings.data() + offset;
+	}
+
+	void LoadTagTables(const BinaryHeader &header,
+			   bool ignore_config_mismatches);
+
+	void LoadDirectory(Directory &directory,
+			   const BinaryDirectory &record);
+	void LoadSong(Directory &parent);
+};
+
+BinaryDatabaseLoader::~BinaryDatabaseLoader() noexcept
+{
+	for (auto *i : tag_items)
+		if (i != nullptr)
+			tag_pool_put_item(i);
+}
+
+inline void
+BinaryDatabaseLoader::LoadTagTables(const BinaryHeader &header,
+				    bool ignore_config_mismatches)
+{
+	const auto tag_types_raw = reader.ReadArray<BinaryTagType>(header.n_tag_types);
+	const auto tag_items_raw = reader.ReadArray<BinaryTagItem>(header.n_tag_items);
+
+	/* map the file's tag type table to our TagType values */
+	std::vector<TagType> tag_types;
+	tag_types.reserve(header.n_tag_types);
+
+	bool enabled[TAG_NUM_OF_ITEM_TYPES]{};
+
+	for (std::size_t i = 0; i < header.n_tag_types; ++i) {
+		const auto t = LoadElement<BinaryTagType>(tag_types_raw, i);
+		const char *name = GetString(t.name);
+		const TagType type = tag_name_parse(name);
+
+		if (type == TAG_NUM_OF_ITEM_TYPES) {
+			if (t.enabled && !ignore_config_mismatches)
+				throw FmtRuntimeError("Unrecognized tag {:?}, "
+						      "discarding database file",
+						      name);
+		} else if (t.enabled)
+			enabled[type] = true;
+
+		tag_types.push_back(type);
+	}
+
+	if (!ignore_config_mismatches)
+		for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+			if (IsTagEnabled(i) && !enabled[i])
+				throw std::runtime_error("Tag list mismatch, "
+							 "discarding database file");
+
+	tag_items.reserve(header.n_tag_items);
+
+	for (std::size_t i = 0; i < header.n_tag_items; ++i) {
+		const auto t = LoadElement<BinaryTagItem>(tag_items_raw, i);
+		if (t.type >= tag_types.size())
+			throw std::runtime_error("Database corrupted");
+
+		const char *value = GetString(t.value);
+		const TagType type = tag_types[t.type];
+
+		tag_items.push_back(type != TAG_NUM_OF_ITEM_TYPES
+				    ? tag_pool_get_item(type, value)
+				    : nullptr);
+	}
+}
+
+inline void
+BinaryDatabaseLoader::LoadSong(Directory &parent)
+{
+	const auto record = reader.Read<BinarySong>();
+	const auto items_raw = reader.ReadArray<uint32_t>(record.n_items);
+
+	const char *filename = GetString(record.filename);
+	if (*filename == 0)
+		throw std::runtime_error("Database corrupted");
+
+	auto song = std::make_unique<Song>(filename, parent);
+	song->target = GetString(record.target);
+	song->mtime = ImportTime(record.mtime);
+	song->added = ImportTime(record.added);
+	song->start_time = SongTime::FromMS(record.start_ms);
+	song->end_time = SongTime::FromMS(record.end_ms);
+	song->in_playlist = record.flags & BINARY_SONG_IN_PLAYLIST;
+
+	const AudioFormat audio_format(record.sample_rate,
+				       SampleFormat(record.sample_format),
+				       record.channels);
+	if (audio_format.IsValid())
+		song->audio_format = audio_format;
+
+	Tag &tag = song->tag;
+	tag.duration = SignedSongTime::FromMS(record.duration_ms);
+	tag.has_playlist = record.flags & BINARY_SONG_HAS_PLAYLIST;
+
+	if (record.n_items > 0) {
+		if (record.n_items > std::numeric_limits<decltype(tag.num_items)>::max())
+			throw std::runtime_error("Database corrupted");
+
+		for (std::size_t i = 0; i < record.n_items; ++i)
+			if (LoadElement<uint32_t>(items_raw, i) >= tag_items.size())
+				throw std::runtime_error("Database corrupted");
+
+		tag.items = Tag::AllocateItems(record.n_items);
+
+		for (std::size_t i = 0; i < record.n_items; ++i) {
+			TagItem *item = tag_items[LoadElement<uint32_t>(items_raw, i)];
+			if (item != nullptr)
+				tag.items[tag.num_items++] = tag_pool_dup_item(item);
+		}
+	}
+
+	parent.AddSong(std::move(song));
+}
+
+void
+BinaryDatabaseLoader::LoadDirectory(Directory &directory,
+				    const BinaryDirectory &record)
+{
+	for (uint32_t i = 0; i < record.n_children; ++i) {
+		const auto child_record = reader.Read<BinaryDirectory>();
+		const char *name = GetString(child_record.name);
+		if (*name == 0)
+			throw std::runtime_error("Database corrupted");
+
+		Directory *child = directory.CreateChild(name);
+		child->device = ImportDirectoryType(child_record.type);
+		child->mtime = ImportTime(child_record.mtime);
+
+		LoadDirectory(*child, child_record);
+	}
+
+	for (uint32_t i = 0; i < record.n_songs; ++i)
+		LoadSong(directory);
+
+	for (uint32_t i = 0; i < record.n_playlists; ++i) {
+		const auto playlist = reader.Read<BinaryPlaylist>();
+		directory.playlists.push_back(PlaylistInfo{
+				GetString(playlist.name),
+				ImportTime(playlist.mtime),
+			});
+	}
+}
+
+void
+BinaryDatabaseLoader::Load(Directory &root, bool ignore_config_mismatches)
+{
+	const auto header = reader.Read<BinaryHeader>();
+	if (header.magic != BINARY_DB_MAGIC)
+		throw std::runtime_error("Database corrupted");
+
+	if (header.format != BINARY_DB_FORMAT ||
+	    header.byte_order != BINARY_DB_BYTE_ORDER)
+		throw std::runtime_error("Database format mismatch, "
+					 "discarding database file");
+
+	strings = ToStringView(reader.ReadBytes(header.strings_size));
+	if (strings.empty() || strings.back() != '\0')
+		throw std::runtime_error("Database corrupted");
+
+	if (!ignore_config_mismatches) {
+		const char *new_charset = GetString(header.fs_charset);
+		const char *const old_charset = GetFSCharset();
+		if (*old_charset != 0
+		    && strcmp(new_charset, old_charset) != 0)
+			throw FmtRuntimeError("Existing database has charset "
+					      "{:?} instead of {:?}; "
+					      "discarding database file",
+					      new_charset, old_charset);
+	}
+
+	LoadTagTables(header, ignore_config_mismatches);
+
+	const auto root_record = reader.Read<BinaryDirectory>();
+
+	{
+		const ScopeDatabaseLock protect;
+		LoadDirectory(root, root_record);
+	}
+
+	if (!reader.empty())
+		throw std::runtime_error("Database corrupted");
+}
+
+} // anonymous namespace
+
+void
+db_load_binary(std::span<const std::byte> src, Directory &root,
+	       bool ignore_config_mismatches)
+{
+	BinaryDatabaseLoader loader{src};
+	loader.Load(root, ignore_config_mismatches);
+}
@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_BINARY_SAVE_HXX
+#define MPD_BINARY_SAVE_HXX
+
+#include <cstddef>
+#include <span>
+
+struct Directory;
+class BufferedOutputStream;
+
+/**
+ * Does the given file contents look like a database in the binary
+ * format written by db_save_binary()?
+ */
+[[gnu::pure]]
+bool
+db_is_binary(std::span<const std::byte> src) noexcept;
+
+/**
+ * Write the database in a binary format.  All strings (names and
+ * tag values) are stored only once in a string table, and all
+ * records refer to them by their offset.  This allows loading the
+ * database without parsing text and with only one tag pool lookup
+ * per distinct tag value.
+ */
+void
+db_save_binary(BufferedOutputStream &os, const Directory &root);
+
+/**
+ * Load a database which was written by db_save_binary().  The
+ * source buffer is usually a #MappedFile.
+ *
+ * Throws #std::runtime_error on error.
+ *
+ * @param ignore_config_mismatches if true, then configuration
+ * mismatches (e.g. enabled tags or filesystem charset) are ignored
+ */
+void
+db_load_binary(std::span<const std::byte> src, Directory &root,
+	       bool ignore_config_mismatches=false);
+
+#endif
@@ -46,11 +46,12 @@ Directory::~Directory() noexcept
 void
 Directory::Delete() noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(parent != nullptr);
 
-	parent->children.erase_and_dispose(parent->children.iterator_to(*this),
-					   DeleteDisposer());
+	parent->children.erase(parent->children.iterator_to(*this));
+	parent->child_index.Remove(*this, parent->children);
+	delete this;
 }
 
 std::string_view
@@ -72,7 +73,7 @@ Directory::GetName() const noexcept
 Directory *
 Directory::CreateChild(std::string_view name_utf8) noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(!name_utf8.empty());
 
 	std::string path_utf8 = IsRoot()
@@ -81,6 +82,7 @@ Directory::CreateChild(std::string_view name_utf8) noexcept
 
 	auto *child = new Directory(std::move(path_utf8), this);
 	children.push_back(*child);
+	child_index.Add(*child, children);
 	return child;
 }
 
@@ -89,6 +91,9 @@ Directory::FindChild(std::string_view name) const noexcept
 {
 	assert(holding_db_lock());
 
+	if (child_index.IsEnabled())
+		return child_index.Find(name);
+
 	for (const auto &child : children)
 		if (child.GetName() == name)
 			return &child;
@@ -114,7 +119,7 @@ Directory::LookupTargetSong(std::string_view target) noexcept
 void
 Directory::ClearInPlaylist() noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 
 	for (auto &child : children)
 		child.ClearInPlaylist();
@@ -126,16 +131,18 @@ Directory::ClearInPlaylist() noexcept
 void
 Directory::PruneEmpty() noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 
 	for (auto child = children.begin(), end = children.end();
 	     child != end;) {
 		child->PruneEmpty();
 
-		if (child->IsEmpty() && !child->IsMount())
-			child = children.erase_and_dispose(child,
-							   DeleteDisposer());
-		else
+		if (child->IsEmpty() && !child->IsMount()) {
+			Directory &d = *child;
+			child = children.erase(child);
+			child_index.Remove(d, children);
+			delete &d;
+		} else
 			++child;
 	}
 }
@@ -172,21 +179,24 @@ Directory::LookupDirectory(std::string_view _uri) noexcept
 void
 Directory::AddSong(SongPtr song) noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(song != nullptr);
 	assert(&song->parent == this);
 
-	songs.push_back(*song.release());
+	Song &s = *song.release();
+	songs.push_back(s);
+	song_index.Add(s, songs);
 }
 
 SongPtr
 Directory::RemoveSong(Song *song) noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(song != nullptr);
 	assert(&song->parent == this);
 
 	songs.erase(songs.iterator_to(*song));
+	song_index.Remove(*song, songs);
 	return SongPtr(song);
 }
 
@@ -195,6 +205,9 @@ Directory::FindSong(std::string_view name_utf8) const noexcept
 {
 	assert(holding_db_lock());
 
+	if (song_index.IsEnabled())
+		return song_index.Find(name_utf8);
+
 	for (auto &song : songs) {
 		assert(&song.parent == this);
 
@@ -215,7 +228,7 @@ directory_cmp(const Directory &a, const Directory &b) noexcept
 void
 Directory::Sort() noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 
 	SortList(children, directory_cmp);
 	song_list_sort(songs);
@@ -236,7 +249,7 @@ Directory::Walk(bool recursive, const SongFilter *filter,
 		/* TODO: eliminate this unlock/lock; it is necessary
 		   because the child's SimpleDatabasePlugin::Visit()
 		   call will lock it again */
-		const ScopeDatabaseUnlock unlock;
+		const ScopeDatabaseReadUnlock unlock;
 		WalkMount(GetPath(), *mounted_database,
 			  "", DatabaseSelection("", recursive, filter),
 			  visit_directory, visit_song,
@@ -5,6 +5,7 @@
 #define MPD_DIRECTORY_HXX
 
 #include "Ptr.hxx"
+#include "NameIndex.hxx"
 #include "Song.hxx" // TODO eliminate this include, forward-declare only
 #include "db/Visitor.hxx"
 #include "db/PlaylistVector.hxx"
@@ -58,6 +59,32 @@ struct Directory : IntrusiveListHook<> {
 	 */
 	IntrusiveList<Song> songs;
 
+private:
+	struct GetChildName {
+		[[gnu::pure]]
+		std::string_view operator()(const Directory &child) const noexcept {
+			return child.GetName();
+		}
+	};
+
+	struct GetSongName {
+		[[gnu::pure]]
+		std::string_view operator()(const Song &song) const noexcept {
+			return song.filename;
+		}
+	};
+
+	/**
+	 * Hash indexes for #children and #songs which are only
+	 * created for large directories; they are used by FindChild()
+	 * and FindSong().
+	 *
+	 * These attributes are protected with the global #db_mutex.
+	 */
+	NameIndex<Directory, GetChildName> child_index;
+	NameIndex<Song, GetSongName> song_index;
+
+public:
 	PlaylistVector playlists;
 
 	Directory *const parent;
@@ -123,14 +150,14 @@ public:
 	 * Remove this #Directory object from its parent and free it.  This
 	 * must not be called with the root Directory.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 */
 	void Delete() noexcept;
 
 	/**
 	 * Create a new #Directory object as a child of the given one.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 *
 	 * @param name_utf8 the UTF-8 encoded name of the new sub directory
 	 */
@@ -152,7 +179,7 @@ public:
 	 * Look up a sub directory, and create the object if it does not
 	 * exist.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 */
 	Directory *MakeChild(std::string_view name_utf8) noexcept {
 		Directory *child = FindChild(name_utf8);
@@ -267,19 +294,19 @@ public:
 	 * Recursively walk through the whole tree and set all
 	 * `Song::in_playlist` fields to `false`.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 */
 	void ClearInPlaylist() noexcept;
 
 	/**
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 */
 	void PruneEmpty() noexcept;
 
 	/**
 	 * Sort all directory entries recursively.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 */
 	void Sort() noexcept;
 
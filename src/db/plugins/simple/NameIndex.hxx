@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * An optional hash index which maps names to the items of an
+ * #IntrusiveList (child directories or songs of a #Directory).  The
+ * index is only created once the list grows beyond #THRESHOLD items;
+ * below that, a linear scan is faster and needs no memory.
+ *
+ * The caller is responsible for calling Add() and Remove() for each
+ * modification of the list.
+ *
+ * @param T the item type
+ * @param GetName a function object returning the name of an item
+ */
+template<typename T, typename GetName>
+class NameIndex {
+	using Map = std::unordered_map<std::string_view, T *>;
+
+	std::unique_ptr<Map> map;
+
+	/**
+	 * The number of items in the list.
+	 */
+	std::size_t n_items = 0;
+
+	/**
+	 * The number of items which are not in the #map because
+	 * another item with the same name was indexed first.  Names
+	 * are usually unique, so this is usually zero, and Remove()
+	 * needs to look for a hidden duplicate only if it is not.
+	 */
+	std::size_t n_duplicates = 0;
+
+public:
+	static constexpr std::size_t THRESHOLD = 32;
+
+	/**
+	 * Has the index been created?  If not, the caller must fall
+	 * back to a linear scan.
+	 */
+	bool IsEnabled() const noexcept {
+		return map != nullptr;
+	}
+
+	/**
+	 * Look up an item.  May only be called if IsEnabled() returns
+	 * true.
+	 */
+	[[gnu::pure]]
+	T *Find(std::string_view name) const noexcept {
+		auto i = map->find(name);
+		return i != map->end() ? i->second : nullptr;
+	}
+
+	/**
+	 * An item has been added to the list.
+	 */
+	template<typename L>
+	void Add(T &item, L &list) noexcept {
+		++n_items;
+
+		if (map) {
+			/* if there is a duplicate, keep the older item
+			   (which is what a linear scan would find) */
+			if (!map->emplace(GetName{}(item), &item).second)
+				++n_duplicates;
+		} else if (n_items > THRESHOLD)
+			Build(list);
+	}
+
+	/**
+	 * An item has been removed from the list.  The item must
+	 * still be alive (because its name is needed), but it must
+	 * not be in the list anymore.
+	 */
+	template<typename L>
+	void Remove(T &item, L &list) noexcept {
+		--n_items;
+
+		if (!map)
+			return;
+
+		if (n_items == 0) {
+			map.reset();
+			n_duplicates = 0;
+			return;
+		}
+
+		const std::string_view name = GetName{}(item);
+		auto i = map->find(name);
+		if (i == map->end() || i->second != &item) {
+			/* this was a hidden duplicate */
+			assert(n_duplicates > 0);
+			--n_duplicates;
+			return;
+		}
+
+		map->erase(i);
+
+		if (n_duplicates == 0)
+			return;
+
+		/* is there another item with the same name which was
+		   hidden by this one? */
+		for (auto &j : list) {
+			if (GetName{}(j) == name) {
+				map->emplace(GetName{}(j), &j);
+				--n_duplicates;
+				break;
+			}
+		}
+	}
+
+private:
+	template<typename L>
+	void Build(L &list) noexcept {
+		map = std::make_unique<Map>();
+		map->reserve(n_items);
+		n_duplicates = 0;
+
+		for (auto &i : list)
+			if (!map->emplace(GetName{}(i), &i).second)
+				++n_duplicates;
+	}
+};
@@ -12,21 +12,27 @@
 #include "db/UniqueTags.hxx"
 #include "db/VHelper.hxx"
 #include "db/LightDirectory.hxx"
+#include "song/Filter.hxx"
 #include "Directory.hxx"
 #include "Song.hxx"
 #include "DatabaseSave.hxx"
+#include "BinarySave.hxx"
+#include "TagIndex.hxx"
 #include "db/DatabaseLock.hxx"
 #include "db/DatabaseError.hxx"
 #include "lib/fmt/PathFormatter.hxx"
 #include "lib/zlib/AutoGunzipFileLineReader.hxx"
 #include "io/BufferedOutputStream.hxx"
 #include "io/FileOutputStream.hxx"
+#include "io/MappedFile.hxx"
 #include "fs/FileInfo.hxx"
 #include "config/Block.hxx"
 #include "fs/FileSystem.hxx"
+#include "lib/fmt/RuntimeError.hxx"
 #include "lib/fmt/SystemError.hxx"
 #include "util/CharUtil.hxx"
 #include "util/Domain.hxx"
+#include "util/StringAPI.hxx"
 #include "util/RecursiveMap.hxx"
 #include "Log.hxx"
 
@@ -39,6 +45,25 @@
 
 static constexpr Domain simple_db_domain("simple_db");
 
+/**
+ * Parse the "format" setting.
+ *
+ * Throws on error.
+ *
+ * @return true for the binary format
+ */
+static bool
+ParseFormat(const char *value)
+{
+	if (StringIsEqual(value, "text"))
+		return false;
+	else if (StringIsEqual(value, "binary"))
+		return true;
+	else
+		throw FmtRuntimeError("Unrecognized database format {:?}",
+				      value);
+}
+
 inline SimpleDatabase::SimpleDatabase(const ConfigBlock &block)
 	:Database(simple_db_plugin),
 	 path(block.GetPath("path")),
@@ -46,8 +71,12 @@ inline SimpleDatabase::SimpleDatabase(const ConfigBlock &block)
 #ifdef ENABLE_ZLIB
 	 compress(block.GetBlockValue("compress", true)),
 #endif
+	 binary(ParseFormat(block.GetBlockValue("format", "text"))),
 	 hide_playlist_targets(block.GetBlockValue("hide_playlist_targets", true))
 {
+	if (block.GetBlockValue("tag_index", false))
+		tag_index = std::make_unique<TagIndex>();
+
 	if (path.IsNull())
 		throw std::runtime_error("No \"path\" parameter specified");
 
@@ -59,8 +88,9 @@ SimpleDatabase::SimpleDatabase(AllocatedPath &&_path,
 #ifndef ENABLE_ZLIB
 			       [[maybe_unused]]
 #endif
-			       bool _compress,
-			       bool _hide_playlist_targets) noexcept
+			       bool _compress, bool _binary,
+			       bool _hide_playlist_targets,
+			       bool _tag_index) noexcept
 	:Database(simple_db_plugin),
 	 path(std::move(_path)),
 	 path_utf8(path.ToUTF8()),
@@ -68,10 +98,15 @@ SimpleDatabase::SimpleDatabase(AllocatedPath &&_path,
 #ifdef ENABLE_ZLIB
 	 compress(_compress),
 #endif
+	 binary(_binary),
 	 hide_playlist_targets(_hide_playlist_targets)
 {
+	if (_tag_index)
+		tag_index = std::make_unique<TagIndex>();
 }
 
+SimpleDatabase::~SimpleDatabase() noexcept = default;
+
 DatabasePtr
 SimpleDatabase::Create(EventLoop &, EventLoop &,
 		       [[maybe_unused]] DatabaseListener &listener,
@@ -129,21 +164,38 @@ SimpleDatabase::Check() const
 #endif
 }
 
-void
+bool
 SimpleDatabase::Load()
 {
 	assert(!path.IsNull());
 	assert(root != nullptr);
 
-	AutoGunzipFileLineReader file{path};
+	bool is_binary;
+
+	{
+		const MappedFile mapped{path};
+		is_binary = db_is_binary(mapped.GetData());
 
-	LogDebug(simple_db_domain, "reading DB");
+		if (is_binary) {
+			LogDebug(simple_db_domain, "reading binary DB");
 
-	db_load_internal(file, *root);
+			db_load_binary(mapped.GetData(), *root);
+		}
+	}
+
+	if (!is_binary) {
+		AutoGunzipFileLineReader file{path};
+
+		LogDebug(simple_db_domain, "reading DB");
+
+		db_load_internal(file, *root);
+	}
 
 	FileInfo fi;
 	if (GetFileInfo(path, fi))
 		mtime = fi.GetModificationTime();
+
+	return is_binary != binary;
 }
 
 void
@@ -158,8 +210,10 @@ SimpleDatabase::Open()
 	borrowed_song_count = 0;
 #endif
 
+	bool convert = false;
+
 	try {
-		Load();
+		convert = Load();
 	} catch (...) {
 		LogError(std::current_exception());
 
@@ -169,6 +223,21 @@ SimpleDatabase::Open()
 
 		root = Directory::NewRoot();
 	}
+
+	if (convert) {
+		/* the configured "format" differs from the file's
+		   format: convert it right now instead of waiting
+		   for the next database update */
+		FmtInfo(simple_db_domain, "Converting database {:?} to {} format",
+			path_utf8, binary ? "binary" : "text");
+
+		try {
+			Save();
+		} catch (...) {
+			LogError(std::current_exception(),
+				 "Failed to convert database");
+		}
+	}
 }
 
 void
@@ -188,7 +257,7 @@ SimpleDatabase::GetSong(std::string_view uri) const
 	assert(prefixed_light_song == nullptr);
 	assert(borrowed_song_count == 0);
 
-	ScopeDatabaseLock protect;
+	ScopeDatabaseReadLock protect;
 
 	auto r = root->LookupDirectory(uri);
 
@@ -260,13 +329,54 @@ CheckSelection(DatabaseSelection selection) noexcept
 	return selection;
 }
 
+/**
+ * Is the given #Directory equal to or below the other one?
+ */
+[[gnu::pure]]
+static bool
+IsInside(const Directory &directory, const Directory &ancestor) noexcept
+{
+	for (const Directory *i = &directory; i != nullptr; i = i->parent)
+		if (i == &ancestor)
+			return true;
+
+	return false;
+}
+
+inline bool
+SimpleDatabase::VisitIndexed(const Directory &directory,
+			     const SongFilter *filter,
+			     const VisitSong &visit_song) const
+{
+	if (tag_index == nullptr || filter == nullptr || !visit_song)
+		return false;
+
+	const auto songs = tag_index->Find(*root, *filter);
+	if (!songs)
+		return false;
+
+	for (const Song *song : *songs) {
+		if (hide_playlist_targets && song->in_playlist)
+			continue;
+
+		if (!IsInside(song->parent, directory))
+			continue;
+
+		const auto song2 = song->Export();
+		if (filter->Match(song2))
+			visit_song(song2);
+	}
+
+	return true;
+}
+
 void
 SimpleDatabase::Visit(const DatabaseSelection &selection,
 		      VisitDirectory visit_directory,
 		      VisitSong visit_song,
 		      VisitPlaylist visit_playlist) const
 {
-	ScopeDatabaseLock protect;
+	ScopeDatabaseReadLock protect;
 
 	auto r = root->LookupDirectory(selection.uri);
 
@@ -290,6 +400,14 @@ SimpleDatabase::Visit(const DatabaseSelection &selection,
 		if (selection.recursive && visit_directory)
 			visit_directory(r.directory->Export());
 
+		if (selection.recursive && !visit_directory &&
+		    !visit_playlist && VisitIndexed(*r.directory,
+						   selection.filter,
+						   visit_song)) {
+			helper.Commit();
+			return;
+		}
+
 		r.directory->Walk(selection.recursive, selection.filter,
 				  hide_playlist_targets,
 				  visit_directory, visit_song,
@@ -350,7 +468,9 @@ SimpleDatabase::Save()
 
 #ifdef ENABLE_ZLIB
 	std::unique_ptr<GzipOutputStream> gzip;
-	if (compress) {
+	/* the binary format is never compressed, because it is
+	   supposed to be mapped into memory */
+	if (compress && !binary) {
 		gzip = std::make_unique<GzipOutputStream>(*os);
 		os = gzip.get();
 	}
@@ -358,7 +478,16 @@ SimpleDatabase::Save()
 
 	BufferedOutputStream bos(*os);
 
-	db_save_internal(bos, *root);
+	{
+		/* a shared lock suffices, and it doesn't block
+		   clients which query the database meanwhile */
+		const ScopeDatabaseReadLock protect;
+
+		if (binary)
+			db_save_binary(bos, *root);
+		else
+			db_save_internal(bos, *root);
+	}
 
 	bos.Flush();
 
@@ -429,7 +558,9 @@ SimpleDatabase::Mount(const char *local_uri, const char *storage_uri)
 	constexpr bool compress = false;
 #endif
 	auto db = std::make_unique<SimpleDatabase>(cache_path / name_fs,
-						   compress, hide_playlist_targets);
+						   compress, binary,
+						   hide_playlist_targets,
+						   tag_index != nullptr);
 	db->Open();
 
 	bool exists = db->FileExists();
@@ -467,6 +598,6 @@ SimpleDatabase::Unmount(const char *uri) noexcept
 
 constexpr DatabasePlugin simple_db_plugin = {
 	"simple",
-	DatabasePlugin::FLAG_REQUIRE_STORAGE,
+	DatabasePlugin::FLAG_REQUIRE_STORAGE|DatabasePlugin::FLAG_THREAD_SAFE,
 	SimpleDatabase::Create,
 };
@@ -12,6 +12,7 @@
 #include "config.h"
 
 #include <cassert>
+#include <memory>
 
 struct ConfigBlock;
 struct Directory;
@@ -19,6 +20,8 @@ struct DatabasePlugin;
 class EventLoop;
 class DatabaseListener;
 class PrefixedLightSong;
+class SongFilter;
+class TagIndex;
 
 class SimpleDatabase : public Database {
 	const AllocatedPath path;
@@ -52,12 +55,24 @@ class SimpleDatabase : public Database {
 	const bool compress;
 #endif
 
+	/**
+	 * Use the binary database format (see db_save_binary())
+	 * instead of the text format?
+	 */
+	const bool binary;
+
 	const bool hide_playlist_targets;
 
+	/**
+	 * Optional inverted tag indexes which speed up searches.
+	 */
+	std::unique_ptr<TagIndex> tag_index;
+
 public:
 	SimpleDatabase(const ConfigBlock &block);
-	SimpleDatabase(AllocatedPath &&_path, bool _compress,
-		       bool _hide_playlist_targets) noexcept;
+	SimpleDatabase(AllocatedPath &&_path, bool _compress, bool _binary,
+		       bool _hide_playlist_targets, bool _tag_index) noexcept;
+	~SimpleDatabase() noexcept override;
 
 	static DatabasePtr Create(EventLoop &main_event_loop,
 				  EventLoop &io_event_loop,
@@ -130,10 +145,24 @@ private:
 
 	/**
 	 * Throws #std::runtime_error on error.
+	 *
+	 * @return true if the file was loaded successfully, but it
+	 * is not in the configured format and needs to be converted
 	 */
-	void Load();
+	bool Load();
 
 	DatabasePtr LockUmountSteal(const char *uri) noexcept;
+
+	/**
+	 * Try to find the songs matching the filter with #tag_index
+	 * instead of walking the whole tree.  Caller must lock the
+	 * #db_mutex.
+	 *
+	 * @return false if the index cannot be used
+	 */
+	bool VisitIndexed(const Directory &directory,
+			  const SongFilter *filter,
+			  const VisitSong &visit_song) const;
 };
 
 extern const DatabasePlugin simple_db_plugin;
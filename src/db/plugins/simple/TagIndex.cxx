@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "TagIndex.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "song/Filter.hxx"
+#include "song/TagSongFilter.hxx"
+#include "tag/Fallback.hxx"
+#include "tag/Tag.hxx"
+
+#include <algorithm>
+#include <cassert>
+
+void
+TagIndex::CollectSongs(const Directory &directory)
+{
+	if (directory.IsMount()) {
+		has_mounts = true;
+		return;
+	}
+
+	/* same order as Directory::Walk() */
+
+	for (const auto &song : directory.songs)
+		songs.push_back(&song);
+
+	for (const auto &child : directory.children)
+		CollectSongs(child);
+}
+
+bool
+TagIndex::Check(const Directory &root)
+{
+	assert(holding_db_lock());
+
+	if (valid && generation == db_generation)
+		return !has_mounts;
+
+	valid = false;
+	built = TagMask::None();
+
+	if (!seen || seen_generation != db_generation) {
+		/* the database has been modified since the last
+		   query; don't rebuild the index now, because it may
+		   be modified again soon (e.g. during a database
+		   update) */
+		seen = true;
+		seen_generation = db_generation;
+
+		/* free memory and drop the stale pointers */
+		songs = {};
+		for (auto &i : tags)
+			i = {};
+
+		return false;
+	}
+
+	songs.clear();
+	has_mounts = false;
+	CollectSongs(root);
+
+	if (songs.size() > UINT32_MAX)
+		return false;
+
+	generation = db_generation;
+	valid = true;
+	return !has_mounts;
+}
+
+const std::vector<TagIndex::Entry> &
+TagIndex::GetTag(TagType type)
+{
+	assert(type < TAG_NUM_OF_ITEM_TYPES);
+
+	auto &entries = tags[type];
+	if (built.Test(type))
+		return entries;
+
+	entries.clear();
+
+	for (std::size_t i = 0; i < songs.size(); ++i) {
+		const Tag &tag = songs[i]->tag;
+
+		/* this mimics the fallback logic of
+		   TagSongFilter::Match() */
+		ApplyTagWithFallback(type, [&](TagType type2){
+			bool found = false;
+
+			for (const auto &item : tag) {
+				if (item.type == type2) {
+					entries.push_back({item.value, static_cast<uint32_t>(i)});
+					found = true;
+				}
+			}
+
+			return found;
+		});
+	}
+
+	std::sort(entries.begin(), entries.end());
+
+	/* remove duplicate values within one song */
+	entries.erase(std::unique(entries.begin(), entries.end(),
+				  [](const Entry &a, const Entry &b){
+					  return a.song == b.song &&
+						  a.value == b.value;
+				  }),
+		      entries.end());
+
+	built.Set(type);
+	return entries;
+}
+
+std::optional<std::span<const TagIndex::Entry>>
+TagIndex::Lookup(const TagSongFilter &f)
+{
+	const TagType type = f.GetTagType();
+	if (type >= TAG_NUM_OF_ITEM_TYPES ||
+	    f.IsNegated() || f.GetFoldCase() || f.IsRegex())
+		return std::nullopt;
+
+	const std::string_view value = f.GetValue();
+	if (value.empty())
+		/* an empty value also matches songs which don't have
+		   this tag at all */
+		return std::nullopt;
+
+	const bool prefix = f.GetPosition() == StringFilter::Position::PREFIX;
+	if (!prefix && f.GetPosition() != StringFilter::Position::FULL)
+		return std::nullopt;
+
+	const std::span<const Entry> entries = GetTag(type);
+
+	const auto begin = std::partition_point(entries.begin(), entries.end(),
+						[value](const Entry &e){
+							return e.value < value;
+						});
+
+	const auto end = prefix
+		? std::partition_point(begin, entries.end(),
+				       [value](const Entry &e){
+					       return e.value.starts_with(value);
+				       })
+		: std::partition_point(begin, entries.end(),
+				       [value](const Entry &e){
+					       return e.value == value;
+				       });
+
+	return std::span<const Entry>{begin, end};
+}
+
+std::optional<std::vector<const Song *>>
+TagIndex::Find(const Directory &root, const SongFilter &filter)
+{
+	const std::scoped_lock lock{mutex};
+
+	if (!Check(root))
+		return std::nullopt;
+
+	/* pick the most selective indexable filter item */
+	std::optional<std::span<const Entry>> best;
+	for (const auto &i : filter.GetItems()) {
+		const auto *f = dynamic_cast<const TagSongFilter *>(i.get());
+		if (f == nullptr)
+			continue;
+
+		const auto r = Lookup(*f);
+		if (r && (!best || r->size() < best->size()))
+			best = r;
+	}
+
+	if (!best)
+		return std::nullopt;
+
+	std::vector<uint32_t> ids;
+	ids.reserve(best->size());
+	for (const auto &e : *best)
+		ids.push_back(e.song);
+
+	/* restore the Directory::Walk() order and remove
+	   duplicates (prefix matches may yield several values per
+	   song) */
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+	std::vector<const Song *> result;
+	result.reserve(ids.size());
+	for (const auto id : ids)
+		result.push_back(songs[id]);
+
+	return result;
+}
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_SIMPLE_TAG_INDEX_HXX
+#define MPD_SIMPLE_TAG_INDEX_HXX
+
+#include "tag/Mask.hxx"
+#include "tag/Type.hxx"
+#include "thread/Mutex.hxx"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+struct Directory;
+struct Song;
+class SongFilter;
+class TagSongFilter;
+
+/**
+ * Inverted indexes which map tag values to songs.  They are used by
+ * SimpleDatabase::Visit() to avoid evaluating a #SongFilter on all
+ * songs if the filter contains an exact-match or prefix
+ * #TagSongFilter.
+ *
+ * The song list is built lazily, and the index for one #TagType
+ * only when it is first needed.  Since the database tree gets
+ * modified from many places, this class does not attempt to update
+ * the indexes incrementally; instead, they are discarded after each
+ * modification (see #db_generation) and rebuilt once the database
+ * has settled (i.e. not during a database update).
+ *
+ * All methods are thread-safe, but the caller must hold the database
+ * lock (shared or exclusive).
+ */
+class TagIndex {
+	struct Entry {
+		/**
+		 * Points to a #TagItem value owned by the tag pool.
+		 */
+		std::string_view value;
+
+		/**
+		 * Index into #songs.
+		 */
+		uint32_t song;
+
+		[[gnu::pure]]
+		bool operator<(const Entry &other) const noexcept {
+			return value != other.value
+				? value < other.value
+				: song < other.song;
+		}
+	};
+
+	Mutex mutex;
+
+	/**
+	 * The #db_generation when the song list was built.
+	 */
+	unsigned generation;
+
+	/**
+	 * The #db_generation when a stale index was last seen.  If
+	 * it is still the same on the next query, the database has
+	 * settled and the index gets rebuilt.
+	 */
+	unsigned seen_generation;
+
+	bool valid = false, seen = false;
+
+	/**
+	 * Does the tree contain mount points?  Their songs are not
+	 * in this index, so it cannot be used.
+	 */
+	bool has_mounts;
+
+	/**
+	 * All songs in the order visited by Directory::Walk().
+	 */
+	std::vector<const Song *> songs;
+
+	/**
+	 * Which elements of #tags have been built already?
+	 */
+	TagMask built = TagMask::None();
+
+	/**
+	 * For each #TagType, a list of (value, song) pairs sorted by
+	 * value.
+	 */
+	std::array<std::vector<Entry>, TAG_NUM_OF_ITEM_TYPES> tags;
+
+public:
+	/**
+	 * Find all songs which may match the given filter; the caller
+	 * needs to check each of them with SongFilter::Match().  The
+	 * songs are returned in the order of Directory::Walk().
+	 *
+	 * @return std::nullopt if the index cannot be used for this
+	 * filter (or is not available right now)
+	 */
+	std::optional<std::vector<const Song *>> Find(const Directory &root,
+						      const SongFilter &filter);
+
+private:
+	/**
+	 * Check whether the index is valid and rebuild it if
+	 * appropriate.  Caller must lock the mutex.
+	 *
+	 * @return true if the index can be used
+	 */
+	bool Check(const Directory &root);
+
+	void CollectSongs(const Directory &directory);
+
+	const std::vector<Entry> &GetTag(TagType type);
+
+	/**
+	 * Look up the entries matching the given #TagSongFilter.
+	 * Caller must lock the mutex.
+	 *
+	 * @return std::nullopt if the filter is not supported by
+	 * the index
+	 */
+	std::optional<std::span<const Entry>> Lookup(const TagSongFilter &f);
+};
+
+#endif
@@ -15,6 +15,12 @@ struct UpdateConfig {
 	bool follow_outside_symlinks = DEFAULT_FOLLOW_OUTSIDE_SYMLINKS;
 #endif
 
+	/**
+	 * The number of threads which load song tags.  With only
+	 * one thread, tags are loaded by the update thread itself.
+	 */
+	unsigned n_threads = 1;
+
 	explicit UpdateConfig(const ConfigData &config);
 };
 
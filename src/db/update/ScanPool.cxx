@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "ScanPool.hxx"
+#include "UpdateDomain.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
+#include "Log.hxx"
+#include "thread/Name.hxx"
+#include "thread/Util.hxx"
+
+#include <cassert>
+
+void
+UpdateScanJob::Run(Storage &storage) noexcept
+try {
+	auto new_song = std::make_unique<Song>(name, directory);
+	if (new_song->UpdateFile(storage, info))
+		result = std::move(new_song);
+} catch (...) {
+	FmtError(update_domain,
+		 "error reading file {}/{}: {}",
+		 directory.GetPath(), name,
+		 std::current_exception());
+}
+
+UpdateScanPool::UpdateScanPool(Storage &_storage, unsigned n_threads)
+	:storage(_storage)
+{
+	assert(n_threads > 0);
+
+	try {
+		for (unsigned i = 0; i < n_threads; ++i) {
+			threads.emplace_front(BIND_THIS_METHOD(WorkerThread));
+			threads.front().Start();
+		}
+	} catch (...) {
+		/* the first Thread object was never started */
+		threads.pop_front();
+		StopThreads();
+		throw;
+	}
+}
+
+UpdateScanPool::~UpdateScanPool() noexcept
+{
+	StopThreads();
+}
+
+void
+UpdateScanPool::StopThreads() noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		quit = true;
+		worker_cond.notify_all();
+	}
+
+	for (auto &i : threads)
+		i.Join();
+
+	threads.clear();
+}
+
+void
+UpdateScanPool::Cancel() noexcept
+{
+	const std::scoped_lock lock{mutex};
+	n_pending -= queue.size();
+	queue.clear();
+}
+
+std::list<UpdateScanJob>
+UpdateScanPool::Collect(std::size_t max_pending) noexcept
+{
+	std::unique_lock lock{mutex};
+	done_cond.wait(lock, [this, max_pending]{
+		return n_pending - done.size() <= max_pending;
+	});
+
+	n_pending -= done.size();
+
+	std::list<UpdateScanJob> result;
+	result.swap(done);
+	return result;
+}
+
+void
+UpdateScanPool::WorkerThread() noexcept
+{
+	SetThreadName("update_scan");
+	SetThreadIdlePriority();
+
+	std::unique_lock lock{mutex};
+
+	while (true) {
+		worker_cond.wait(lock, [this]{
+			return quit || !queue.empty();
+		});
+
+		if (quit)
+			break;
+
+		/* move the job to a local list, so it survives
+		   Cancel() */
+		std::list<UpdateScanJob> current;
+		current.splice(current.end(), queue, queue.begin());
+
+		lock.unlock();
+
+		const auto start = std::chrono::steady_clock::now();
+		current.front().Run(storage);
+		const auto duration = std::chrono::steady_clock::now() - start;
+
+		lock.lock();
+
+		scan_duration += duration;
+		done.splice(done.end(), current);
+		done_cond.notify_all();
+	}
+}
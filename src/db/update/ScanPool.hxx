@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include "db/plugins/simple/Ptr.hxx"
+#include "storage/FileInfo.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+
+#include <chrono>
+#include <forward_list>
+#include <list>
+#include <string>
+
+struct Directory;
+struct Song;
+class Storage;
+
+/**
+ * A request to load the tags of one song file, submitted to an
+ * #UpdateScanPool.
+ */
+struct UpdateScanJob {
+	Directory &directory;
+
+	/**
+	 * The existing #Song which shall be updated, or nullptr if
+	 * this is a new file.  Worker threads never touch this
+	 * object; the result is applied to it by the caller of
+	 * UpdateScanPool::Collect().
+	 */
+	Song *const song;
+
+	const std::string name;
+
+	const StorageFileInfo info;
+
+	/**
+	 * The result: a new (unlinked) #Song object with the tags
+	 * which were loaded from the file, or nullptr if the file was
+	 * not recognized.
+	 */
+	SongPtr result;
+
+	template<typename N>
+	UpdateScanJob(Directory &_directory, Song *_song,
+		      N &&_name, const StorageFileInfo &_info) noexcept
+		:directory(_directory), song(_song),
+		 name(std::forward<N>(_name)), info(_info) {}
+
+	/**
+	 * Load the tags and store them in #result.  This method
+	 * does not access the #Directory tree (other than reading
+	 * the path of #directory) and may be called from any thread.
+	 */
+	void Run(Storage &storage) noexcept;
+};
+
+/**
+ * A pool of threads which load song tags for #UpdateWalk.  This
+ * allows the walker to continue reading directories while the tags
+ * of many files are being loaded concurrently, which helps with
+ * storages which have a high latency (e.g. NFS or SMB).
+ *
+ * The worker threads do not modify the #Directory tree; the walker
+ * collects the finished jobs and merges them into the tree.
+ */
+class UpdateScanPool final {
+	Storage &storage;
+
+	std::forward_list<Thread> threads;
+
+	mutable Mutex mutex;
+
+	/**
+	 * Signalled when a new job is queued or when the pool shall
+	 * quit.
+	 */
+	Cond worker_cond;
+
+	/**
+	 * Signalled when a job has been finished.
+	 */
+	Cond done_cond;
+
+	/**
+	 * Jobs which have not been picked up by a worker yet.
+	 */
+	std::list<UpdateScanJob> queue;
+
+	/**
+	 * Jobs which are finished and wait to be collected.
+	 */
+	std::list<UpdateScanJob> done;
+
+	/**
+	 * The number of jobs which have been submitted but not yet
+	 * collected.
+	 */
+	std::size_t n_pending = 0;
+
+	/**
+	 * The total time spent by all worker threads loading tags.
+	 */
+	std::chrono::steady_clock::duration scan_duration{};
+
+	bool quit = false;
+
+public:
+	UpdateScanPool(Storage &_storage, unsigned n_threads);
+	~UpdateScanPool() noexcept;
+
+	UpdateScanPool(const UpdateScanPool &) = delete;
+	UpdateScanPool &operator=(const UpdateScanPool &) = delete;
+
+	/**
+	 * Submit a new job.
+	 */
+	template<typename N>
+	void Push(Directory &directory, Song *song,
+		  N &&name, const StorageFileInfo &info) noexcept {
+		const std::scoped_lock lock{mutex};
+		queue.emplace_back(directory, song,
+				   std::forward<N>(name), info);
+		++n_pending;
+		worker_cond.notify_one();
+	}
+
+	/**
+	 * Remove all jobs which have not yet been started.
+	 */
+	void Cancel() noexcept;
+
+	/**
+	 * Wait until no more than the given number of jobs is
+	 * pending, and return all finished jobs.
+	 *
+	 * @param max_pending the maximum number of pending jobs; 0
+	 * waits for all jobs to finish
+	 */
+	std::list<UpdateScanJob> Collect(std::size_t max_pending) noexcept;
+
+	std::chrono::steady_clock::duration GetScanDuration() const noexcept {
+		const std::scoped_lock lock{mutex};
+		return scan_duration;
+	}
+
+private:
+	void StopThreads() noexcept;
+
+	/* the worker thread function */
+	void WorkerThread() noexcept;
+};
@@ -61,7 +61,7 @@ UpdateService::CancelMount(const char *uri) noexcept
 
 	Directory::LookupResult lr;
 	{
-		const ScopeDatabaseLock protect;
+		const ScopeDatabaseReadLock protect;
 		lr = db.GetRoot().LookupDirectory(uri);
 	}
 
@@ -162,7 +162,7 @@ UpdateService::Enqueue(std::string_view path, bool discard)
 
 	Directory::LookupResult lr;
 	{
-		const ScopeDatabaseLock protect;
+		const ScopeDatabaseReadLock protect;
 		lr = db.GetRoot().LookupDirectory(path);
 	}
 
@@ -2,6 +2,7 @@
 // Copyright The Music Player Daemon Project
 
 #include "Walk.hxx"
+#include "ScanPool.hxx"
 #include "UpdateIO.hxx"
 #include "UpdateDomain.hxx"
 #include "lib/fmt/ExceptionFormatter.hxx"
@@ -41,37 +42,12 @@ try {
 		FmtDebug(update_domain, "reading {}/{}",
 			 directory.GetPath(), name);
 
-		auto new_song = Song::LoadFile(storage, name, info,
-					       directory);
-		if (!new_song) {
-			FmtDebug(update_domain,
-				 "ignoring unrecognized file {}/{}",
-				 directory.GetPath(), name);
-			return;
-		}
-
-		new_song->mark = true;
-		new_song->added = std::chrono::system_clock::now();
-
-		{
-			const ScopeDatabaseLock protect;
-			directory.AddSong(std::move(new_song));
-		}
-
-		modified = true;
-		FmtNotice(update_domain, "added {}/{}",
-			  directory.GetPath(), name);
+		ScanSongFile(directory, nullptr, name, info);
 	} else if (info.mtime != song->mtime || walk_discard) {
 		FmtNotice(update_domain, "updating {}/{}",
 			  directory.GetPath(), name);
-		if (song->UpdateFile(storage, info))
-			song->mark = true;
-		else
-			FmtDebug(update_domain,
-				 "deleting unrecognized file {}/{}",
-				 directory.GetPath(), name);
 
-		modified = true;
+		ScanSongFile(directory, song, name, info);
 	} else {
 		/* not modified */
 		song->mark = true;
@@ -93,3 +69,97 @@ UpdateWalk::UpdateSongFile(Directory &directory,
 	UpdateSongFile2(directory, name, suffix, info);
 	return true;
 }
+
+void
+UpdateWalk::ScanSongFile(Directory &directory, Song *song,
+			 std::string_view name,
+			 const StorageFileInfo &info) noexcept
+{
+	if (song != nullptr)
+		/* mark it right now, so PurgeDeletedFromDirectory()
+		   doesn't delete it while the job is pending;
+		   ApplyScanJob() deletes it if the file is not
+		   recognized anymore */
+		song->mark = true;
+
+	if (scan_pool != nullptr) {
+		scan_pool->Push(directory, song, name, info);
+
+		/* merge finished jobs, and throttle the walk if the
+		   worker threads can't keep up */
+		CollectScanJobs(config.n_threads * 16);
+		return;
+	}
+
+	UpdateScanJob job{directory, song, name, info};
+
+	const auto start = std::chrono::steady_clock::now();
+	job.Run(storage);
+	const auto end = std::chrono::steady_clock::now();
+	scan_duration += end - start;
+
+	{
+		const ScopeDatabaseLock protect;
+		ApplyScanJob(job);
+	}
+
+	merge_duration += std::chrono::steady_clock::now() - end;
+}
+
+void
+UpdateWalk::ApplyScanJob(UpdateScanJob &job) noexcept
+{
+	Directory &directory = job.directory;
+
+	++n_scanned;
+
+	if (job.song == nullptr) {
+		if (!job.result) {
+			FmtDebug(update_domain,
+				 "ignoring unrecognized file {}/{}",
+				 directory.GetPath(), job.name);
+			return;
+		}
+
+		job.result->mark = true;
+		job.result->added = std::chrono::system_clock::now();
+		directory.AddSong(std::move(job.result));
+
+		FmtNotice(update_domain, "added {}/{}",
+			  directory.GetPath(), job.name);
+	} else if (job.result) {
+		Song &song = *job.song;
+		song.tag = std::move(job.result->tag);
+		song.mtime = job.result->mtime;
+		song.audio_format = job.result->audio_format;
+	} else {
+		FmtDebug(update_domain,
+			 "deleting unrecognized file {}/{}",
+			 directory.GetPath(), job.name);
+
+		editor.DeleteSong(directory, job.song);
+	}
+
+	modified = true;
+}
+
+void
+UpdateWalk::CollectScanJobs(std::size_t max_pending) noexcept
+{
+	if (scan_pool == nullptr)
+		return;
+
+	auto jobs = scan_pool->Collect(max_pending);
+	if (jobs.empty())
+		return;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	{
+		const ScopeDatabaseLock protect;
+		for (auto &job : jobs)
+			ApplyScanJob(job);
+	}
+
+	merge_duration += std::chrono::steady_clock::now() - start;
+}
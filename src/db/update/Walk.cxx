@@ -4,6 +4,7 @@
 #include "Walk.hxx"
 #include "UpdateIO.hxx"
 #include "Editor.hxx"
+#include "ScanPool.hxx"
 #include "UpdateDomain.hxx"
 #include "db/DatabaseLock.hxx"
 #include "db/Uri.hxx"
@@ -38,6 +39,26 @@ UpdateWalk::UpdateWalk(const UpdateConfig &_config,
 	 storage(_storage),
 	 editor(_loop, _listener)
 {
+	if (config.n_threads > 1) {
+		try {
+			scan_pool = std::make_unique<UpdateScanPool>(storage,
+								     config.n_threads);
+		} catch (...) {
+			LogError(std::current_exception(),
+				 "Failed to start update threads");
+		}
+	}
+}
+
+UpdateWalk::~UpdateWalk() noexcept = default;
+
+void
+UpdateWalk::Cancel() noexcept
+{
+	cancel = true;
+
+	if (scan_pool != nullptr)
+		scan_pool->Cancel();
 }
 
 static void
@@ -340,6 +361,8 @@ UpdateWalk::UpdateDirectory(Directory &directory,
 
 	directory_set_stat(directory, info);
 
+	++n_directories;
+
 	std::unique_ptr<StorageDirectoryReader> reader;
 
 	try {
@@ -510,6 +533,14 @@ UpdateWalk::Walk(Directory &root, const char *path, bool discard) noexcept
 	walk_discard = discard;
 	modified = false;
 
+	n_directories = n_scanned = 0;
+	scan_duration = merge_duration = {};
+
+	const auto start_time = std::chrono::steady_clock::now();
+	const auto pool_scan_start = scan_pool != nullptr
+		? scan_pool->GetScanDuration()
+		: std::chrono::steady_clock::duration{};
+
 	if (path != nullptr && !isRootDirectory(path)) {
 		UpdateUri(root, path);
 	} else {
@@ -528,11 +559,27 @@ UpdateWalk::Walk(Directory &root, const char *path, bool discard) noexcept
 		UpdateDirectory(root, exclude_list, info);
 	}
 
+	/* the remaining steps need the tags of all songs */
+	CollectScanJobs(0);
+
 	{
 		const ScopeDatabaseLock protect;
 		root.ClearInPlaylist();
 		PurgeDanglingFromPlaylists(root);
 	}
 
+	if (scan_pool != nullptr)
+		scan_duration = scan_pool->GetScanDuration() - pool_scan_start;
+
+	using FloatSeconds = std::chrono::duration<double>;
+	FmtInfo(update_domain,
+		"walked {} directories and scanned {} files in {:.1f}s "
+		"(tag scanning: {:.1f}s in {} thread(s), merging: {:.1f}s)",
+		n_directories, n_scanned,
+		FloatSeconds(std::chrono::steady_clock::now() - start_time).count(),
+		FloatSeconds(scan_duration).count(),
+		scan_pool != nullptr ? config.n_threads : 1,
+		FloatSeconds(merge_duration).count());
+
 	return modified;
 }
@@ -8,6 +8,8 @@
 #include "archive/Features.h" // for ENABLE_ARCHIVE
 
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <string_view>
 
 struct StorageFileInfo;
@@ -18,6 +20,8 @@ class SongEnumerator;
 class ArchiveFile;
 class Storage;
 class ExcludeList;
+class UpdateScanPool;
+struct UpdateScanJob;
 
 class UpdateWalk final {
 #ifdef ENABLE_ARCHIVE
@@ -40,18 +44,30 @@ class UpdateWalk final {
 
 	DatabaseEditor editor;
 
+	/**
+	 * Loads song tags in worker threads.  This is nullptr if
+	 * only one thread is configured; in that case, tags are
+	 * loaded synchronously.
+	 */
+	std::unique_ptr<UpdateScanPool> scan_pool;
+
+	/**
+	 * Statistics for the log message at the end of Walk().
+	 */
+	unsigned n_directories, n_scanned;
+	std::chrono::steady_clock::duration scan_duration, merge_duration;
+
 public:
 	UpdateWalk(const UpdateConfig &_config,
 		   EventLoop &_loop, DatabaseListener &_listener,
 		   Storage &_storage) noexcept;
+	~UpdateWalk() noexcept;
 
 	/**
 	 * Cancel the current update and quit the Walk() method as
 	 * soon as possible.
 	 */
-	void Cancel() noexcept {
-		cancel = true;
-	}
+	void Cancel() noexcept;
 
 	/**
 	 * Returns true if the database was modified.
@@ -85,6 +101,34 @@ private:
 			    std::string_view name, std::string_view suffix,
 			    const StorageFileInfo &info) noexcept;
 
+	/**
+	 * Load the tags of a new or modified song file, either
+	 * synchronously or by submitting a job to the #scan_pool.
+	 *
+	 * @param song the existing #Song object or nullptr if this
+	 * is a new file
+	 */
+	void ScanSongFile(Directory &directory, Song *song,
+			  std::string_view name,
+			  const StorageFileInfo &info) noexcept;
+
+	/**
+	 * Merge the result of a finished #UpdateScanJob into the
+	 * database.
+	 *
+	 * Caller must lock the #db_mutex.
+	 */
+	void ApplyScanJob(UpdateScanJob &job) noexcept;
+
+	/**
+	 * Collect finished jobs from the #scan_pool and merge them
+	 * into the database.
+	 *
+	 * @param max_pending wait until no more than this number of
+	 * jobs is pending; 0 waits for all jobs
+	 */
+	void CollectScanJobs(std::size_t max_pending) noexcept;
+
 	bool UpdateContainerFile(Directory &directory,
 				 std::string_view name, std::string_view suffix,
 				 const StorageFileInfo &info) noexcept;
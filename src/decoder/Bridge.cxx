@@ -108,6 +108,19 @@ DecoderBridge::GetChunk() noexcept
 		return current_chunk.get();
 
 	do {
+		if (pipe_limit_reached) {
+			/* the player doesn't want more chunks from us
+			   yet (see DecoderControl::SetPipeLimit());
+			   check again while holding the lock, so we
+			   don't miss the wakeup */
+			std::unique_lock lock{dc.mutex};
+			pipe_limit_reached = dc.IsPipeLimitReached();
+			cmd = pipe_limit_reached
+				? NeedChunks(dc, lock)
+				: dc.command;
+			continue;
+		}
+
 		current_chunk = dc.buffer->Allocate();
 		if (current_chunk != nullptr) {
 			current_chunk->replay_gain_serial = replay_gain_serial;
@@ -136,6 +149,7 @@ DecoderBridge::FlushChunk() noexcept
 		dc.pipe->Push(std::move(chunk));
 
 	const std::scoped_lock protect{dc.mutex};
+	pipe_limit_reached = dc.IsPipeLimitReached();
 	dc.client_cond.notify_one();
 }
 
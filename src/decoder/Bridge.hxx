@@ -86,6 +86,13 @@ private:
 	/** the chunk currently being written to */
 	MusicChunkPtr current_chunk;
 
+	/**
+	 * Has #DecoderControl::pipe reached the limit set by
+	 * DecoderControl::SetPipeLimit()?  This is updated by
+	 * FlushChunk() and GetChunk().
+	 */
+	bool pipe_limit_reached = false;
+
 	ReplayGainInfo replay_gain_info;
 
 	/**
@@ -95,6 +95,13 @@ DecoderControl::Stop(std::unique_lock<Mutex> &lock) noexcept
 		SynchronousCommandLocked(lock, DecoderCommand::STOP);
 }
 
+bool
+DecoderControl::IsPipeLimitReached() const noexcept
+{
+	return pipe_limit > 0 && pipe != nullptr &&
+		pipe->GetSize() >= pipe_limit;
+}
+
 void
 DecoderControl::Seek(std::unique_lock<Mutex> &lock, SongTime t)
 {
@@ -151,6 +151,16 @@ public:
 	 */
 	std::shared_ptr<MusicPipe> pipe;
 
+private:
+	/**
+	 * If non-zero, then the decoder stops (as if the
+	 * #MusicBuffer was full) while #pipe contains at least this
+	 * number of chunks.  Protected by #mutex.
+	 */
+	unsigned pipe_limit = 0;
+
+public:
+
 	const ReplayGainConfig replay_gain_config;
 	ReplayGainMode replay_gain_mode = ReplayGainMode::OFF;
 
@@ -396,6 +406,23 @@ public:
 	 */
 	void Stop(std::unique_lock<Mutex> &lock) noexcept;
 
+	/**
+	 * Limit the number of chunks the decoder may push into
+	 * #pipe; 0 means no limit.  After lifting or raising the
+	 * limit, call Signal() to wake up the decoder.
+	 *
+	 * Caller must lock the object.
+	 */
+	void SetPipeLimit(unsigned _pipe_limit) noexcept {
+		pipe_limit = _pipe_limit;
+	}
+
+	/**
+	 * Caller must lock the object.
+	 */
+	[[gnu::pure]]
+	bool IsPipeLimitReached() const noexcept;
+
 	/**
 	 * Throws #std::runtime_error on error.
 	 *
@@ -435,6 +462,20 @@ public:
 	 */
 	void CycleMixRamp() noexcept;
 
+	/**
+	 * Copy the ReplayGain and MixRamp values of the song decoded
+	 * by the other instance to the "previous" attributes, as if
+	 * this instance had decoded that song before its current
+	 * one.  This is used after this instance has decoded the next
+	 * song ahead of time.
+	 *
+	 * Caller must lock the object.
+	 */
+	void InheritPrevious(const DecoderControl &other) noexcept {
+		replay_gain_prev_db = other.replay_gain_db;
+		previous_mix_ramp = other.mix_ramp;
+	}
+
 private:
 	void RunThread() noexcept;
 
@@ -4,6 +4,7 @@
 #include "Configured.hxx"
 #include "EncoderList.hxx"
 #include "EncoderPlugin.hxx"
+#include "Shared.hxx"
 #include "config/Block.hxx"
 #include "lib/fmt/RuntimeError.hxx"
 #include "util/StringAPI.hxx"
@@ -35,6 +36,6 @@ GetConfiguredEncoderPlugin(const ConfigBlock &block, bool shout_legacy)
 PreparedEncoder *
 CreateConfiguredEncoder(const ConfigBlock &block, bool shout_legacy)
 {
-	return encoder_init(GetConfiguredEncoderPlugin(block, shout_legacy),
-			    block);
+	return CreateShareableEncoder(GetConfiguredEncoderPlugin(block, shout_legacy),
+				      block);
 }
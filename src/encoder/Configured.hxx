@@ -10,7 +10,8 @@ class PreparedEncoder;
 /**
  * Create a #PreparedEncoder instance from the settings in the
  * #ConfigBlock.  Its "encoder" setting is used to choose the encoder
- * plugin.
+ * plugin.  See CreateShareableEncoder() for the "share_encoder"
+ * setting.
  *
  * Throws an exception on error.
  *
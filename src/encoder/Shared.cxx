@@ -0,0 +1,833 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "Shared.hxx"
+#include "EncoderInterface.hxx"
+#include "EncoderPlugin.hxx"
+#include "config/Block.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "tag/Tag.hxx"
+#include "thread/Mutex.hxx"
+#include "util/AllocatedArray.hxx"
+#include "util/Domain.hxx"
+#include "util/IntrusiveList.hxx"
+#include "util/SpanCast.hxx"
+#include "util/StringBuffer.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+static constexpr Domain shared_encoder_domain("shared_encoder");
+
+namespace {
+
+[[gnu::pure]]
+static bool
+IsSilence(std::span<const std::byte> src) noexcept
+{
+	return std::all_of(src.begin(), src.end(),
+			   [](std::byte b){ return b == std::byte{}; });
+}
+
+/**
+ * Serialize a #Tag so it can be compared with memcmp().
+ */
+static std::string
+SerializeTag(const Tag &tag) noexcept
+{
+	std::string result;
+	for (const auto &i : tag) {
+		result.push_back(static_cast<char>(i.type));
+		result.append(i.value);
+		result.push_back('\0');
+	}
+
+	return result;
+}
+
+/**
+ * One call to the shared #Encoder, together with its input (for
+ * comparing it with the calls made by the other outputs) and the
+ * encoded data it has produced.
+ */
+struct SharedEncoderOp {
+	enum class Type : uint_least8_t {
+		WRITE,
+		FLUSH,
+		PRE_TAG,
+		TAG,
+		END,
+	};
+
+	const Type type;
+
+	/**
+	 * WRITE: the PCM data; TAG: the serialized tag.
+	 */
+	const AllocatedArray<std::byte> input;
+
+	/**
+	 * The encoded data which was returned by Encoder::Read()
+	 * after this call.
+	 */
+	std::vector<std::byte> output;
+
+	SharedEncoderOp(Type _type, std::span<const std::byte> _input) noexcept
+		:type(_type), input(_input) {}
+
+	/**
+	 * Is this call "soft", i.e. may it be skipped by outputs
+	 * which have not made this call?  That applies to Flush()
+	 * (which just makes data available earlier) and to silence
+	 * (which is written while paused, at a pace which differs
+	 * between outputs).
+	 */
+	[[gnu::pure]]
+	static bool IsSoft(Type type, std::span<const std::byte> input) noexcept {
+		return type == Type::FLUSH ||
+			(type == Type::WRITE && IsSilence(input));
+	}
+
+	[[gnu::pure]]
+	bool IsSoft() const noexcept {
+		return IsSoft(type, input);
+	}
+
+	[[gnu::pure]]
+	bool Matches(Type _type, std::span<const std::byte> _input) const noexcept {
+		return type == _type && input.size() == _input.size() &&
+			std::memcmp(input.data(), _input.data(),
+				    _input.size()) == 0;
+	}
+};
+
+class SharedEncoderGroup;
+
+/**
+ * The #Encoder implementation returned by
+ * PreparedSharedEncoder::Open().  It submits all calls to a
+ * #SharedEncoderGroup, and falls back to a private #Encoder if its
+ * input differs.
+ */
+class SharedEncoder final : public Encoder, public IntrusiveListHook<> {
+	friend class SharedEncoderGroup;
+
+	/**
+	 * Used to open the private encoder.
+	 */
+	PreparedEncoder &prepared;
+
+	const AudioFormat audio_format;
+
+	const std::shared_ptr<SharedEncoderGroup> group;
+
+	enum class State : uint_least8_t {
+		/**
+		 * This output has joined the group after data has
+		 * been encoded; its position will be determined by
+		 * the first call which is not soft.
+		 */
+		JOINING,
+
+		/**
+		 * The input of this output has been identical to
+		 * the group's input so far.
+		 */
+		SYNCHRONIZED,
+
+		/**
+		 * The input has differed; the remaining encoded data
+		 * up to #next_op is still being read, after that,
+		 * the private encoder is used.
+		 */
+		DIVERGED,
+
+		/**
+		 * No more data from the group.
+		 */
+		LOST,
+	} state;
+
+	std::size_t header_position = 0;
+
+	/**
+	 * The absolute index of the next #SharedEncoderOp to be
+	 * matched with this output's next call.
+	 */
+	uint_least64_t next_op;
+
+	/**
+	 * The absolute index of the #SharedEncoderOp whose output is
+	 * being read, and the position within that output.
+	 */
+	uint_least64_t read_op;
+	std::size_t read_position = 0;
+
+	std::unique_ptr<Encoder> private_encoder;
+
+public:
+	SharedEncoder(PreparedEncoder &_prepared, AudioFormat _audio_format,
+		      std::shared_ptr<SharedEncoderGroup> &&_group) noexcept;
+	~SharedEncoder() noexcept override;
+
+	/* virtual methods from class Encoder */
+	void End() override;
+	void Flush() override;
+	void PreTag() override;
+	void SendTag(const Tag &tag) override;
+	void Write(std::span<const std::byte> src) override;
+	std::span<const std::byte> Read(std::span<std::byte> buffer) noexcept override;
+
+private:
+	/**
+	 * Submit a call to the group; if that fails, switch to the
+	 * private encoder.
+	 *
+	 * @return true if the call has been handled by the group,
+	 * false if the caller needs to invoke the private encoder
+	 */
+	bool Submit(SharedEncoderOp::Type type,
+		    std::span<const std::byte> input,
+		    const Tag *tag=nullptr);
+};
+
+/**
+ * One #Encoder instance shared by several #SharedEncoder instances.
+ * It contains a log of recent calls; the first #SharedEncoder to
+ * make a call performs it on the real #Encoder, and the others just
+ * compare their call with the log and copy the encoded data.
+ */
+class SharedEncoderGroup {
+	/**
+	 * Keep this number of recent calls, even if all outputs have
+	 * read them, so outputs which are opened a bit later can
+	 * join.
+	 */
+	static constexpr std::size_t HISTORY = 64;
+
+	/**
+	 * Never keep more than this number of calls; outputs which
+	 * are lagging behind (e.g. because they have been paused)
+	 * are disconnected from the group.
+	 */
+	static constexpr std::size_t MAX_OPS = 4096;
+
+	const std::string key;
+
+	Mutex mutex;
+
+	const std::unique_ptr<Encoder> encoder;
+
+	const AudioFormat audio_format;
+
+	/**
+	 * The encoded data which was returned by Encoder::Read()
+	 * right after opening the encoder.
+	 */
+	std::vector<std::byte> header;
+
+	std::deque<SharedEncoderOp> ops;
+
+	/**
+	 * The absolute index of ops.front().
+	 */
+	uint_least64_t base = 0;
+
+	/**
+	 * The error thrown by the last call to the #Encoder.  After
+	 * that, the #Encoder cannot be used anymore.
+	 */
+	std::exception_ptr error;
+
+	/**
+	 * Has Encoder::End() been called?
+	 */
+	bool ended = false;
+
+	IntrusiveList<SharedEncoder,
+		      IntrusiveListBaseHookTraits<SharedEncoder>,
+		      IntrusiveListOptions{.constant_time_size = true}> subscribers;
+
+public:
+	SharedEncoderGroup(std::string_view _key,
+			   std::unique_ptr<Encoder> &&_encoder,
+			   AudioFormat _audio_format) noexcept;
+
+	std::string_view GetKey() const noexcept {
+		return key;
+	}
+
+	/**
+	 * The #AudioFormat after the #Encoder has modified it.
+	 */
+	AudioFormat GetAudioFormat() const noexcept {
+		return audio_format;
+	}
+
+	bool ImplementsTag() const noexcept {
+		return encoder->ImplementsTag();
+	}
+
+	void Subscribe(SharedEncoder &s) noexcept;
+	void Unsubscribe(SharedEncoder &s) noexcept;
+
+	/**
+	 * Submit a call from the given #SharedEncoder.
+	 *
+	 * Throws on error.
+	 *
+	 * @return false if the call differs from the group's log and
+	 * the caller must use a private #Encoder from now on
+	 */
+	bool Submit(SharedEncoder &s, SharedEncoderOp::Type type,
+		    std::span<const std::byte> input,
+		    const Tag *tag=nullptr);
+
+	/**
+	 * Handle SharedEncoder::End(): if this is the only output,
+	 * then the real #Encoder is ended; else the #SharedEncoder
+	 * just stops receiving data.
+	 *
+	 * Throws on error.
+	 *
+	 * @return true if the real #Encoder has been ended
+	 */
+	bool End(SharedEncoder &s);
+
+	/**
+	 * Mark the #SharedEncoder as diverged.
+	 */
+	void Detach(SharedEncoder &s) noexcept;
+
+	std::span<const std::byte> Read(SharedEncoder &s,
+					std::span<std::byte> buffer) noexcept;
+
+private:
+	uint_least64_t GetEnd() const noexcept {
+		return base + ops.size();
+	}
+
+	SharedEncoderOp &GetOp(uint_least64_t i) noexcept {
+		assert(i >= base);
+		assert(i < GetEnd());
+
+		return ops[i - base];
+	}
+
+	/**
+	 * Search the log for the first call of a #SharedEncoder in
+	 * state JOINING.
+	 */
+	bool Synchronize(SharedEncoder &s, SharedEncoderOp::Type type,
+			 std::span<const std::byte> input) noexcept;
+
+	/**
+	 * Perform the call on the real #Encoder and append it to the
+	 * log.
+	 */
+	void Perform(SharedEncoderOp::Type type,
+		     std::span<const std::byte> input,
+		     const Tag *tag);
+
+	/**
+	 * Remove calls which have been read by all outputs.
+	 */
+	void Trim() noexcept;
+};
+
+/**
+ * Wrapper for the configured #PreparedEncoder which looks up a
+ * #SharedEncoderGroup in the global registry.
+ */
+class PreparedSharedEncoder final : public PreparedEncoder {
+	const std::unique_ptr<PreparedEncoder> prepared;
+
+	/**
+	 * Identifies the encoder plugin and its settings.
+	 */
+	const std::string key;
+
+public:
+	PreparedSharedEncoder(std::unique_ptr<PreparedEncoder> &&_prepared,
+			      std::string &&_key) noexcept
+		:prepared(std::move(_prepared)), key(std::move(_key)) {}
+
+	/* virtual methods from class PreparedEncoder */
+	Encoder *Open(AudioFormat &audio_format) override;
+
+	const char *GetMimeType() const noexcept override {
+		return prepared->GetMimeType();
+	}
+};
+
+/**
+ * All #SharedEncoderGroup instances, indexed by their key.
+ */
+static Mutex registry_mutex;
+static std::map<std::string, std::weak_ptr<SharedEncoderGroup>,
+		std::less<>> registry;
+
+/**
+ * Remove the group from the registry, so no more outputs can join
+ * it.
+ */
+static void
+Unregister(const SharedEncoderGroup &group) noexcept
+{
+	const std::scoped_lock lock{registry_mutex};
+
+	if (auto i = registry.find(group.GetKey());
+	    i != registry.end() && i->second.lock().get() == &group)
+		registry.erase(i);
+}
+
+SharedEncoderGroup::SharedEncoderGroup(std::string_view _key,
+				       std::unique_ptr<Encoder> &&_encoder,
+				       AudioFormat _audio_format) noexcept
+	:key(_key), encoder(std::move(_encoder)), audio_format(_audio_format)
+{
+	std::byte buffer[4096];
+	for (auto r = encoder->Read(buffer); !r.empty(); r = encoder->Read(buffer))
+		header.insert(header.end(), r.begin(), r.end());
+}
+
+void
+SharedEncoderGroup::Subscribe(SharedEncoder &s) noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	if (base == 0 && ops.empty()) {
+		/* nothing has been encoded yet */
+		s.state = SharedEncoder::State::SYNCHRONIZED;
+		s.next_op = s.read_op = 0;
+	} else
+		s.state = SharedEncoder::State::JOINING;
+
+	subscribers.push_back(s);
+}
+
+void
+SharedEncoderGroup::Unsubscribe(SharedEncoder &s) noexcept
+{
+	const std::scoped_lock lock{mutex};
+	subscribers.erase(subscribers.iterator_to(s));
+	Trim();
+}
+
+inline bool
+SharedEncoderGroup::Synchronize(SharedEncoder &s, SharedEncoderOp::Type type,
+				std::span<const std::byte> input) noexcept
+{
+	assert(s.state == SharedEncoder::State::JOINING);
+
+	for (uint_least64_t i = base; i < GetEnd(); ++i) {
+		if (GetOp(i).Matches(type, input)) {
+			s.next_op = s.read_op = i;
+			s.state = SharedEncoder::State::SYNCHRONIZED;
+			return true;
+		}
+	}
+
+	if (subscribers.size() == 1) {
+		/* all other outputs have left the group; continue
+		   where they stopped */
+		s.next_op = s.read_op = GetEnd();
+		s.state = SharedEncoder::State::SYNCHRONIZED;
+		return true;
+	}
+
+	return false;
+}
+
+inline void
+SharedEncoderGroup::Perform(SharedEncoderOp::Type type,
+			    std::span<const std::byte> input,
+			    const Tag *tag)
+{
+	if (error)
+		std::rethrow_exception(error);
+
+	try {
+		switch (type) {
+		case SharedEncoderOp::Type::WRITE:
+			encoder->Write(input);
+			break;
+
+		case SharedEncoderOp::Type::FLUSH:
+			encoder->Flush();
+			break;
+
+		case SharedEncoderOp::Type::PRE_TAG:
+			encoder->PreTag();
+			break;
+
+		case SharedEncoderOp::Type::TAG:
+			assert(tag != nullptr);
+			encoder->SendTag(*tag);
+			break;
+
+		case SharedEncoderOp::Type::END:
+			ended = true;
+			encoder->End();
+			break;
+		}
+	} catch (...) {
+		error = std::current_exception();
+		throw;
+	}
+
+	auto &op = ops.emplace_back(type, input);
+
+	std::byte buffer[4096];
+	for (auto r = encoder->Read(buffer); !r.empty(); r = encoder->Read(buffer))
+		op.output.insert(op.output.end(), r.begin(), r.end());
+
+	Trim();
+}
+
+bool
+SharedEncoderGroup::Submit(SharedEncoder &s, SharedEncoderOp::Type type,
+			   std::span<const std::byte> input,
+			   const Tag *tag)
+{
+	const bool soft = SharedEncoderOp::IsSoft(type, input);
+
+	const std::scoped_lock lock{mutex};
+
+	switch (s.state) {
+	case SharedEncoder::State::JOINING:
+		if (soft)
+			/* wait for a call which can be located in the
+			   log */
+			return true;
+
+		if (!Synchronize(s, type, input))
+			return false;
+
+		break;
+
+	case SharedEncoder::State::SYNCHRONIZED:
+		break;
+
+	case SharedEncoder::State::DIVERGED:
+	case SharedEncoder::State::LOST:
+		return false;
+	}
+
+	while (s.next_op < GetEnd()) {
+		const auto &op = GetOp(s.next_op);
+		if (op.Matches(type, input)) {
+			/* another output has already made this call;
+			   just copy its output */
+			++s.next_op;
+			return true;
+		}
+
+		if (!op.IsSoft())
+			break;
+
+		/* another output has made a soft call which this
+		   output didn't make; skip it (but still send the
+		   encoded data) */
+		++s.next_op;
+	}
+
+	if (s.next_op < GetEnd())
+		/* this output's call differs from the log; if it's a
+		   soft call, it can simply be omitted, else it's a
+		   divergence */
+		return soft;
+
+	/* this output is the first to make this call */
+
+	if (ended)
+		return false;
+
+	Perform(type, input, tag);
+	++s.next_op;
+	return true;
+}
+
+bool
+SharedEncoderGroup::End(SharedEncoder &s)
+{
+	const std::scoped_lock lock{mutex};
+
+	if (s.state == SharedEncoder::State::SYNCHRONIZED &&
+	    subscribers.size() == 1 && s.next_op == GetEnd() && !ended) {
+		Perform(SharedEncoderOp::Type::END, {}, nullptr);
+		++s.next_op;
+		return true;
+	}
+
+	/* other outputs are still using the shared encoder; this
+	   one just stops receiving data (which means the stream
+	   lacks the end-of-stream marker) */
+	if (s.state == SharedEncoder::State::SYNCHRONIZED)
+		s.state = SharedEncoder::State::DIVERGED;
+	else if (s.state == SharedEncoder::State::JOINING)
+		s.state = SharedEncoder::State::LOST;
+	return false;
+}
+
+void
+SharedEncoderGroup::Detach(SharedEncoder &s) noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	if (s.state == SharedEncoder::State::SYNCHRONIZED)
+		s.state = SharedEncoder::State::DIVERGED;
+	else if (s.state == SharedEncoder::State::JOINING)
+		s.state = SharedEncoder::State::LOST;
+}
+
+std::span<const std::byte>
+SharedEncoderGroup::Read(SharedEncoder &s, std::span<std::byte> buffer) noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	std::span<const std::byte> src;
+
+	if (s.header_position < header.size()) {
+		src = std::span{header}.subspan(s.header_position);
+		src = src.first(std::min(src.size(), buffer.size()));
+		s.header_position += src.size();
+	} else if (s.state == SharedEncoder::State::SYNCHRONIZED ||
+		   s.state == SharedEncoder::State::DIVERGED) {
+		for (; s.read_op < s.next_op; ++s.read_op, s.read_position = 0) {
+			const auto &output = GetOp(s.read_op).output;
+			if (s.read_position < output.size()) {
+				src = std::span{output}.subspan(s.read_position);
+				src = src.first(std::min(src.size(), buffer.size()));
+				s.read_position += src.size();
+				break;
+			}
+		}
+
+		if (src.empty() && s.state == SharedEncoder::State::DIVERGED) {
+			/* all shared data has been read; continue
+			   with the private encoder */
+			s.state = SharedEncoder::State::LOST;
+			Trim();
+		}
+	}
+
+	/* copy to the caller's buffer because the log may be
+	   trimmed by another thread after we release the lock */
+	std::copy(src.begin(), src.end(), buffer.begin());
+	return buffer.first(src.size());
+}
+
+void
+SharedEncoderGroup::Trim() noexcept
+{
+	/* find the oldest call which has not been read yet */
+	uint_least64_t min_read = GetEnd();
+	for (const auto &s : subscribers)
+		if (s.state == SharedEncoder::State::SYNCHRONIZED ||
+		    s.state == SharedEncoder::State::DIVERGED)
+			min_read = std::min(min_read, s.read_op);
+
+	while (ops.size() > HISTORY && base < min_read) {
+		ops.pop_front();
+		++base;
+	}
+
+	/* disconnect outputs which are lagging too far behind */
+	while (ops.size() > MAX_OPS) {
+		const bool soft = ops.front().IsSoft();
+
+		for (auto &s : subscribers) {
+			if ((s.state != SharedEncoder::State::SYNCHRONIZED &&
+			     s.state != SharedEncoder::State::DIVERGED) ||
+			    s.read_op != base)
+				continue;
+
+			if (soft && s.state == SharedEncoder::State::SYNCHRONIZED &&
+			    s.next_op == base) {
+				/* it has not made this call yet, and
+				   it is allowed to skip it */
+				s.next_op = s.read_op = base + 1;
+				s.read_position = 0;
+			} else {
+				LogWarning(shared_encoder_domain,
+					   "Output is lagging behind the shared encoder");
+				s.state = SharedEncoder::State::LOST;
+			}
+		}
+
+		ops.pop_front();
+		++base;
+	}
+}
+
+SharedEncoder::SharedEncoder(PreparedEncoder &_prepared,
+			     AudioFormat _audio_format,
+			     std::shared_ptr<SharedEncoderGroup> &&_group) noexcept
+	:Encoder(_group->ImplementsTag()),
+	 prepared(_prepared), audio_format(_audio_format),
+	 group(std::move(_group))
+{
+	group->Subscribe(*this);
+}
+
+SharedEncoder::~SharedEncoder() noexcept
+{
+	group->Unsubscribe(*this);
+}
+
+bool
+SharedEncoder::Submit(SharedEncoderOp::Type type,
+		      std::span<const std::byte> input,
+		      const Tag *tag)
+{
+	if (private_encoder)
+		return false;
+
+	if (group->Submit(*this, type, input, tag))
+		return true;
+
+	LogWarning(shared_encoder_domain,
+		   "Output differs from the shared encoder, using a private encoder");
+
+	group->Detach(*this);
+
+	AudioFormat af = audio_format;
+	private_encoder.reset(prepared.Open(af));
+	return false;
+}
+
+void
+SharedEncoder::End()
+{
+	if (!private_encoder && group->End(*this)) {
+		/* no more outputs can join this group */
+		Unregister(*group);
+		return;
+	}
+
+	if (private_encoder)
+		private_encoder->End();
+}
+
+void
+SharedEncoder::Flush()
+{
+	if (!Submit(SharedEncoderOp::Type::FLUSH, {}))
+		private_encoder->Flush();
+}
+
+void
+SharedEncoder::PreTag()
+{
+	if (!Submit(SharedEncoderOp::Type::PRE_TAG, {}))
+		private_encoder->PreTag();
+}
+
+void
+SharedEncoder::SendTag(const Tag &tag)
+{
+	const auto serialized = SerializeTag(tag);
+	if (!Submit(SharedEncoderOp::Type::TAG, AsBytes(serialized), &tag))
+		private_encoder->SendTag(tag);
+}
+
+void
+SharedEncoder::Write(std::span<const std::byte> src)
+{
+	if (!Submit(SharedEncoderOp::Type::WRITE, src))
+		private_encoder->Write(src);
+}
+
+std::span<const std::byte>
+SharedEncoder::Read(std::span<std::byte> buffer) noexcept
+{
+	if (auto r = group->Read(*this, buffer); !r.empty())
+		return r;
+
+	if (private_encoder)
+		return private_encoder->Read(buffer);
+
+	return {};
+}
+
+Encoder *
+PreparedSharedEncoder::Open(AudioFormat &audio_format)
+{
+	const AudioFormat requested = audio_format;
+
+	std::string group_key = key;
+	group_key.push_back('\n');
+	group_key.append(ToString(audio_format).c_str());
+
+	std::shared_ptr<SharedEncoderGroup> group;
+
+	{
+		const std::scoped_lock lock{registry_mutex};
+
+		std::erase_if(registry, [](const auto &i){
+			return i.second.expired();
+		});
+
+		auto &weak = registry[group_key];
+		group = weak.lock();
+		if (!group) {
+			AudioFormat af = requested;
+			std::unique_ptr<Encoder> encoder{prepared->Open(af)};
+			group = std::make_shared<SharedEncoderGroup>(group_key,
+								     std::move(encoder),
+								     af);
+			weak = group;
+		}
+	}
+
+	/* the encoder may have modified the AudioFormat; apply the
+	   same modification to the caller's copy */
+	audio_format = group->GetAudioFormat();
+
+	return new SharedEncoder(*prepared, requested, std::move(group));
+}
+
+} // anonymous namespace
+
+PreparedEncoder *
+CreateShareableEncoder(const EncoderPlugin &plugin, const ConfigBlock &block)
+{
+	if (!block.GetBlockValue("share_encoder", false))
+		return encoder_init(plugin, block);
+
+	/* remember which settings the encoder plugin uses; they
+	   (together with the plugin name) identify the group of
+	   outputs which can share an encoder */
+	std::vector<bool> was_used;
+	was_used.reserve(block.block_params.size());
+	for (const auto &i : block.block_params)
+		was_used.push_back(i.used);
+
+	std::unique_ptr<PreparedEncoder> prepared{encoder_init(plugin, block)};
+
+	std::vector<std::string> settings;
+	for (std::size_t i = 0; i < block.block_params.size(); ++i) {
+		const auto &param = block.block_params[i];
+		if (param.used && !was_used[i])
+			settings.emplace_back(param.name + '=' + param.value);
+	}
+
+	std::sort(settings.begin(), settings.end());
+
+	std::string key = plugin.name;
+	for (const auto &i : settings) {
+		key.push_back('\n');
+		key.append(i);
+	}
+
+	return new PreparedSharedEncoder(std::move(prepared), std::move(key));
+}
@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+struct EncoderPlugin;
+struct ConfigBlock;
+class PreparedEncoder;
+
+/**
+ * Create a new #PreparedEncoder, just like encoder_init().  If the
+ * "share_encoder" setting is enabled, the returned object shares one
+ * #Encoder instance with all other outputs which have enabled this
+ * setting and which use the same encoder plugin, the same encoder
+ * settings and the same input audio format: the first output to
+ * submit a portion of PCM data encodes it, and the others obtain a
+ * copy of the encoded data.
+ *
+ * If an output submits different data than the others (e.g. due to
+ * a different volume or because it has been paused independently),
+ * it falls back to a private #Encoder.
+ *
+ * Throws on error.
+ */
+PreparedEncoder *
+CreateShareableEncoder(const EncoderPlugin &plugin, const ConfigBlock &block);
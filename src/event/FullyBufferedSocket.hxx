@@ -60,6 +60,13 @@ protected:
 
 	void OnIdle() noexcept;
 
+	/**
+	 * All data in the output buffer has been sent to the socket.
+	 * The implementation must not call Write() or destroy the
+	 * object.
+	 */
+	virtual void OnSocketOutputDrained() noexcept {}
+
 	/* virtual methods from class BufferedSocket */
 	void OnSocketReady(unsigned flags) noexcept override;
 };
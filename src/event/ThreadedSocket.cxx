@@ -0,0 +1,339 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "ThreadedSocket.hxx"
+#include "Call.hxx"
+#include "net/SocketError.hxx"
+
+#include <stdexcept>
+#include <utility> // for std::exchange()
+
+ThreadedSocket::ThreadedSocket(SocketDescriptor _fd,
+			       EventLoop &_loop, EventLoop &io_loop,
+			       std::size_t normal_size,
+			       std::size_t peak_size) noexcept
+	:loop(_loop),
+	 event(io_loop, BIND_THIS_METHOD(OnSocketReady), _fd),
+	 idle_event(io_loop, BIND_THIS_METHOD(OnIoWakeup)),
+	 io_inject(io_loop, BIND_THIS_METHOD(OnIoWakeup)),
+	 defer_owner(_loop, BIND_THIS_METHOD(OnOwnerWakeup)),
+	 owner_inject(_loop, BIND_THIS_METHOD(OnOwnerWakeup)),
+	 output(normal_size, peak_size)
+{
+	if (IsThreaded())
+		/* the socket can only be registered from within the
+		   I/O thread */
+		io_inject.Schedule();
+	else
+		event.ScheduleRead();
+}
+
+ThreadedSocket::~ThreadedSocket() noexcept
+{
+	if (IsDefined())
+		Close();
+}
+
+void
+ThreadedSocket::Close() noexcept
+{
+	if (IsThreaded()) {
+		/* this waits for I/O callbacks which are currently
+		   running in the other thread */
+		BlockingCall(event.GetEventLoop(), [this]{
+			io_inject.Cancel();
+			event.Close();
+		});
+
+		owner_inject.Cancel();
+	} else {
+		idle_event.Cancel();
+		defer_owner.Cancel();
+		event.Close();
+	}
+}
+
+ThreadedSocket::WriteResult
+ThreadedSocket::FlushLocked() noexcept
+{
+	const auto data = output.Read();
+	if (data.empty())
+		return WriteResult::NONE;
+
+	const auto nbytes = event.GetSocket().WriteNoWait(data);
+	if (nbytes < 0) [[unlikely]] {
+		const auto code = GetSocketError();
+		if (IsSocketErrorSendWouldBlock(code))
+			return WriteResult::NONE;
+
+		if (IsSocketErrorClosed(code))
+			io_hangup = true;
+		else
+			io_error = std::make_exception_ptr(MakeSocketError(code, "Failed to send to socket"));
+		return WriteResult::ERROR;
+	}
+
+	output.Consume(nbytes);
+	if (output.empty())
+		io_drained = true;
+
+	return WriteResult::OK;
+}
+
+bool
+ThreadedSocket::Flush() noexcept
+{
+	assert(IsDefined());
+
+	std::unique_lock lock{mutex};
+	const auto result = FlushLocked();
+	const bool pending = !output.empty();
+	const bool drained = std::exchange(io_drained, false);
+	lock.unlock();
+
+	if (result == WriteResult::ERROR)
+		return CheckIoError(true);
+
+	if (drained)
+		OnSocketOutputDrained();
+	else if (pending)
+		/* let the I/O loop send the rest */
+		ScheduleIo();
+
+	return true;
+}
+
+bool
+ThreadedSocket::Write(const void *data, std::size_t length) noexcept
+{
+	assert(IsDefined());
+
+	if (length == 0)
+		return true;
+
+	std::unique_lock lock{mutex};
+	const bool was_empty = output.empty();
+	const bool success = output.Append({(const std::byte *)data, length});
+	lock.unlock();
+
+	if (!success) {
+		OnSocketError(std::make_exception_ptr(std::runtime_error("Output buffer is full")));
+		return false;
+	}
+
+	if (was_empty)
+		ScheduleIo();
+	return true;
+}
+
+bool
+ThreadedSocket::PullReceived() noexcept
+{
+	std::unique_lock lock{mutex};
+	const auto r = received.Read();
+	if (r.empty())
+		return false;
+
+	const std::size_t n = input.MoveFrom(r);
+	received.Consume(n);
+	const bool resume = n > 0 && std::exchange(io_read_blocked, false);
+	lock.unlock();
+
+	if (resume)
+		ScheduleIo();
+
+	return n > 0;
+}
+
+bool
+ThreadedSocket::CheckIoError(bool ignore_input) noexcept
+{
+	std::unique_lock lock{mutex};
+	auto error = io_error;
+	const bool hangup = io_hangup && (ignore_input || received.empty());
+	lock.unlock();
+
+	if (error) {
+		OnSocketError(std::move(error));
+		return false;
+	}
+
+	if (hangup) {
+		OnSocketClosed();
+		return false;
+	}
+
+	return true;
+}
+
+bool
+ThreadedSocket::ResumeInput() noexcept
+{
+	assert(IsDefined());
+
+	input_paused = false;
+
+	PullReceived();
+
+	for (auto buffer = input.Read(); !buffer.empty();
+	     buffer = input.Read()) {
+		switch (OnSocketInput(buffer)) {
+		case InputResult::MORE:
+			if (input.IsFull()) {
+				OnSocketError(std::make_exception_ptr(std::runtime_error("Input buffer is full")));
+				return false;
+			}
+
+			if (!PullReceived())
+				/* wait for more data */
+				return CheckIoError();
+
+			break;
+
+		case InputResult::PAUSE:
+			input_paused = true;
+			return true;
+
+		case InputResult::AGAIN:
+			break;
+
+		case InputResult::CLOSED:
+			return false;
+		}
+	}
+
+	return CheckIoError();
+}
+
+void
+ThreadedSocket::OnSocketReady(unsigned flags) noexcept
+{
+	const std::scoped_lock lock{mutex};
+
+	bool notify = false;
+
+	if (flags & SocketEvent::WRITE) {
+		switch (FlushLocked()) {
+		case WriteResult::OK:
+			if (output.empty()) {
+				event.CancelWrite();
+				notify = true;
+			}
+
+			break;
+
+		case WriteResult::NONE:
+			break;
+
+		case WriteResult::ERROR:
+			event.Cancel();
+			ScheduleOwner();
+			return;
+		}
+	}
+
+	if (flags & (SocketEvent::ERROR|SocketEvent::HANGUP)) [[unlikely]] {
+		io_hangup = true;
+		event.Cancel();
+		ScheduleOwner();
+		return;
+	}
+
+	if (flags & SocketEvent::READ) {
+		const auto w = received.Write();
+		assert(!w.empty());
+
+		const auto nbytes = event.GetSocket().ReadNoWait(w);
+		if (nbytes > 0) [[likely]] {
+			received.Append(nbytes);
+			notify = true;
+
+			if (received.IsFull()) {
+				/* wait until the owner has consumed
+				   some of it (see PullReceived()) */
+				io_read_blocked = true;
+				event.CancelRead();
+			}
+		} else if (nbytes == 0) {
+			io_hangup = true;
+			event.Cancel();
+			notify = true;
+		} else if (const auto code = GetSocketError();
+			   !IsSocketErrorReceiveWouldBlock(code)) {
+			if (IsSocketErrorClosed(code))
+				io_hangup = true;
+			else
+				io_error = std::make_exception_ptr(MakeSocketError(code, "Failed to receive from socket"));
+			event.Cancel();
+			notify = true;
+		}
+	}
+
+	if (notify)
+		ScheduleOwner();
+}
+
+void
+ThreadedSocket::OnIoWakeup() noexcept
+{
+	if (!event.IsDefined())
+		return;
+
+	const std::scoped_lock lock{mutex};
+
+	if (io_error || io_hangup)
+		/* the socket has failed, and the owner is going to
+		   close it */
+		return;
+
+	if (!io_read_blocked)
+		event.ScheduleRead();
+
+	switch (FlushLocked()) {
+	case WriteResult::OK:
+		if (output.empty()) {
+			event.CancelWrite();
+			ScheduleOwner();
+		} else
+			event.ScheduleWrite();
+		break;
+
+	case WriteResult::NONE:
+		if (output.empty())
+			event.CancelWrite();
+		else
+			event.ScheduleWrite();
+		break;
+
+	case WriteResult::ERROR:
+		event.Cancel();
+		ScheduleOwner();
+		break;
+	}
+}
+
+void
+ThreadedSocket::OnOwnerWakeup() noexcept
+{
+	if (!IsDefined())
+		return;
+
+	std::unique_lock lock{mutex};
+	const bool drained = std::exchange(io_drained, false) &&
+		output.empty();
+	const bool failed = io_error || io_hangup;
+	lock.unlock();
+
+	if (drained)
+		OnSocketOutputDrained();
+
+	if (input_paused) {
+		/* don't process input now, but report errors
+		   immediately */
+		if (failed)
+			CheckIoError(true);
+		return;
+	}
+
+	ResumeInput();
+}
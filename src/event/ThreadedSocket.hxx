@@ -0,0 +1,303 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include "SocketEvent.hxx"
+#include "DeferEvent.hxx"
+#include "IdleEvent.hxx"
+#include "InjectEvent.hxx"
+#include "thread/Mutex.hxx"
+#include "util/PeakBuffer.hxx"
+#include "util/StaticFifoBuffer.hxx"
+
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <span>
+
+/**
+ * A socket with an input and an output buffer, similar to
+ * #FullyBufferedSocket.  The difference is that the socket may be
+ * registered in a different #EventLoop (the "I/O loop"), which runs
+ * in its own thread: that thread receives data into a buffer and
+ * sends the output buffer, and the owner's #EventLoop is only woken
+ * up to process complete portions of input.  This moves the system
+ * calls out of the owner's thread.
+ *
+ * All public and protected methods and all virtual methods are
+ * called in the owner's #EventLoop thread.  Both loops may be the
+ * same; then everything runs in one thread.
+ */
+class ThreadedSocket {
+	EventLoop &loop;
+
+	/**
+	 * The socket; this is registered in the I/O loop.
+	 */
+	SocketEvent event;
+
+	/**
+	 * Flushes the output buffer; runs in the I/O loop if it is
+	 * the owner's loop (see ScheduleIo()).
+	 */
+	IdleEvent idle_event;
+
+	/**
+	 * Like #idle_event, but used if the I/O loop runs in a
+	 * different thread.
+	 */
+	InjectEvent io_inject;
+
+	/**
+	 * Submits received data (and errors) to the owner; this is
+	 * used if the I/O loop is the owner's loop (see
+	 * ScheduleOwner()).
+	 */
+	DeferEvent defer_owner;
+
+	/**
+	 * Like #defer_owner, but used if the I/O loop runs in a
+	 * different thread.
+	 */
+	InjectEvent owner_inject;
+
+	/**
+	 * Protects #received, #output and the "io_" attributes.
+	 */
+	Mutex mutex;
+
+	/**
+	 * Data which has been received by the I/O loop, but has not
+	 * yet been moved to #input.
+	 */
+	StaticFifoBuffer<std::byte, 8192> received;
+
+	/**
+	 * The owner's input buffer which gets passed to
+	 * OnSocketInput().
+	 */
+	StaticFifoBuffer<std::byte, 8192> input;
+
+	PeakBuffer output;
+
+	/**
+	 * An error which occurred in the I/O loop and has not yet
+	 * been submitted to OnSocketError().
+	 */
+	std::exception_ptr io_error;
+
+	/**
+	 * Has the I/O loop stopped reading because #received is full?
+	 */
+	bool io_read_blocked = false;
+
+	/**
+	 * Has the peer closed the connection?  This will be submitted
+	 * to OnSocketClosed() after all received data has been
+	 * processed.
+	 */
+	bool io_hangup = false;
+
+	/**
+	 * Has the output buffer become empty?  This will be
+	 * submitted to OnSocketOutputDrained().
+	 */
+	bool io_drained = false;
+
+	/**
+	 * Has OnSocketInput() returned InputResult::PAUSE?  Only
+	 * accessed by the owner.
+	 */
+	bool input_paused = false;
+
+public:
+	/**
+	 * @param _loop the owner's #EventLoop
+	 * @param io_loop the #EventLoop which performs I/O on the
+	 * socket; may be the same as #_loop
+	 */
+	ThreadedSocket(SocketDescriptor _fd,
+		       EventLoop &_loop, EventLoop &io_loop,
+		       std::size_t normal_size,
+		       std::size_t peak_size=0) noexcept;
+
+	~ThreadedSocket() noexcept;
+
+	ThreadedSocket(const ThreadedSocket &) = delete;
+	ThreadedSocket &operator=(const ThreadedSocket &) = delete;
+
+	EventLoop &GetEventLoop() const noexcept {
+		return loop;
+	}
+
+	bool IsDefined() const noexcept {
+		return event.IsDefined();
+	}
+
+	/**
+	 * Close the socket.  If the I/O loop runs in a different
+	 * thread, this waits until that thread has unregistered the
+	 * socket.
+	 */
+	void Close() noexcept;
+
+	std::size_t GetOutputMaxSize() const noexcept {
+		return output.max_size();
+	}
+
+protected:
+	/**
+	 * Does the I/O loop run in a different thread?
+	 */
+	bool IsThreaded() const noexcept {
+		return &event.GetEventLoop() != &loop;
+	}
+
+	/**
+	 * @return false if the socket has been closed
+	 */
+	bool ResumeInput() noexcept;
+
+	/**
+	 * Mark a portion of the input buffer "consumed".  Only
+	 * allowed to be called from OnSocketInput().  This method
+	 * does not invalidate the pointer passed to OnSocketInput()
+	 * yet.
+	 */
+	void ConsumeInput(std::size_t nbytes) noexcept {
+		assert(IsDefined());
+
+		input.Consume(nbytes);
+	}
+
+	/**
+	 * Send data from the output buffer to the socket
+	 * immediately (from the owner's thread).
+	 *
+	 * @return false if the socket has been closed
+	 */
+	bool Flush() noexcept;
+
+	/**
+	 * @return false if the socket has been closed
+	 */
+	bool Write(const void *data, std::size_t length) noexcept;
+
+	enum class InputResult {
+		/**
+		 * The method was successful, and it is ready to
+		 * read more data.
+		 */
+		MORE,
+
+		/**
+		 * The method does not want to get more data for now.
+		 * It will call ResumeInput() when it's ready for
+		 * more.
+		 */
+		PAUSE,
+
+		/**
+		 * The method wants to be called again immediately, if
+		 * there's more data in the buffer.
+		 */
+		AGAIN,
+
+		/**
+		 * The method has closed the socket.
+		 */
+		CLOSED,
+	};
+
+	/**
+	 * Data has been received on the socket.
+	 *
+	 * @param src the buffer containing the data; the
+	 * buffer may be modified by the method while it processes the
+	 * data
+	 */
+	virtual InputResult OnSocketInput(std::span<std::byte> src) noexcept = 0;
+
+	/**
+	 * The socket has failed or the peer has closed the
+	 * connection.  Unlike input, this is reported even while
+	 * input is paused (see InputResult::PAUSE), so whatever
+	 * caused the pause (e.g. a command running in another
+	 * thread) may still be in progress; the implementation must
+	 * not block waiting for it.
+	 */
+	virtual void OnSocketError(std::exception_ptr ep) noexcept = 0;
+	virtual void OnSocketClosed() noexcept = 0;
+
+	/**
+	 * All data in the output buffer has been sent to the socket.
+	 * The implementation must not call Write() or destroy the
+	 * object.
+	 */
+	virtual void OnSocketOutputDrained() noexcept {}
+
+private:
+	void ScheduleIo() noexcept {
+		if (IsThreaded())
+			io_inject.Schedule();
+		else
+			idle_event.Schedule();
+	}
+
+	void ScheduleOwner() noexcept {
+		if (IsThreaded())
+			owner_inject.Schedule();
+		else
+			defer_owner.Schedule();
+	}
+
+	enum class WriteResult {
+		/**
+		 * Some or all data has been sent.
+		 */
+		OK,
+
+		/**
+		 * The output buffer was already empty, or the socket
+		 * is not ready for writing.
+		 */
+		NONE,
+
+		/**
+		 * The socket has failed; #io_error or #io_hangup
+		 * has been set.
+		 */
+		ERROR,
+	};
+
+	/**
+	 * Send data from the output buffer to the socket.  Caller
+	 * must lock the mutex.
+	 */
+	WriteResult FlushLocked() noexcept;
+
+	/**
+	 * Move data from #received to #input.
+	 *
+	 * @return true if data has been moved
+	 */
+	bool PullReceived() noexcept;
+
+	/**
+	 * Submit a failure from the I/O loop to the owner.
+	 *
+	 * @param ignore_input if true, then report a hangup even if
+	 * there is still received data which has not been processed
+	 * yet
+	 * @return false if a failure has been submitted
+	 */
+	bool CheckIoError(bool ignore_input=false) noexcept;
+
+	/* I/O loop callbacks */
+	void OnSocketReady(unsigned flags) noexcept;
+	void OnIoWakeup() noexcept;
+
+	/* owner loop callback */
+	void OnOwnerWakeup() noexcept;
+};
@@ -81,6 +81,8 @@ public:
 
 #else
 
+#include "io/FileDescriptor.hxx"
+
 #include <dirent.h>
 
 /**
@@ -130,6 +132,14 @@ public:
 		assert(HasEntry());
 		return Path::FromFS(ent->d_name);
 	}
+
+	/**
+	 * Returns the file descriptor of this directory, e.g. for
+	 * statx() relative to it.
+	 */
+	FileDescriptor GetFileDescriptor() const noexcept {
+		return FileDescriptor{dirfd(dirp)};
+	}
 };
 
 #endif
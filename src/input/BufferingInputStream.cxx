@@ -16,12 +16,19 @@ BufferingInputStream::BufferingInputStream(InputStreamPtr _input)
 	input->SetHandler(this);
 
 	buffer.SetName("InputCache");
-
-	thread.Start();
 }
 
 BufferingInputStream::~BufferingInputStream() noexcept
 {
+	Stop();
+}
+
+void
+BufferingInputStream::Stop() noexcept
+{
+	if (!thread.IsDefined())
+		return;
+
 	{
 		const std::scoped_lock lock{mutex};
 		stop = true;
@@ -176,6 +183,8 @@ BufferingInputStream::RunThread() noexcept
 		OnBufferAvailable();
 	}
 
+	const bool complete = !error && FindFirstHole() == INVALID_OFFSET;
+
 	/* clear the "input" attribute while holding the mutex */
 	auto _input = std::move(input);
 
@@ -185,4 +194,7 @@ BufferingInputStream::RunThread() noexcept
 
 	/* and now actually destruct the InputStream */
 	_input.reset();
+
+	if (complete)
+		OnBufferComplete();
 }
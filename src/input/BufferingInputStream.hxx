@@ -12,6 +12,7 @@
 
 #include <cstddef>
 #include <exception>
+#include <span>
 
 /**
  * A "huge" buffer which remembers the (partial) contents of an
@@ -75,6 +76,17 @@ public:
 		return buffer.size();
 	}
 
+	/**
+	 * Has the whole file been copied into the buffer (or has the
+	 * thread failed)?
+	 *
+	 * Caller must lock the mutex.
+	 */
+	[[gnu::pure]]
+	bool IsComplete() const noexcept {
+		return error || FindFirstHole() == INVALID_OFFSET;
+	}
+
 	/**
 	 * Wrapper for InputStream::Check().
 	 *
@@ -99,6 +111,25 @@ public:
 		    std::span<std::byte> dest);
 
 protected:
+	/**
+	 * Start the thread.  This must be called by the derived
+	 * class's constructor after it has been initialized
+	 * completely, because the thread invokes virtual methods.
+	 *
+	 * Throws on error.
+	 */
+	void Start() {
+		thread.Start();
+	}
+
+	/**
+	 * Stop the thread.  Derived classes which override
+	 * OnBufferAvailable() must call this in their destructor,
+	 * because the thread may invoke that method until it has
+	 * stopped.
+	 */
+	void Stop() noexcept;
+
 	/**
 	 * This virtual method gets called each time data has been
 	 * added to the buffer.  During this method call, the mutex is
@@ -106,6 +137,35 @@ protected:
 	 */
 	virtual void OnBufferAvailable() noexcept {}
 
+	/**
+	 * This virtual method gets called by the thread after the
+	 * whole file has been copied into the buffer, right before
+	 * the thread exits.  The mutex is not locked; the buffer will
+	 * not be modified anymore and can be obtained with
+	 * GetCompleteBuffer().
+	 */
+	virtual void OnBufferComplete() noexcept {}
+
+	/**
+	 * Has Stop() been called?  A long-running OnBufferComplete()
+	 * implementation should check this periodically and return
+	 * early, because Stop() blocks until it has finished.
+	 */
+	[[gnu::pure]]
+	bool IsStopping() const noexcept {
+		const std::scoped_lock lock{mutex};
+		return stop;
+	}
+
+	/**
+	 * Obtain the whole buffer.  Only allowed to be called after
+	 * the buffer has been filled completely, e.g. from
+	 * OnBufferComplete().
+	 */
+	std::span<const std::byte> GetCompleteBuffer() const noexcept {
+		return buffer.Read(0).defined_buffer;
+	}
+
 private:
 	size_t FindFirstHole() const noexcept;
 
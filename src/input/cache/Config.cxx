@@ -7,6 +7,7 @@
 
 static constexpr size_t KILOBYTE = 1024;
 static constexpr size_t MEGABYTE = 1024 * KILOBYTE;
+static constexpr uint_least64_t GIGABYTE = 1024 * MEGABYTE;
 
 InputCacheConfig::InputCacheConfig(const ConfigBlock &block)
 {
@@ -16,4 +17,22 @@ InputCacheConfig::InputCacheConfig(const ConfigBlock &block)
 		size = size_param->With([](const char *s){
 			return ParseSize(s);
 		});
+
+	prefetch_songs = block.GetBlockValue("prefetch_songs", 3U);
+
+	prefetch_size = size / 2;
+	const auto *prefetch_size_param = block.GetBlockParam("prefetch_size");
+	if (prefetch_size_param != nullptr)
+		prefetch_size = prefetch_size_param->With([](const char *s){
+			return ParseSize(s);
+		});
+
+	disk_path = block.GetPath("disk_path");
+
+	disk_size = 4 * GIGABYTE;
+	const auto *disk_size_param = block.GetBlockParam("disk_size");
+	if (disk_size_param != nullptr)
+		disk_size = disk_size_param->With([](const char *s){
+			return ParseSize(s);
+		});
 }
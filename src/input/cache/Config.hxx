@@ -4,13 +4,37 @@
 #ifndef MPD_INPUT_CACHE_CONFIG_HXX
 #define MPD_INPUT_CACHE_CONFIG_HXX
 
+#include "fs/AllocatedPath.hxx"
+
 #include <cstddef>
+#include <cstdint>
 
 struct ConfigBlock;
 
 struct InputCacheConfig {
 	size_t size;
 
+	/**
+	 * The maximum number of upcoming songs to be prefetched.
+	 */
+	unsigned prefetch_songs;
+
+	/**
+	 * The maximum total size of all prefetched songs.
+	 */
+	size_t prefetch_size;
+
+	/**
+	 * The directory of the persistent disk cache; nullptr if
+	 * disabled.
+	 */
+	AllocatedPath disk_path = nullptr;
+
+	/**
+	 * The maximum total size of all files in the disk cache.
+	 */
+	uint_least64_t disk_size;
+
 	explicit InputCacheConfig(const ConfigBlock &block);
 };
 
@@ -0,0 +1,314 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "Disk.hxx"
+#include "Log.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
+#include "lib/fmt/PathFormatter.hxx"
+#include "fs/DirectoryReader.hxx"
+#include "fs/FileInfo.hxx"
+#include "fs/FileSystem.hxx"
+#include "fs/Traits.hxx"
+#include "io/FileOutputStream.hxx"
+#include "io/FileReader.hxx"
+#include "util/DeleteDisposer.hxx"
+#include "util/Domain.hxx"
+#include "util/SpanCast.hxx"
+#include "util/djb_hash.hxx"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h> // for AT_FDCWD
+#include <sys/stat.h> // for utimensat()
+#endif
+
+static constexpr Domain cache_domain("cache");
+
+/**
+ * The suffix of the files which contain the key of a cached file.
+ */
+static constexpr std::string_view KEY_SUFFIX = ".key";
+
+static void
+TryRemoveFile(Path path) noexcept
+{
+	try {
+		RemoveFile(path);
+	} catch (...) {
+		LogError(std::current_exception());
+	}
+}
+
+static std::string
+MakeName(std::string_view key) noexcept
+{
+	return fmt::format("{:016x}", djb_hash(AsBytes(key)));
+}
+
+InputCacheDisk::InputCacheDisk(AllocatedPath &&_path,
+			       uint_least64_t _max_size)
+	:path(std::move(_path)), max_size(_max_size)
+{
+	if (!DirectoryExists(path))
+		CreateDirectoryNoThrow(path);
+
+	Load();
+
+	FmtDebug(cache_domain, "Loaded {} bytes from disk cache {:?}",
+		 total_size, path);
+}
+
+InputCacheDisk::~InputCacheDisk() noexcept
+{
+	entries_by_name.clear();
+	entries_by_time.clear_and_dispose(DeleteDisposer{});
+}
+
+std::string
+InputCacheDisk::MakeKey(const char *uri) noexcept
+{
+	const auto file_path = AllocatedPath::FromUTF8(uri);
+	if (file_path.IsNull())
+		return {};
+
+	FileInfo info;
+	if (!GetFileInfo(file_path, info) || !info.IsRegular())
+		return {};
+
+	const auto mtime = std::chrono::duration_cast<std::chrono::nanoseconds>(info.GetModificationTime().time_since_epoch());
+
+	return fmt::format("{}\n{}\n{}", uri, info.GetSize(), mtime.count());
+}
+
+AllocatedPath
+InputCacheDisk::GetFilePath(std::string_view name) const noexcept
+{
+	return AllocatedPath::Build(path, AllocatedPath::FromUTF8(name));
+}
+
+AllocatedPath
+InputCacheDisk::GetKeyPath(std::string_view name) const noexcept
+{
+	return GetFilePath(fmt::format("{}{}", name, KEY_SUFFIX));
+}
+
+static std::string
+ReadKeyFile(Path path)
+{
+	FileReader reader{path};
+
+	std::string key;
+	std::byte buffer[1024];
+	while (true) {
+		const std::size_t nbytes = reader.Read(buffer);
+		if (nbytes == 0)
+			break;
+
+		key.append(ToStringView(std::span{buffer}.first(nbytes)));
+	}
+
+	return key;
+}
+
+inline void
+InputCacheDisk::Load()
+{
+	struct Found {
+		std::string name, key;
+		uint_least64_t size;
+		std::chrono::system_clock::time_point mtime;
+	};
+
+	std::vector<Found> found;
+
+	DirectoryReader reader{path};
+	while (reader.ReadEntry()) {
+		const Path name_fs = reader.GetEntry();
+		if (PathTraitsFS::IsSpecialFilename(name_fs.c_str()))
+			continue;
+
+		std::string name = name_fs.ToUTF8();
+		if (name.empty())
+			continue;
+
+		const auto file_path = GetFilePath(name);
+
+		if (name.ends_with(".tmp")) {
+			/* an interrupted Store() call */
+			TryRemoveFile(file_path);
+			continue;
+		}
+
+		if (name.ends_with(KEY_SUFFIX)) {
+			/* delete orphaned key files */
+			name.resize(name.size() - KEY_SUFFIX.size());
+			if (!FileExists(GetFilePath(name)))
+				TryRemoveFile(file_path);
+			continue;
+		}
+
+		FileInfo info;
+		if (!GetFileInfo(file_path, info) || !info.IsRegular())
+			continue;
+
+		std::string key;
+		try {
+			key = ReadKeyFile(GetKeyPath(name));
+		} catch (...) {
+		}
+
+		if (key.empty() || MakeName(key) != name) {
+			/* the data file without a key may be
+			   incomplete */
+			TryRemoveFile(file_path);
+			continue;
+		}
+
+		found.push_back({
+			std::move(name), std::move(key),
+			info.GetSize(), info.GetModificationTime(),
+		});
+	}
+
+	std::sort(found.begin(), found.end(),
+		  [](const Found &a, const Found &b){
+			  return a.mtime < b.mtime;
+		  });
+
+	const std::scoped_lock lock{mutex};
+
+	for (auto &i : found)
+		Insert(std::move(i.name), std::move(i.key), i.size);
+
+	EvictLocked();
+}
+
+inline void
+InputCacheDisk::Insert(std::string &&name, std::string &&key,
+		       uint_least64_t size) noexcept
+{
+	auto *entry = new Entry(std::move(name), std::move(key), size);
+	entries_by_name.insert(*entry);
+	entries_by_time.push_back(*entry);
+	total_size += size;
+}
+
+void
+InputCacheDisk::EvictLocked() noexcept
+{
+	while (total_size > max_size && !entries_by_time.empty())
+		DeleteLocked(entries_by_time.front());
+}
+
+void
+InputCacheDisk::DeleteLocked(Entry &entry) noexcept
+{
+	/* delete the key first, so an interrupted deletion does not
+	   leave a stale key behind */
+	TryRemoveFile(GetKeyPath(entry.name));
+	TryRemoveFile(GetFilePath(entry.name));
+
+	assert(total_size >= entry.size);
+	total_size -= entry.size;
+
+	entries_by_name.erase(entries_by_name.iterator_to(entry));
+	entries_by_time.erase(entries_by_time.iterator_to(entry));
+	delete &entry;
+}
+
+AllocatedPath
+InputCacheDisk::Lookup(std::string_view key) noexcept
+{
+	const auto name = MakeName(key);
+
+	const std::scoped_lock lock{mutex};
+
+	auto i = entries_by_name.find(name);
+	if (i == entries_by_name.end() || i->key != key)
+		return nullptr;
+
+	/* refresh */
+	entries_by_time.erase(entries_by_time.iterator_to(*i));
+	entries_by_time.push_back(*i);
+
+	auto file_path = GetFilePath(name);
+
+#ifndef _WIN32
+	/* update the modification time, so the LRU order survives a
+	   restart */
+	utimensat(AT_FDCWD, file_path.c_str(), nullptr, 0);
+#endif
+
+	return file_path;
+}
+
+void
+InputCacheDisk::Store(std::string_view key,
+		      std::span<const std::byte> data,
+		      BoundMethod<bool() noexcept> is_cancelled) noexcept
+{
+	if (data.size() > max_size)
+		return;
+
+	std::string name = MakeName(key);
+
+	{
+		const std::scoped_lock lock{mutex};
+
+		if (auto i = entries_by_name.find(name);
+		    i != entries_by_name.end()) {
+			if (i->key == key)
+				/* already stored */
+				return;
+
+			/* a different key with the same hash (or an
+			   obsolete version of the same file) */
+			DeleteLocked(*i);
+		}
+	}
+
+	try {
+		/* write the data first; the key file marks the
+		   entry as complete */
+		FileOutputStream data_file{GetFilePath(name)};
+
+		/* write in small portions, because write() may not
+		   accept huge buffers at once */
+		static constexpr std::size_t MAX_WRITE = 1024 * 1024;
+		for (auto rest = data; !rest.empty();) {
+			if (is_cancelled())
+				/* not committing the FileOutputStream
+				   deletes the partial file */
+				return;
+
+			const auto chunk = rest.first(std::min(rest.size(), MAX_WRITE));
+			data_file.Write(chunk);
+			rest = rest.subspan(chunk.size());
+		}
+
+		data_file.Commit();
+
+		FileOutputStream key_file{GetKeyPath(name)};
+		key_file.Write(AsBytes(key));
+		key_file.Commit();
+	} catch (...) {
+		FmtError(cache_domain, "Failed to store file in disk cache: {}",
+			 std::current_exception());
+		return;
+	}
+
+	const std::scoped_lock lock{mutex};
+
+	if (entries_by_name.find(name) != entries_by_name.end())
+		/* another thread has stored the same file
+		   meanwhile */
+		return;
+
+	Insert(std::move(name), std::string{key}, data.size());
+	EvictLocked();
+}
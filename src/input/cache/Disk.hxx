@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include "fs/AllocatedPath.hxx"
+#include "thread/Mutex.hxx"
+#include "util/BindMethod.hxx"
+#include "util/IntrusiveHashSet.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+/**
+ * A persistent cache of complete files in a local directory.  This
+ * is the second tier below the RAM cache of #InputCacheManager: files
+ * which have been loaded completely into RAM are copied to disk, and
+ * later (even after a restart) they can be loaded from there instead
+ * of reading them again from their (possibly slow) origin.
+ *
+ * Each file is stored with its "key", which contains the URI and
+ * validators (size and modification time) of the origin; a modified
+ * origin file therefore misses the cache.  If the total size exceeds
+ * the configured maximum, the least recently used files are deleted.
+ *
+ * This class is thread-safe.
+ */
+class InputCacheDisk {
+	const AllocatedPath path;
+
+	const uint_least64_t max_size;
+
+	mutable Mutex mutex;
+
+	uint_least64_t total_size = 0;
+
+	struct Entry final
+		: IntrusiveListHook<>, IntrusiveHashSetHook<>
+	{
+		/**
+		 * The file name (without the directory); this is a
+		 * hash of the #key.
+		 */
+		const std::string name;
+
+		const std::string key;
+
+		const uint_least64_t size;
+
+		Entry(std::string &&_name, std::string &&_key,
+		      uint_least64_t _size) noexcept
+			:name(std::move(_name)), key(std::move(_key)),
+			 size(_size) {}
+
+		struct GetName {
+			std::string_view operator()(const Entry &entry) const noexcept {
+				return entry.name;
+			}
+		};
+	};
+
+	/**
+	 * All entries, least recently used first.
+	 */
+	IntrusiveList<Entry> entries_by_time;
+
+	IntrusiveHashSet<Entry, 1021,
+			 IntrusiveHashSetOperators<Entry, Entry::GetName,
+						   std::hash<std::string_view>,
+						   std::equal_to<std::string_view>>> entries_by_name;
+
+public:
+	/**
+	 * Open the cache directory (creating it if it does not exist)
+	 * and load the index of all files in it.
+	 *
+	 * Throws on error.
+	 */
+	InputCacheDisk(AllocatedPath &&_path, uint_least64_t _max_size);
+
+	~InputCacheDisk() noexcept;
+
+	InputCacheDisk(const InputCacheDisk &) = delete;
+	InputCacheDisk &operator=(const InputCacheDisk &) = delete;
+
+	/**
+	 * Build the key for the given local file from its URI and the
+	 * validators of the file.
+	 *
+	 * @return the key or an empty string if the file cannot be
+	 * cached (e.g. because it does not exist)
+	 */
+	static std::string MakeKey(const char *uri) noexcept;
+
+	/**
+	 * Look up a file in the cache and mark it "recently used".
+	 *
+	 * @param key the return value of MakeKey()
+	 * @return the path of the cached copy or nullptr on cache miss
+	 */
+	AllocatedPath Lookup(std::string_view key) noexcept;
+
+	/**
+	 * Store a copy of a complete file, evicting old files if
+	 * necessary.  Errors are logged.  This may block for a long
+	 * time and should be called from a worker thread.
+	 *
+	 * @param key the return value of MakeKey()
+	 * @param is_cancelled polled between write() calls; if it
+	 * returns true, the partial file is deleted and nothing is
+	 * stored
+	 */
+	void Store(std::string_view key,
+		   std::span<const std::byte> data,
+		   BoundMethod<bool() noexcept> is_cancelled) noexcept;
+
+private:
+	[[gnu::pure]]
+	AllocatedPath GetFilePath(std::string_view name) const noexcept;
+
+	[[gnu::pure]]
+	AllocatedPath GetKeyPath(std::string_view name) const noexcept;
+
+	void Load();
+
+	void Insert(std::string &&name, std::string &&key,
+		    uint_least64_t size) noexcept;
+
+	/**
+	 * Delete files until the total size fits into the maximum.
+	 * Caller must lock the mutex.
+	 */
+	void EvictLocked() noexcept;
+
+	/**
+	 * Delete the entry and its files.  Caller must lock the
+	 * mutex.
+	 */
+	void DeleteLocked(Entry &entry) noexcept;
+};
@@ -3,18 +3,24 @@
 
 #include "Item.hxx"
 #include "Lease.hxx"
+#include "Disk.hxx"
 #include "input/InputStream.hxx"
 
 #include <cassert>
 
-InputCacheItem::InputCacheItem(InputStreamPtr _input) noexcept
+InputCacheItem::InputCacheItem(std::string_view _uri, InputStreamPtr _input,
+			       InputCacheDisk *_disk, std::string &&_disk_key)
 	:BufferingInputStream(std::move(_input)),
-	 uri(GetInput().GetURI())
+	 uri(_uri),
+	 disk(_disk), disk_key(std::move(_disk_key))
 {
+	Start();
 }
 
 InputCacheItem::~InputCacheItem() noexcept
 {
+	Stop();
+
 	assert(leases.empty());
 }
 
@@ -45,3 +51,17 @@ InputCacheItem::OnBufferAvailable() noexcept
 		i->OnInputCacheAvailable();
 	}
 }
+
+bool
+InputCacheItem::IsStopRequested() noexcept
+{
+	return IsStopping();
+}
+
+void
+InputCacheItem::OnBufferComplete() noexcept
+{
+	if (disk != nullptr)
+		disk->Store(disk_key, GetCompleteBuffer(),
+			    BIND_THIS_METHOD(IsStopRequested));
+}
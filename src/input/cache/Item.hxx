@@ -10,8 +10,10 @@
 #include "util/IntrusiveHashSet.hxx"
 
 #include <string>
+#include <string_view>
 
 class InputCacheLease;
+class InputCacheDisk;
 
 /**
  * An item in the #InputCacheManager.  It caches the contents of a
@@ -32,8 +34,24 @@ class InputCacheItem final
 	LeaseList leases;
 	LeaseList::iterator next_lease = leases.end();
 
+	/**
+	 * If not nullptr, then the complete file will be stored in
+	 * this disk cache with the key #disk_key.
+	 */
+	InputCacheDisk *const disk;
+
+	const std::string disk_key;
+
 public:
-	explicit InputCacheItem(InputStreamPtr _input) noexcept;
+	/**
+	 * Throws on error.
+	 *
+	 * @param _uri the URI of the original file (which may be
+	 * different from the URI of #_input if it was loaded from the
+	 * disk cache)
+	 */
+	InputCacheItem(std::string_view _uri, InputStreamPtr _input,
+		       InputCacheDisk *_disk, std::string &&_disk_key);
 	~InputCacheItem() noexcept;
 
 	const std::string &GetUri() const noexcept {
@@ -51,8 +69,14 @@ public:
 	void RemoveLease(InputCacheLease &lease) noexcept;
 
 private:
+	/**
+	 * Callback for InputCacheDisk::Store().
+	 */
+	bool IsStopRequested() noexcept;
+
 	/* virtual methods from class BufferingInputStream */
 	void OnBufferAvailable() noexcept override;
+	void OnBufferComplete() noexcept override;
 };
 
 #endif
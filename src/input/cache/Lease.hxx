@@ -52,6 +52,19 @@ public:
 		return *this;
 	}
 
+	/**
+	 * Release the item (if any) now.  Derived classes which
+	 * override OnInputCacheAvailable() should call this in their
+	 * destructor, because the buffering thread may invoke that
+	 * method until the lease has been removed from the item.
+	 */
+	void Release() noexcept {
+		if (item != nullptr) {
+			item->RemoveLease(*this);
+			item = nullptr;
+		}
+	}
+
 	operator bool() const noexcept {
 		return item != nullptr;
 	}
@@ -5,21 +5,33 @@
 #include "Config.hxx"
 #include "Item.hxx"
 #include "Lease.hxx"
+#include "Disk.hxx"
+#include "Log.hxx"
 #include "input/InputStream.hxx"
+#include "input/LocalOpen.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
+#include "util/Domain.hxx"
 #include "fs/Traits.hxx"
 #include "util/DeleteDisposer.hxx"
 
 #include <string.h>
 
+static constexpr Domain cache_domain("cache");
+
 inline std::string_view
 InputCacheManager::ItemGetUri::operator()(const InputCacheItem &item) const noexcept
 {
 	return item.GetUri();
 }
 
-InputCacheManager::InputCacheManager(const InputCacheConfig &config) noexcept
-	:max_total_size(config.size)
+InputCacheManager::InputCacheManager(const InputCacheConfig &config)
+	:max_total_size(config.size),
+	 prefetch_size(config.prefetch_size),
+	 prefetch_songs(config.prefetch_songs)
 {
+	if (!config.disk_path.IsNull())
+		disk = std::make_unique<InputCacheDisk>(AllocatedPath{config.disk_path},
+							config.disk_size);
 }
 
 InputCacheManager::~InputCacheManager() noexcept
@@ -43,6 +55,38 @@ InputCacheManager::Flush() noexcept
 	// TODO: invalidate busy items and flush them later
 }
 
+InputStreamPtr
+InputCacheManager::Open(const char *uri, std::string &disk_key)
+{
+	if (disk) {
+		disk_key = InputCacheDisk::MakeKey(uri);
+		if (!disk_key.empty()) {
+			if (const auto path = disk->Lookup(disk_key);
+			    !path.IsNull()) {
+				try {
+					auto is = OpenLocalInputStream(path, mutex);
+					FmtDebug(cache_domain,
+						 "Loading {:?} from disk cache",
+						 uri);
+
+					/* it's already there, don't
+					   store it again */
+					disk_key.clear();
+					return is;
+				} catch (...) {
+					/* may have been evicted
+					   meanwhile; fall back to the
+					   original file */
+					LogError(std::current_exception());
+				}
+			}
+		}
+	}
+
+	// TODO: wait for "ready" without blocking here
+	return InputStream::OpenReady(uri, mutex);
+}
+
 bool
 InputCacheManager::IsEligible(const InputStream &input) const noexcept
 {
@@ -82,8 +126,8 @@ InputCacheManager::Get(const char *uri, bool create)
 	if (!create)
 		return {};
 
-	// TODO: wait for "ready" without blocking here
-	auto is = InputStream::OpenReady(uri, mutex);
+	std::string disk_key;
+	auto is = Open(uri, disk_key);
 
 	if (!IsEligible(*is))
 		return {};
@@ -93,7 +137,9 @@ InputCacheManager::Get(const char *uri, bool create)
 
 	while (total_size > max_total_size && EvictOldestUnused()) {}
 
-	auto *item = new InputCacheItem(std::move(is));
+	auto *item = new InputCacheItem(uri, std::move(is),
+					disk_key.empty() ? nullptr : disk.get(),
+					std::move(disk_key));
 	items_by_uri.insert(*item);
 	items_by_time.push_back(*item);
 
@@ -106,6 +152,14 @@ InputCacheManager::Prefetch(const char *uri)
 	Get(uri, true);
 }
 
+void
+InputCacheManager::Cancel(const char *uri) noexcept
+{
+	if (auto iter = items_by_uri.find(uri);
+	    iter != items_by_uri.end() && !iter->IsInUse())
+		Delete(&*iter);
+}
+
 void
 InputCacheManager::Remove(InputCacheItem &item) noexcept
 {
@@ -3,15 +3,19 @@
 
 #pragma once
 
+#include "input/Ptr.hxx"
 #include "thread/Mutex.hxx"
 #include "util/IntrusiveHashSet.hxx"
 #include "util/IntrusiveList.hxx"
 
+#include <memory>
+#include <string>
 #include <string_view>
 
 class InputStream;
 class InputCacheItem;
 class InputCacheLease;
+class InputCacheDisk;
 struct InputCacheConfig;
 
 /**
@@ -21,6 +25,15 @@ struct InputCacheConfig;
 class InputCacheManager {
 	const size_t max_total_size;
 
+	const size_t prefetch_size;
+
+	const unsigned prefetch_songs;
+
+	/**
+	 * The persistent disk cache; nullptr if disabled.
+	 */
+	std::unique_ptr<InputCacheDisk> disk;
+
 	mutable Mutex mutex;
 
 	size_t total_size = 0;
@@ -38,11 +51,28 @@ class InputCacheManager {
 						   std::equal_to<std::string_view>>> items_by_uri;
 
 public:
-	explicit InputCacheManager(const InputCacheConfig &config) noexcept;
+	/**
+	 * Throws if the disk cache cannot be opened.
+	 */
+	explicit InputCacheManager(const InputCacheConfig &config);
 	~InputCacheManager() noexcept;
 
 	void Flush() noexcept;
 
+	/**
+	 * The maximum number of upcoming songs to be prefetched.
+	 */
+	unsigned GetPrefetchSongs() const noexcept {
+		return prefetch_songs;
+	}
+
+	/**
+	 * The maximum total size of all prefetched songs.
+	 */
+	size_t GetPrefetchSize() const noexcept {
+		return prefetch_size;
+	}
+
 	[[gnu::pure]]
 	bool Contains(const char *uri) noexcept;
 
@@ -62,7 +92,23 @@ public:
 	 */
 	void Prefetch(const char *uri);
 
+	/**
+	 * Remove the item with the given URI unless it is in use.
+	 * This cancels a prefetch which is not needed anymore.
+	 */
+	void Cancel(const char *uri) noexcept;
+
 private:
+	/**
+	 * Open the file, preferably from the disk cache.
+	 *
+	 * Throws on error.
+	 *
+	 * @param disk_key if the file shall be stored in the disk
+	 * cache, its key is returned here
+	 */
+	InputStreamPtr Open(const char *uri, std::string &disk_key);
+
 	/**
 	 * Check whether the given #InputStream can be stored in this
 	 * cache.
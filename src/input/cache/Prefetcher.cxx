@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "Prefetcher.hxx"
+#include "Manager.hxx"
+#include "Log.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
+#include "util/Domain.hxx"
+
+#include <algorithm>
+
+static constexpr Domain cache_domain("cache");
+
+inline bool
+InputCachePrefetcher::Pin::IsComplete() const noexcept
+{
+	auto &cache_item = GetCacheItem();
+	const std::scoped_lock lock{cache_item.mutex};
+	return cache_item.IsComplete();
+}
+
+void
+InputCachePrefetcher::Pin::OnInputCacheAvailable() noexcept
+{
+	/* the mutex is already locked by the caller */
+	if (GetCacheItem().IsComplete())
+		prefetcher.inject_run.Schedule();
+}
+
+InputCachePrefetcher::InputCachePrefetcher(EventLoop &event_loop,
+					   InputCacheManager &_cache) noexcept
+	:cache(_cache),
+	 defer_run(event_loop, BIND_THIS_METHOD(Run)),
+	 inject_run(event_loop, BIND_THIS_METHOD(Run))
+{
+}
+
+InputCachePrefetcher::~InputCachePrefetcher() noexcept = default;
+
+unsigned
+InputCachePrefetcher::GetMaxSongs() const noexcept
+{
+	return cache.GetPrefetchSongs();
+}
+
+void
+InputCachePrefetcher::Schedule(std::vector<std::string> &&uris) noexcept
+{
+	if (uris == wanted)
+		return;
+
+	wanted = std::move(uris);
+	defer_run.Schedule();
+}
+
+inline void
+InputCachePrefetcher::Run() noexcept
+{
+	const size_t max_size = cache.GetPrefetchSize();
+
+	auto old_pins = std::move(pins);
+	pins.clear();
+
+	size_t total_size = 0;
+
+	/* is there an incomplete prefetch?  If yes, then we don't
+	   start another one, to avoid competing for disk bandwidth
+	   with the nearest song */
+	bool busy = false;
+
+	for (const auto &uri : wanted) {
+		if (total_size >= max_size)
+			break;
+
+		if (auto i = std::find_if(old_pins.begin(), old_pins.end(),
+					  [&uri](const Pin &pin){
+						  return pin->GetUri() == uri;
+					  });
+		    i != old_pins.end()) {
+			/* keep this pin */
+			pins.splice(pins.end(), old_pins, i);
+		} else {
+			auto lease = cache.Get(uri.c_str(), false);
+			if (!lease) {
+				if (busy)
+					break;
+
+				FmtDebug(cache_domain, "Prefetch {:?}", uri);
+
+				try {
+					lease = cache.Get(uri.c_str(), true);
+				} catch (...) {
+					FmtError(cache_domain,
+						 "Prefetch {:?} failed: {}",
+						 uri, std::current_exception());
+					continue;
+				}
+
+				if (!lease)
+					/* not eligible for caching */
+					continue;
+			}
+
+			pins.emplace_back(*this, lease.GetCacheItem());
+		}
+
+		const auto &pin = pins.back();
+		total_size += pin->size();
+		if (!pin.IsComplete())
+			busy = true;
+	}
+
+	/* release all pins which are not needed anymore, and cancel
+	   incomplete prefetches to free the buffering thread and the
+	   cache space */
+	while (!old_pins.empty()) {
+		const auto &pin = old_pins.front();
+		const bool complete = pin.IsComplete();
+		const std::string uri = pin->GetUri();
+		old_pins.pop_front();
+
+		if (!complete) {
+			FmtDebug(cache_domain, "Cancel prefetch {:?}", uri);
+			cache.Cancel(uri.c_str());
+		}
+	}
+}
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include "Lease.hxx"
+#include "event/DeferEvent.hxx"
+#include "event/InjectEvent.hxx"
+
+#include <list>
+#include <string>
+#include <vector>
+
+class InputCacheManager;
+
+/**
+ * Loads the songs which are going to be played next into the
+ * #InputCacheManager.  Songs are loaded one at a time, nearest
+ * first, until the configured size budget is exhausted.  The cache
+ * items are pinned by a lease, so they cannot be evicted before they
+ * get played.
+ *
+ * All methods must be called from the #EventLoop thread.
+ */
+class InputCachePrefetcher {
+	InputCacheManager &cache;
+
+	/**
+	 * Invokes Run() after Schedule() has been called.  This
+	 * coalesces multiple queue modifications.
+	 */
+	DeferEvent defer_run;
+
+	/**
+	 * Invokes Run() after a file has been loaded completely; this
+	 * is triggered from the buffering thread.
+	 */
+	InjectEvent inject_run;
+
+	class Pin final : public InputCacheLease {
+		InputCachePrefetcher &prefetcher;
+
+	public:
+		Pin(InputCachePrefetcher &_prefetcher,
+		    InputCacheItem &_item) noexcept
+			:InputCacheLease(_item), prefetcher(_prefetcher) {}
+
+		~Pin() noexcept {
+			Release();
+		}
+
+		[[gnu::pure]]
+		bool IsComplete() const noexcept;
+
+		/* virtual methods from class InputCacheLease */
+		void OnInputCacheAvailable() noexcept override;
+	};
+
+	/**
+	 * Leases of all items which have been prefetched (or are
+	 * being prefetched), nearest first.
+	 */
+	std::list<Pin> pins;
+
+	/**
+	 * The URIs of the songs which are going to be played next,
+	 * nearest first.
+	 */
+	std::vector<std::string> wanted;
+
+public:
+	InputCachePrefetcher(EventLoop &event_loop,
+			     InputCacheManager &_cache) noexcept;
+	~InputCachePrefetcher() noexcept;
+
+	InputCachePrefetcher(const InputCachePrefetcher &) = delete;
+	InputCachePrefetcher &operator=(const InputCachePrefetcher &) = delete;
+
+	/**
+	 * The maximum number of songs which shall be passed to
+	 * Schedule().
+	 */
+	[[gnu::pure]]
+	unsigned GetMaxSongs() const noexcept;
+
+	/**
+	 * Replace the list of songs to be prefetched.  Prefetches of
+	 * songs which are not in the new list are canceled.
+	 *
+	 * @param uris the URIs of the songs which are going to be
+	 * played next, nearest first
+	 */
+	void Schedule(std::vector<std::string> &&uris) noexcept;
+
+private:
+	void Run() noexcept;
+};
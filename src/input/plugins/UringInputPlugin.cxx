@@ -5,44 +5,294 @@
 #include "../AsyncInputStream.hxx"
 #include "event/Call.hxx"
 #include "event/Loop.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
 #include "lib/fmt/RuntimeError.hxx"
 #include "lib/fmt/SystemError.hxx"
 #include "io/Open.hxx"
 #include "io/UniqueFileDescriptor.hxx"
-#include "io/uring/ReadOperation.hxx"
+#include "io/uring/Operation.hxx"
 #include "io/uring/Queue.hxx"
+#include "util/Domain.hxx"
+#include "util/HugeAllocator.hxx"
+#include "Log.hxx"
+
+#include <array>
+#include <cassert>
+#include <deque>
+#include <memory>
 
 #include <sys/stat.h>
 
 /**
- * Read at most this number of bytes in each read request.
+ * Read at most this number of bytes in each read request.  This is
+ * also the size of each registered buffer.
+ */
+static constexpr size_t URING_MAX_READ = 256 * 1024;
+
+/**
+ * Read at least this number of bytes in each read request (unless
+ * the end of the file is reached).
+ */
+static constexpr size_t URING_MIN_READ = 32 * 1024;
+
+/**
+ * The initial size of read requests.  It adapts to the consumption
+ * rate of the stream (between #URING_MIN_READ and #URING_MAX_READ).
+ */
+static constexpr size_t URING_INITIAL_READ = 64 * 1024;
+
+/**
+ * The maximum number of read requests in flight per stream.
+ */
+static constexpr unsigned URING_MAX_IN_FLIGHT = 4;
+
+/**
+ * The number of buffers registered with the io_uring; they are
+ * shared by all streams.
  */
-static const size_t URING_MAX_READ = 256 * 1024;
+static constexpr unsigned URING_N_BUFFERS = 16;
 
 /**
  * Do not buffer more than this number of bytes.  It should be a
  * reasonable limit that doesn't make low-end machines suffer too
- * much, but doesn't cause stuttering on high-latency lines.
+ * much, but doesn't cause stuttering with high-bitrate files.
  */
-static const size_t URING_MAX_BUFFERED = 512 * 1024;
+static constexpr size_t URING_MAX_BUFFERED = 2 * 1024 * 1024;
 
 /**
  * Resume the stream at this number of bytes after it has been paused.
  */
-static const size_t URING_RESUME_AT = 384 * 1024;
+static constexpr size_t URING_RESUME_AT = 1536 * 1024;
+
+static constexpr Domain uring_input_domain("uring_input");
+
+/**
+ * A set of buffers registered with the io_uring
+ * (io_uring_register_buffers()), which saves the kernel from mapping
+ * the destination pages for each read.  If registration fails (e.g.
+ * due to RLIMIT_MEMLOCK), the buffers are still used, but with
+ * regular read requests.
+ *
+ * This class is only accessed in the #EventLoop thread.
+ */
+class UringBufferPool {
+	HugeArray<std::byte> allocation;
+
+	/**
+	 * The indexes of all buffers which are not in use.
+	 */
+	std::array<unsigned, URING_N_BUFFERS> free_list;
+	unsigned n_free = URING_N_BUFFERS;
+
+	bool registered = false;
+
+public:
+	explicit UringBufferPool(Uring::Queue &queue)
+		:allocation(URING_N_BUFFERS * URING_MAX_READ)
+	{
+		allocation.SetName("UringBufferPool");
+		allocation.ForkCow(false);
+
+		std::array<struct iovec, URING_N_BUFFERS> iov;
+		for (unsigned i = 0; i < URING_N_BUFFERS; ++i) {
+			free_list[i] = URING_N_BUFFERS - 1 - i;
+			iov[i] = {
+				.iov_base = &allocation[i * URING_MAX_READ],
+				.iov_len = URING_MAX_READ,
+			};
+		}
+
+		try {
+			queue.RegisterBuffers(iov);
+			registered = true;
+		} catch (...) {
+			FmtInfo(uring_input_domain,
+				"Failed to register buffers: {}",
+				std::current_exception());
+		}
+	}
+
+	bool IsRegistered() const noexcept {
+		return registered;
+	}
+
+	/**
+	 * @return a buffer index or -1 if all buffers are in use
+	 */
+	int Allocate() noexcept {
+		if (n_free == 0)
+			return -1;
+
+		return free_list[--n_free];
+	}
+
+	void Free(unsigned index) noexcept {
+		assert(index < URING_N_BUFFERS);
+		assert(n_free < URING_N_BUFFERS);
+
+		free_list[n_free++] = index;
+	}
+
+	std::span<std::byte> Get(unsigned index) noexcept {
+		assert(index < URING_N_BUFFERS);
+
+		return {&allocation[index * URING_MAX_READ], URING_MAX_READ};
+	}
+};
 
 static EventLoop *uring_input_event_loop;
 static Uring::Queue *uring_input_queue;
+static std::unique_ptr<UringBufferPool> uring_input_buffers;
 static bool uring_input_initialized = false;
 
-class UringInputStream final : public AsyncInputStream, Uring::ReadHandler {
+class UringInputStream;
+
+/**
+ * One read request of a #UringInputStream.  Its buffer is one of the
+ * #UringBufferPool buffers (if one is available) or a private heap
+ * allocation.
+ *
+ * Instances of this class must be allocated with `new`, because
+ * cancellation will require this object (and its buffer) to persist
+ * until the kernel completes the operation.
+ */
+class UringReadRequest final : Uring::Operation {
+	/**
+	 * The stream which receives the data; nullptr after it has
+	 * been canceled.
+	 */
+	UringInputStream *stream;
+
+	const uint64_t offset;
+
+	/**
+	 * The #UringBufferPool buffer index or -1 if #heap_buffer is
+	 * used.
+	 */
+	const int buffer_index;
+
+	std::unique_ptr<std::byte[]> heap_buffer;
+
+	const std::span<std::byte> buffer;
+
+	struct iovec iov;
+
+	/**
+	 * The result passed to OnUringCompletion(); only valid if
+	 * #complete is set.
+	 */
+	int result;
+
+	bool complete = false;
+
+public:
+	UringReadRequest(UringInputStream &_stream,
+			 uint64_t _offset, std::size_t size) noexcept
+		:stream(&_stream), offset(_offset),
+		 buffer_index(uring_input_buffers->Allocate()),
+		 heap_buffer(buffer_index < 0
+			     ? std::make_unique_for_overwrite<std::byte[]>(size)
+			     : nullptr),
+		 buffer(buffer_index < 0
+			? std::span{heap_buffer.get(), size}
+			: uring_input_buffers->Get(buffer_index).first(size))
+	{
+		assert(size <= URING_MAX_READ);
+	}
+
+	~UringReadRequest() noexcept {
+		if (buffer_index >= 0)
+			uring_input_buffers->Free(buffer_index);
+	}
+
+	void Start(Uring::Queue &queue, FileDescriptor fd) noexcept {
+		auto &s = queue.RequireSubmitEntry();
+
+		if (buffer_index >= 0 && uring_input_buffers->IsRegistered()) {
+			io_uring_prep_read_fixed(&s, fd.Get(),
+						 buffer.data(), buffer.size(),
+						 offset, buffer_index);
+		} else {
+			iov.iov_base = buffer.data();
+			iov.iov_len = buffer.size();
+			io_uring_prep_readv(&s, fd.Get(), &iov, 1, offset);
+		}
+
+		queue.Push(s, *this);
+	}
+
+	/**
+	 * Cancel this request.  It will be freed after the kernel has
+	 * finished, i.e. the caller resigns ownership.
+	 */
+	void Cancel() noexcept {
+		if (complete)
+			delete this;
+		else
+			stream = nullptr;
+	}
+
+	uint64_t GetOffset() const noexcept {
+		return offset;
+	}
+
+	std::size_t GetSize() const noexcept {
+		return buffer.size();
+	}
+
+	bool IsComplete() const noexcept {
+		return complete;
+	}
+
+	/**
+	 * @return the number of bytes read or a negative errno value
+	 */
+	int GetResult() const noexcept {
+		assert(complete);
+
+		return result;
+	}
+
+	std::span<const std::byte> GetData() const noexcept {
+		assert(complete);
+		assert(result >= 0);
+
+		return buffer.first(result);
+	}
+
+private:
+	/* virtual methods from class Uring::Operation */
+	void OnUringCompletion(int res) noexcept override;
+};
+
+class UringInputStream final : public AsyncInputStream {
 	Uring::Queue &uring;
 
 	UniqueFileDescriptor fd;
 
+	/**
+	 * The file offset of the next read request.
+	 */
 	uint64_t next_offset = 0;
 
-	std::unique_ptr<Uring::ReadOperation> read_operation;
+	/**
+	 * Read requests in flight (and completed requests which have
+	 * not yet been copied to the buffer because an earlier one is
+	 * still in flight), ordered by offset.
+	 */
+	std::deque<UringReadRequest *> requests;
+
+	/**
+	 * The total size of all #requests; this much buffer space is
+	 * reserved for them.
+	 */
+	std::size_t reserved = 0;
+
+	/**
+	 * The size of new read requests.  It grows if the consumer
+	 * is waiting for data, and it shrinks if the buffer is full.
+	 */
+	std::size_t read_size = URING_INITIAL_READ;
 
 public:
 	UringInputStream(EventLoop &event_loop, Uring::Queue &_uring,
@@ -61,104 +311,166 @@ public:
 		SetReady();
 
 		BlockingCall(GetEventLoop(), [this](){
-			SubmitRead();
+			SubmitReads();
 		});
 	}
 
 	~UringInputStream() noexcept override {
 		BlockingCall(GetEventLoop(), [this](){
-			CancelRead();
+			CancelReads();
 		});
 	}
 
-private:
-	void SubmitRead() noexcept;
+	/**
+	 * Called by #UringReadRequest when it has completed.
+	 */
+	void OnReadComplete() noexcept;
 
-	void CancelRead() noexcept {
-		if (read_operation)
-			read_operation.release()->Cancel();
+private:
+	/**
+	 * Submit new read requests until #URING_MAX_IN_FLIGHT is
+	 * reached or the buffer is full.  Caller must lock the mutex
+	 * (unless called from the constructor).
+	 */
+	void SubmitReads() noexcept;
+
+	void CancelReads() noexcept {
+		for (auto *request : requests)
+			request->Cancel();
+		requests.clear();
+		reserved = 0;
 	}
 
+	/**
+	 * Copy completed requests (in offset order) to the buffer.
+	 * Caller must lock the mutex.
+	 *
+	 * @return false if an error has occurred
+	 */
+	bool CommitReads() noexcept;
+
 protected:
 	/* virtual methods from AsyncInputStream */
 	void DoResume() override;
 	void DoSeek(offset_type new_offset) override;
-
-private:
-	/* virtual methods from class Uring::Operation */
-	void OnRead(std::unique_ptr<std::byte[]> buffer,
-		    std::size_t size) noexcept override;
-	void OnReadError(int error) noexcept override;
 };
 
 void
-UringInputStream::SubmitRead() noexcept
+UringReadRequest::OnUringCompletion(int res) noexcept
 {
-	assert(!read_operation);
-
-	int64_t remaining = size - next_offset;
-	if (remaining <= 0)
-		return;
-
-	auto w = PrepareWriteBuffer();
-	if (w.empty()) {
-		Pause();
-		return;
-	}
-
-	read_operation = std::make_unique<Uring::ReadOperation>();
-	read_operation->Start(uring, fd, next_offset,
-			      std::min(w.size(), URING_MAX_READ),
-			      *this);
+	result = res;
+	complete = true;
+
+	if (stream == nullptr)
+		/* this request was canceled */
+		delete this;
+	else
+		stream->OnReadComplete();
 }
 
 void
-UringInputStream::DoResume()
+UringInputStream::SubmitReads() noexcept
 {
-	SubmitRead();
+	while (requests.size() < URING_MAX_IN_FLIGHT) {
+		if (next_offset >= size)
+			return;
+
+		const uint64_t remaining = size - next_offset;
+
+		const std::size_t space = GetBufferSpace() - reserved;
+		if (space < std::min<uint64_t>(remaining, URING_MIN_READ)) {
+			if (requests.empty()) {
+				/* the consumer is slow: make smaller
+				   requests to keep the buffer level
+				   smooth */
+				read_size = std::max(read_size / 2,
+						     URING_MIN_READ);
+				Pause();
+			}
+
+			return;
+		}
+
+		const std::size_t nbytes =
+			std::min<uint64_t>({read_size, space, remaining});
+
+		auto *request = new UringReadRequest(*this, next_offset,
+						     nbytes);
+		requests.push_back(request);
+		reserved += nbytes;
+		next_offset += nbytes;
+
+		request->Start(uring, fd);
+	}
 }
 
-void
-UringInputStream::DoSeek(offset_type new_offset)
+inline bool
+UringInputStream::CommitReads() noexcept
 {
-	CancelRead();
+	while (!requests.empty() && requests.front()->IsComplete()) {
+		std::unique_ptr<UringReadRequest> request{requests.front()};
+		requests.pop_front();
+
+		assert(reserved >= request->GetSize());
+		reserved -= request->GetSize();
+
+		const int result = request->GetResult();
+		if (result < 0) {
+			postponed_exception = std::make_exception_ptr(MakeErrno(-result, "Read failed"));
+			CancelReads();
+			InvokeOnAvailable();
+			return false;
+		}
+
+		if (result == 0) {
+			postponed_exception = std::make_exception_ptr(std::runtime_error("Premature end of file"));
+			CancelReads();
+			InvokeOnAvailable();
+			return false;
+		}
+
+		if (IsBufferEmpty())
+			/* the consumer is waiting for us: make larger
+			   requests */
+			read_size = std::min(read_size * 2, URING_MAX_READ);
+
+		AppendToBuffer(request->GetData());
+
+		if (std::size_t(result) < request->GetSize()) {
+			/* short read: discard all following
+			   requests and continue after the data we
+			   got */
+			CancelReads();
+			next_offset = request->GetOffset() + result;
+		}
+	}
 
-	next_offset = offset = new_offset;
-	SeekDone();
-	SubmitRead();
+	return true;
 }
 
 void
-UringInputStream::OnRead(std::unique_ptr<std::byte[]> data,
-			 std::size_t nbytes) noexcept
+UringInputStream::OnReadComplete() noexcept
 {
-	read_operation.reset();
-
 	const std::scoped_lock protect{mutex};
 
-	if (nbytes == 0) {
-		postponed_exception = std::make_exception_ptr(std::runtime_error("Premature end of file"));
-		InvokeOnAvailable();
-		return;
-	}
-
-	auto w = PrepareWriteBuffer();
-	assert(w.size() >= nbytes);
-	memcpy(w.data(), data.get(), nbytes);
-	CommitWriteBuffer(nbytes);
-	next_offset += nbytes;
-	SubmitRead();
+	if (CommitReads())
+		SubmitReads();
 }
 
 void
-UringInputStream::OnReadError(int error) noexcept
+UringInputStream::DoResume()
 {
-	read_operation.reset();
+	SubmitReads();
+}
 
-	const std::scoped_lock protect{mutex};
+void
+UringInputStream::DoSeek(offset_type new_offset)
+{
+	CancelReads();
 
-	postponed_exception = std::make_exception_ptr(MakeErrno(error, "Read failed"));
-	InvokeOnAvailable();
+	next_offset = offset = new_offset;
+	SeekDone();
+	SubmitReads();
 }
 
 InputStreamPtr
@@ -170,6 +482,8 @@ OpenUringInputStream(const char *path, Mutex &mutex)
 				return;
 
 			uring_input_queue = uring_input_event_loop->GetUring();
+			if (uring_input_queue != nullptr)
+				uring_input_buffers = std::make_unique<UringBufferPool>(*uring_input_queue);
 			uring_input_initialized = true;
 		});
 	}
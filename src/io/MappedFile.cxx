@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// author: Max Kellermann <max.kellermann@gmail.com>
+
+#include "MappedFile.hxx"
+#include "FileReader.hxx"
+#include "fs/Path.hxx"
+#include "lib/fmt/SystemError.hxx"
+
+#ifdef _WIN32
+#include <stdexcept>
+#else
+#include <sys/mman.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(Path path)
+{
+	FileReader reader{path};
+
+	const std::size_t size = reader.GetSize();
+	buffer = std::make_unique<std::byte[]>(size);
+
+	std::span<std::byte> dest{buffer.get(), size};
+	while (!dest.empty()) {
+		const std::size_t nbytes = reader.Read(dest);
+		if (nbytes == 0)
+			throw std::runtime_error("Unexpected end of file");
+
+		dest = dest.subspan(nbytes);
+	}
+
+	data = {buffer.get(), size};
+}
+
+MappedFile::~MappedFile() noexcept = default;
+
+#else
+
+MappedFile::MappedFile(Path path)
+{
+	const FileReader reader{path};
+
+	const std::size_t size = reader.GetSize();
+	if (size == 0)
+		/* mmap() refuses to map empty files */
+		return;
+
+	void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE,
+		       reader.GetFD().Get(), 0);
+	if (p == MAP_FAILED)
+		throw MakeErrno("Failed to map file");
+
+	/* the file is usually parsed once from start to end */
+	madvise(p, size, MADV_SEQUENTIAL);
+
+	data = {static_cast<const std::byte *>(p), size};
+}
+
+MappedFile::~MappedFile() noexcept
+{
+	if (!data.empty())
+		munmap(const_cast<std::byte *>(data.data()), data.size());
+}
+
+#endif
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// author: Max Kellermann <max.kellermann@gmail.com>
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+
+class Path;
+
+/**
+ * A read-only view of a whole file's contents.  On POSIX systems,
+ * the file is mapped into memory with mmap(); on other systems, it
+ * is read into a heap buffer.
+ */
+class MappedFile {
+	std::span<const std::byte> data;
+
+#ifdef _WIN32
+	std::unique_ptr<std::byte[]> buffer;
+#endif
+
+public:
+	/**
+	 * Throws on error.
+	 */
+	explicit MappedFile(Path path);
+
+	~MappedFile() noexcept;
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	std::span<const std::byte> GetData() const noexcept {
+		return data;
+	}
+};
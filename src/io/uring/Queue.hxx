@@ -38,6 +38,10 @@ public:
 		ring.SetMaxWorkers(bounded, unbounded);
 	}
 
+	void RegisterBuffers(std::span<const struct iovec> buffers) {
+		ring.RegisterBuffers(buffers);
+	}
+
 	struct io_uring_sqe *GetSubmitEntry() noexcept {
 		return ring.GetSubmitEntry();
 	}
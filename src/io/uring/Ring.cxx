@@ -29,6 +29,15 @@ Ring::SetMaxWorkers(unsigned values[2])
 		throw MakeErrno(-error, "io_uring_register_iowq_max_workers() failed");
 }
 
+void
+Ring::RegisterBuffers(std::span<const struct iovec> buffers)
+{
+	if (int error = io_uring_register_buffers(&ring, buffers.data(),
+						  buffers.size());
+	    error < 0)
+		throw MakeErrno(-error, "io_uring_register_buffers() failed");
+}
+
 void
 Ring::Submit()
 {
@@ -8,6 +8,8 @@
 
 #include <liburing.h>
 
+#include <span>
+
 namespace Uring {
 
 /**
@@ -67,6 +69,13 @@ public:
 		SetMaxWorkers(values);
 	}
 
+	/**
+	 * Wrapper for io_uring_register_buffers().
+	 *
+	 * Throws on error.
+	 */
+	void RegisterBuffers(std::span<const struct iovec> buffers);
+
 	/**
 	 * Returns a submit queue entry or nullptr if the submit queue
 	 * is full.
@@ -15,8 +15,15 @@
 
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
 using std::string_view_literals::operator""sv;
 
 HttpdClient::~HttpdClient() noexcept
@@ -44,7 +51,11 @@ HttpdClient::BeginResponse() noexcept
 	assert(state != State::RESPONSE);
 
 	state = State::RESPONSE;
-	current_page = nullptr;
+
+	const std::scoped_lock protect{httpd.mutex};
+
+	/* start streaming with the next data from the encoder */
+	cursor.position = httpd.ring.GetHead();
 
 	if (!head_method)
 		httpd.SendHeader(*this);
@@ -164,193 +175,183 @@ HttpdClient::HttpdClient(HttpdOutput &_httpd, UniqueSocketDescriptor _fd,
 {
 }
 
-void
-HttpdClient::ClearQueue() noexcept
-{
-	assert(state == State::RESPONSE);
-
-	while (!pages.empty()) {
-#ifndef NDEBUG
-		auto &page = pages.front();
-		assert(queue_size >= page->size());
-		queue_size -= page->size();
-#endif
-
-		pages.pop();
-	}
-
-	assert(queue_size == 0);
-}
-
 void
 HttpdClient::CancelQueue() noexcept
 {
 	if (state != State::RESPONSE)
 		return;
 
-	ClearQueue();
-
-	if (current_page == nullptr)
-		event.CancelWrite();
+	cursor.position = httpd.ring.GetHead();
+	event.CancelWrite();
 }
 
-ssize_t
-HttpdClient::TryWritePage(const Page &page, size_t position) noexcept
+std::span<const std::byte>
+HttpdClient::GetChunk(const Cursor &c) const noexcept
 {
-	assert(position < page.size());
+	if (metadata_requested && c.metadata_fill >= metaint) {
+		/* a metadata block is due */
 
-	return GetSocket().WriteNoWait(std::span<const std::byte>{page}.subspan(position));
-}
+		if (!c.metadata_sent)
+			return std::span<const std::byte>{*metadata}
+				.subspan(c.metadata_position);
 
-ssize_t
-HttpdClient::TryWritePageN(const Page &page,
-			   size_t position, ssize_t n) noexcept
-{
-	return n >= 0
-		? GetSocket().WriteNoWait({page.data() + position, (std::size_t)n})
-		: TryWritePage(page, position);
+		/* no new metadata: send an empty metadata block
+		   (just the length byte) */
+		static constexpr std::byte empty_data[1]{};
+		return empty_data;
+	}
+
+	std::span<const std::byte> chunk;
+	if (header != nullptr && c.header_position < header->size())
+		chunk = std::span<const std::byte>{*header}
+			.subspan(c.header_position);
+	else
+		chunk = httpd.ring.Read(c.position);
+
+	if (metadata_requested && chunk.size() > metaint - c.metadata_fill)
+		chunk = chunk.first(metaint - c.metadata_fill);
+
+	return chunk;
 }
 
-ssize_t
-HttpdClient::GetBytesTillMetaData() const noexcept
+void
+HttpdClient::Advance(Cursor &c, std::size_t n) const noexcept
 {
-	if (metadata_requested &&
-	    current_page->size() - current_position > metaint - metadata_fill)
-		return metaint - metadata_fill;
+	if (metadata_requested && c.metadata_fill >= metaint) {
+		if (!c.metadata_sent) {
+			c.metadata_position += n;
+			assert(c.metadata_position <= metadata->size());
 
-	return -1;
+			if (c.metadata_position < metadata->size())
+				return;
+
+			c.metadata_position = 0;
+			c.metadata_sent = true;
+		}
+
+		c.metadata_fill = 0;
+		return;
+	}
+
+	if (header != nullptr && c.header_position < header->size())
+		c.header_position += n;
+	else
+		c.position += n;
+
+	if (metadata_requested)
+		c.metadata_fill += n;
 }
 
-inline bool
+bool
 HttpdClient::TryWrite() noexcept
 {
-	const std::scoped_lock protect{httpd.mutex};
-
 	assert(state == State::RESPONSE);
 
-	if (current_page == nullptr) {
-		if (pages.empty()) {
-			/* another thread has removed the event source
-			   while this thread was waiting for
-			   httpd.mutex */
-			event.CancelWrite();
-			return true;
-		}
+	if (!httpd.ring.IsValid(cursor.position)) {
+		LogDebug(httpd_output_domain,
+			 "client is too slow, skipping ahead");
+		cursor.position = httpd.ring.GetHead();
+	}
+
+	/* collect all pending chunks (the header, up to two
+	   portions of the ring and metadata blocks in between) and
+	   send them with a single system call */
 
-		current_page = pages.front();
-		pages.pop();
-		current_position = 0;
+	std::array<std::span<const std::byte>, 16> chunks;
+	std::size_t n = 0;
 
-		assert(queue_size >= current_page->size());
-		queue_size -= current_page->size();
+	for (Cursor c = cursor; n < chunks.size();) {
+		const auto chunk = GetChunk(c);
+		if (chunk.empty())
+			break;
+
+		chunks[n++] = chunk;
+		Advance(c, chunk.size());
 	}
 
-	const ssize_t bytes_to_write = GetBytesTillMetaData();
-	if (bytes_to_write == 0) {
-		if (!metadata_sent) {
-			ssize_t nbytes = TryWritePage(*metadata,
-						      metadata_current_position);
-			if (nbytes < 0) {
-				auto e = GetSocketError();
-				if (IsSocketErrorSendWouldBlock(e))
-					return true;
-
-				if (!IsSocketErrorClosed(e)) {
-					SocketErrorMessage msg(e);
-					FmtWarning(httpd_output_domain,
-						   "failed to write to client: {}",
-						   (const char *)msg);
-				}
-
-				Close();
-				return false;
-			}
-
-			metadata_current_position += nbytes;
-
-			if (metadata->size() - metadata_current_position == 0) {
-				metadata_fill = 0;
-				metadata_current_position = 0;
-				metadata_sent = true;
-			}
-		} else {
-			static constexpr std::byte empty_data[1]{};
-
-			ssize_t nbytes = GetSocket().Write(empty_data);
-			if (nbytes < 0) {
-				auto e = GetSocketError();
-				if (IsSocketErrorSendWouldBlock(e))
-					return true;
-
-				if (!IsSocketErrorClosed(e)) {
-					SocketErrorMessage msg(e);
-					FmtWarning(httpd_output_domain,
-						   "failed to write to client: {}",
-						   (const char *)msg);
-				}
-
-				Close();
-				return false;
-			}
+	if (n == 0) {
+		/* everything has been sent */
+		event.CancelWrite();
+		return true;
+	}
 
-			metadata_fill = 0;
-			metadata_current_position = 0;
-		}
-	} else {
-		ssize_t nbytes =
-			TryWritePageN(*current_page, current_position,
-				      bytes_to_write);
-		if (nbytes < 0) {
-			auto e = GetSocketError();
-			if (IsSocketErrorSendWouldBlock(e))
-				return true;
-
-			if (!IsSocketErrorClosed(e)) {
-				SocketErrorMessage msg(e);
-				FmtWarning(httpd_output_domain,
-					   "failed to write to client: {}",
-					   (const char *)msg);
-			}
-
-			Close();
-			return false;
+#ifdef _WIN32
+	/* no sendmsg() on Windows */
+	ssize_t nbytes = GetSocket().WriteNoWait(chunks.front());
+#else
+	std::array<struct iovec, chunks.size()> v;
+	for (std::size_t i = 0; i < n; ++i)
+		v[i] = {
+			.iov_base = const_cast<std::byte *>(chunks[i].data()),
+			.iov_len = chunks[i].size(),
+		};
+
+	ssize_t nbytes = GetSocket().Send(std::span{v}.first(n),
+					  MSG_DONTWAIT);
+#endif
+	if (nbytes < 0) {
+		auto e = GetSocketError();
+		if (IsSocketErrorSendWouldBlock(e)) {
+			event.ScheduleWrite();
+			return true;
 		}
 
-		current_position += nbytes;
-		assert(current_position <= current_page->size());
-
-		if (metadata_requested)
-			metadata_fill += nbytes;
+		if (!IsSocketErrorClosed(e)) {
+			SocketErrorMessage msg(e);
+			FmtWarning(httpd_output_domain,
+				   "failed to write to client: {}",
+				   (const char *)msg);
+		}
 
-		if (current_position >= current_page->size()) {
-			current_page.reset();
+		Close();
+		return false;
+	}
 
-			if (pages.empty())
-				/* all pages are sent: remove the
-				   event source */
-				event.CancelWrite();
-		}
+	for (std::size_t remaining = nbytes; remaining > 0;) {
+		const std::size_t size = std::min(GetChunk(cursor).size(),
+						  remaining);
+		assert(size > 0);
+		Advance(cursor, size);
+		remaining -= size;
 	}
 
+	if (GetChunk(cursor).empty())
+		/* all data has been sent: remove the event source */
+		event.CancelWrite();
+	else
+		event.ScheduleWrite();
+
 	return true;
 }
 
 void
-HttpdClient::PushPage(PagePtr page) noexcept
+HttpdClient::OnStreamData() noexcept
 {
 	if (state != State::RESPONSE)
 		/* the client is still writing the HTTP request */
 		return;
 
-	if (queue_size > 256 * 1024) {
-		LogDebug(httpd_output_domain,
-			 "client is too slow, flushing its queue");
-		ClearQueue();
-	}
+	if (event.IsWritePending())
+		/* the socket is congested; wait for it to become
+		   writable */
+		return;
+
+	/* the socket was idle, which means it's probably writable;
+	   try to send right now, which saves two epoll_ctl() calls
+	   and an epoll_wait() wakeup */
+	TryWrite();
+}
+
+void
+HttpdClient::SetHeader(PagePtr page) noexcept
+{
+	assert(state == State::RESPONSE);
 
-	queue_size += page->size();
-	pages.emplace(std::move(page));
+	header = std::move(page);
+	cursor.header_position = 0;
 
+	/* don't send it right now, because the response headers
+	   need to be sent first */
 	event.ScheduleWrite();
 }
 
@@ -360,15 +361,17 @@ HttpdClient::PushMetaData(PagePtr page) noexcept
 	assert(page != nullptr);
 
 	metadata = std::move(page);
-	metadata_sent = false;
+	cursor.metadata_sent = false;
 }
 
 void
 HttpdClient::OnSocketReady(unsigned flags) noexcept
 {
-	if (flags & SocketEvent::WRITE)
+	if (flags & SocketEvent::WRITE) {
+		const std::scoped_lock protect{httpd.mutex};
 		if (!TryWrite())
 			return;
+	}
 
 	BufferedSocket::OnSocketReady(flags);
 }
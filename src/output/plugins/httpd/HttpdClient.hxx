@@ -4,12 +4,12 @@
 #pragma once
 
 #include "Page.hxx"
+#include "StreamRing.hxx"
 #include "event/BufferedSocket.hxx"
 #include "util/IntrusiveList.hxx"
 
 #include <cstddef>
-#include <list>
-#include <queue>
+#include <span>
 #include <string_view>
 
 class UniqueSocketDescriptor;
@@ -39,25 +39,49 @@ class HttpdClient final
 	} state = State::REQUEST;
 
 	/**
-	 * A queue of #Page objects to be sent to the client.
+	 * The encoder header which is sent before the stream; nullptr
+	 * if none.
 	 */
-	std::queue<PagePtr, std::list<PagePtr>> pages;
+	PagePtr header;
 
 	/**
-	 * The sum of all page sizes in #pages.
+	 * The position within the stream which will be sent next.
+	 * All bytes before this position (including the header) have
+	 * already been sent.
 	 */
-	size_t queue_size = 0;
+	struct Cursor {
+		/**
+		 * The number of bytes of #header which were already
+		 * sent.
+		 */
+		std::size_t header_position = 0;
 
-	/**
-	 * The #page which is currently being sent to the client.
-	 */
-	PagePtr current_page;
+		/**
+		 * The position in the #HttpdOutput's #StreamRing.
+		 */
+		StreamRing::Position position = 0;
 
-	/**
-	 * The amount of bytes which were already sent from
-	 * #current_page.
-	 */
-	size_t current_position;
+		/**
+		 * The amount of streaming data sent to the client
+		 * since the last icy information was sent.
+		 */
+		std::size_t metadata_fill = 0;
+
+		/**
+		 * The amount of bytes which were already sent from
+		 * the metadata.
+		 */
+		std::size_t metadata_position = 0;
+
+		/**
+		 * If the current metadata was already sent to the
+		 * client.
+		 *
+		 * Initialized to `true` because there is no metadata
+		 * #Page pending to be sent.
+		 */
+		bool metadata_sent = true;
+	} cursor;
 
 	/**
 	 * Is this a HEAD request?
@@ -82,14 +106,6 @@ class HttpdClient final
 	 */
 	bool metadata_requested = false;
 
-	/**
-	 * If the current metadata was already sent to the client.
-	 *
-	 * Initialized to `true` because there is no metadata #Page
-	 * pending to be sent.
-	 */
-	bool metadata_sent = true;
-
 	/**
 	 * The amount of streaming data between each metadata block
 	 */
@@ -100,17 +116,6 @@ class HttpdClient final
 	 */
 	PagePtr metadata;
 
-	/**
-	 * The amount of bytes which were already sent from the metadata.
-	 */
-	size_t metadata_current_position = 0;
-
-	/**
-	 * The amount of streaming data sent to the client
-	 * since the last icy information was sent.
-	 */
-	unsigned metadata_fill = 0;
-
 public:
 	/**
 	 * @param httpd the HTTP output device
@@ -136,7 +141,9 @@ public:
 	void LockClose() noexcept;
 
 	/**
-	 * Clears the page queue.
+	 * Discard all pending stream data, continue with new data.
+	 *
+	 * Caller must lock the mutex.
 	 */
 	void CancelQueue() noexcept;
 
@@ -155,19 +162,27 @@ public:
 	 */
 	bool SendResponse() noexcept;
 
-	[[gnu::pure]]
-	ssize_t GetBytesTillMetaData() const noexcept;
-
-	ssize_t TryWritePage(const Page &page, size_t position) noexcept;
-	ssize_t TryWritePageN(const Page &page,
-			      size_t position, ssize_t n) noexcept;
-
+	/**
+	 * Send as much pending data as possible to the socket.
+	 *
+	 * Caller must lock the mutex.
+	 *
+	 * @return false if the client has been closed
+	 */
 	bool TryWrite() noexcept;
 
 	/**
-	 * Appends a page to the client's queue.
+	 * New data has been appended to the #StreamRing.  Attempts to
+	 * send it right away.
+	 *
+	 * Caller must lock the mutex.
 	 */
-	void PushPage(PagePtr page) noexcept;
+	void OnStreamData() noexcept;
+
+	/**
+	 * Sends the encoder header before the stream.
+	 */
+	void SetHeader(PagePtr page) noexcept;
 
 	/**
 	 * Sends the passed metadata.
@@ -175,7 +190,19 @@ public:
 	void PushMetaData(PagePtr page) noexcept;
 
 private:
-	void ClearQueue() noexcept;
+	/**
+	 * Returns the next contiguous chunk of data to be sent at the
+	 * given #Cursor.
+	 */
+	[[gnu::pure]]
+	std::span<const std::byte> GetChunk(const Cursor &c) const noexcept;
+
+	/**
+	 * Advance the #Cursor by the given number of bytes (which
+	 * must not exceed the size of GetChunk()).
+	 */
+	void Advance(Cursor &c, std::size_t n) const noexcept;
+
 
 protected:
 	/* virtual methods from class BufferedSocket */
@@ -9,17 +9,15 @@
 #pragma once
 
 #include "HttpdClient.hxx"
+#include "StreamRing.hxx"
 #include "output/Interface.hxx"
 #include "output/Timer.hxx"
 #include "thread/Mutex.hxx"
-#include "thread/Cond.hxx"
 #include "event/ServerSocket.hxx"
 #include "event/InjectEvent.hxx"
 #include "util/Cast.hxx"
 #include "util/IntrusiveList.hxx"
 
-#include <queue>
-#include <list>
 #include <memory>
 #include <span>
 
@@ -32,6 +30,12 @@ class Encoder;
 struct Tag;
 
 class HttpdOutput final : AudioOutput, ServerSocket {
+	/**
+	 * The size of the #ring.  A client which falls behind by
+	 * more than this skips ahead.
+	 */
+	static constexpr std::size_t RING_SIZE = 256 * 1024;
+
 	/**
 	 * True if the audio output is open and accepts client
 	 * connections.
@@ -61,16 +65,17 @@ public:
 	const char *content_type;
 
 	/**
-	 * This mutex protects the listener socket and the client
-	 * list.
+	 * This mutex protects the listener socket, the client list
+	 * and the #ring.
 	 */
 	mutable Mutex mutex;
 
 	/**
-	 * This condition gets signalled when an item is removed from
-	 * #pages.
+	 * Encoded data to be broadcasted to all clients.  The
+	 * OutputThread appends to it, and the IOThread sends it to
+	 * the clients.  It is protected by #mutex.
 	 */
-	Cond cond;
+	StreamRing ring{RING_SIZE};
 
 private:
 	/**
@@ -90,13 +95,8 @@ private:
 	PagePtr metadata;
 
 	/**
-	 * The page queue, i.e. pages from the encoder to be
-	 * broadcasted to all clients.  This container is necessary to
-	 * pass pages from the OutputThread to the IOThread.  It is
-	 * protected by #mutex, and removing signals #cond.
+	 * Notifies the IOThread about new data in the #ring.
 	 */
-	std::queue<PagePtr, std::list<PagePtr>> pages;
-
 	InjectEvent defer_broadcast;
 
  public:
@@ -200,7 +200,9 @@ public:
 
 	/**
 	 * Sends the encoder header to the client.  This is called
-	 * right after the response headers have been sent.
+	 * right before the response headers are sent.
+	 *
+	 * Caller must lock the mutex.
 	 */
 	void SendHeader(HttpdClient &client) const noexcept;
 
@@ -209,16 +211,17 @@ public:
 
 	/**
 	 * Reads data from the encoder (as much as available) and
-	 * returns it as a new #page object.
+	 * returns it as a new #page object.  This is used for the
+	 * header, which is kept for new clients.
 	 */
 	PagePtr ReadPage() noexcept;
 
 	/**
-	 * Broadcasts a page struct to all clients.
+	 * Broadcasts data to all clients.
 	 *
 	 * Mutext must not be locked.
 	 */
-	void BroadcastPage(PagePtr page) noexcept;
+	void Broadcast(std::span<const std::byte> src) noexcept;
 
 	/**
 	 * Broadcasts data from the encoder to all clients.
@@ -93,22 +93,17 @@ HttpdOutput::AddClient(UniqueSocketDescriptor fd) noexcept
 void
 HttpdOutput::OnDeferredBroadcast() noexcept
 {
-	/* this method runs in the IOThread; it broadcasts pages from
-	   our own queue to all clients */
+	/* this method runs in the IOThread; it sends new data from
+	   the ring to all clients */
 
 	const std::scoped_lock protect{mutex};
 
-	while (!pages.empty()) {
-		PagePtr page = std::move(pages.front());
-		pages.pop();
-
-		for (auto &client : clients)
-			client.PushPage(page);
+	for (auto i = clients.begin(); i != clients.end();) {
+		/* advance the iterator first, because
+		   OnStreamData() may delete the client */
+		auto &client = *i++;
+		client.OnStreamData();
 	}
-
-	/* wake up the client that may be waiting for the queue to be
-	   flushed */
-	cond.notify_all();
 }
 
 void
@@ -128,19 +123,6 @@ HttpdOutput::OnAccept(UniqueSocketDescriptor fd,
 PagePtr
 HttpdOutput::ReadPage() noexcept
 {
-	if (unflushed_input >= 65536) {
-		/* we have fed a lot of input into the encoder, but it
-		   didn't give anything back yet - flush now to avoid
-		   buffer underruns */
-		try {
-			encoder->Flush();
-		} catch (...) {
-			/* ignore */
-		}
-
-		unflushed_input = 0;
-	}
-
 	std::byte buffer[32768];
 
 	size_t size = 0;
@@ -242,7 +224,7 @@ void
 HttpdOutput::SendHeader(HttpdClient &client) const noexcept
 {
 	if (header != nullptr)
-		client.PushPage(header);
+		client.SetHeader(header);
 }
 
 std::chrono::steady_clock::duration
@@ -267,13 +249,11 @@ HttpdOutput::Delay() const noexcept
 }
 
 void
-HttpdOutput::BroadcastPage(PagePtr page) noexcept
+HttpdOutput::Broadcast(std::span<const std::byte> src) noexcept
 {
-	assert(page != nullptr);
-
 	{
 		const std::scoped_lock lock{mutex};
-		pages.emplace(std::move(page));
+		ring.Append(src);
 	}
 
 	defer_broadcast.Schedule();
@@ -282,19 +262,35 @@ HttpdOutput::BroadcastPage(PagePtr page) noexcept
 void
 HttpdOutput::BroadcastFromEncoder() noexcept
 {
-	/* synchronize with the IOThread */
-	{
-		std::unique_lock lock{mutex};
-		cond.wait(lock, [this]{ return pages.empty(); });
+	if (unflushed_input >= 65536) {
+		/* we have fed a lot of input into the encoder, but it
+		   didn't give anything back yet - flush now to avoid
+		   buffer underruns */
+		try {
+			encoder->Flush();
+		} catch (...) {
+			/* ignore */
+		}
+
+		unflushed_input = 0;
 	}
 
+	std::byte buffer[32768];
+
 	bool empty = true;
 
-	PagePtr page;
-	while ((page = ReadPage()) != nullptr) {
-		const std::scoped_lock lock{mutex};
-		pages.emplace(std::move(page));
+	while (true) {
+		const auto r = encoder->Read(buffer);
+		if (r.empty())
+			break;
+
+		unflushed_input = 0;
 		empty = false;
+
+		/* copy the data right into the ring which is shared
+		   by all clients */
+		const std::scoped_lock lock{mutex};
+		ring.Append(r);
 	}
 
 	if (!empty)
@@ -371,8 +367,10 @@ HttpdOutput::SendTag(const Tag &tag)
 
 		auto page = ReadPage();
 		if (page != nullptr) {
-			header = page;
-			BroadcastPage(page);
+			Broadcast(*page);
+
+			const std::scoped_lock lock{mutex};
+			header = std::move(page);
 		}
 	} else {
 		/* use Icy-Metadata */
@@ -396,15 +394,10 @@ HttpdOutput::CancelAllClients() noexcept
 {
 	const std::scoped_lock protect{mutex};
 
-	while (!pages.empty()) {
-		PagePtr page = std::move(pages.front());
-		pages.pop();
-	}
+	ring.Clear();
 
 	for (auto &client : clients)
 		client.CancelQueue();
-
-	cond.notify_all();
 }
 
 void
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "StreamRing.hxx"
+
+#include <algorithm>
+#include <cassert>
+
+void
+StreamRing::Append(std::span<const std::byte> src) noexcept
+{
+	const std::size_t capacity = buffer.size();
+
+	head += src.size();
+
+	if (src.size() > capacity)
+		/* only the newest data fits */
+		src = src.last(capacity);
+
+	if (head - tail > capacity)
+		tail = head - capacity;
+
+	/* copy in (up to) two portions: until the end of the buffer
+	   and then from its beginning */
+	std::size_t offset = (head - src.size()) % capacity;
+	while (!src.empty()) {
+		const std::size_t n = std::min(src.size(), capacity - offset);
+		std::copy_n(src.begin(), n, buffer.begin() + offset);
+		src = src.subspan(n);
+		offset = 0;
+	}
+}
+
+std::span<const std::byte>
+StreamRing::Read(Position position) const noexcept
+{
+	assert(IsValid(position));
+
+	const std::size_t capacity = buffer.size();
+	const std::size_t offset = position % capacity;
+	const std::size_t available = head - position;
+
+	return std::span<const std::byte>{buffer}
+		.subspan(offset, std::min(available, capacity - offset));
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include "util/AllocatedArray.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/**
+ * A ring buffer containing the most recent encoded data, shared by
+ * all clients of an #HttpdOutput.  Instead of copying data into
+ * per-client queues, each client has a read cursor: an absolute
+ * stream position counting all bytes ever appended.  A cursor which
+ * points to data that has already been overwritten (i.e. the client
+ * is too slow) can thus be detected.
+ *
+ * This class is not thread-safe.
+ */
+class StreamRing {
+	AllocatedArray<std::byte> buffer;
+
+	/**
+	 * The absolute position of the oldest byte which is still
+	 * available.
+	 */
+	uint_least64_t tail = 0;
+
+	/**
+	 * The absolute position after the newest byte.
+	 */
+	uint_least64_t head = 0;
+
+public:
+	using Position = uint_least64_t;
+
+	explicit StreamRing(std::size_t capacity) noexcept
+		:buffer(capacity) {}
+
+	StreamRing(const StreamRing &) = delete;
+	StreamRing &operator=(const StreamRing &) = delete;
+
+	Position GetTail() const noexcept {
+		return tail;
+	}
+
+	Position GetHead() const noexcept {
+		return head;
+	}
+
+	/**
+	 * Is data at the given position still available?
+	 */
+	bool IsValid(Position position) const noexcept {
+		return position >= tail && position <= head;
+	}
+
+	/**
+	 * Discard all data.
+	 */
+	void Clear() noexcept {
+		tail = head;
+	}
+
+	/**
+	 * Append data, overwriting the oldest data if the buffer is
+	 * full.
+	 */
+	void Append(std::span<const std::byte> src) noexcept;
+
+	/**
+	 * Returns the contiguous data at the given position (which
+	 * must be valid).  There may be more data after the returned
+	 * span (at the beginning of the buffer); call this method
+	 * again after advancing the position.
+	 */
+	std::span<const std::byte> Read(Position position) const noexcept;
+};
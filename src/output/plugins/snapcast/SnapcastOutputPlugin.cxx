@@ -9,6 +9,7 @@
 #include "encoder/EncoderInterface.hxx"
 #include "encoder/EncoderPlugin.hxx"
 #include "encoder/Configured.hxx"
+#include "encoder/Shared.hxx"
 #include "encoder/plugins/WaveEncoderPlugin.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
 #include "net/SocketAddress.hxx"
@@ -37,7 +38,7 @@ SnapcastOutput::SnapcastOutput(EventLoop &_loop, const ConfigBlock &block)
 	 ServerSocket(_loop),
 	 inject_event(_loop, BIND_THIS_METHOD(OnInject)),
 	 // TODO: support other encoder plugins?
-	 prepared_encoder(encoder_init(wave_encoder_plugin, block))
+	 prepared_encoder(CreateShareableEncoder(wave_encoder_plugin, block))
 {
 	const unsigned port = block.GetBlockValue("port", 1704U);
 	ServerSocketAddGeneric(*this, block.GetBlockValue("bind_to_address"),
@@ -10,6 +10,10 @@
 
 #include "Dither.cxx" // including the .cxx file to get inlined templates
 
+#if defined(__x86_64__) || defined(__i386__)
+#include "X86Simd.hxx"
+#endif
+
 #include <cassert>
 #include <cmath>
 #include <utility> // for std::unreachable()
@@ -58,8 +62,16 @@ PcmAddVolumeVoid(PcmDither &dither,
 
 static void
 pcm_add_vol_float(float *buffer1, const float *buffer2,
-		  unsigned num_samples, float volume1, float volume2) noexcept
+		  size_t num_samples, float volume1, float volume2) noexcept
 {
+#if defined(__x86_64__) || defined(__i386__)
+	const size_t done = PcmX86MixFloat(buffer1, buffer2, num_samples,
+					   volume1, volume2);
+	buffer1 += done;
+	buffer2 += done;
+	num_samples -= done;
+#endif
+
 	while (num_samples > 0) {
 		float sample1 = *buffer1;
 		float sample2 = *buffer2++;
@@ -125,12 +137,47 @@ PcmAdd(typename Traits::value_type _a, typename Traits::value_type _b) noexcept
 	return PcmClamp<F, Traits>(a + b);
 }
 
+#if defined(__x86_64__) || defined(__i386__)
+
+/**
+ * Invoke the SIMD implementation of PcmAdd() for the given sample
+ * format.
+ *
+ * @return the number of samples which were processed
+ */
+template<SampleFormat F, ArithmeticSampleTraits Traits=SampleTraits<F>>
+static size_t
+PcmX86Add(typename Traits::pointer a,
+	  typename Traits::const_pointer b,
+	  size_t n) noexcept
+{
+	if constexpr (F == SampleFormat::S8)
+		return PcmX86Add8(a, b, n);
+	else if constexpr (F == SampleFormat::S16)
+		return PcmX86Add16(a, b, n);
+	else if constexpr (F == SampleFormat::S24_P32)
+		return PcmX86Add24(a, b, n);
+	else if constexpr (F == SampleFormat::S32)
+		return PcmX86Add32(a, b, n);
+	else
+		return 0;
+}
+
+#endif
+
 template<SampleFormat F, ArithmeticSampleTraits Traits=SampleTraits<F>>
 static void
 PcmAdd(typename Traits::pointer a,
        typename Traits::const_pointer b,
        size_t n) noexcept
 {
+#if defined(__x86_64__) || defined(__i386__)
+	const size_t done = PcmX86Add<F, Traits>(a, b, n);
+	a += done;
+	b += done;
+	n -= done;
+#endif
+
 	for (size_t i = 0; i != n; ++i)
 		a[i] = PcmAdd<F, Traits>(a[i], b[i]);
 }
@@ -149,8 +196,15 @@ PcmAddVoid(void *a, const void *b, size_t size) noexcept
 
 static void
 pcm_add_float(float *buffer1, const float *buffer2,
-	      unsigned num_samples) noexcept
+	      size_t num_samples) noexcept
 {
+#if defined(__x86_64__) || defined(__i386__)
+	const size_t done = PcmX86AddFloat(buffer1, buffer2, num_samples);
+	buffer1 += done;
+	buffer2 += done;
+	num_samples -= done;
+#endif
+
 	while (num_samples > 0) {
 		float sample1 = *buffer1;
 		float sample2 = *buffer2++;
@@ -50,8 +50,8 @@ struct NeonFloatTo16 {
 
 	static constexpr size_t BLOCK_SIZE = 16;
 
-	void Convert(int16_t *dst, const float *src,
-		     const size_t n) const noexcept {
+	size_t Convert(int16_t *dst, const float *src,
+		       const size_t n) const noexcept {
 		for (unsigned i = 0; i < n / BLOCK_SIZE;
 		     ++i, src += BLOCK_SIZE, dst += BLOCK_SIZE) {
 			/* load 16 float samples into 4 quad
@@ -72,6 +72,8 @@ struct NeonFloatTo16 {
 			/* store result */
 			vst4_s16(dst, nvalue);
 		}
+
+		return n - n % BLOCK_SIZE;
 	}
 };
 
@@ -32,6 +32,42 @@ struct Convert8To16
 	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S8,
 						  SampleFormat::S16>> {};
 
+struct Convert8To24
+	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S8,
+						  SampleFormat::S24_P32>> {};
+
+struct Convert16To24
+	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S16,
+						  SampleFormat::S24_P32>> {};
+
+struct Convert32To24
+	: PerSampleConvert<RightShiftSampleConvert<SampleFormat::S32,
+						   SampleFormat::S24_P32>> {};
+
+struct Convert8To32
+	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S8,
+						  SampleFormat::S32>> {};
+
+struct Convert16To32
+	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S16,
+						  SampleFormat::S32>> {};
+
+struct Convert24To32
+	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S24_P32,
+						  SampleFormat::S32>> {};
+
+struct Convert8ToFloat
+	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S8>> {};
+
+struct Convert16ToFloat
+	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S16>> {};
+
+struct Convert24ToFloat
+	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S24_P32>> {};
+
+struct Convert32ToFloat
+	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S32>> {};
+
 struct Convert24To16 {
 	using SrcTraits = SampleTraits<SampleFormat::S24_P32>;
 	using DstTraits = SampleTraits<SampleFormat::S16>;
@@ -69,6 +105,9 @@ struct FloatToInteger : PortableFloatToInteger<F, Traits> {};
  * A template class that attempts to use the "optimized" algorithm for
  * large portions of the buffer, and calls the "portable" algorithm"
  * for the rest when the last block is not full.
+ *
+ * Optimized::Convert() returns the number of samples it has
+ * converted.
  */
 template<typename Optimized, typename Portable>
 class GlueOptimizedConvert : Optimized, Portable {
@@ -79,16 +118,21 @@ public:
 	void Convert(typename DstTraits::pointer out,
 		     typename SrcTraits::const_pointer in,
 		     size_t n) const {
-		Optimized::Convert(out, in, n);
+		const size_t done = Optimized::Convert(out, in, n);
 
 		/* use the "portable" algorithm for the trailing
 		   samples */
-		size_t remaining = n % Optimized::BLOCK_SIZE;
-		size_t done = n - remaining;
-		Portable::Convert(out + done, in + done, remaining);
+		Portable::Convert(out + done, in + done, n - done);
 	}
 };
 
+/**
+ * An alias for the #Portable converter which may be specialized to
+ * use an optimized implementation.
+ */
+template<typename Portable>
+struct OptimizedConvert : Portable {};
+
 #ifdef __ARM_NEON__
 #include "Neon.hxx"
 
@@ -99,6 +143,72 @@ struct FloatToInteger<SampleFormat::S16, SampleTraits<SampleFormat::S16>>
 
 #endif
 
+#if defined(__x86_64__) || defined(__i386__)
+#include "X86Simd.hxx"
+
+/**
+ * Adapter for a function from X86Simd.hxx.
+ */
+template<auto f>
+struct X86Convert {
+	template<typename D, typename S>
+	static size_t Convert(D *out, const S *in, size_t n) noexcept {
+		return f(out, in, n);
+	}
+};
+
+template<>
+struct FloatToInteger<SampleFormat::S16, SampleTraits<SampleFormat::S16>>
+	: GlueOptimizedConvert<X86Convert<PcmX86ConvertFloatTo16>,
+			       PortableFloatToInteger<SampleFormat::S16>> {};
+
+template<>
+struct FloatToInteger<SampleFormat::S24_P32, SampleTraits<SampleFormat::S24_P32>>
+	: GlueOptimizedConvert<X86Convert<PcmX86ConvertFloatTo24>,
+			       PortableFloatToInteger<SampleFormat::S24_P32>> {};
+
+template<>
+struct FloatToInteger<SampleFormat::S32, SampleTraits<SampleFormat::S32>>
+	: GlueOptimizedConvert<X86Convert<PcmX86ConvertFloatTo32>,
+			       PortableFloatToInteger<SampleFormat::S32>> {};
+
+template<>
+struct OptimizedConvert<Convert16To24>
+	: GlueOptimizedConvert<X86Convert<PcmX86Convert16To24>,
+			       Convert16To24> {};
+
+template<>
+struct OptimizedConvert<Convert16To32>
+	: GlueOptimizedConvert<X86Convert<PcmX86Convert16To32>,
+			       Convert16To32> {};
+
+template<>
+struct OptimizedConvert<Convert24To32>
+	: GlueOptimizedConvert<X86Convert<PcmX86Convert24To32>,
+			       Convert24To32> {};
+
+template<>
+struct OptimizedConvert<Convert32To24>
+	: GlueOptimizedConvert<X86Convert<PcmX86Convert32To24>,
+			       Convert32To24> {};
+
+template<>
+struct OptimizedConvert<Convert16ToFloat>
+	: GlueOptimizedConvert<X86Convert<PcmX86Convert16ToFloat>,
+			       Convert16ToFloat> {};
+
+template<>
+struct OptimizedConvert<Convert24ToFloat>
+	: GlueOptimizedConvert<X86Convert<PcmX86Convert24ToFloat>,
+			       Convert24ToFloat> {};
+
+template<>
+struct OptimizedConvert<Convert32ToFloat>
+	: GlueOptimizedConvert<X86Convert<PcmX86Convert32ToFloat>,
+			       Convert32ToFloat> {};
+
+#endif
+
 template<class C>
 static std::span<const typename C::DstTraits::value_type>
 AllocateConvert(PcmBuffer &buffer, C convert,
@@ -174,14 +284,6 @@ pcm_convert_to_16(PcmBuffer &buffer, PcmDither &dither,
 	return {};
 }
 
-struct Convert8To24
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S8,
-						  SampleFormat::S24_P32>> {};
-
-struct Convert16To24
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S16,
-						  SampleFormat::S24_P32>> {};
-
 static std::span<const int32_t>
 pcm_allocate_8_to_24(PcmBuffer &buffer, std::span<const int8_t> src)
 {
@@ -191,17 +293,13 @@ pcm_allocate_8_to_24(PcmBuffer &buffer, std::span<const int8_t> src)
 static std::span<const int32_t>
 pcm_allocate_16_to_24(PcmBuffer &buffer, std::span<const int16_t> src)
 {
-	return AllocateConvert(buffer, Convert16To24(), src);
+	return AllocateConvert(buffer, OptimizedConvert<Convert16To24>(), src);
 }
 
-struct Convert32To24
-	: PerSampleConvert<RightShiftSampleConvert<SampleFormat::S32,
-						   SampleFormat::S24_P32>> {};
-
 static std::span<const int32_t>
 pcm_allocate_32_to_24(PcmBuffer &buffer, std::span<const int32_t> src)
 {
-	return AllocateConvert(buffer, Convert32To24(), src);
+	return AllocateConvert(buffer, OptimizedConvert<Convert32To24>(), src);
 }
 
 static std::span<const int32_t>
@@ -242,18 +340,6 @@ pcm_convert_to_24(PcmBuffer &buffer,
 	return {};
 }
 
-struct Convert8To32
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S8,
-						  SampleFormat::S32>> {};
-
-struct Convert16To32
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S16,
-						  SampleFormat::S32>> {};
-
-struct Convert24To32
-	: PerSampleConvert<LeftShiftSampleConvert<SampleFormat::S24_P32,
-						  SampleFormat::S32>> {};
-
 static std::span<const int32_t>
 pcm_allocate_8_to_32(PcmBuffer &buffer, std::span<const int8_t> src)
 {
@@ -263,13 +349,13 @@ pcm_allocate_8_to_32(PcmBuffer &buffer, std::span<const int8_t> src)
 static std::span<const int32_t>
 pcm_allocate_16_to_32(PcmBuffer &buffer, std::span<const int16_t> src)
 {
-	return AllocateConvert(buffer, Convert16To32(), src);
+	return AllocateConvert(buffer, OptimizedConvert<Convert16To32>(), src);
 }
 
 static std::span<const int32_t>
 pcm_allocate_24p32_to_32(PcmBuffer &buffer, std::span<const int32_t> src)
 {
-	return AllocateConvert(buffer, Convert24To32(), src);
+	return AllocateConvert(buffer, OptimizedConvert<Convert24To32>(), src);
 }
 
 static std::span<const int32_t>
@@ -310,18 +396,6 @@ pcm_convert_to_32(PcmBuffer &buffer,
 	return {};
 }
 
-struct Convert8ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S8>> {};
-
-struct Convert16ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S16>> {};
-
-struct Convert24ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S24_P32>> {};
-
-struct Convert32ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S32>> {};
-
 static std::span<const float>
 pcm_allocate_8_to_float(PcmBuffer &buffer, std::span<const int8_t> src)
 {
@@ -331,19 +405,19 @@ pcm_allocate_8_to_float(PcmBuffer &buffer, std::span<const int8_t> src)
 static std::span<const float>
 pcm_allocate_16_to_float(PcmBuffer &buffer, std::span<const int16_t> src)
 {
-	return AllocateConvert(buffer, Convert16ToFloat(), src);
+	return AllocateConvert(buffer, OptimizedConvert<Convert16ToFloat>(), src);
 }
 
 static std::span<const float>
 pcm_allocate_24p32_to_float(PcmBuffer &buffer, std::span<const int32_t> src)
 {
-	return AllocateConvert(buffer, Convert24ToFloat(), src);
+	return AllocateConvert(buffer, OptimizedConvert<Convert24ToFloat>(), src);
 }
 
 static std::span<const float>
 pcm_allocate_32_to_float(PcmBuffer &buffer, std::span<const int32_t> src)
 {
-	return AllocateConvert(buffer, Convert32ToFloat(), src);
+	return AllocateConvert(buffer, OptimizedConvert<Convert32ToFloat>(), src);
 }
 
 std::span<const float>
@@ -10,6 +10,10 @@
 
 #include "Dither.cxx" // including the .cxx file to get inlined templates
 
+#if defined(__x86_64__) || defined(__i386__)
+#include "X86Simd.hxx"
+#endif
+
 #include <cassert>
 #include <cstdint>
 #include <utility> // for std::unreachable()
@@ -98,6 +102,15 @@ static void
 PcmVolumeChange16to32(int32_t *dest, const int16_t *src, size_t n,
 		      int volume) noexcept
 {
+#if defined(__x86_64__) || defined(__i386__)
+	if (volume <= INT16_MAX) {
+		const size_t done = PcmX86Volume16To24(dest, src, n, volume);
+		dest += done;
+		src += done;
+		n -= done;
+	}
+#endif
+
 	transform_n(src, n, dest,
 		    [volume](auto x){
 			    return PcmVolumeConvert<SampleFormat::S16,
@@ -127,6 +140,13 @@ static void
 pcm_volume_change_float(float *dest, const float *src, size_t n,
 			float volume) noexcept
 {
+#if defined(__x86_64__) || defined(__i386__)
+	const size_t done = PcmX86VolumeFloat(dest, src, n, volume);
+	dest += done;
+	src += done;
+	n -= done;
+#endif
+
 	transform_n(src, n, dest,
 		    [volume](float x){ return x * volume; });
 }
@@ -0,0 +1,807 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "X86Simd.hxx"
+#include "Volume.hxx"
+
+#include <immintrin.h>
+
+/**
+ * After multiplying a S16 sample with the volume, shift it right by
+ * this number of bits to get a S24_P32 sample (see
+ * PcmVolumeConvert()).
+ */
+static constexpr int VOLUME_16_TO_24_SHIFT = 16 + PCM_VOLUME_BITS - 24;
+static_assert(VOLUME_16_TO_24_SHIFT > 0);
+
+/* the conversion factors from FloatConvert.hxx */
+static constexpr float FACTOR_16 = 1 << 15;
+static constexpr float FACTOR_24 = 1 << 23;
+static constexpr float FACTOR_32 = 1U << 31;
+
+/* the range of S24_P32 samples, see SampleTraits */
+static constexpr int32_t S24_MIN = -(1 << 23);
+static constexpr int32_t S24_MAX = (1 << 23) - 1;
+
+/*
+ * SSE2
+ *
+ * Each function processes "n" samples, and "n" must be a multiple
+ * of #PCM_X86_BLOCK_SIZE.
+ *
+ */
+
+[[gnu::target("sse2")]]
+static void
+VolumeFloatSSE2(float *dest, const float *src, std::size_t n,
+		float volume) noexcept
+{
+	const __m128 v = _mm_set1_ps(volume);
+
+	for (std::size_t i = 0; i < n; i += 4)
+		_mm_storeu_ps(dest + i, _mm_mul_ps(_mm_loadu_ps(src + i), v));
+}
+
+[[gnu::target("sse2")]]
+static void
+Volume16To24SSE2(int32_t *dest, const int16_t *src, std::size_t n,
+		 int volume) noexcept
+{
+	const __m128i v = _mm_set1_epi16(volume);
+
+	for (std::size_t i = 0; i < n; i += 8) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+
+		/* 16x16=32 bit multiplication */
+		const __m128i lo = _mm_mullo_epi16(x, v);
+		const __m128i hi = _mm_mulhi_epi16(x, v);
+
+		_mm_storeu_si128((__m128i *)(dest + i),
+				 _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi),
+						VOLUME_16_TO_24_SHIFT));
+		_mm_storeu_si128((__m128i *)(dest + i + 4),
+				 _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi),
+						VOLUME_16_TO_24_SHIFT));
+	}
+}
+
+/**
+ * Convert 16 bit samples to 32 bit, shifting them left by 16 bits
+ * and then right by #RIGHT_SHIFT bits.
+ */
+template<int RIGHT_SHIFT>
+[[gnu::target("sse2")]]
+static void
+Convert16To32SSE2(int32_t *dest, const int16_t *src, std::size_t n) noexcept
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	for (std::size_t i = 0; i < n; i += 8) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+
+		__m128i lo = _mm_unpacklo_epi16(zero, x);
+		__m128i hi = _mm_unpackhi_epi16(zero, x);
+		if constexpr (RIGHT_SHIFT > 0) {
+			lo = _mm_srai_epi32(lo, RIGHT_SHIFT);
+			hi = _mm_srai_epi32(hi, RIGHT_SHIFT);
+		}
+
+		_mm_storeu_si128((__m128i *)(dest + i), lo);
+		_mm_storeu_si128((__m128i *)(dest + i + 4), hi);
+	}
+}
+
+[[gnu::target("sse2")]]
+static void
+Convert24To32SSE2(int32_t *dest, const int32_t *src, std::size_t n) noexcept
+{
+	for (std::size_t i = 0; i < n; i += 4) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_slli_epi32(x, 8));
+	}
+}
+
+[[gnu::target("sse2")]]
+static void
+Convert32To24SSE2(int32_t *dest, const int32_t *src, std::size_t n) noexcept
+{
+	for (std::size_t i = 0; i < n; i += 4) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_srai_epi32(x, 8));
+	}
+}
+
+[[gnu::target("sse2")]]
+static void
+Convert16ToFloatSSE2(float *dest, const int16_t *src, std::size_t n) noexcept
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 factor = _mm_set1_ps(1.0f / FACTOR_16);
+
+	for (std::size_t i = 0; i < n; i += 8) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+
+		/* sign-extend to 32 bit */
+		const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(zero, x), 16);
+		const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(zero, x), 16);
+
+		_mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), factor));
+		_mm_storeu_ps(dest + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), factor));
+	}
+}
+
+template<unsigned BITS>
+[[gnu::target("sse2")]]
+static void
+Convert32ToFloatSSE2(float *dest, const int32_t *src, std::size_t n) noexcept
+{
+	const __m128 factor = _mm_set1_ps(1.0f / (1U << (BITS - 1)));
+
+	for (std::size_t i = 0; i < n; i += 4) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(x), factor));
+	}
+}
+
+/**
+ * Scale and clamp float samples and convert them to 32 bit integers.
+ * Clamping before truncating gives the same result as
+ * FloatToIntegerSampleConvert, which clamps after truncating,
+ * because the limits are integers.
+ */
+[[gnu::target("sse2")]]
+static inline __m128i
+FloatToIntegerSSE2(__m128 x, __m128 factor, __m128 min, __m128 max) noexcept
+{
+	x = _mm_mul_ps(x, factor);
+	x = _mm_max_ps(x, min);
+	x = _mm_min_ps(x, max);
+	return _mm_cvttps_epi32(x);
+}
+
+[[gnu::target("sse2")]]
+static void
+ConvertFloatTo16SSE2(int16_t *dest, const float *src, std::size_t n) noexcept
+{
+	const __m128 factor = _mm_set1_ps(FACTOR_16);
+	const __m128 min = _mm_set1_ps(-FACTOR_16);
+	const __m128 max = _mm_set1_ps(FACTOR_16 - 1);
+
+	for (std::size_t i = 0; i < n; i += 8) {
+		const __m128i a = FloatToIntegerSSE2(_mm_loadu_ps(src + i),
+						     factor, min, max);
+		const __m128i b = FloatToIntegerSSE2(_mm_loadu_ps(src + i + 4),
+						     factor, min, max);
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_packs_epi32(a, b));
+	}
+}
+
+[[gnu::target("sse2")]]
+static void
+ConvertFloatTo24SSE2(int32_t *dest, const float *src, std::size_t n) noexcept
+{
+	const __m128 factor = _mm_set1_ps(FACTOR_24);
+	const __m128 min = _mm_set1_ps(-FACTOR_24);
+	const __m128 max = _mm_set1_ps(FACTOR_24 - 1);
+
+	for (std::size_t i = 0; i < n; i += 4)
+		_mm_storeu_si128((__m128i *)(dest + i),
+				 FloatToIntegerSSE2(_mm_loadu_ps(src + i),
+						    factor, min, max));
+}
+
+[[gnu::target("sse2")]]
+static void
+ConvertFloatTo32SSE2(int32_t *dest, const float *src, std::size_t n) noexcept
+{
+	const __m128 factor = _mm_set1_ps(FACTOR_32);
+
+	for (std::size_t i = 0; i < n; i += 4) {
+		const __m128 x = _mm_mul_ps(_mm_loadu_ps(src + i), factor);
+
+		/* CVTTPS2DQ returns INT32_MIN on overflow; flip
+		   that to INT32_MAX for positive values */
+		const __m128 overflow = _mm_cmpge_ps(x, factor);
+		_mm_storeu_si128((__m128i *)(dest + i),
+				 _mm_xor_si128(_mm_cvttps_epi32(x),
+					       _mm_castps_si128(overflow)));
+	}
+}
+
+[[gnu::target("sse2")]]
+static void
+MixFloatSSE2(float *dest, const float *src, std::size_t n,
+	     float volume1, float volume2) noexcept
+{
+	const __m128 v1 = _mm_set1_ps(volume1);
+	const __m128 v2 = _mm_set1_ps(volume2);
+
+	for (std::size_t i = 0; i < n; i += 4) {
+		/* no FMA here, because the portable implementation
+		   rounds after each multiplication */
+		const __m128 a = _mm_mul_ps(_mm_loadu_ps(dest + i), v1);
+		const __m128 b = _mm_mul_ps(_mm_loadu_ps(src + i), v2);
+		_mm_storeu_ps(dest + i, _mm_add_ps(a, b));
+	}
+}
+
+[[gnu::target("sse2")]]
+static void
+Add8SSE2(int8_t *dest, const int8_t *src, std::size_t n) noexcept
+{
+	for (std::size_t i = 0; i < n; i += 16) {
+		const __m128i a = _mm_loadu_si128((const __m128i *)(dest + i));
+		const __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_adds_epi8(a, b));
+	}
+}
+
+[[gnu::target("sse2")]]
+static void
+Add16SSE2(int16_t *dest, const int16_t *src, std::size_t n) noexcept
+{
+	for (std::size_t i = 0; i < n; i += 8) {
+		const __m128i a = _mm_loadu_si128((const __m128i *)(dest + i));
+		const __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_adds_epi16(a, b));
+	}
+}
+
+/**
+ * Select "a" where the mask is set, else "b" (SSE2 has no PBLENDVB).
+ */
+[[gnu::target("sse2")]]
+static inline __m128i
+SelectSSE2(__m128i mask, __m128i a, __m128i b) noexcept
+{
+	return _mm_or_si128(_mm_and_si128(mask, a),
+			    _mm_andnot_si128(mask, b));
+}
+
+[[gnu::target("sse2")]]
+static void
+Add24SSE2(int32_t *dest, const int32_t *src, std::size_t n) noexcept
+{
+	/* SSE2 has no PMINSD/PMAXSD */
+	const __m128i min = _mm_set1_epi32(S24_MIN);
+	const __m128i max = _mm_set1_epi32(S24_MAX);
+
+	for (std::size_t i = 0; i < n; i += 4) {
+		const __m128i a = _mm_loadu_si128((const __m128i *)(dest + i));
+		const __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i x = _mm_add_epi32(a, b);
+		x = SelectSSE2(_mm_cmpgt_epi32(x, max), max, x);
+		x = SelectSSE2(_mm_cmplt_epi32(x, min), min, x);
+		_mm_storeu_si128((__m128i *)(dest + i), x);
+	}
+}
+
+[[gnu::target("sse2")]]
+static void
+Add32SSE2(int32_t *dest, const int32_t *src, std::size_t n) noexcept
+{
+	const __m128i max = _mm_set1_epi32(INT32_MAX);
+
+	for (std::size_t i = 0; i < n; i += 4) {
+		const __m128i a = _mm_loadu_si128((const __m128i *)(dest + i));
+		const __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+		const __m128i sum = _mm_add_epi32(a, b);
+
+		/* the addition has overflowed if both operands have
+		   the same sign, but the sign of the sum differs; the
+		   result is then INT32_MAX or INT32_MIN, depending on
+		   the sign of the operands */
+		const __m128i overflow =
+			_mm_srai_epi32(_mm_andnot_si128(_mm_xor_si128(a, b),
+							_mm_xor_si128(a, sum)),
+				       31);
+		const __m128i saturated = _mm_xor_si128(_mm_srai_epi32(a, 31),
+							max);
+		_mm_storeu_si128((__m128i *)(dest + i),
+				 SelectSSE2(overflow, saturated, sum));
+	}
+}
+
+[[gnu::target("sse2")]]
+static void
+AddFloatSSE2(float *dest, const float *src, std::size_t n) noexcept
+{
+	for (std::size_t i = 0; i < n; i += 4)
+		_mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i),
+						   _mm_loadu_ps(src + i)));
+}
+
+/*
+ * AVX2
+ *
+ */
+
+[[gnu::target("avx2")]]
+static void
+VolumeFloatAVX2(float *dest, const float *src, std::size_t n,
+		float volume) noexcept
+{
+	const __m256 v = _mm256_set1_ps(volume);
+
+	for (std::size_t i = 0; i < n; i += 8)
+		_mm256_storeu_ps(dest + i,
+				 _mm256_mul_ps(_mm256_loadu_ps(src + i), v));
+}
+
+[[gnu::target("avx2")]]
+static inline __m256i
+Load16To32AVX2(const int16_t *src) noexcept
+{
+	return _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)src));
+}
+
+[[gnu::target("avx2")]]
+static void
+Volume16To24AVX2(int32_t *dest, const int16_t *src, std::size_t n,
+		 int volume) noexcept
+{
+	const __m256i v = _mm256_set1_epi32(volume);
+
+	for (std::size_t i = 0; i < n; i += 8) {
+		const __m256i x = _mm256_mullo_epi32(Load16To32AVX2(src + i), v);
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_srai_epi32(x, VOLUME_16_TO_24_SHIFT));
+	}
+}
+
+template<int LEFT_SHIFT>
+[[gnu::target("avx2")]]
+static void
+Convert16To32AVX2(int32_t *dest, const int16_t *src, std::size_t n) noexcept
+{
+	for (std::size_t i = 0; i < n; i += 8)
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_slli_epi32(Load16To32AVX2(src + i),
+						      LEFT_SHIFT));
+}
+
+[[gnu::target("avx2")]]
+static void
+Convert24To32AVX2(int32_t *dest, const int32_t *src, std::size_t n) noexcept
+{
+	for (std::size_t i = 0; i < n; i += 8) {
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_slli_epi32(x, 8));
+	}
+}
+
+[[gnu::target("avx2")]]
+static void
+Convert32To24AVX2(int32_t *dest, const int32_t *src, std::size_t n) noexcept
+{
+	for (std::size_t i = 0; i < n; i += 8) {
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_srai_epi32(x, 8));
+	}
+}
+
+[[gnu::target("avx2")]]
+static void
+Convert16ToFloatAVX2(float *dest, const int16_t *src, std::size_t n) noexcept
+{
+	const __m256 factor = _mm256_set1_ps(1.0f / FACTOR_16);
+
+	for (std::size_t i = 0; i < n; i += 8)
+		_mm256_storeu_ps(dest + i,
+				 _mm256_mul_ps(_mm256_cvtepi32_ps(Load16To32AVX2(src + i)),
+					       factor));
+}
+
+template<unsigned BITS>
+[[gnu::target("avx2")]]
+static void
+Convert32ToFloatAVX2(float *dest, const int32_t *src, std::size_t n) noexcept
+{
+	const __m256 factor = _mm256_set1_ps(1.0f / (1U << (BITS - 1)));
+
+	for (std::size_t i = 0; i < n; i += 8) {
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_ps(dest + i,
+				 _mm256_mul_ps(_mm256_cvtepi32_ps(x), factor));
+	}
+}
+
+/**
+ * @see FloatToIntegerSSE2()
+ */
+[[gnu::target("avx2")]]
+static inline __m256i
+FloatToIntegerAVX2(__m256 x, __m256 factor, __m256 min, __m256 max) noexcept
+{
+	x = _mm256_mul_ps(x, factor);
+	x = _mm256_max_ps(x, min);
+	x = _mm256_min_ps(x, max);
+	return _mm256_cvttps_epi32(x);
+}
+
+[[gnu::target("avx2")]]
+static void
+ConvertFloatTo16AVX2(int16_t *dest, const float *src, std::size_t n) noexcept
+{
+	const __m256 factor = _mm256_set1_ps(FACTOR_16);
+	const __m256 min = _mm256_set1_ps(-FACTOR_16);
+	const __m256 max = _mm256_set1_ps(FACTOR_16 - 1);
+
+	for (std::size_t i = 0; i < n; i += 16) {
+		const __m256i a = FloatToIntegerAVX2(_mm256_loadu_ps(src + i),
+						     factor, min, max);
+		const __m256i b = FloatToIntegerAVX2(_mm256_loadu_ps(src + i + 8),
+						     factor, min, max);
+
+		/* VPACKSSDW works on each 128 bit lane separately;
+		   restore the order of the 64 bit quarters */
+		const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b),
+								0xd8);
+		_mm256_storeu_si256((__m256i *)(dest + i), packed);
+	}
+}
+
+[[gnu::target("avx2")]]
+static void
+ConvertFloatTo24AVX2(int32_t *dest, const float *src, std::size_t n) noexcept
+{
+	const __m256 factor = _mm256_set1_ps(FACTOR_24);
+	const __m256 min = _mm256_set1_ps(-FACTOR_24);
+	const __m256 max = _mm256_set1_ps(FACTOR_24 - 1);
+
+	for (std::size_t i = 0; i < n; i += 8)
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    FloatToIntegerAVX2(_mm256_loadu_ps(src + i),
+						       factor, min, max));
+}
+
+[[gnu::target("avx2")]]
+static void
+ConvertFloatTo32AVX2(int32_t *dest, const float *src, std::size_t n) noexcept
+{
+	const __m256 factor = _mm256_set1_ps(FACTOR_32);
+
+	for (std::size_t i = 0; i < n; i += 8) {
+		const __m256 x = _mm256_mul_ps(_mm256_loadu_ps(src + i), factor);
+
+		/* see ConvertFloatTo32SSE2() */
+		const __m256 overflow = _mm256_cmp_ps(x, factor, _CMP_GE_OQ);
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_xor_si256(_mm256_cvttps_epi32(x),
+						     _mm256_castps_si256(overflow)));
+	}
+}
+
+[[gnu::target("avx2")]]
+static void
+MixFloatAVX2(float *dest, const float *src, std::size_t n,
+	     float volume1, float volume2) noexcept
+{
+	const __m256 v1 = _mm256_set1_ps(volume1);
+	const __m256 v2 = _mm256_set1_ps(volume2);
+
+	for (std::size_t i = 0; i < n; i += 8) {
+		/* see MixFloatSSE2() */
+		const __m256 a = _mm256_mul_ps(_mm256_loadu_ps(dest + i), v1);
+		const __m256 b = _mm256_mul_ps(_mm256_loadu_ps(src + i), v2);
+		_mm256_storeu_ps(dest + i, _mm256_add_ps(a, b));
+	}
+}
+
+[[gnu::target("avx2")]]
+static void
+Add8AVX2(int8_t *dest, const int8_t *src, std::size_t n) noexcept
+{
+	std::size_t i = 0;
+	for (; i + 32 <= n; i += 32) {
+		const __m256i a = _mm256_loadu_si256((const __m256i *)(dest + i));
+		const __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_adds_epi8(a, b));
+	}
+
+	/* "n" is a multiple of 16, but not necessarily of 32 */
+	if (i < n)
+		Add8SSE2(dest + i, src + i, n - i);
+}
+
+[[gnu::target("avx2")]]
+static void
+Add16AVX2(int16_t *dest, const int16_t *src, std::size_t n) noexcept
+{
+	for (std::size_t i = 0; i < n; i += 16) {
+		const __m256i a = _mm256_loadu_si256((const __m256i *)(dest + i));
+		const __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_adds_epi16(a, b));
+	}
+}
+
+[[gnu::target("avx2")]]
+static void
+Add24AVX2(int32_t *dest, const int32_t *src, std::size_t n) noexcept
+{
+	const __m256i min = _mm256_set1_epi32(S24_MIN);
+	const __m256i max = _mm256_set1_epi32(S24_MAX);
+
+	for (std::size_t i = 0; i < n; i += 8) {
+		const __m256i a = _mm256_loadu_si256((const __m256i *)(dest + i));
+		const __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+		const __m256i x = _mm256_add_epi32(a, b);
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_max_epi32(_mm256_min_epi32(x, max),
+						     min));
+	}
+}
+
+[[gnu::target("avx2")]]
+static void
+Add32AVX2(int32_t *dest, const int32_t *src, std::size_t n) noexcept
+{
+	const __m256i max = _mm256_set1_epi32(INT32_MAX);
+
+	for (std::size_t i = 0; i < n; i += 8) {
+		const __m256i a = _mm256_loadu_si256((const __m256i *)(dest + i));
+		const __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+		const __m256i sum = _mm256_add_epi32(a, b);
+
+		/* see Add32SSE2() */
+		const __m256i overflow =
+			_mm256_srai_epi32(_mm256_andnot_si256(_mm256_xor_si256(a, b),
+							      _mm256_xor_si256(a, sum)),
+					  31);
+		const __m256i saturated =
+			_mm256_xor_si256(_mm256_srai_epi32(a, 31), max);
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_blendv_epi8(sum, saturated,
+						       overflow));
+	}
+}
+
+[[gnu::target("avx2")]]
+static void
+AddFloatAVX2(float *dest, const float *src, std::size_t n) noexcept
+{
+	for (std::size_t i = 0; i < n; i += 8)
+		_mm256_storeu_ps(dest + i,
+				 _mm256_add_ps(_mm256_loadu_ps(dest + i),
+					       _mm256_loadu_ps(src + i)));
+}
+
+/*
+ * runtime dispatch
+ *
+ */
+
+namespace {
+
+struct Kernels {
+	const char *name;
+
+	void (*volume_float)(float *, const float *, std::size_t, float) noexcept;
+	void (*volume_16_to_24)(int32_t *, const int16_t *, std::size_t, int) noexcept;
+	void (*convert_16_to_24)(int32_t *, const int16_t *, std::size_t) noexcept;
+	void (*convert_16_to_32)(int32_t *, const int16_t *, std::size_t) noexcept;
+	void (*convert_24_to_32)(int32_t *, const int32_t *, std::size_t) noexcept;
+	void (*convert_32_to_24)(int32_t *, const int32_t *, std::size_t) noexcept;
+	void (*convert_16_to_float)(float *, const int16_t *, std::size_t) noexcept;
+	void (*convert_24_to_float)(float *, const int32_t *, std::size_t) noexcept;
+	void (*convert_32_to_float)(float *, const int32_t *, std::size_t) noexcept;
+	void (*convert_float_to_16)(int16_t *, const float *, std::size_t) noexcept;
+	void (*convert_float_to_24)(int32_t *, const float *, std::size_t) noexcept;
+	void (*convert_float_to_32)(int32_t *, const float *, std::size_t) noexcept;
+	void (*mix_float)(float *, const float *, std::size_t, float, float) noexcept;
+	void (*add_8)(int8_t *, const int8_t *, std::size_t) noexcept;
+	void (*add_16)(int16_t *, const int16_t *, std::size_t) noexcept;
+	void (*add_24)(int32_t *, const int32_t *, std::size_t) noexcept;
+	void (*add_32)(int32_t *, const int32_t *, std::size_t) noexcept;
+	void (*add_float)(float *, const float *, std::size_t) noexcept;
+};
+
+} // anonymous namespace
+
+static constexpr Kernels sse2_kernels{
+	"sse2",
+	VolumeFloatSSE2,
+	Volume16To24SSE2,
+	Convert16To32SSE2<8>,
+	Convert16To32SSE2<0>,
+	Convert24To32SSE2,
+	Convert32To24SSE2,
+	Convert16ToFloatSSE2,
+	Convert32ToFloatSSE2<24>,
+	Convert32ToFloatSSE2<32>,
+	ConvertFloatTo16SSE2,
+	ConvertFloatTo24SSE2,
+	ConvertFloatTo32SSE2,
+	MixFloatSSE2,
+	Add8SSE2,
+	Add16SSE2,
+	Add24SSE2,
+	Add32SSE2,
+	AddFloatSSE2,
+};
+
+static constexpr Kernels avx2_kernels{
+	"avx2",
+	VolumeFloatAVX2,
+	Volume16To24AVX2,
+	Convert16To32AVX2<8>,
+	Convert16To32AVX2<16>,
+	Convert24To32AVX2,
+	Convert32To24AVX2,
+	Convert16ToFloatAVX2,
+	Convert32ToFloatAVX2<24>,
+	Convert32ToFloatAVX2<32>,
+	ConvertFloatTo16AVX2,
+	ConvertFloatTo24AVX2,
+	ConvertFloatTo32AVX2,
+	MixFloatAVX2,
+	Add8AVX2,
+	Add16AVX2,
+	Add24AVX2,
+	Add32AVX2,
+	AddFloatAVX2,
+};
+
+static Kernels
+ChooseKernels() noexcept
+{
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return avx2_kernels;
+
+	if (__builtin_cpu_supports("sse2"))
+		return sse2_kernels;
+
+	/* all function pointers are nullptr, which means the
+	   portable implementations will be used */
+	return {};
+}
+
+/* until this is initialized (i.e. in other static initializers),
+   all pointers are nullptr */
+static const Kernels kernels = ChooseKernels();
+
+template<typename D, typename S, typename... Args>
+static std::size_t
+Run(void (*f)(D *, const S *, std::size_t, Args...) noexcept,
+    D *dest, const S *src, std::size_t n, Args... args) noexcept
+{
+	if (f == nullptr)
+		return 0;
+
+	n -= n % PCM_X86_BLOCK_SIZE;
+	f(dest, src, n, args...);
+	return n;
+}
+
+const char *
+PcmX86GetKernelName() noexcept
+{
+	return kernels.name;
+}
+
+std::size_t
+PcmX86VolumeFloat(float *dest, const float *src, std::size_t n,
+		  float volume) noexcept
+{
+	return Run(kernels.volume_float, dest, src, n, volume);
+}
+
+std::size_t
+PcmX86Volume16To24(int32_t *dest, const int16_t *src, std::size_t n,
+		   int volume) noexcept
+{
+	return Run(kernels.volume_16_to_24, dest, src, n, volume);
+}
+
+std::size_t
+PcmX86Convert16To24(int32_t *dest, const int16_t *src,
+		    std::size_t n) noexcept
+{
+	return Run(kernels.convert_16_to_24, dest, src, n);
+}
+
+std::size_t
+PcmX86Convert16To32(int32_t *dest, const int16_t *src,
+		    std::size_t n) noexcept
+{
+	return Run(kernels.convert_16_to_32, dest, src, n);
+}
+
+std::size_t
+PcmX86Convert24To32(int32_t *dest, const int32_t *src,
+		    std::size_t n) noexcept
+{
+	return Run(kernels.convert_24_to_32, dest, src, n);
+}
+
+std::size_t
+PcmX86Convert32To24(int32_t *dest, const int32_t *src,
+		    std::size_t n) noexcept
+{
+	return Run(kernels.convert_32_to_24, dest, src, n);
+}
+
+std::size_t
+PcmX86Convert16ToFloat(float *dest, const int16_t *src,
+		       std::size_t n) noexcept
+{
+	return Run(kernels.convert_16_to_float, dest, src, n);
+}
+
+std::size_t
+PcmX86Convert24ToFloat(float *dest, const int32_t *src,
+		       std::size_t n) noexcept
+{
+	return Run(kernels.convert_24_to_float, dest, src, n);
+}
+
+std::size_t
+PcmX86Convert32ToFloat(float *dest, const int32_t *src,
+		       std::size_t n) noexcept
+{
+	return Run(kernels.convert_32_to_float, dest, src, n);
+}
+
+std::size_t
+PcmX86ConvertFloatTo16(int16_t *dest, const float *src,
+		       std::size_t n) noexcept
+{
+	return Run(kernels.convert_float_to_16, dest, src, n);
+}
+
+std::size_t
+PcmX86ConvertFloatTo24(int32_t *dest, const float *src,
+		       std::size_t n) noexcept
+{
+	return Run(kernels.convert_float_to_24, dest, src, n);
+}
+
+std::size_t
+PcmX86ConvertFloatTo32(int32_t *dest, const float *src,
+		       std::size_t n) noexcept
+{
+	return Run(kernels.convert_float_to_32, dest, src, n);
+}
+
+std::size_t
+PcmX86MixFloat(float *dest, const float *src, std::size_t n,
+	       float volume1, float volume2) noexcept
+{
+	return Run(kernels.mix_float, dest, src, n, volume1, volume2);
+}
+
+std::size_t
+PcmX86Add8(int8_t *dest, const int8_t *src, std::size_t n) noexcept
+{
+	return Run(kernels.add_8, dest, src, n);
+}
+
+std::size_t
+PcmX86Add16(int16_t *dest, const int16_t *src, std::size_t n) noexcept
+{
+	return Run(kernels.add_16, dest, src, n);
+}
+
+std::size_t
+PcmX86Add24(int32_t *dest, const int32_t *src, std::size_t n) noexcept
+{
+	return Run(kernels.add_24, dest, src, n);
+}
+
+std::size_t
+PcmX86Add32(int32_t *dest, const int32_t *src, std::size_t n) noexcept
+{
+	return Run(kernels.add_32, dest, src, n);
+}
+
+std::size_t
+PcmX86AddFloat(float *dest, const float *src, std::size_t n) noexcept
+{
+	return Run(kernels.add_float, dest, src, n);
+}
@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#ifndef MPD_PCM_X86_SIMD_HXX
+#define MPD_PCM_X86_SIMD_HXX
+
+/** \file
+ *
+ * SIMD implementations of PCM routines for x86 CPUs.  The best
+ * implementation (AVX2 or SSE2) is chosen at runtime.
+ *
+ * Each function processes only complete blocks of
+ * #PCM_X86_BLOCK_SIZE samples and returns the number of samples it
+ * has processed; the caller is responsible for the rest (using the
+ * portable implementation).  If the CPU supports none of these
+ * instruction sets, they return 0.
+ *
+ * The results are bit-exact with the portable implementations.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+static constexpr std::size_t PCM_X86_BLOCK_SIZE = 16;
+
+/**
+ * Returns the name of the instruction set which is used ("avx2" or
+ * "sse2"), or nullptr if the portable implementations are used.
+ */
+[[gnu::const]]
+const char *
+PcmX86GetKernelName() noexcept;
+
+/**
+ * Multiply all samples with the given volume factor.
+ */
+std::size_t
+PcmX86VolumeFloat(float *dest, const float *src, std::size_t n,
+		  float volume) noexcept;
+
+/**
+ * Apply software volume while converting from S16 to S24_P32, see
+ * PcmVolumeConvert().
+ *
+ * @param volume the volume (see #PCM_VOLUME_1); must not be larger
+ * than 32767
+ */
+std::size_t
+PcmX86Volume16To24(int32_t *dest, const int16_t *src, std::size_t n,
+		   int volume) noexcept;
+
+std::size_t
+PcmX86Convert16To24(int32_t *dest, const int16_t *src,
+		    std::size_t n) noexcept;
+
+std::size_t
+PcmX86Convert16To32(int32_t *dest, const int16_t *src,
+		    std::size_t n) noexcept;
+
+std::size_t
+PcmX86Convert24To32(int32_t *dest, const int32_t *src,
+		    std::size_t n) noexcept;
+
+std::size_t
+PcmX86Convert32To24(int32_t *dest, const int32_t *src,
+		    std::size_t n) noexcept;
+
+std::size_t
+PcmX86Convert16ToFloat(float *dest, const int16_t *src,
+		       std::size_t n) noexcept;
+
+std::size_t
+PcmX86Convert24ToFloat(float *dest, const int32_t *src,
+		       std::size_t n) noexcept;
+
+std::size_t
+PcmX86Convert32ToFloat(float *dest, const int32_t *src,
+		       std::size_t n) noexcept;
+
+std::size_t
+PcmX86ConvertFloatTo16(int16_t *dest, const float *src,
+		       std::size_t n) noexcept;
+
+std::size_t
+PcmX86ConvertFloatTo24(int32_t *dest, const float *src,
+		       std::size_t n) noexcept;
+
+std::size_t
+PcmX86ConvertFloatTo32(int32_t *dest, const float *src,
+		       std::size_t n) noexcept;
+
+/**
+ * Cross-fade two buffers: dest[i] = dest[i] * volume1 + src[i] *
+ * volume2.  This is the non-dithered floating point path of
+ * pcm_mix().
+ */
+std::size_t
+PcmX86MixFloat(float *dest, const float *src, std::size_t n,
+	       float volume1, float volume2) noexcept;
+
+/**
+ * Add the samples of the second buffer to the first one, clamping
+ * the result to the range of the sample format (see PcmClamp()).
+ */
+std::size_t
+PcmX86Add8(int8_t *dest, const int8_t *src, std::size_t n) noexcept;
+
+std::size_t
+PcmX86Add16(int16_t *dest, const int16_t *src, std::size_t n) noexcept;
+
+std::size_t
+PcmX86Add24(int32_t *dest, const int32_t *src, std::size_t n) noexcept;
+
+std::size_t
+PcmX86Add32(int32_t *dest, const int32_t *src, std::size_t n) noexcept;
+
+std::size_t
+PcmX86AddFloat(float *dest, const float *src, std::size_t n) noexcept;
+
+#endif
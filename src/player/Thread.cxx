@@ -50,7 +50,21 @@ static constexpr auto buffer_before_play_duration = std::chrono::seconds(1);
 class Player {
 	PlayerControl &pc;
 
-	DecoderControl &dc;
+	/**
+	 * The decoder of the current song (or of the next song after
+	 * it has finished the current one).
+	 */
+	DecoderControl *dc;
+
+	/**
+	 * The second decoder which decodes the next song ahead of
+	 * time, while #dc is still busy with the current song (see
+	 * PlayerConfig::decode_ahead); nullptr if disabled.  Its
+	 * #DecoderControl::pipe is set while it has been started for
+	 * PlayerControl::next_song.  When #dc finishes, both
+	 * decoders swap roles.
+	 */
+	DecoderControl *ahead_dc;
 
 	MusicBuffer &buffer;
 
@@ -85,6 +99,13 @@ class Player {
 	 */
 	const unsigned decoder_wakeup_threshold;
 
+	/**
+	 * The maximum number of chunks #ahead_dc may decode before
+	 * it becomes the primary decoder.  This leaves most of the
+	 * #MusicBuffer to the current song.
+	 */
+	const unsigned ahead_pipe_limit;
+
 	/**
 	 * Are we waiting for #buffer_before_play?
 	 */
@@ -180,9 +201,11 @@ class Player {
 
 public:
 	Player(PlayerControl &_pc, DecoderControl &_dc,
+	       DecoderControl *_ahead_dc,
 	       MusicBuffer &_buffer) noexcept
-		:pc(_pc), dc(_dc), buffer(_buffer),
-		 decoder_wakeup_threshold(buffer.GetSize() * 3 / 4)
+		:pc(_pc), dc(&_dc), ahead_dc(_ahead_dc), buffer(_buffer),
+		 decoder_wakeup_threshold(buffer.GetSize() * 3 / 4),
+		 ahead_pipe_limit(buffer.GetSize() / 4)
 	{
 	}
 
@@ -207,9 +230,58 @@ private:
 	 * Caller must lock the mutex.
 	 */
 	void StartDecoder(std::unique_lock<Mutex> &lock,
+			  std::shared_ptr<MusicPipe> _pipe,
+			  bool initial_seek_essential) noexcept {
+		assert(!decoder_starting);
+
+		StartDecoder(lock, *dc, std::move(_pipe),
+			     initial_seek_essential);
+	}
+
+	/**
+	 * Start the given decoder on PlayerControl::next_song.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void StartDecoder(std::unique_lock<Mutex> &lock,
+			  DecoderControl &decoder,
 			  std::shared_ptr<MusicPipe> pipe,
 			  bool initial_seek_essential) noexcept;
 
+	/**
+	 * Is #ahead_dc decoding (or has it decoded, or has it failed
+	 * to decode) PlayerControl::next_song?
+	 */
+	[[nodiscard]]
+	bool IsAheadDecoderBusy() const noexcept {
+		return ahead_dc != nullptr && ahead_dc->pipe != nullptr;
+	}
+
+	/**
+	 * Start decoding PlayerControl::next_song with #ahead_dc if
+	 * that is enabled and appropriate right now.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void MaybeStartAheadDecoder(std::unique_lock<Mutex> &lock) noexcept;
+
+	/**
+	 * Stop #ahead_dc and discard its pipe (if it is busy).
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void StopAheadDecoder(std::unique_lock<Mutex> &lock) noexcept;
+
+	/**
+	 * #dc has finished the current song and #ahead_dc has
+	 * already started decoding the next one: swap the two, so
+	 * #ahead_dc becomes the primary decoder (at the next song,
+	 * see IsDecoderAtNextSong()).
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void SwapAheadDecoder() noexcept;
+
 	/**
 	 * The decoder has acknowledged the "START" command (see
 	 * ActivateDecoder()).  This function checks if the decoder
@@ -240,7 +312,7 @@ private:
 	bool IsDecoderAtCurrentSong() const noexcept {
 		assert(pipe != nullptr);
 
-		return dc.pipe == pipe;
+		return dc->pipe == pipe;
 	}
 
 	/**
@@ -250,7 +322,7 @@ private:
 	 */
 	[[nodiscard]] [[gnu::pure]]
 	bool IsDecoderAtNextSong() const noexcept {
-		return dc.pipe != nullptr && !IsDecoderAtCurrentSong();
+		return dc->pipe != nullptr && !IsDecoderAtCurrentSong();
 	}
 
 	/**
@@ -364,22 +436,72 @@ public:
 
 void
 Player::StartDecoder(std::unique_lock<Mutex> &lock,
+		     DecoderControl &decoder,
 		     std::shared_ptr<MusicPipe> _pipe,
 		     bool initial_seek_essential) noexcept
 {
-	assert(!decoder_starting);
 	assert(queued || pc.command == PlayerCommand::SEEK);
 	assert(pc.next_song != nullptr);
 
 	/* copy ReplayGain parameters to the decoder */
-	dc.replay_gain_mode = pc.replay_gain_mode;
+	decoder.replay_gain_mode = pc.replay_gain_mode;
 
 	SongTime start_time = pc.next_song->GetStartTime() + pc.seek_time;
 
-	dc.Start(lock, std::make_unique<DetachedSong>(*pc.next_song),
-		 start_time, pc.next_song->GetEndTime(),
-		 initial_seek_essential,
-		 buffer, std::move(_pipe));
+	decoder.Start(lock, std::make_unique<DetachedSong>(*pc.next_song),
+		      start_time, pc.next_song->GetEndTime(),
+		      initial_seek_essential,
+		      buffer, std::move(_pipe));
+}
+
+inline void
+Player::MaybeStartAheadDecoder(std::unique_lock<Mutex> &lock) noexcept
+{
+	if (ahead_dc == nullptr || IsAheadDecoderBusy() || !queued ||
+	    decoder_starting || dc->IsIdle() || !IsDecoderAtCurrentSong())
+		/* disabled, already running, nothing queued, or the
+		   primary decoder can handle the next song by
+		   itself */
+		return;
+
+	ahead_dc->SetPipeLimit(ahead_pipe_limit);
+	StartDecoder(lock, *ahead_dc, std::make_shared<MusicPipe>(), false);
+}
+
+void
+Player::StopAheadDecoder(std::unique_lock<Mutex> &lock) noexcept
+{
+	if (!IsAheadDecoderBusy())
+		return;
+
+	{
+		const PlayerControl::ScopeOccupied occupied(pc);
+		ahead_dc->Stop(lock);
+	}
+
+	ahead_dc->pipe->Clear();
+	ahead_dc->pipe.reset();
+}
+
+inline void
+Player::SwapAheadDecoder() noexcept
+{
+	assert(IsAheadDecoderBusy());
+	assert(dc->IsIdle());
+	assert(dc->pipe == nullptr || dc->pipe == pipe);
+
+	ahead_dc->InheritPrevious(*dc);
+
+	/* the old primary decoder's pipe is still being played; it
+	   is owned by #pipe */
+	dc->pipe.reset();
+
+	std::swap(dc, ahead_dc);
+
+	/* the new primary decoder may fill the whole buffer now */
+	dc->SetPipeLimit(0);
+	dc->Signal();
+	decoder_woken = true;
 }
 
 void
@@ -387,13 +509,13 @@ Player::StopDecoder(std::unique_lock<Mutex> &lock) noexcept
 {
 	const PlayerControl::ScopeOccupied occupied(pc);
 
-	dc.Stop(lock);
+	dc->Stop(lock);
 
-	if (dc.pipe != nullptr) {
+	if (dc->pipe != nullptr) {
 		/* clear and free the decoder pipe */
 
-		dc.pipe->Clear();
-		dc.pipe.reset();
+		dc->pipe->Clear();
+		dc->pipe.reset();
 
 		/* just in case we've been cross-fading: cancel it
 		   now, because we just deleted the new song's decoder
@@ -408,7 +530,7 @@ bool
 Player::ForwardDecoderError() noexcept
 {
 	try {
-		dc.CheckRethrowError();
+		dc->CheckRethrowError();
 	} catch (...) {
 		pc.SetError(PlayerError::DECODER, std::current_exception());
 		return false;
@@ -483,7 +605,7 @@ inline bool
 Player::MixRampScannerReady() noexcept
 {
 	assert(pipe);
-	assert(dc.pipe);
+	assert(dc->pipe);
 
 	if (!pc.cross_fade.IsMixRampEnabled())
 		return true;
@@ -492,16 +614,16 @@ Player::MixRampScannerReady() noexcept
 		/* always ready if the scanner is disabled */
 		return true;
 
-	if (dc.GetMixRampPreviousEnd() == nullptr) {
+	if (dc->GetMixRampPreviousEnd() == nullptr) {
 		// TODO: scan incrementally backwards until mixrampdb is reached
 		auto s = UnlockAnalyzeMixRamp(*pipe, play_audio_format,
 					      MixRampDirection::END);
 		if (!s.empty()) {
 			FmtDebug(player_domain, "Analyzed MixRamp end: {}", s);
-			dc.SetMixRampPreviousEnd(std::move(s));
+			dc->SetMixRampPreviousEnd(std::move(s));
 		}
 
-		if (dc.GetMixRampStart() == nullptr)
+		if (dc->GetMixRampStart() == nullptr)
 			/* scan the next song in the next call; first,
 			   let the main loop submit a few more chunks
 			   to the outputs for playback to avoid
@@ -509,30 +631,30 @@ Player::MixRampScannerReady() noexcept
 			return false;
 	}
 
-	if (dc.GetMixRampStart() == nullptr) {
+	if (dc->GetMixRampStart() == nullptr) {
 		const std::size_t want_pipe_bytes =
-			dc.out_audio_format.TimeToSize(std::chrono::seconds{20});
+			dc->out_audio_format.TimeToSize(std::chrono::seconds{20});
 		const std::size_t want_pipe_chunks =
-			std::min((want_pipe_bytes + sizeof(MusicChunk::data) - 1)
-				 / sizeof(MusicChunk::data),
+			std::min((want_pipe_bytes + buffer.GetChunkCapacity() - 1)
+				 / buffer.GetChunkCapacity(),
 				 buffer.GetSize() / std::size_t{3});
 
-		if (dc.pipe->GetSize() < want_pipe_chunks) {
+		if (dc->pipe->GetSize() < want_pipe_chunks) {
 			/* need more data */
 			if (!buffer.IsFull()) {
 				decoder_woken = true;
-				dc.Signal();
+				dc->Signal();
 			}
 
 			return false;
 		}
 
 		// TODO: scan incrementally until mixrampdb is reached
-		auto s = UnlockAnalyzeMixRamp(*dc.pipe, dc.out_audio_format,
+		auto s = UnlockAnalyzeMixRamp(*dc->pipe, dc->out_audio_format,
 					      MixRampDirection::START);
 		if (!s.empty()) {
 			FmtDebug(player_domain, "Analyzed MixRamp start: {}", s);
-			dc.SetMixRampStart(std::move(s));
+			dc->SetMixRampStart(std::move(s));
 		}
 	}
 
@@ -580,7 +702,7 @@ Player::CheckDecoderStartup(std::unique_lock<Mutex> &lock) noexcept
 	if (!ForwardDecoderError()) {
 		/* the decoder failed */
 		return false;
-	} else if (!dc.IsStarting()) {
+	} else if (!dc->IsStarting()) {
 		/* the decoder is ready and ok */
 
 		if (output_open &&
@@ -589,17 +711,17 @@ Player::CheckDecoderStartup(std::unique_lock<Mutex> &lock) noexcept
 			   all chunks yet - wait for that */
 			return true;
 
-		pc.total_time = real_song_duration(*dc.song,
-						   dc.total_time);
-		pc.audio_format = dc.in_audio_format;
-		play_audio_format = dc.out_audio_format;
+		pc.total_time = real_song_duration(*dc->song,
+						   dc->total_time);
+		pc.audio_format = dc->in_audio_format;
+		play_audio_format = dc->out_audio_format;
 		decoder_starting = false;
 
 		const size_t buffer_before_play_size =
 			play_audio_format.TimeToSize(buffer_before_play_duration);
 		buffer_before_play =
-			(buffer_before_play_size + sizeof(MusicChunk::data) - 1)
-			/ sizeof(MusicChunk::data);
+			(buffer_before_play_size + buffer.GetChunkCapacity() - 1)
+			/ buffer.GetChunkCapacity();
 
 		pc.listener.OnPlayerStateChanged();
 
@@ -626,7 +748,7 @@ Player::CheckDecoderStartup(std::unique_lock<Mutex> &lock) noexcept
 			FmtError(player_domain,
 				 "problems opening audio device "
 				 "while playing {:?}",
-				 dc.song->GetURI());
+				 dc->song->GetURI());
 			return true;
 		}
 
@@ -634,7 +756,7 @@ Player::CheckDecoderStartup(std::unique_lock<Mutex> &lock) noexcept
 	} else {
 		/* the decoder is not yet ready; wait
 		   some more */
-		dc.WaitForDecoder(lock);
+		dc->WaitForDecoder(lock);
 
 		return true;
 	}
@@ -655,7 +777,7 @@ Player::SeekDecoder(std::unique_lock<Mutex> &lock, SongTime seek_time) noexcept
 	try {
 		const PlayerControl::ScopeOccupied occupied(pc);
 
-		dc.Seek(lock, song->GetStartTime() + seek_time);
+		dc->Seek(lock, song->GetStartTime() + seek_time);
 	} catch (...) {
 		/* decoder failure */
 		pc.SetError(PlayerError::DECODER, std::current_exception());
@@ -672,7 +794,7 @@ Player::SeekDecoder(std::unique_lock<Mutex> &lock) noexcept
 	assert(pc.next_song != nullptr);
 
 	if (pc.seek_time > SongTime::zero() && // TODO: allow this only if the song duration is known
-	    dc.IsUnseekableCurrentSong(*pc.next_song)) {
+	    dc->IsUnseekableCurrentSong(*pc.next_song)) {
 		/* seeking into the current song; but we already know
 		   it's not seekable, so let's fail early */
 		/* note the seek_time>0 check: if seeking to the
@@ -693,7 +815,7 @@ Player::SeekDecoder(std::unique_lock<Mutex> &lock) noexcept
 
 	pc.listener.OnPlayerStateChanged();
 
-	if (!dc.IsSeekableCurrentSong(*pc.next_song)) {
+	if (!dc->IsSeekableCurrentSong(*pc.next_song)) {
 		/* the decoder is already decoding the "next" song -
 		   stop it and start the previous song again */
 
@@ -717,7 +839,7 @@ Player::SeekDecoder(std::unique_lock<Mutex> &lock) noexcept
 		if (!IsDecoderAtCurrentSong()) {
 			/* the decoder is already decoding the "next" song,
 			   but it is the same song file; exchange the pipe */
-			ReplacePipe(dc.pipe);
+			ReplacePipe(dc->pipe);
 		}
 
 		pc.next_song.reset();
@@ -783,11 +905,12 @@ Player::ProcessCommand(std::unique_lock<Mutex> &lock) noexcept
 		assert(pc.next_song != nullptr);
 		assert(!queued);
 		assert(!IsDecoderAtNextSong());
+		assert(!IsAheadDecoderBusy());
 
 		queued = true;
 		pc.CommandFinished();
 
-		if (!decoder_starting && dc.IsIdle())
+		if (!decoder_starting && dc->IsIdle())
 			StartDecoder(lock, std::make_shared<MusicPipe>(),
 				     false);
 
@@ -812,6 +935,10 @@ Player::ProcessCommand(std::unique_lock<Mutex> &lock) noexcept
 		break;
 
 	case PlayerCommand::SEEK:
+		/* the song decoded ahead of time (if any) is
+		   obsolete; the playlist will queue a new one */
+		StopAheadDecoder(lock);
+
 		return SeekDecoder(lock);
 
 	case PlayerCommand::CANCEL:
@@ -826,6 +953,8 @@ Player::ProcessCommand(std::unique_lock<Mutex> &lock) noexcept
 			   stop it and reset the position */
 			StopDecoder(lock);
 
+		StopAheadDecoder(lock);
+
 		pc.next_song.reset();
 		queued = false;
 		pc.CommandFinished();
@@ -862,7 +991,7 @@ Player::CheckCrossFade() noexcept
 		return;
 	}
 
-	if (!IsDecoderAtNextSong() || dc.IsStarting() || dc.pipe->IsEmpty())
+	if (!IsDecoderAtNextSong() || dc->IsStarting() || dc->pipe->IsEmpty())
 		/* we need information about the next song before we
 		   can decide */
 		/* the "pipe.empty" check is here so we wait for all
@@ -870,8 +999,8 @@ Player::CheckCrossFade() noexcept
                    decoders parse only after reporting readiness */
 		return;
 
-	if (!pc.cross_fade.CanCrossFade(pc.total_time, dc.total_time,
-					dc.out_audio_format,
+	if (!pc.cross_fade.CanCrossFade(pc.total_time, dc->total_time,
+					dc->out_audio_format,
 					play_audio_format)) {
 		/* cross fading is disabled or the next song is too
 		   short */
@@ -886,11 +1015,12 @@ Player::CheckCrossFade() noexcept
 	/* enable cross fading in this song?  if yes, calculate how
 	   many chunks will be required for it */
 	cross_fade_chunks =
-		pc.cross_fade.Calculate(dc.replay_gain_db,
-					dc.replay_gain_prev_db,
-					dc.GetMixRampStart(),
-					dc.GetMixRampPreviousEnd(),
+		pc.cross_fade.Calculate(dc->replay_gain_db,
+					dc->replay_gain_prev_db,
+					dc->GetMixRampStart(),
+					dc->GetMixRampPreviousEnd(),
 					play_audio_format,
+					buffer.GetChunkCapacity(),
 					buffer.GetSize() -
 					buffer_before_play);
 	if (cross_fade_chunks > 0)
@@ -973,7 +1103,7 @@ Player::PlayNextChunk() noexcept
 		unsigned cross_fade_position = pipe->GetSize();
 		assert(cross_fade_position <= cross_fade_chunks);
 
-		auto other_chunk = dc.pipe->Shift();
+		auto other_chunk = dc->pipe->Shift();
 		if (other_chunk != nullptr) {
 			chunk = pipe->Shift();
 			assert(chunk != nullptr);
@@ -1009,14 +1139,14 @@ Player::PlayNextChunk() noexcept
 
 			std::unique_lock lock{pc.mutex};
 
-			if (dc.IsIdle()) {
+			if (dc->IsIdle()) {
 				/* the decoder isn't running, abort
 				   cross fading */
 				xfade_state = CrossFadeState::DISABLED;
 			} else {
 				/* wait for the decoder */
-				dc.Signal();
-				dc.WaitForDecoder(lock);
+				dc->Signal();
+				dc->WaitForDecoder(lock);
 
 				return true;
 			}
@@ -1060,10 +1190,10 @@ Player::PlayNextChunk() noexcept
 	/* this formula should prevent that the decoder gets woken up
 	   with each chunk; it is more efficient to make it decode a
 	   larger block at a time */
-	if (!dc.IsIdle() && dc.pipe->GetSize() <= decoder_wakeup_threshold) {
+	if (!dc->IsIdle() && dc->pipe->GetSize() <= decoder_wakeup_threshold) {
 		if (!decoder_woken) {
 			decoder_woken = true;
-			dc.Signal();
+			dc->Signal();
 		}
 	} else
 		decoder_woken = false;
@@ -1079,7 +1209,7 @@ Player::SongBorder() noexcept
 
 		FmtNotice(player_domain, "played {:?}", song->GetURI());
 
-		ReplacePipe(dc.pipe);
+		ReplacePipe(dc->pipe);
 
 		pc.outputs.SongBorder();
 	}
@@ -1134,10 +1264,10 @@ Player::Run() noexcept
 			   prevent stuttering on slow machines */
 
 			if (pipe->GetSize() < buffer_before_play &&
-			    !dc.IsIdle() && !buffer.IsFull()) {
+			    !dc->IsIdle() && !buffer.IsFull()) {
 				/* not enough decoded buffer space yet */
 
-				dc.WaitForDecoder(lock);
+				dc->WaitForDecoder(lock);
 				continue;
 			} else {
 				/* buffering is complete */
@@ -1145,15 +1275,21 @@ Player::Run() noexcept
 			}
 		}
 
-		if (dc.IsIdle() && queued && IsDecoderAtCurrentSong()) {
+		if (dc->IsIdle() && queued && IsDecoderAtCurrentSong()) {
 			/* the decoder has finished the current song;
 			   make it decode the next song */
 
-			assert(dc.pipe == nullptr || dc.pipe == pipe);
+			assert(dc->pipe == nullptr || dc->pipe == pipe);
 
-			StartDecoder(lock, std::make_shared<MusicPipe>(),
-				     false);
-		}
+			if (IsAheadDecoderBusy())
+				/* ... which has already been
+				   started by the other decoder */
+				SwapAheadDecoder();
+			else
+				StartDecoder(lock, std::make_shared<MusicPipe>(),
+					     false);
+		} else
+			MaybeStartAheadDecoder(lock);
 
 		CheckCrossFade();
 
@@ -1175,14 +1311,14 @@ Player::Run() noexcept
 			   waiting for space in the MusicBuffer) and
 			   wait for it */
 			// TODO: eliminate this kludge
-			dc.Signal();
+			dc->Signal();
 
-			dc.WaitForDecoder(lock);
+			dc->WaitForDecoder(lock);
 		} else if (IsDecoderAtNextSong()) {
 			/* at the beginning of a new song */
 
 			SongBorder();
-		} else if (dc.IsIdle()) {
+		} else if (dc->IsIdle()) {
 			if (queued)
 				/* the decoder has just stopped,
 				   between the two IsIdle() checks,
@@ -1212,14 +1348,15 @@ Player::Run() noexcept
 			   waiting for space in the MusicBuffer) and
 			   wait for it */
 			// TODO: eliminate this kludge
-			dc.Signal();
+			dc->Signal();
 
-			dc.WaitForDecoder(lock);
+			dc->WaitForDecoder(lock);
 		}
 	}
 
 	CancelPendingSeek();
 	StopDecoder(lock);
+	StopAheadDecoder(lock);
 
 	pipe.reset();
 
@@ -1241,11 +1378,16 @@ Player::Run() noexcept
 }
 
 static void
-do_play(PlayerControl &pc, DecoderControl &dc,
+do_play(PlayerControl &pc, DecoderControl &dc, DecoderControl *ahead_dc,
 	MusicBuffer &buffer) noexcept
 {
-	Player player(pc, dc, buffer);
+	Player player(pc, dc, ahead_dc, buffer);
 	player.Run();
+
+	FmtDebug(player_domain,
+		 "MusicBuffer: high water mark {}/{} chunks, {} allocation failures",
+		 buffer.GetHighWaterMark(), buffer.GetSize(),
+		 buffer.GetAllocationFailures());
 }
 
 void
@@ -1259,7 +1401,18 @@ try {
 			  config.replay_gain);
 	dc.StartThread();
 
-	MusicBuffer buffer{config.buffer_chunks};
+	/* the second decoder for decoding the next song ahead of
+	   time */
+	std::unique_ptr<DecoderControl> ahead_dc;
+	if (config.decode_ahead) {
+		ahead_dc = std::make_unique<DecoderControl>(mutex, cond,
+							    input_cache,
+							    config.audio_format,
+							    config.replay_gain);
+		ahead_dc->StartThread();
+	}
+
+	MusicBuffer buffer{config.buffer_chunks, config.chunk_size};
 
 	std::unique_lock lock{mutex};
 
@@ -1271,7 +1424,7 @@ try {
 
 			{
 				const ScopeUnlock unlock(mutex);
-				do_play(*this, dc, buffer);
+				do_play(*this, dc, ahead_dc.get(), buffer);
 
 				/* give the main thread a chance to
 				   queue another song, just in case
@@ -1322,6 +1475,8 @@ try {
 			{
 				const ScopeUnlock unlock(mutex);
 				dc.Quit();
+				if (ahead_dc)
+					ahead_dc->Quit();
 				outputs.Close();
 			}
 
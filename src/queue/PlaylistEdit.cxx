@@ -264,9 +264,28 @@ playlist::DeleteRange(PlayerControl &pc, RangeArg range)
 
 	const DetachedSong *queued_song = GetQueuedSong();
 
-	do {
-		DeleteInternal(pc, --range.end, &queued_song);
-	} while (range.end != range.start);
+	if (current >= 0 &&
+	    range.Contains(queue.OrderToPosition(current))) {
+		/* the current song is going to be deleted; let
+		   DeleteInternal() deal with that, one by one */
+		do {
+			DeleteInternal(pc, --range.end, &queued_song);
+		} while (range.end != range.start);
+	} else {
+		/* fast path: delete the whole range at once, and
+		   adjust "current" by the number of deleted songs
+		   which were before it */
+		if (current > 0) {
+			unsigned n_before = 0;
+			for (unsigned i = range.start; i < range.end; ++i)
+				if (queue.PositionToOrder(i) < unsigned(current))
+					++n_before;
+
+			current -= n_before;
+		}
+
+		queue.DeleteRange(range.start, range.end);
+	}
 
 	UpdateQueuedSong(pc, queued_song);
 	OnModified();
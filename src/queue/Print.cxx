@@ -10,11 +10,13 @@
 #include "song/LightSong.hxx"
 #include "tag/Sort.hxx"
 #include "client/Response.hxx"
+#include "client/ResponseProducer.hxx"
 #include "PlaylistError.hxx"
 
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <memory>
 
 /**
  * Send detailed information about a range of songs in the queue to a
@@ -48,6 +50,50 @@ queue_print_info(Response &r, const Queue &queue,
 		queue_print_song_info(r, queue, i);
 }
 
+namespace {
+
+/**
+ * Sends a range of the queue in portions; see queue_stream_info().
+ */
+class QueueInfoProducer final : public ResponseProducer {
+	const Queue &queue;
+
+	unsigned position, end;
+
+public:
+	QueueInfoProducer(const Queue &_queue,
+			  unsigned start, unsigned _end) noexcept
+		:queue(_queue), position(start), end(_end) {}
+
+	/* virtual methods from class ResponseProducer */
+	bool Produce(Response &r) override {
+		/* the queue may have been shortened meanwhile */
+		end = std::min(end, queue.GetLength());
+
+		while (position < end) {
+			queue_print_song_info(r, queue, position++);
+
+			if (r.IsBatchFull())
+				return position >= end;
+		}
+
+		return true;
+	}
+};
+
+} // anonymous namespace
+
+CommandResult
+queue_stream_info(Response &r, const Queue &queue,
+		  unsigned start, unsigned end)
+{
+	assert(start <= end);
+	assert(end <= queue.GetLength());
+
+	return r.Stream(std::make_unique<QueueInfoProducer>(queue,
+							    start, end));
+}
+
 void
 queue_print_uris(Response &r, const Queue &queue,
 		 unsigned start, unsigned end)
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include "command/CommandResult.hxx"
+
 #include <cstdint>
 
 struct Queue;
@@ -18,6 +20,15 @@ void
 queue_print_info(Response &r, const Queue &queue,
 		 unsigned start, unsigned end);
 
+/**
+ * Like queue_print_info(), but large responses are sent in portions
+ * (see Response::Stream()).  If the queue is modified meanwhile, the
+ * response may be inconsistent.
+ */
+CommandResult
+queue_stream_info(Response &r, const Queue &queue,
+		  unsigned start, unsigned end);
+
 void
 queue_print_uris(Response &r, const Queue &queue,
 		 unsigned start, unsigned end);
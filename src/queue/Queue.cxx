@@ -11,6 +11,7 @@ Queue::Queue(unsigned _max_length) noexcept
 	:max_length(_max_length),
 	 items(new Item[max_length]),
 	 order(new unsigned[max_length]),
+	 position_order(new unsigned[max_length]),
 	 id_table(max_length * HASH_MULT)
 {
 }
@@ -21,6 +22,7 @@ Queue::~Queue() noexcept
 
 	delete[] items;
 	delete[] order;
+	delete[] position_order;
 }
 
 LightSong
@@ -88,7 +90,7 @@ Queue::Append(DetachedSong &&song, uint8_t priority) noexcept
 	item.version = version;
 	item.priority = priority;
 
-	order[position] = position;
+	order[position] = position_order[position] = position;
 
 	return id;
 }
@@ -131,17 +133,10 @@ Queue::MovePostion(unsigned from, unsigned to) noexcept
 
 	/* now deal with order */
 
-	if (random) {
-		for (unsigned i = 0; i < length; i++) {
-			if (order[i] > from && order[i] <= to)
-				order[i]--;
-			else if (order[i] < from &&
-				 order[i] >= to)
-				order[i]++;
-			else if (from == order[i])
-				order[i] = to;
-		}
-	}
+	if (from < to)
+		RotateOrder(from, from + 1, to + 1);
+	else if (from > to)
+		RotateOrder(to, from, from + 1);
 }
 
 void
@@ -171,20 +166,33 @@ Queue::MoveRange(unsigned start, unsigned end, unsigned to) noexcept
 		items[to + i - start].version = version;
 	}
 
-	if (random) {
-		// Update the positions in the queue.
-		// Note that the ranges for these cases are the same as the ranges of
-		// the loops above.
-		for (unsigned i = 0; i < length; i++) {
-			if (order[i] >= end && order[i] < to + end - start)
-				order[i] -= end - start;
-			else if (order[i] < start &&
-				 order[i] >= to)
-				order[i] += end - start;
-			else if (start <= order[i] && order[i] < end)
-				order[i] += to - start;
-		}
-	}
+	// Update the positions in the queue.
+	// Note that the ranges for these cases are the same as the ranges of
+	// the loops above.
+	if (to > start)
+		RotateOrder(start, end, to + end - start);
+	else if (to < start)
+		RotateOrder(to, start, end);
+}
+
+void
+Queue::RotateOrder(unsigned first, unsigned middle, unsigned last) noexcept
+{
+	assert(first <= middle);
+	assert(middle <= last);
+	assert(last <= length);
+
+	if (!random)
+		return;
+
+	/* only the items within the range have moved, so only their
+	   "order" entries need to be updated, and they can be found
+	   quickly in the inverse "position_order" list */
+	std::rotate(position_order + first, position_order + middle,
+		    position_order + last);
+
+	for (unsigned i = first; i < last; ++i)
+		order[position_order[i]] = i;
 }
 
 unsigned
@@ -204,6 +212,9 @@ Queue::MoveOrder(unsigned from_order, unsigned to_order) noexcept
 	}
 
 	order[to_order] = from_position;
+
+	UpdatePositionOrder(std::min(from_order, to_order),
+			    std::max(from_order, to_order) + 1);
 	return to_order;
 }
 
@@ -226,36 +237,69 @@ Queue::MoveOrderAfter(unsigned from_order, unsigned to_order) noexcept
 }
 
 void
-Queue::DeletePosition(unsigned position) noexcept
+Queue::DeleteRange(unsigned start, unsigned end) noexcept
 {
-	assert(position < length);
+	assert(start < end);
+	assert(end <= length);
 
-	delete items[position].song;
+	const unsigned n = end - start;
 
-	const unsigned id = PositionToId(position);
-	const unsigned _order = PositionToOrder(position);
+	/* free the songs and release their ids */
 
-	--length;
+	for (unsigned i = start; i < end; i++) {
+		delete items[i].song;
+		id_table.Erase(items[i].id);
+	}
 
-	/* release the song id */
+	/* delete songs from songs array */
 
-	id_table.Erase(id);
+	for (unsigned i = end; i < length; i++)
+		MoveItemTo(i, i - n);
 
-	/* delete song from songs array */
+	if (random && n == 1) {
+		/* delete the entry from both order arrays and
+		   readjust the remaining values; these loops access
+		   memory sequentially and can be vectorized */
 
-	for (unsigned i = position; i < length; i++)
-		MoveItemTo(i + 1, i);
+		const unsigned _order = position_order[start];
+		const unsigned new_length = length - 1;
 
-	/* delete the entry from the order array */
+		std::copy(order + _order + 1, order + length,
+			  order + _order);
+		std::copy(position_order + end, position_order + length,
+			  position_order + start);
 
-	for (unsigned i = _order; i < length; i++)
-		order[i] = order[i + 1];
+		for (unsigned i = 0; i < new_length; i++)
+			order[i] -= order[i] > start;
 
-	/* readjust values in the order array */
+		for (unsigned i = 0; i < new_length; i++)
+			position_order[i] -= position_order[i] > _order;
+	} else if (random) {
+		/* delete the entries from the order array and
+		   readjust the remaining values */
+
+		unsigned dest = 0;
+		for (unsigned i = 0; i < length; i++) {
+			unsigned position = order[i];
+			if (position >= end)
+				position -= n;
+			else if (position >= start)
+				continue;
+
+			order[dest] = position;
+			position_order[position] = dest;
+			++dest;
+		}
+
+		assert(dest == length - n);
+	} else {
+		/* the order array is the identity, and deleting
+		   items from the end doesn't change that */
+		assert(order[start] == start);
+		assert(position_order[start] == start);
+	}
 
-	for (unsigned i = 0; i < length; i++)
-		if (order[i] > position)
-			--order[i];
+	length -= n;
 }
 
 void
@@ -289,6 +333,8 @@ queue_sort_order_by_priority(Queue *queue,
 		return a.priority > b.priority;
 	};
 
+	/* this does not update "position_order"; the caller is
+	   responsible for that */
 	std::stable_sort(queue->order + start, queue->order + end, cmp);
 }
 
@@ -301,6 +347,7 @@ Queue::ShuffleOrderRange(unsigned start, unsigned end) noexcept
 
 	rand.AutoCreate();
 	std::shuffle(order + start, order + end, rand);
+	UpdatePositionOrder(start, end);
 }
 
 /**
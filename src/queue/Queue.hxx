@@ -69,6 +69,13 @@ struct Queue {
 	/** map order numbers to positions */
 	unsigned *const order;
 
+	/**
+	 * Map positions to order numbers; this is the inverse of
+	 * #order and allows PositionToOrder() to run in constant
+	 * time.
+	 */
+	unsigned *const position_order;
+
 	/** map song ids to positions */
 	IdTable id_table;
 
@@ -153,13 +160,9 @@ struct Queue {
 	[[gnu::pure]]
 	unsigned PositionToOrder(unsigned position) const noexcept {
 		assert(position < length);
+		assert(order[position_order[position]] == position);
 
-		for (unsigned i = 0;; ++i) {
-			assert(i < length);
-
-			if (order[i] == position)
-				return i;
-		}
+		return position_order[position];
 	}
 
 	[[gnu::pure]]
@@ -268,6 +271,8 @@ struct Queue {
 	 */
 	void SwapOrders(unsigned order1, unsigned order2) noexcept {
 		std::swap(order[order1], order[order2]);
+		position_order[order[order1]] = order1;
+		position_order[order[order2]] = order2;
 	}
 
 	/**
@@ -308,7 +313,17 @@ struct Queue {
 	/**
 	 * Removes a song from the playlist.
 	 */
-	void DeletePosition(unsigned position) noexcept;
+	void DeletePosition(unsigned position) noexcept {
+		DeleteRange(position, position + 1);
+	}
+
+	/**
+	 * Removes a range of songs from the playlist.  This is
+	 * cheaper than calling DeletePosition() for each of them,
+	 * because the remaining items and the "order" list are
+	 * moved only once.
+	 */
+	void DeleteRange(unsigned start, unsigned end) noexcept;
 
 	/**
 	 * Removes all songs from the playlist.
@@ -320,7 +335,7 @@ struct Queue {
 	 */
 	void RestoreOrder() noexcept {
 		for (unsigned i = 0; i < length; ++i)
-			order[i] = i;
+			order[i] = position_order[i] = i;
 	}
 
 	/**
@@ -365,6 +380,26 @@ struct Queue {
 			      uint8_t priority, int after_order) noexcept;
 
 private:
+	/**
+	 * Update #position_order after #order has been modified in
+	 * the specified range.
+	 */
+	void UpdatePositionOrder(unsigned start_order,
+				 unsigned end_order) noexcept {
+		for (unsigned i = start_order; i < end_order; ++i)
+			position_order[order[i]] = i;
+	}
+
+	/**
+	 * Update the "order" list after the items in the position
+	 * range [first, last) have been rotated (like std::rotate())
+	 * so that "middle" is now at "first".  This is only needed in
+	 * random mode; in non-random mode, the "order" list is the
+	 * identity and remains unchanged.
+	 */
+	void RotateOrder(unsigned first, unsigned middle,
+			 unsigned last) noexcept;
+
 	void MoveItemTo(unsigned from, unsigned to) noexcept {
 		unsigned from_id = items[from].id;
 
@@ -81,6 +81,10 @@ public:
 		return fold_case;
 	}
 
+	Position GetPosition() const noexcept {
+		return position;
+	}
+
 	bool IsNegated() const noexcept {
 		return negated;
 	}
@@ -33,7 +33,7 @@ GetConfiguredMusicDirectory(const ConfigData &config)
 }
 
 static std::unique_ptr<Storage>
-CreateConfiguredStorageLocal(const ConfigData &config)
+CreateConfiguredStorageLocal(const ConfigData &config, EventLoop &event_loop)
 {
 	AllocatedPath path = GetConfiguredMusicDirectory(config);
 	if (path.IsNull())
@@ -41,7 +41,7 @@ CreateConfiguredStorageLocal(const ConfigData &config)
 
 	path.ChopSeparators();
 	CheckDirectoryReadable(path);
-	return CreateLocalStorage(path);
+	return CreateLocalStorage(path, &event_loop);
 }
 
 std::unique_ptr<Storage>
@@ -51,7 +51,7 @@ CreateConfiguredStorage(const ConfigData &config, EventLoop &event_loop)
 	if (uri != nullptr && uri_has_scheme(uri))
 		return CreateConfiguredStorageUri(event_loop, uri);
 
-	return CreateConfiguredStorageLocal(config);
+	return CreateConfiguredStorageLocal(config, event_loop);
 }
 
 bool
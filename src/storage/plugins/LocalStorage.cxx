@@ -11,6 +11,16 @@
 #include "fs/AllocatedPath.hxx"
 #include "fs/DirectoryReader.hxx"
 #include "util/StringCompare.hxx"
+#include "io/uring/Features.h"
+
+#ifdef HAVE_URING
+#include "UringStat.hxx"
+#include "event/Loop.hxx"
+
+#include <vector>
+
+#include <sys/sysmacros.h> // for makedev()
+#endif
 
 #include <string>
 
@@ -30,13 +40,62 @@ public:
 	StorageFileInfo GetInfo(bool follow) override;
 };
 
+#ifdef HAVE_URING
+
+/**
+ * A #StorageDirectoryReader which reads all directory entries at
+ * once and obtains their attributes with a batch of io_uring statx
+ * requests, instead of one stat() system call per GetInfo() call.
+ */
+class UringLocalDirectoryReader final : public StorageDirectoryReader {
+	const AllocatedPath base_fs;
+
+	std::vector<UringStatEntry> entries;
+
+	/**
+	 * The index of the next entry to be returned by Read().
+	 */
+	std::size_t position = 0;
+
+	std::string name_utf8;
+
+	/**
+	 * Has UringStat() been used successfully?  If not, then
+	 * GetInfo() falls back to stat().
+	 */
+	bool have_stat;
+
+public:
+	UringLocalDirectoryReader(EventLoop &event_loop,
+				  AllocatedPath &&_base_fs);
+
+	/* virtual methods from class StorageDirectoryReader */
+	const char *Read() noexcept override;
+	StorageFileInfo GetInfo(bool follow) override;
+};
+
+#endif
+
 class LocalStorage final : public Storage {
 	const AllocatedPath base_fs;
 	const std::string base_utf8;
 
+#ifdef HAVE_URING
+	/**
+	 * If not nullptr, then directory entries are inspected with
+	 * io_uring in this #EventLoop.
+	 */
+	EventLoop *const uring_event_loop;
+#endif
+
 public:
-	explicit LocalStorage(Path _base_fs)
-		:base_fs(_base_fs), base_utf8(base_fs.ToUTF8Throw()) {
+	LocalStorage(Path _base_fs,
+		     [[maybe_unused]] EventLoop *_event_loop)
+		:base_fs(_base_fs), base_utf8(base_fs.ToUTF8Throw())
+#ifdef HAVE_URING
+		, uring_event_loop(_event_loop)
+#endif
+	{
 		assert(!base_fs.IsNull());
 		assert(!base_utf8.empty());
 	}
@@ -82,6 +141,33 @@ Stat(Path path, bool follow)
 	return info;
 }
 
+#ifdef HAVE_URING
+
+/**
+ * Convert a statx() result to #StorageFileInfo, just like Stat()
+ * does with struct stat.
+ */
+static StorageFileInfo
+ToStorageFileInfo(const struct statx &stx) noexcept
+{
+	StorageFileInfo info;
+
+	if (S_ISREG(stx.stx_mode))
+		info.type = StorageFileInfo::Type::REGULAR;
+	else if (S_ISDIR(stx.stx_mode))
+		info.type = StorageFileInfo::Type::DIRECTORY;
+	else
+		info.type = StorageFileInfo::Type::OTHER;
+
+	info.size = stx.stx_size;
+	info.mtime = std::chrono::system_clock::from_time_t(stx.stx_mtime.tv_sec);
+	info.device = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+	info.inode = stx.stx_ino;
+	return info;
+}
+
+#endif
+
 std::string
 LocalStorage::MapUTF8(std::string_view uri_utf8) const noexcept
 {
@@ -135,6 +221,12 @@ LocalStorage::GetInfo(std::string_view uri_utf8, bool follow)
 std::unique_ptr<StorageDirectoryReader>
 LocalStorage::OpenDirectory(std::string_view uri_utf8)
 {
+#ifdef HAVE_URING
+	if (uring_event_loop != nullptr)
+		return std::make_unique<UringLocalDirectoryReader>(*uring_event_loop,
+								   MapFSOrThrow(uri_utf8));
+#endif
+
 	return std::make_unique<LocalDirectoryReader>(MapFSOrThrow(uri_utf8));
 }
 
@@ -162,10 +254,60 @@ LocalDirectoryReader::GetInfo(bool follow)
 	return Stat(base_fs / reader.GetEntry(), follow);
 }
 
+#ifdef HAVE_URING
+
+UringLocalDirectoryReader::UringLocalDirectoryReader(EventLoop &event_loop,
+						     AllocatedPath &&_base_fs)
+	:base_fs(std::move(_base_fs))
+{
+	DirectoryReader reader(base_fs);
+
+	while (reader.ReadEntry()) {
+		const Path name_fs = reader.GetEntry();
+		if (!PathTraitsFS::IsSpecialFilename(name_fs.c_str()))
+			entries.emplace_back(name_fs.c_str());
+	}
+
+	have_stat = UringStat(event_loop, reader.GetFileDescriptor(), entries);
+}
+
+const char *
+UringLocalDirectoryReader::Read() noexcept
+{
+	while (position < entries.size()) {
+		const Path name_fs = Path::FromFS(entries[position++].name.c_str());
+
+		try {
+			name_utf8 = name_fs.ToUTF8Throw();
+			return name_utf8.c_str();
+		} catch (...) {
+		}
+	}
+
+	return nullptr;
+}
+
+StorageFileInfo
+UringLocalDirectoryReader::GetInfo(bool follow)
+{
+	assert(position > 0);
+
+	const auto &entry = entries[position - 1];
+	if (follow && have_stat && entry.result == 0)
+		return ToStorageFileInfo(entry.stx);
+
+	/* fall back to stat() for lstat() semantics and for
+	   failed requests (which will throw an error with the
+	   usual message) */
+	return Stat(base_fs / Path::FromFS(entry.name.c_str()), follow);
+}
+
+#endif
+
 std::unique_ptr<Storage>
-CreateLocalStorage(Path base_fs)
+CreateLocalStorage(Path base_fs, EventLoop *event_loop)
 {
-	return std::make_unique<LocalStorage>(base_fs);
+	return std::make_unique<LocalStorage>(base_fs, event_loop);
 }
 
 constexpr StoragePlugin local_storage_plugin = {
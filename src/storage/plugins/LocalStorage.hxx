@@ -9,10 +9,16 @@
 struct StoragePlugin;
 class Storage;
 class Path;
+class EventLoop;
 
 extern const StoragePlugin local_storage_plugin;
 
+/**
+ * @param event_loop if not nullptr, then directory entries are
+ * inspected with batched io_uring requests in this #EventLoop (if
+ * available); this must not be used from within its thread
+ */
 std::unique_ptr<Storage>
-CreateLocalStorage(Path base_fs);
+CreateLocalStorage(Path base_fs, EventLoop *event_loop=nullptr);
 
 #endif
@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "UringStat.hxx"
+#include "event/Call.hxx"
+#include "event/Loop.hxx"
+#include "io/FileDescriptor.hxx"
+#include "io/uring/Operation.hxx"
+#include "io/uring/Queue.hxx"
+#include "thread/AsyncWaiter.hxx"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#include <fcntl.h> // for AT_STATX_SYNC_AS_STAT
+
+/**
+ * The maximum number of statx requests in flight.  This keeps the
+ * submission queue available for other users of the #EventLoop.
+ */
+static constexpr std::size_t URING_STAT_WINDOW = 256;
+
+class UringStatBatch {
+	class Request final : Uring::Operation {
+		UringStatBatch *batch;
+		UringStatEntry *entry;
+
+	public:
+		/**
+		 * Throws on error.
+		 */
+		void Start(UringStatBatch &_batch, UringStatEntry &_entry) {
+			batch = &_batch;
+			entry = &_entry;
+
+			auto &s = batch->queue->RequireSubmitEntry();
+			io_uring_prep_statx(&s, batch->directory_fd.Get(),
+					    entry->name.c_str(),
+					    AT_STATX_SYNC_AS_STAT,
+					    STATX_BASIC_STATS,
+					    &entry->stx);
+			batch->queue->Push(s, *this);
+		}
+
+	private:
+		/* virtual methods from class Uring::Operation */
+		void OnUringCompletion(int res) noexcept override {
+			entry->result = res;
+			batch->OnRequestComplete(*this);
+		}
+	};
+
+	Uring::Queue *queue;
+
+	const FileDescriptor directory_fd;
+
+	const std::span<UringStatEntry> entries;
+
+	/**
+	 * The index of the next entry to be submitted.
+	 */
+	std::size_t next = 0;
+
+	/**
+	 * The number of requests in flight.
+	 */
+	std::size_t n_pending = 0;
+
+	std::array<Request, URING_STAT_WINDOW> requests;
+
+	AsyncWaiter waiter;
+
+public:
+	UringStatBatch(FileDescriptor _directory_fd,
+		       std::span<UringStatEntry> _entries) noexcept
+		:directory_fd(_directory_fd), entries(_entries) {}
+
+	/**
+	 * Submit the first requests.  Must be called in the
+	 * #EventLoop thread.
+	 *
+	 * @return false if io_uring is not available
+	 */
+	bool Start(EventLoop &event_loop) noexcept {
+		queue = event_loop.GetUring();
+		if (queue == nullptr)
+			return false;
+
+		const std::size_t n = std::min(requests.size(), entries.size());
+		for (std::size_t i = 0; i < n; ++i)
+			StartNext(requests[i]);
+
+		CheckDone();
+		return true;
+	}
+
+	/**
+	 * Wait until all requests have completed.  Must be called
+	 * outside of the #EventLoop thread after Start() has
+	 * succeeded.
+	 */
+	void Wait() noexcept {
+		waiter.Wait();
+	}
+
+private:
+	/**
+	 * Submit the next entry using the given (idle) #Request.
+	 * Entries which cannot be submitted are skipped; their
+	 * #UringStatEntry::result remains -ECANCELED.
+	 */
+	void StartNext(Request &request) noexcept {
+		while (next < entries.size()) {
+			try {
+				request.Start(*this, entries[next++]);
+				++n_pending;
+				return;
+			} catch (...) {
+			}
+		}
+	}
+
+	void CheckDone() noexcept {
+		if (n_pending == 0)
+			waiter.SetDone();
+	}
+
+	void OnRequestComplete(Request &request) noexcept {
+		assert(n_pending > 0);
+		--n_pending;
+
+		StartNext(request);
+		CheckDone();
+	}
+};
+
+bool
+UringStat(EventLoop &event_loop, FileDescriptor directory_fd,
+	  std::span<UringStatEntry> entries) noexcept
+try {
+	if (!event_loop.IsAlive() || event_loop.IsInside())
+		/* nobody would dispatch the completions while we
+		   wait */
+		return false;
+
+	UringStatBatch batch(directory_fd, entries);
+
+	bool started = false;
+	BlockingCall(event_loop, [&batch, &event_loop, &started](){
+		started = batch.Start(event_loop);
+	});
+
+	if (!started)
+		return false;
+
+	batch.Wait();
+	return true;
+} catch (...) {
+	return false;
+}
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#pragma once
+
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <errno.h>
+#include <sys/stat.h> // for struct statx
+
+class EventLoop;
+class FileDescriptor;
+
+struct UringStatEntry {
+	/**
+	 * The file name relative to the directory.
+	 */
+	std::string name;
+
+	struct statx stx;
+
+	/**
+	 * 0 on success or a negative errno value.
+	 */
+	int result = -ECANCELED;
+
+	explicit UringStatEntry(std::string_view _name) noexcept
+		:name(_name) {}
+};
+
+/**
+ * Obtain the attributes of many directory entries at once by
+ * submitting IORING_OP_STATX requests (following symlinks) to the
+ * io_uring of the given #EventLoop and waiting for their completion.
+ * This must be called from a different thread than the #EventLoop.
+ *
+ * Individual failures are reported in UringStatEntry::result.
+ *
+ * @param directory_fd the directory which contains all entries
+ * @return false if io_uring is not available (no entry has been
+ * touched)
+ */
+bool
+UringStat(EventLoop &event_loop, FileDescriptor directory_fd,
+	  std::span<UringStatEntry> entries) noexcept;
@@ -20,25 +20,40 @@ TagBuilder::TagBuilder(const Tag &other) noexcept
 	const std::size_t n = other.num_items;
 	if (n > 0) {
 		items.reserve(other.num_items);
-		const std::scoped_lock protect{tag_pool_lock};
 		for (std::size_t i = 0; i != n; ++i)
 			items.push_back(tag_pool_dup_item(other.items[i]));
 	}
 }
 
-TagBuilder::TagBuilder(Tag &&other) noexcept
-	:duration(other.duration), has_playlist(other.has_playlist)
+/**
+ * Move all #TagItem pointers from the #Tag object to the vector.
+ */
+static void
+MoveTagItems(std::vector<TagItem *> &dest, Tag &&src) noexcept
 {
-	/* move all TagItem pointers from the Tag object; we don't
-	   need to contact the tag pool, because all we do is move
-	   references */
-	items.reserve(other.num_items);
-	std::copy_n(other.items, other.num_items, std::back_inserter(items));
+	dest.reserve(dest.size() + src.num_items);
+
+	if (src.IsItemsShared()) {
+		/* the array is shared with other Tag objects; we
+		   need our own references */
+		std::transform(src.items, src.items + src.num_items,
+			       std::back_inserter(dest), tag_pool_dup_item);
+		src.Clear();
+		return;
+	}
+
+	/* we don't need to contact the tag pool, because all we do
+	   is move references */
+	std::copy_n(src.items, src.num_items, std::back_inserter(dest));
 
 	/* discard the pointers from the Tag object */
-	other.num_items = 0;
-	delete[] other.items;
-	other.items = nullptr;
+	src.FreeItems();
+}
+
+TagBuilder::TagBuilder(Tag &&other) noexcept
+	:duration(other.duration), has_playlist(other.has_playlist)
+{
+	MoveTagItems(items, std::move(other));
 }
 
 TagBuilder &
@@ -54,7 +69,6 @@ TagBuilder::operator=(const TagBuilder &other) noexcept
 		items = other.items;
 
 		/* increment the tag pool refcounters */
-		const std::scoped_lock protect{tag_pool_lock};
 		for (auto &i : items)
 			i = tag_pool_dup_item(i);
 	}
@@ -87,13 +101,7 @@ TagBuilder::operator=(Tag &&other) noexcept
 	   need to contact the tag pool, because all we do is move
 	   references */
 	RemoveAll();
-	items.reserve(other.num_items);
-	std::copy_n(other.items, other.num_items, std::back_inserter(items));
-
-	/* discard the pointers from the Tag object */
-	other.num_items = 0;
-	delete[] other.items;
-	other.items = nullptr;
+	MoveTagItems(items, std::move(other));
 
 	return *this;
 }
@@ -120,7 +128,7 @@ TagBuilder::Commit(Tag &tag) noexcept
 	   object */
 	const unsigned n_items = items.size();
 	tag.num_items = n_items;
-	tag.items = new TagItem *[n_items];
+	tag.items = Tag::AllocateItems(n_items);
 	std::copy_n(items.begin(), n_items, tag.items);
 	items.clear();
 
@@ -170,7 +178,6 @@ TagBuilder::Complement(const Tag &other) noexcept
 
 		items.reserve(items.size() + n);
 
-		const std::scoped_lock protect{tag_pool_lock};
 		for (std::size_t i = 0; i != n; ++i) {
 			TagItem *item = other.items[i];
 			if (!present[item->type])
@@ -182,14 +189,7 @@ TagBuilder::Complement(const Tag &other) noexcept
 void
 TagBuilder::AddItemUnchecked(TagType type, std::string_view value) noexcept
 {
-	TagItem *i;
-
-	{
-		const std::scoped_lock protect{tag_pool_lock};
-		i = tag_pool_get_item(type, value);
-	}
-
-	items.push_back(i);
+	items.push_back(tag_pool_get_item(type, value));
 }
 
 inline void
@@ -222,16 +222,8 @@ TagBuilder::AddEmptyItem(TagType type) noexcept
 void
 TagBuilder::RemoveAll() noexcept
 {
-	if (items.empty())
-		/* don't acquire the tag_pool_lock if we're not going
-		   to call tag_pool_put_item() anyway */
-		return;
-
-	{
-		const std::scoped_lock protect{tag_pool_lock};
-		for (auto i : items)
-			tag_pool_put_item(i);
-	}
+	for (auto i : items)
+		tag_pool_put_item(i);
 
 	items.clear();
 }
@@ -239,14 +231,8 @@ TagBuilder::RemoveAll() noexcept
 void
 TagBuilder::RemoveType(TagType type) noexcept
 {
-	if (items.empty())
-		/* don't acquire the tag_pool_lock if we're not going
-		   to call tag_pool_put_item() anyway */
-		return;
-
 	const auto begin = items.begin(), end = items.end();
 
-	const std::scoped_lock protect{tag_pool_lock};
 	items.erase(std::remove_if(begin, end,
 				   [type](TagItem *item) {
 					   if (item->type != type)
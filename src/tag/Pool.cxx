@@ -3,108 +3,283 @@
 
 #include "Pool.hxx"
 #include "Item.hxx"
+#include "thread/Mutex.hxx"
 #include "util/Cast.hxx"
 #include "util/djb_hash.hxx"
-#include "util/IntrusiveHashSet.hxx"
 #include "util/SpanCast.hxx"
 #include "util/VarSize.hxx"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <limits>
+#include <memory>
 
-Mutex tag_pool_lock;
+/**
+ * The number of shards; must be a power of two.  Each shard has its
+ * own lock, which allows threads to access the pool in parallel as
+ * long as they look up different values.
+ */
+static constexpr std::size_t N_SHARDS = 64;
 
-struct TagPoolKey {
-	std::string_view value;
-	TagType type;
+/**
+ * The initial number of hash buckets per shard; must be a power of
+ * two.  The table is doubled whenever the number of items exceeds
+ * the number of buckets.
+ */
+static constexpr std::size_t INITIAL_BUCKETS = 256;
 
-	friend constexpr auto operator<=>(const TagPoolKey &,
-					  const TagPoolKey &) noexcept = default;
-
-	struct Hash {
-		[[gnu::pure]]
-		std::size_t operator()(const TagPoolKey &key) const noexcept {
-			return djb_hash(AsBytes(key.value)) ^ key.type;
-		}
-	};
-};
+[[gnu::pure]]
+static std::size_t
+TagPoolHash(TagType type, std::string_view value) noexcept
+{
+	return djb_hash(AsBytes(value)) ^ type;
+}
 
 struct TagPoolItem {
-	IntrusiveHashSetHook<IntrusiveHookMode::NORMAL> hash_set_hook;
-	uint8_t ref = 1;
+	/**
+	 * The next item in the same hash bucket.  Protected by the
+	 * shard's mutex.
+	 */
+	TagPoolItem *next = nullptr;
+
+	/**
+	 * The hash of #item (see TagPoolHash()), cached for rehashing
+	 * and for cheap comparisons.
+	 */
+	const std::size_t hash;
+
+	/**
+	 * The reference counter.  Once it has dropped to zero, the
+	 * item is being deleted and must not be referenced again;
+	 * see TryRef().
+	 */
+	std::atomic<uint_least32_t> ref{1};
+
 	TagItem item;
 
-	static constexpr unsigned MAX_REF = std::numeric_limits<decltype(ref)>::max();
+	static constexpr uint_least32_t MAX_REF = std::numeric_limits<uint_least32_t>::max();
 
-	TagPoolItem(TagType type,
-		    std::string_view value) noexcept {
+	TagPoolItem(std::size_t _hash, TagType type,
+		    std::string_view value) noexcept
+		:hash(_hash) {
 		item.type = type;
 		*std::copy(value.begin(), value.end(), item.value) = 0;
 	}
 
-	static TagPoolItem *Create(TagType type,
+	static TagPoolItem *Create(std::size_t hash, TagType type,
 				   std::string_view value) noexcept;
 
-	struct GetKey {
-		[[gnu::pure]]
-		constexpr TagPoolKey operator()(const TagItem &i) const noexcept {
-			return { i.value, i.type };
-		}
+	/**
+	 * The number of bytes allocated by Create() for an item with
+	 * this value.
+	 */
+	static constexpr std::size_t GetAllocationSize(std::string_view value) noexcept {
+		return sizeof(TagPoolItem) - sizeof(TagItem::value) + value.size() + 1;
+	}
 
-		[[gnu::pure]]
-		constexpr TagPoolKey operator()(const TagPoolItem &i) const noexcept {
-			return operator()(i.item);
-		}
-	};
+	[[gnu::pure]]
+	bool Matches(std::size_t _hash, TagType type,
+		     std::string_view value) const noexcept {
+		return hash == _hash && item.type == type &&
+			value == item.value;
+	}
 
-	struct CanIncrementRef {
-		constexpr bool operator()(const TagPoolItem &i) const noexcept {
-			return i.ref < MAX_REF;
-		}
-	};
+	/**
+	 * Obtain a new reference unless the counter is zero (i.e. the
+	 * item is being deleted) or would overflow.
+	 */
+	bool TryRef() noexcept {
+		auto r = ref.load(std::memory_order_relaxed);
+		while (r > 0 && r < MAX_REF)
+			if (ref.compare_exchange_weak(r, r + 1,
+						      std::memory_order_relaxed))
+				return true;
+
+		return false;
+	}
+
+	/**
+	 * Release a reference.
+	 *
+	 * @return true if this was the last reference and the caller
+	 * shall delete the item
+	 */
+	bool Unref() noexcept {
+		assert(ref.load(std::memory_order_relaxed) > 0);
+
+		return ref.fetch_sub(1, std::memory_order_acq_rel) == 1;
+	}
 };
 
 TagPoolItem *
-TagPoolItem::Create(TagType type,
+TagPoolItem::Create(std::size_t hash, TagType type,
 		    std::string_view value) noexcept
 {
-	TagPoolItem *dummy;
-	return NewVarSize<TagPoolItem>(sizeof(dummy->item.value),
+	return NewVarSize<TagPoolItem>(sizeof(TagItem::value),
 				       value.size() + 1,
-				       type,
+				       hash, type,
 				       value);
 }
 
-static IntrusiveHashSet<TagPoolItem, 16384,
-	IntrusiveHashSetOperators<TagPoolItem, TagPoolItem::GetKey,
-				  TagPoolKey::Hash,
-				  std::equal_to<TagPoolKey>>,
-	IntrusiveHashSetMemberHookTraits<&TagPoolItem::hash_set_hook>,
-	IntrusiveHashSetOptions{.zero_initialized = true}> tag_pool;
-
 static constexpr TagPoolItem *
 TagItemToPoolItem(TagItem *item) noexcept
 {
 	return &ContainerCast(*item, &TagPoolItem::item);
 }
 
+/**
+ * One part of the tag pool: a growing chained hash table protected
+ * by a mutex.
+ */
+class alignas(64) TagPoolShard {
+	Mutex mutex;
+
+	/**
+	 * The hash buckets (singly linked lists of items).  This is
+	 * allocated on the first insertion.
+	 */
+	std::unique_ptr<TagPoolItem *[]> buckets;
+
+	std::size_t n_buckets = 0;
+
+	std::size_t n_items = 0;
+
+	/**
+	 * The number of bytes allocated for items.
+	 */
+	std::size_t n_item_bytes = 0;
+
+	uint_least64_t n_collisions = 0, n_lock_waits = 0;
+
+public:
+	std::unique_lock<Mutex> Lock() noexcept {
+		std::unique_lock lock{mutex, std::try_to_lock};
+		if (!lock.owns_lock()) {
+			lock.lock();
+			++n_lock_waits;
+		}
+
+		return lock;
+	}
+
+	/**
+	 * Find an item and obtain a reference, or create a new one.
+	 * Caller must lock the mutex.
+	 */
+	TagPoolItem &Get(std::size_t hash, TagType type,
+			 std::string_view value) noexcept {
+		if (n_buckets > 0) {
+			for (auto *i = GetBucket(hash); i != nullptr; i = i->next) {
+				if (!i->Matches(hash, type, value))
+					++n_collisions;
+				else if (i->TryRef())
+					return *i;
+			}
+		}
+
+		/* not found, or all matching items are either
+		   "full" or being deleted: create a new one */
+		auto *item = TagPoolItem::Create(hash, type, value);
+		++n_items;
+		n_item_bytes += TagPoolItem::GetAllocationSize(value);
+
+		if (n_items > n_buckets)
+			Grow();
+
+		auto *&bucket = GetBucket(hash);
+		item->next = bucket;
+		bucket = item;
+		return *item;
+	}
+
+	/**
+	 * Remove an item from the table whose reference counter has
+	 * dropped to zero.  Caller must lock the mutex.
+	 */
+	void Remove(TagPoolItem &item) noexcept {
+		assert(n_items > 0);
+
+		auto **p = &GetBucket(item.hash);
+		while (*p != &item) {
+			assert(*p != nullptr);
+			p = &(*p)->next;
+		}
+
+		*p = item.next;
+		--n_items;
+		n_item_bytes -= TagPoolItem::GetAllocationSize(item.item.value);
+	}
+
+	/**
+	 * Add this shard's counters to the given object.  Caller must
+	 * lock the mutex.
+	 */
+	void AddStats(TagPoolStats &stats) const noexcept {
+		stats.n_items += n_items;
+		stats.n_bytes += n_item_bytes + n_buckets * sizeof(buckets[0]);
+		stats.n_collisions += n_collisions;
+		stats.n_lock_waits += n_lock_waits;
+	}
+
+	Mutex &GetMutex() noexcept {
+		return mutex;
+	}
+
+private:
+	static constexpr std::size_t GetBucketIndex(std::size_t hash,
+						    std::size_t n) noexcept {
+		/* the lower bits were already used to choose the
+		   shard */
+		return (hash / N_SHARDS) & (n - 1);
+	}
+
+	TagPoolItem *&GetBucket(std::size_t hash) noexcept {
+		assert(n_buckets > 0);
+
+		return buckets[GetBucketIndex(hash, n_buckets)];
+	}
+
+	void Grow() noexcept {
+		const std::size_t new_size = n_buckets > 0
+			? n_buckets * 2
+			: INITIAL_BUCKETS;
+
+		auto new_buckets = std::make_unique<TagPoolItem *[]>(new_size);
+
+		for (std::size_t b = 0; b < n_buckets; ++b) {
+			for (auto *i = buckets[b]; i != nullptr;) {
+				auto *next = i->next;
+				auto *&bucket = new_buckets[GetBucketIndex(i->hash, new_size)];
+				i->next = bucket;
+				bucket = i;
+				i = next;
+			}
+		}
+
+		buckets = std::move(new_buckets);
+		n_buckets = new_size;
+	}
+};
+
+static std::array<TagPoolShard, N_SHARDS> tag_pool;
+
+static TagPoolShard &
+GetShard(std::size_t hash) noexcept
+{
+	return tag_pool[hash % N_SHARDS];
+}
+
 TagItem *
 tag_pool_get_item(TagType type, std::string_view value) noexcept
 {
-	const auto [position, inserted] =
-		tag_pool.insert_check_if(TagPoolKey{value, type},
-					 TagPoolItem::CanIncrementRef{});
-
-	if (inserted) {
-		auto *pool_item = TagPoolItem::Create(type, value);
-		tag_pool.insert_commit(position, *pool_item);
-		return &pool_item->item;
-	} else {
-		++position->ref;
-		return &position->item;
-	}
+	const std::size_t hash = TagPoolHash(type, value);
+	auto &shard = GetShard(hash);
+
+	const auto lock = shard.Lock();
+	return &shard.Get(hash, type, value).item;
 }
 
 TagItem *
@@ -112,10 +287,9 @@ tag_pool_dup_item(TagItem *item) noexcept
 {
 	TagPoolItem *pool_item = TagItemToPoolItem(item);
 
-	assert(pool_item->ref > 0);
+	assert(pool_item->ref.load(std::memory_order_relaxed) > 0);
 
-	if (pool_item->ref < TagPoolItem::MAX_REF) {
-		++pool_item->ref;
+	if (pool_item->TryRef()) {
 		return item;
 	} else {
 		/* the reference counter overflows above MAX_REF;
@@ -129,12 +303,30 @@ void
 tag_pool_put_item(TagItem *item) noexcept
 {
 	TagPoolItem *const pool_item = TagItemToPoolItem(item);
-	assert(pool_item->ref > 0);
-	--pool_item->ref;
-
-	if (pool_item->ref > 0)
+	if (!pool_item->Unref())
 		return;
 
-	tag_pool.erase(tag_pool.iterator_to(*pool_item));
+	/* nobody can obtain a new reference to this item (see
+	   TagPoolItem::TryRef()), so we can remove it without
+	   checking the counter again */
+	{
+		auto &shard = GetShard(pool_item->hash);
+		const auto lock = shard.Lock();
+		shard.Remove(*pool_item);
+	}
+
 	DeleteVarSize(pool_item);
 }
+
+TagPoolStats
+tag_pool_get_stats() noexcept
+{
+	TagPoolStats stats{};
+
+	for (auto &shard : tag_pool) {
+		const std::scoped_lock lock{shard.GetMutex()};
+		shard.AddStats(stats);
+	}
+
+	return stats;
+}
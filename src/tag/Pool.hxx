@@ -4,17 +4,20 @@
 #ifndef MPD_TAG_POOL_HXX
 #define MPD_TAG_POOL_HXX
 
-#include "thread/Mutex.hxx"
-
+#include <cstddef>
 #include <cstdint>
 #include <string_view>
 
 enum TagType : uint8_t;
 
-extern Mutex tag_pool_lock;
-
 struct TagItem;
 
+/*
+ * The tag pool de-duplicates #TagItem instances.  All functions are
+ * thread-safe; the pool is split into shards which are locked
+ * separately, and references are counted with atomic operations.
+ */
+
 [[nodiscard]]
 TagItem *
 tag_pool_get_item(TagType type, std::string_view value) noexcept;
@@ -26,4 +29,31 @@ tag_pool_dup_item(TagItem *item) noexcept;
 void
 tag_pool_put_item(TagItem *item) noexcept;
 
+struct TagPoolStats {
+	/**
+	 * The number of #TagItem instances in the pool.
+	 */
+	std::size_t n_items;
+
+	/**
+	 * The amount of memory allocated by the pool (for items and
+	 * hash tables).
+	 */
+	std::size_t n_bytes;
+
+	/**
+	 * The number of items which were skipped during lookups
+	 * because their key differs from the one being looked up.
+	 */
+	uint_least64_t n_collisions;
+
+	/**
+	 * The number of times a shard lock was contended.
+	 */
+	uint_least64_t n_lock_waits;
+};
+
+TagPoolStats
+tag_pool_get_stats() noexcept;
+
 #endif
@@ -5,7 +5,65 @@
 #include "Pool.hxx"
 #include "Builder.hxx"
 
+#include <atomic>
 #include <cassert>
+#include <new>
+
+namespace {
+
+/**
+ * The header of an array allocated by Tag::AllocateItems(); it is
+ * followed by the #TagItem pointers.
+ */
+struct alignas(TagItem *) TagItemArrayHeader {
+	std::atomic_uint ref{1};
+};
+
+} // anonymous namespace
+
+static TagItemArrayHeader &
+GetItemArrayHeader(TagItem **items) noexcept
+{
+	assert(items != nullptr);
+
+	return reinterpret_cast<TagItemArrayHeader *>(items)[-1];
+}
+
+TagItem **
+Tag::AllocateItems(std::size_t n) noexcept
+{
+	void *p = ::operator new(sizeof(TagItemArrayHeader) +
+				 n * sizeof(TagItem *));
+	auto *header = new(p) TagItemArrayHeader();
+	return reinterpret_cast<TagItem **>(header + 1);
+}
+
+static void
+FreeItemArray(TagItem **items) noexcept
+{
+	auto &header = GetItemArrayHeader(items);
+	header.~TagItemArrayHeader();
+	::operator delete(&header);
+}
+
+bool
+Tag::IsItemsShared() const noexcept
+{
+	return items != nullptr &&
+		GetItemArrayHeader(items).ref.load(std::memory_order_acquire) > 1;
+}
+
+void
+Tag::FreeItems() noexcept
+{
+	assert(!IsItemsShared());
+
+	if (items != nullptr)
+		FreeItemArray(items);
+
+	items = nullptr;
+	num_items = 0;
+}
 
 bool
 Tag::operator==(const Tag &other) const noexcept {
@@ -13,7 +71,8 @@ Tag::operator==(const Tag &other) const noexcept {
 		duration == other.duration
 		&& has_playlist == other.has_playlist
 		&& num_items == other.num_items
-		&& std::equal(begin(), end(), other.begin(), other.end());
+		&& (items == other.items ||
+		    std::equal(begin(), end(), other.begin(), other.end()));
 }
 
 void
@@ -22,15 +81,16 @@ Tag::Clear() noexcept
 	duration = SignedSongTime::Negative();
 	has_playlist = false;
 
-	if (num_items > 0) {
-		assert(items != nullptr);
-		const std::scoped_lock protect{tag_pool_lock};
+	if (items != nullptr &&
+	    GetItemArrayHeader(items).ref.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		/* this was the last reference to the array */
 		for (unsigned i = 0; i < num_items; ++i)
 			tag_pool_put_item(items[i]);
-		num_items = 0;
+
+		FreeItemArray(items);
 	}
 
-	delete[] items;
+	num_items = 0;
 	items = nullptr;
 }
 
@@ -39,11 +99,9 @@ Tag::Tag(const Tag &other) noexcept
 	 num_items(other.num_items)
 {
 	if (num_items > 0) {
-		items = new TagItem *[num_items];
-
-		const std::scoped_lock protect{tag_pool_lock};
-		for (unsigned i = 0; i < num_items; i++)
-			items[i] = tag_pool_dup_item(other.items[i]);
+		/* share the array */
+		items = other.items;
+		GetItemArrayHeader(items).ref.fetch_add(1, std::memory_order_relaxed);
 	}
 }
 
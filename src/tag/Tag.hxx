@@ -9,6 +9,7 @@
 #include "Chrono.hxx"
 #include "util/DereferenceIterator.hxx"
 
+#include <cstddef>
 #include <memory>
 #include <utility>
 
@@ -32,7 +33,13 @@ struct Tag {
 	/** the total number of tag items in the #items array */
 	unsigned short num_items = 0;
 
-	/** an array of tag items */
+	/**
+	 * An array of tag items, allocated with AllocateItems().  The
+	 * array is immutable and reference counted, and copies of
+	 * this object share it; this way, copying a #Tag (e.g. from
+	 * the database to the queue) does not allocate memory and
+	 * does not touch the tag pool.
+	 */
 	TagItem **items = nullptr;
 
 	/**
@@ -96,6 +103,26 @@ struct Tag {
 	 */
 	void Clear() noexcept;
 
+	/**
+	 * Allocate a new (reference counted) array for #items.  The
+	 * caller fills it with references obtained from the tag
+	 * pool.
+	 */
+	static TagItem **AllocateItems(std::size_t n) noexcept;
+
+	/**
+	 * Is the #items array shared with other #Tag instances?
+	 */
+	[[gnu::pure]]
+	bool IsItemsShared() const noexcept;
+
+	/**
+	 * Free the #items array without releasing the tag pool
+	 * references; the caller must have taken them over.  This is
+	 * only allowed if the array is not shared.
+	 */
+	void FreeItems() noexcept;
+
 	/**
 	 * Merges the data from two tags.  If both tags share data for the
 	 * same TagType, only data from "add" is used.
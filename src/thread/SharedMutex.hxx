@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// author: Max Kellermann <max.kellermann@gmail.com>
+
+#ifndef THREAD_SHARED_MUTEX_HXX
+#define THREAD_SHARED_MUTEX_HXX
+
+#include "Mutex.hxx"
+#include "Cond.hxx"
+
+#include <cassert>
+
+/**
+ * A reader/writer lock.  Unlike std::shared_mutex (whose policy
+ * depends on the platform), the caller of a shared lock chooses
+ * whether it yields to writers which are waiting for the exclusive
+ * lock:
+ *
+ * - lock_shared() waits until no writer is waiting; this prevents
+ *   readers from starving writers, but a new reader may have to wait
+ *   for the longest current reader
+ *
+ * - lock_shared_eager() only waits while a writer actually holds the
+ *   lock; use this for short critical sections in latency-sensitive
+ *   threads
+ *
+ * Writers can still be starved if eager readers overlap all the
+ * time, so eager locks should be rare and short.
+ *
+ * Shared locks must not be obtained recursively, because a waiting
+ * writer would cause a deadlock.
+ */
+class SharedMutex {
+	Mutex mutex;
+
+	/**
+	 * Signalled when the exclusive lock or the last shared lock
+	 * has been released.
+	 */
+	Cond cond;
+
+	/**
+	 * The number of shared lock holders.
+	 */
+	unsigned n_readers = 0;
+
+	/**
+	 * The number of threads waiting in lock().
+	 */
+	unsigned n_waiting_writers = 0;
+
+	/**
+	 * Is the exclusive lock being held?
+	 */
+	bool writer = false;
+
+public:
+	SharedMutex() noexcept = default;
+
+	SharedMutex(const SharedMutex &other) = delete;
+	SharedMutex &operator=(const SharedMutex &other) = delete;
+
+	void lock() noexcept {
+		std::unique_lock lock{mutex};
+		++n_waiting_writers;
+		cond.wait(lock, [this]{ return !writer && n_readers == 0; });
+		--n_waiting_writers;
+		writer = true;
+	}
+
+	void unlock() noexcept {
+		{
+			const std::scoped_lock lock{mutex};
+			assert(writer);
+			writer = false;
+		}
+
+		cond.notify_all();
+	}
+
+	void lock_shared() noexcept {
+		std::unique_lock lock{mutex};
+		cond.wait(lock, [this]{
+			return !writer && n_waiting_writers == 0;
+		});
+		++n_readers;
+	}
+
+	void lock_shared_eager() noexcept {
+		std::unique_lock lock{mutex};
+		cond.wait(lock, [this]{ return !writer; });
+		++n_readers;
+	}
+
+	void unlock_shared() noexcept {
+		bool notify;
+
+		{
+			const std::scoped_lock lock{mutex};
+			assert(n_readers > 0);
+			notify = --n_readers == 0;
+		}
+
+		if (notify)
+			cond.notify_all();
+	}
+};
+
+#endif
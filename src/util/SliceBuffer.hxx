@@ -6,127 +6,329 @@
 
 #include "HugeAllocator.hxx"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <new>
+#include <thread>
 #include <utility>
 
 /**
  * This class pre-allocates a certain number of objects, and allows
  * callers to allocate and free these objects ("slices").
+ *
+ * The slice size may be larger than sizeof(T); this allows #T to be
+ * followed by a variable-length payload whose size is determined at
+ * runtime.
+ *
+ * All methods are thread-safe and lock-free: the free slices are
+ * managed in a lock-free stack whose head is tagged with a
+ * modification counter (to avoid the ABA problem), and the number
+ * of allocated slices is reserved with an atomic counter before
+ * popping a slice from the stack.
  */
 template<typename T>
 class SliceBuffer {
+	static constexpr uint32_t NONE = ~uint32_t{};
+
+	/**
+	 * This flag in #n_allocated means that DiscardMemory() is
+	 * currently running; Allocate() must wait until it has
+	 * finished.
+	 */
+	static constexpr unsigned DISCARDING = ~(~0U >> 1);
+
 	union Slice {
-		Slice *next;
+		/**
+		 * The index of the next free slice or #NONE.  This is
+		 * only valid while the slice is in the "available"
+		 * stack.
+		 */
+		std::atomic<uint32_t> next;
 
 		T value;
 	};
 
-	HugeArray<Slice> buffer;
+	/**
+	 * The distance between two slices in bytes.
+	 */
+	const std::size_t slice_size;
+
+	HugeArray<std::byte> buffer;
+
+	/**
+	 * The number of slices in #buffer.
+	 */
+	const unsigned capacity;
+
+	/**
+	 * The head of the "available" stack.  The lower 32 bits are
+	 * the index of the first free slice (or #NONE), the upper 32
+	 * bits are a counter which is incremented on each
+	 * modification.
+	 */
+	std::atomic<uint64_t> available{NONE};
 
 	/**
 	 * The number of slices that are initialized.  This is used to
 	 * avoid page faulting on the new allocation, so the kernel
 	 * does not need to reserve physical memory pages.
 	 */
-	unsigned n_initialized = 0;
+	std::atomic<unsigned> n_initialized{0};
+
+	/**
+	 * The number of slices currently allocated (or reserved by a
+	 * pending Allocate() call), possibly combined with the
+	 * #DISCARDING flag.
+	 */
+	std::atomic<unsigned> n_allocated{0};
 
 	/**
-	 * The number of slices currently allocated.
+	 * The highest value of #n_allocated ever seen.
 	 */
-	unsigned n_allocated = 0;
+	std::atomic<unsigned> high_water{0};
 
 	/**
-	 * Pointer to the first free element in the chain.
+	 * The number of Allocate() calls which failed because the
+	 * buffer was full.
 	 */
-	Slice *available = nullptr;
+	std::atomic<unsigned long> n_failures{0};
+
+	static constexpr std::size_t RoundUpSliceSize(std::size_t size) noexcept {
+		size = std::max(size, sizeof(Slice));
+		return (size + alignof(Slice) - 1) / alignof(Slice) * alignof(Slice);
+	}
 
 public:
-	SliceBuffer(unsigned _count)
-		:buffer(_count) {
+	/**
+	 * @param _slice_size the size of each slice in bytes; must
+	 * not be smaller than sizeof(T)
+	 */
+	explicit SliceBuffer(unsigned _count,
+			     std::size_t _slice_size=sizeof(T))
+		:slice_size(RoundUpSliceSize(_slice_size)),
+		 buffer(_count * slice_size),
+		 capacity(buffer.size() / slice_size) {
+		assert(_slice_size >= sizeof(T));
+		assert(capacity < NONE);
+		assert(capacity < DISCARDING);
+
 		buffer.ForkCow(false);
 	}
 
 	~SliceBuffer() noexcept {
 		/* all slices must be freed explicitly, and this
 		   assertion checks for leaks */
-		assert(n_allocated == 0);
+		assert(empty());
 	}
 
 	SliceBuffer(const SliceBuffer &other) = delete;
 	SliceBuffer &operator=(const SliceBuffer &other) = delete;
 
 	unsigned GetCapacity() const noexcept {
-		return buffer.size();
+		return capacity;
+	}
+
+	/**
+	 * Returns the size of each slice in bytes.
+	 */
+	std::size_t GetSliceSize() const noexcept {
+		return slice_size;
 	}
 
 	bool empty() const noexcept {
-		return n_allocated == 0;
+		return (n_allocated.load(std::memory_order_relaxed) & ~DISCARDING) == 0;
 	}
 
 	bool IsFull() const noexcept {
-		return n_allocated == buffer.size();
+		return (n_allocated.load(std::memory_order_relaxed) & ~DISCARDING) >= capacity;
 	}
 
-	void SetName(const char *name) noexcept {
-		buffer.SetName(name);
+	/**
+	 * Returns the highest number of slices which were allocated
+	 * at the same time.
+	 */
+	unsigned GetHighWaterMark() const noexcept {
+		return high_water.load(std::memory_order_relaxed);
 	}
 
-	void DiscardMemory() noexcept {
-		assert(empty());
+	/**
+	 * Returns the number of Allocate() calls which failed because
+	 * the buffer was full.
+	 */
+	unsigned long GetAllocationFailures() const noexcept {
+		return n_failures.load(std::memory_order_relaxed);
+	}
 
-		n_initialized = 0;
-		buffer.Discard();
-		available = nullptr;
+	void SetName(const char *name) noexcept {
+		buffer.SetName(name);
 	}
 
 	template<typename... Args>
 	T *Allocate(Args&&... args) {
-		assert(n_initialized <= buffer.size());
-		assert(n_allocated <= n_initialized);
-
-		if (available == nullptr) {
-			if (n_initialized == buffer.size()) {
-				/* out of (internal) memory, buffer is full */
-				assert(n_allocated == buffer.size());
-				return nullptr;
-			}
-
-			available = &buffer[n_initialized++];
-			available->next = nullptr;
+		if (!Reserve()) {
+			/* out of (internal) memory, buffer is full */
+			n_failures.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
 		}
 
 		/* allocate a slice */
-		T *value = &available->value;
-		available = available->next;
-		++n_allocated;
+		T *value = &Pop().value;
 
 		/* construct the object */
 		return ::new((void *)value) T(std::forward<Args>(args)...);
 	}
 
 	void Free(T *value) noexcept {
-		assert(n_initialized <= buffer.size());
-		assert(n_allocated > 0);
-		assert(n_allocated <= n_initialized);
+		assert(!empty());
 
 		Slice *slice = reinterpret_cast<Slice *>(value);
-		assert(slice >= &buffer.front() && slice <= &buffer.back());
+		assert(reinterpret_cast<std::byte *>(slice) >= &buffer.front());
+		assert(reinterpret_cast<std::byte *>(slice) < &buffer.front() + capacity * slice_size);
+		assert((reinterpret_cast<std::byte *>(slice) - &buffer.front()) % slice_size == 0);
 
 		/* destruct the object */
 		value->~T();
 
-		/* insert the slice in the "available" linked list */
-		slice->next = available;
-		available = slice;
-		--n_allocated;
+		/* insert the slice in the "available" stack; this must
+		   happen before decrementing n_allocated, because
+		   Pop() relies on a slice being available after
+		   Reserve() has succeeded */
+		Push(*slice);
 
 		/* give memory back to the kernel when the last slice
 		   was freed */
-		if (n_allocated == 0) {
+		if (n_allocated.fetch_sub(1, std::memory_order_release) == 1)
 			DiscardMemory();
+	}
+
+private:
+	Slice &GetSlice(uint32_t i) noexcept {
+		assert(i < capacity);
+
+		return *reinterpret_cast<Slice *>(&buffer.front() + i * slice_size);
+	}
+
+	uint32_t GetSliceIndex(const Slice &slice) const noexcept {
+		return (reinterpret_cast<const std::byte *>(&slice) - &buffer.front()) / slice_size;
+	}
+
+	static constexpr uint32_t GetIndex(uint64_t head) noexcept {
+		return static_cast<uint32_t>(head);
+	}
+
+	static constexpr uint64_t MakeHead(uint32_t index,
+					   uint64_t old_head) noexcept {
+		return ((old_head >> 32) + 1) << 32 | index;
+	}
+
+	/**
+	 * Reserve one slice by incrementing #n_allocated.
+	 *
+	 * @return false if the buffer is full
+	 */
+	bool Reserve() noexcept {
+		unsigned n = n_allocated.load(std::memory_order_relaxed);
+		while (true) {
+			if (n & DISCARDING) {
+				/* DiscardMemory() is running in another
+				   thread; this is rare and
+				   short */
+				std::this_thread::yield();
+				n = n_allocated.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			if (n >= capacity)
+				return false;
+
+			if (n_allocated.compare_exchange_weak(n, n + 1,
+							      std::memory_order_acquire,
+							      std::memory_order_relaxed))
+				break;
 		}
+
+		unsigned hw = high_water.load(std::memory_order_relaxed);
+		while (n + 1 > hw &&
+		       !high_water.compare_exchange_weak(hw, n + 1,
+							 std::memory_order_relaxed))
+		{}
+
+		return true;
+	}
+
+	/**
+	 * Obtain a free slice.  Reserve() must have been called
+	 * successfully before.
+	 */
+	Slice &Pop() noexcept {
+		while (true) {
+			uint64_t head = available.load(std::memory_order_acquire);
+			while (GetIndex(head) != NONE) {
+				Slice &slice = GetSlice(GetIndex(head));
+
+				/* if another thread has popped this
+				   slice meanwhile, this value may be
+				   garbage, but then the following
+				   compare_exchange fails because the
+				   counter in the head has changed */
+				const uint32_t next = slice.next.load(std::memory_order_relaxed);
+
+				if (available.compare_exchange_weak(head,
+								    MakeHead(next, head),
+								    std::memory_order_acquire,
+								    std::memory_order_acquire))
+					return slice;
+			}
+
+			/* the stack is empty: initialize a new slice */
+			unsigned i = n_initialized.load(std::memory_order_relaxed);
+			while (i < capacity)
+				if (n_initialized.compare_exchange_weak(i, i + 1,
+									std::memory_order_relaxed))
+					return GetSlice(i);
+
+			/* all slices are initialized, and the one we
+			   reserved is still being pushed by another
+			   thread's Free() call; try again */
+		}
+	}
+
+	void Push(Slice &slice) noexcept {
+		const uint32_t index = GetSliceIndex(slice);
+		std::construct_at(&slice.next, NONE);
+
+		uint64_t head = available.load(std::memory_order_relaxed);
+		do {
+			slice.next.store(GetIndex(head), std::memory_order_relaxed);
+		} while (!available.compare_exchange_weak(head,
+							  MakeHead(index, head),
+							  std::memory_order_release,
+							  std::memory_order_relaxed));
+	}
+
+	/**
+	 * Give all memory back to the kernel if no slice is
+	 * allocated.  Allocate() calls are blocked meanwhile.
+	 */
+	void DiscardMemory() noexcept {
+		unsigned expected = 0;
+		if (!n_allocated.compare_exchange_strong(expected, DISCARDING,
+							 std::memory_order_acquire,
+							 std::memory_order_relaxed))
+			/* a slice was allocated meanwhile, or
+			   another thread is already discarding */
+			return;
+
+		n_initialized.store(0, std::memory_order_relaxed);
+		available.store(MakeHead(NONE, available.load(std::memory_order_relaxed)),
+				std::memory_order_relaxed);
+		buffer.Discard();
+
+		n_allocated.store(0, std::memory_order_release);
 	}
 };
 
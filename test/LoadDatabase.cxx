@@ -3,8 +3,10 @@
 
 #include "config.h"
 #include "db/plugins/simple/DatabaseSave.hxx"
+#include "db/plugins/simple/BinarySave.hxx"
 #include "db/plugins/simple/Directory.hxx"
 #include "lib/zlib/AutoGunzipFileLineReader.hxx"
+#include "io/MappedFile.hxx"
 #include "fs/Path.hxx"
 #include "fs/NarrowPath.hxx"
 #include "util/PrintException.hxx"
@@ -20,8 +22,14 @@ try {
 	const FromNarrowPath db_path = argv[1];
 
 	Directory root{{}, nullptr};
-	AutoGunzipFileLineReader line_reader{db_path};
-	db_load_internal(line_reader, root, true);
+
+	const MappedFile mapped{db_path};
+	if (db_is_binary(mapped.GetData())) {
+		db_load_binary(mapped.GetData(), root, true);
+	} else {
+		AutoGunzipFileLineReader line_reader{db_path};
+		db_load_internal(line_reader, root, true);
+	}
 
 	return EXIT_SUCCESS;
 } catch (...) {
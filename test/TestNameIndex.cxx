@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "db/plugins/simple/NameIndex.hxx"
+
+#include <gtest/gtest.h>
+
+#include <list>
+#include <string>
+
+#include <fmt/format.h>
+
+struct Item {
+	std::string name;
+};
+
+struct GetItemName {
+	std::string_view operator()(const Item &item) const noexcept {
+		return item.name;
+	}
+};
+
+using Index = NameIndex<Item, GetItemName>;
+
+struct IndexedList {
+	std::list<Item> list;
+	Index index;
+
+	Item &Add(std::string name) {
+		auto &item = list.emplace_back(std::move(name));
+		index.Add(item, list);
+		return item;
+	}
+
+	void Remove(std::string_view name) {
+		for (auto i = list.begin(); i != list.end(); ++i) {
+			if (i->name == name) {
+				/* the item must be unlinked, but still
+				   alive */
+				std::list<Item> removed;
+				removed.splice(removed.end(), list, i);
+				index.Remove(removed.front(), list);
+				return;
+			}
+		}
+	}
+
+	/**
+	 * Look up with the index if enabled, or else with a linear
+	 * scan (like #Directory does).
+	 */
+	const Item *Find(std::string_view name) const noexcept {
+		if (index.IsEnabled())
+			return index.Find(name);
+
+		for (const auto &i : list)
+			if (i.name == name)
+				return &i;
+		return nullptr;
+	}
+};
+
+static std::string
+MakeName(unsigned i)
+{
+	return fmt::format("song{}.flac", i);
+}
+
+TEST(NameIndex, Threshold)
+{
+	IndexedList l;
+
+	for (unsigned i = 0; i < Index::THRESHOLD; ++i)
+		l.Add(MakeName(i));
+
+	EXPECT_FALSE(l.index.IsEnabled());
+
+	l.Add(MakeName(Index::THRESHOLD));
+	EXPECT_TRUE(l.index.IsEnabled());
+
+	for (unsigned i = 0; i <= Index::THRESHOLD; ++i) {
+		const auto *item = l.Find(MakeName(i));
+		ASSERT_NE(item, nullptr);
+		EXPECT_EQ(item->name, MakeName(i));
+	}
+
+	EXPECT_EQ(l.Find("foo"), nullptr);
+}
+
+TEST(NameIndex, AddRemove)
+{
+	IndexedList l;
+
+	for (unsigned i = 0; i < 100; ++i)
+		l.Add(MakeName(i));
+
+	ASSERT_TRUE(l.index.IsEnabled());
+
+	/* remove every other item */
+	for (unsigned i = 0; i < 100; i += 2)
+		l.Remove(MakeName(i));
+
+	for (unsigned i = 0; i < 100; ++i) {
+		const auto *item = l.Find(MakeName(i));
+		if (i % 2 == 0) {
+			EXPECT_EQ(item, nullptr);
+		} else {
+			ASSERT_NE(item, nullptr);
+			EXPECT_EQ(item->name, MakeName(i));
+		}
+	}
+
+	/* add them again */
+	for (unsigned i = 0; i < 100; i += 2)
+		l.Add(MakeName(i));
+
+	for (unsigned i = 0; i < 100; ++i)
+		EXPECT_NE(l.Find(MakeName(i)), nullptr);
+
+	/* remove everything; the index is discarded when the list
+	   becomes empty */
+	for (unsigned i = 0; i < 100; ++i)
+		l.Remove(MakeName(i));
+
+	EXPECT_TRUE(l.list.empty());
+	EXPECT_FALSE(l.index.IsEnabled());
+	EXPECT_EQ(l.Find(MakeName(1)), nullptr);
+}
+
+TEST(NameIndex, Duplicate)
+{
+	IndexedList l;
+
+	for (unsigned i = 0; i < 40; ++i)
+		l.Add(MakeName(i));
+
+	ASSERT_TRUE(l.index.IsEnabled());
+
+	/* a duplicate is hidden by the older item, like with a
+	   linear scan */
+	const auto &first = *l.Find(MakeName(5));
+	const auto &second = l.Add(MakeName(5));
+	EXPECT_EQ(l.Find(MakeName(5)), &first);
+
+	/* removing the older one reveals the duplicate */
+	l.Remove(MakeName(5));
+	EXPECT_EQ(l.Find(MakeName(5)), &second);
+
+	l.Remove(MakeName(5));
+	EXPECT_EQ(l.Find(MakeName(5)), nullptr);
+
+	/* a duplicate which was added before the index was built */
+	IndexedList l2;
+	const auto &a = l2.Add("x");
+	const auto &b = l2.Add("x");
+	for (unsigned i = 0; i < 40; ++i)
+		l2.Add(MakeName(i));
+
+	ASSERT_TRUE(l2.index.IsEnabled());
+	EXPECT_EQ(l2.Find("x"), &a);
+	l2.Remove("x");
+	EXPECT_EQ(l2.Find("x"), &b);
+}
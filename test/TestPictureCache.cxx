@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "PictureCache.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using std::chrono::system_clock;
+
+static std::shared_ptr<const CachedPicture>
+MakePicture(std::size_t size, const char *mime_type="image/png")
+{
+	auto picture = std::make_shared<CachedPicture>();
+	picture->mime_type = mime_type;
+	picture->data.ResizeDiscard(size);
+	std::fill(picture->data.begin(), picture->data.end(), std::byte{0x42});
+	return picture;
+}
+
+static PictureCacheConfig
+MakeConfig(std::size_t size, std::size_t max_item_size)
+{
+	PictureCacheConfig config;
+	config.size = size;
+	config.max_item_size = max_item_size;
+	return config;
+}
+
+TEST(PictureCache, Basic)
+{
+	PictureCache cache{MakeConfig(1024 * 1024, 64 * 1024)};
+
+	const auto mtime = system_clock::now();
+	unsigned n_loads = 0;
+
+	auto a = cache.Get({"foo", mtime}, [&]{
+		++n_loads;
+		return MakePicture(1000);
+	});
+	ASSERT_TRUE(a);
+	EXPECT_EQ(a->data.size(), 1000U);
+	EXPECT_EQ(n_loads, 1U);
+
+	/* cache hit */
+	auto b = cache.Get({"foo", mtime}, [&]{
+		++n_loads;
+		return MakePicture(1000);
+	});
+	EXPECT_EQ(b, a);
+	EXPECT_EQ(n_loads, 1U);
+
+	/* different modification time: cache miss */
+	auto c = cache.Get({"foo", mtime + std::chrono::seconds{1}}, [&]{
+		++n_loads;
+		return MakePicture(2000);
+	});
+	ASSERT_TRUE(c);
+	EXPECT_NE(c, a);
+	EXPECT_EQ(n_loads, 2U);
+
+	/* "no picture" is cached, too */
+	auto d = cache.Get({"bar", mtime}, [&]{
+		++n_loads;
+		return nullptr;
+	});
+	EXPECT_FALSE(d);
+	d = cache.Get({"bar", mtime}, [&]{
+		++n_loads;
+		return nullptr;
+	});
+	EXPECT_FALSE(d);
+	EXPECT_EQ(n_loads, 3U);
+
+	auto stats = cache.GetStats();
+	EXPECT_EQ(stats.n_items, 3U);
+	EXPECT_GT(stats.n_bytes, 3000U);
+	EXPECT_EQ(stats.n_hits, 2U);
+	EXPECT_EQ(stats.n_misses, 3U);
+
+	cache.Flush();
+	stats = cache.GetStats();
+	EXPECT_EQ(stats.n_items, 0U);
+	EXPECT_EQ(stats.n_bytes, 0U);
+
+	/* the picture is still valid after it was evicted */
+	EXPECT_EQ(a->data.size(), 1000U);
+}
+
+TEST(PictureCache, MaxItemSize)
+{
+	PictureCache cache{MakeConfig(1024 * 1024, 1000)};
+
+	const auto mtime = system_clock::now();
+	unsigned n_loads = 0;
+
+	for (unsigned i = 0; i < 2; ++i) {
+		auto a = cache.Get({"foo", mtime}, [&]{
+			++n_loads;
+			return MakePicture(1001);
+		});
+		ASSERT_TRUE(a);
+	}
+
+	/* too large, wasn't cached */
+	EXPECT_EQ(n_loads, 2U);
+	EXPECT_EQ(cache.GetStats().n_items, 0U);
+}
+
+TEST(PictureCache, Evict)
+{
+	PictureCache cache{MakeConfig(10000, 4000)};
+
+	const auto mtime = system_clock::now();
+	unsigned n_loads = 0;
+	const auto load = [&]{
+		++n_loads;
+		return MakePicture(3000);
+	};
+
+	cache.Get({"a", mtime}, load);
+	cache.Get({"b", mtime}, load);
+	cache.Get({"c", mtime}, load);
+	EXPECT_EQ(n_loads, 3U);
+
+	/* refresh "a" */
+	cache.Get({"a", mtime}, load);
+	EXPECT_EQ(n_loads, 3U);
+
+	/* evicts the least recently used item "b" */
+	cache.Get({"d", mtime}, load);
+	EXPECT_EQ(n_loads, 4U);
+	EXPECT_LE(cache.GetStats().n_bytes, 10000U);
+
+	cache.Get({"a", mtime}, load);
+	EXPECT_EQ(n_loads, 4U);
+
+	cache.Get({"b", mtime}, load);
+	EXPECT_EQ(n_loads, 5U);
+}
@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "encoder/Shared.hxx"
+#include "encoder/EncoderInterface.hxx"
+#include "encoder/EncoderPlugin.hxx"
+#include "config/Block.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "tag/Tag.hxx"
+#include "util/SpanCast.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+/**
+ * The number of Encoder::Write() calls on all #FakeEncoder
+ * instances.
+ */
+static unsigned n_writes;
+
+/**
+ * An #Encoder which "encodes" by copying the input and appending
+ * markers for all other calls.
+ */
+class FakeEncoder final : public Encoder {
+	std::string buffer = "H";
+
+public:
+	FakeEncoder() noexcept:Encoder(true) {}
+
+	void End() override {
+		buffer.push_back('E');
+	}
+
+	void Flush() override {
+		buffer.push_back('F');
+	}
+
+	void PreTag() override {
+		buffer.push_back('P');
+	}
+
+	void SendTag(const Tag &) override {
+		buffer.push_back('T');
+	}
+
+	void Write(std::span<const std::byte> src) override {
+		++n_writes;
+		buffer.append(ToStringView(src));
+	}
+
+	std::span<const std::byte> Read(std::span<std::byte> dest) noexcept override {
+		const std::size_t n = std::min(dest.size(), buffer.size());
+		std::copy_n(AsBytes(buffer).begin(), n, dest.begin());
+		buffer.erase(0, n);
+		return dest.first(n);
+	}
+};
+
+class PreparedFakeEncoder final : public PreparedEncoder {
+	const std::string quality;
+
+public:
+	explicit PreparedFakeEncoder(const ConfigBlock &block) noexcept
+		:quality(block.GetBlockValue("quality", "")) {}
+
+	Encoder *Open(AudioFormat &) override {
+		return new FakeEncoder();
+	}
+};
+
+static PreparedEncoder *
+fake_encoder_init(const ConfigBlock &block)
+{
+	return new PreparedFakeEncoder(block);
+}
+
+static constexpr EncoderPlugin fake_encoder_plugin = {
+	"fake",
+	fake_encoder_init,
+};
+
+static std::unique_ptr<PreparedEncoder>
+MakePrepared(const char *quality="5")
+{
+	ConfigBlock block;
+	block.AddBlockParam("name", "foo");
+	block.AddBlockParam("share_encoder", "yes");
+	block.AddBlockParam("quality", quality);
+
+	return std::unique_ptr<PreparedEncoder>{CreateShareableEncoder(fake_encoder_plugin, block)};
+}
+
+static std::unique_ptr<Encoder>
+Open(PreparedEncoder &prepared)
+{
+	AudioFormat audio_format{44100, SampleFormat::S16, 2};
+	return std::unique_ptr<Encoder>{prepared.Open(audio_format)};
+}
+
+static std::string
+ReadAll(Encoder &encoder)
+{
+	std::string result;
+
+	std::byte buffer[3];
+	for (auto r = encoder.Read(buffer); !r.empty(); r = encoder.Read(buffer))
+		result.append(ToStringView(r));
+
+	return result;
+}
+
+static void
+Write(Encoder &encoder, std::string_view src)
+{
+	encoder.Write(AsBytes(src));
+}
+
+TEST(SharedEncoder, EncodeOnce)
+{
+	n_writes = 0;
+
+	auto p1 = MakePrepared(), p2 = MakePrepared();
+	auto e1 = Open(*p1), e2 = Open(*p2);
+	EXPECT_EQ(ReadAll(*e1), "H");
+	EXPECT_EQ(ReadAll(*e2), "H");
+
+	Write(*e1, "abc");
+	Write(*e2, "abc");
+	EXPECT_EQ(ReadAll(*e1), "abc");
+	EXPECT_EQ(ReadAll(*e2), "abc");
+
+	/* the second one may be ahead */
+	Write(*e2, "de");
+	Write(*e2, "fg");
+	EXPECT_EQ(ReadAll(*e2), "defg");
+	Write(*e1, "de");
+	Write(*e1, "fg");
+	EXPECT_EQ(ReadAll(*e1), "defg");
+
+	e1->PreTag();
+	e2->PreTag();
+	e1->SendTag(Tag{});
+	e2->SendTag(Tag{});
+	EXPECT_EQ(ReadAll(*e1), "PT");
+	EXPECT_EQ(ReadAll(*e2), "PT");
+
+	EXPECT_EQ(n_writes, 3U);
+}
+
+TEST(SharedEncoder, DifferentSettings)
+{
+	n_writes = 0;
+
+	auto p1 = MakePrepared("5"), p2 = MakePrepared("6");
+	auto e1 = Open(*p1), e2 = Open(*p2);
+
+	Write(*e1, "abc");
+	Write(*e2, "abc");
+	EXPECT_EQ(ReadAll(*e1), "Habc");
+	EXPECT_EQ(ReadAll(*e2), "Habc");
+
+	EXPECT_EQ(n_writes, 2U);
+}
+
+TEST(SharedEncoder, Soft)
+{
+	n_writes = 0;
+
+	auto p1 = MakePrepared(), p2 = MakePrepared();
+	auto e1 = Open(*p1), e2 = Open(*p2);
+	EXPECT_EQ(ReadAll(*e1), "H");
+	EXPECT_EQ(ReadAll(*e2), "H");
+
+	/* Flush() and silence are omitted or copied as needed */
+	Write(*e1, "abc");
+	e1->Flush();
+	Write(*e1, std::string_view{"\0\0", 2});
+	Write(*e1, "de");
+
+	Write(*e2, "abc");
+	e2->Flush();
+	e2->Flush();
+	Write(*e2, "de");
+	Write(*e2, std::string_view{"\0", 1});
+	Write(*e2, "fg");
+
+	Write(*e1, "fg");
+
+	EXPECT_EQ(ReadAll(*e1), std::string_view("abcF\0\0de\0fg", 11));
+	EXPECT_EQ(ReadAll(*e2), std::string_view("abcF\0\0de\0fg", 11));
+
+	EXPECT_EQ(n_writes, 5U);
+}
+
+TEST(SharedEncoder, Diverge)
+{
+	n_writes = 0;
+
+	auto p1 = MakePrepared(), p2 = MakePrepared();
+	auto e1 = Open(*p1), e2 = Open(*p2);
+	EXPECT_EQ(ReadAll(*e1), "H");
+	EXPECT_EQ(ReadAll(*e2), "H");
+
+	Write(*e1, "abc");
+	Write(*e1, "de");
+	Write(*e2, "abc");
+	Write(*e2, "xy");
+	Write(*e2, "z");
+
+	/* the second one gets the shared "abc" and then switches to
+	   a private encoder */
+	EXPECT_EQ(ReadAll(*e1), "abcde");
+	EXPECT_EQ(ReadAll(*e2), "abcHxyz");
+
+	EXPECT_EQ(n_writes, 4U);
+}
+
+TEST(SharedEncoder, Join)
+{
+	n_writes = 0;
+
+	auto p1 = MakePrepared(), p2 = MakePrepared();
+	auto e1 = Open(*p1);
+	EXPECT_EQ(ReadAll(*e1), "H");
+	Write(*e1, "abc");
+	Write(*e1, "de");
+	EXPECT_EQ(ReadAll(*e1), "abcde");
+
+	/* the second one is opened later, but is a bit behind */
+	auto e2 = Open(*p2);
+	EXPECT_EQ(ReadAll(*e2), "H");
+	Write(*e2, "de");
+	Write(*e2, "fg");
+	Write(*e1, "fg");
+	EXPECT_EQ(ReadAll(*e1), "fg");
+	EXPECT_EQ(ReadAll(*e2), "defg");
+
+	EXPECT_EQ(n_writes, 3U);
+}
+
+TEST(SharedEncoder, End)
+{
+	n_writes = 0;
+
+	auto p1 = MakePrepared(), p2 = MakePrepared();
+	auto e1 = Open(*p1), e2 = Open(*p2);
+
+	Write(*e1, "abc");
+	Write(*e2, "abc");
+
+	/* ending one of them does not end the shared encoder */
+	e1->End();
+	EXPECT_EQ(ReadAll(*e1), "Habc");
+	e1.reset();
+
+	Write(*e2, "de");
+	e2->End();
+	EXPECT_EQ(ReadAll(*e2), "HabcdeE");
+	e2.reset();
+
+	/* now a new group is created */
+	auto e3 = Open(*p1);
+	EXPECT_EQ(ReadAll(*e3), "H");
+}
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "output/plugins/httpd/StreamRing.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+static std::span<const std::byte>
+AsBytes(std::string_view s) noexcept
+{
+	return {(const std::byte *)s.data(), s.size()};
+}
+
+/**
+ * Read all data from the given position.
+ */
+static std::string
+ReadAll(const StreamRing &ring, StreamRing::Position position)
+{
+	std::string result;
+
+	while (position < ring.GetHead()) {
+		const auto chunk = ring.Read(position);
+		EXPECT_FALSE(chunk.empty());
+		result.append((const char *)chunk.data(), chunk.size());
+		position += chunk.size();
+	}
+
+	return result;
+}
+
+TEST(StreamRing, Basic)
+{
+	StreamRing ring(8);
+	EXPECT_EQ(ring.GetTail(), 0U);
+	EXPECT_EQ(ring.GetHead(), 0U);
+	EXPECT_TRUE(ring.IsValid(0));
+	EXPECT_TRUE(ring.Read(0).empty());
+
+	ring.Append(AsBytes("abc"));
+	EXPECT_EQ(ring.GetTail(), 0U);
+	EXPECT_EQ(ring.GetHead(), 3U);
+	EXPECT_EQ(ReadAll(ring, 0), "abc");
+	EXPECT_EQ(ReadAll(ring, 1), "bc");
+	EXPECT_FALSE(ring.IsValid(4));
+
+	ring.Clear();
+	EXPECT_EQ(ring.GetTail(), 3U);
+	EXPECT_FALSE(ring.IsValid(0));
+	EXPECT_TRUE(ring.IsValid(3));
+}
+
+TEST(StreamRing, Wrap)
+{
+	StreamRing ring(8);
+
+	ring.Append(AsBytes("abcdef"));
+	ring.Append(AsBytes("ghij"));
+
+	/* "ab" has been overwritten */
+	EXPECT_EQ(ring.GetTail(), 2U);
+	EXPECT_EQ(ring.GetHead(), 10U);
+	EXPECT_FALSE(ring.IsValid(1));
+	EXPECT_TRUE(ring.IsValid(2));
+
+	/* the data wraps around: two chunks */
+	EXPECT_EQ(ring.Read(2).size(), 6U);
+	EXPECT_EQ(ReadAll(ring, 2), "cdefghij");
+	EXPECT_EQ(ReadAll(ring, 7), "hij");
+}
+
+TEST(StreamRing, Oversized)
+{
+	StreamRing ring(4);
+
+	ring.Append(AsBytes("abcdefghij"));
+	EXPECT_EQ(ring.GetTail(), 6U);
+	EXPECT_EQ(ring.GetHead(), 10U);
+	EXPECT_EQ(ReadAll(ring, 6), "ghij");
+}
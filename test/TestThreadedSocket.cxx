@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "event/ThreadedSocket.hxx"
+#include "event/Loop.hxx"
+#include "event/Thread.hxx"
+#include "net/SocketDescriptor.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <utility> // for std::exchange()
+
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * Echoes each received line.
+ */
+class EchoSocket final : public ThreadedSocket {
+	EventLoop &owner;
+
+public:
+	unsigned n_lines = 0;
+	bool closed = false;
+
+	EchoSocket(SocketDescriptor fd, EventLoop &_loop,
+		   EventLoop &io_loop) noexcept
+		:ThreadedSocket(fd, _loop, io_loop, 65536),
+		 owner(_loop) {}
+
+protected:
+	InputResult OnSocketInput(std::span<std::byte> src) noexcept override {
+		const char *p = (const char *)src.data();
+		const char *newline = (const char *)memchr(p, '\n', src.size());
+		if (newline == nullptr)
+			return InputResult::MORE;
+
+		const std::size_t length = newline + 1 - p;
+		ConsumeInput(length);
+		Write(p, length);
+		++n_lines;
+		return InputResult::AGAIN;
+	}
+
+	void OnSocketError(std::exception_ptr) noexcept override {
+		OnSocketClosed();
+	}
+
+	void OnSocketClosed() noexcept override {
+		closed = true;
+		Close();
+		owner.Break();
+	}
+};
+
+/**
+ * Pauses input after the first line and then lets the peer hang up.
+ */
+class PausingSocket final : public ThreadedSocket {
+	EventLoop &owner;
+
+	int peer_fd;
+
+public:
+	unsigned n_lines = 0;
+	bool closed = false;
+
+	PausingSocket(SocketDescriptor fd, EventLoop &_loop,
+		      EventLoop &io_loop, int _peer_fd) noexcept
+		:ThreadedSocket(fd, _loop, io_loop, 65536),
+		 owner(_loop), peer_fd(_peer_fd) {}
+
+protected:
+	InputResult OnSocketInput(std::span<std::byte> src) noexcept override {
+		const char *p = (const char *)src.data();
+		const char *newline = (const char *)memchr(p, '\n', src.size());
+		if (newline == nullptr)
+			return InputResult::MORE;
+
+		ConsumeInput(newline + 1 - p);
+		++n_lines;
+
+		if (peer_fd >= 0)
+			close(std::exchange(peer_fd, -1));
+
+		return InputResult::PAUSE;
+	}
+
+	void OnSocketError(std::exception_ptr) noexcept override {
+		OnSocketClosed();
+	}
+
+	void OnSocketClosed() noexcept override {
+		closed = true;
+		Close();
+		owner.Break();
+	}
+};
+
+} // anonymous namespace
+
+static void
+RunEcho(bool threaded)
+{
+	static constexpr unsigned N = 20000;
+
+	int fds[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+	const SocketDescriptor fd(fds[0]);
+	fd.SetNonBlocking();
+
+	EventLoop loop;
+	EventThread io_thread;
+	io_thread.Start();
+
+	EchoSocket socket(fd, loop,
+			  threaded ? io_thread.GetEventLoop() : loop);
+
+	std::string request;
+	for (unsigned i = 0; i < N; ++i)
+		request += "line " + std::to_string(i) + "\n";
+
+	std::string response;
+
+	std::thread peer([&]{
+		std::thread writer([&]{
+			/* send in odd-sized portions to split
+			   lines */
+			for (std::size_t position = 0;
+			     position < request.size();) {
+				const auto nbytes =
+					write(fds[1], request.data() + position,
+					      std::min<std::size_t>(777, request.size() - position));
+				if (nbytes <= 0)
+					break;
+				position += nbytes;
+			}
+		});
+
+		char buffer[4096];
+		while (response.size() < request.size()) {
+			const auto nbytes = read(fds[1], buffer, sizeof(buffer));
+			if (nbytes <= 0)
+				break;
+			response.append(buffer, nbytes);
+		}
+
+		writer.join();
+		close(fds[1]);
+	});
+
+	loop.Run();
+	peer.join();
+
+	EXPECT_EQ(response, request);
+	EXPECT_EQ(socket.n_lines, N);
+	EXPECT_TRUE(socket.closed);
+}
+
+TEST(ThreadedSocket, Direct)
+{
+	RunEcho(false);
+}
+
+TEST(ThreadedSocket, Threaded)
+{
+	RunEcho(true);
+}
+
+/**
+ * A hangup must be reported even if the owner has paused input
+ * (e.g. while a client's command is running in a worker thread).
+ */
+static void
+RunHangupWhilePaused(bool threaded)
+{
+	int fds[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+	const SocketDescriptor fd(fds[0]);
+	fd.SetNonBlocking();
+
+	EventLoop loop;
+	EventThread io_thread;
+	io_thread.Start();
+
+	static constexpr char request[] = "first\nsecond\n";
+	ASSERT_EQ(write(fds[1], request, sizeof(request) - 1),
+		  ssize_t(sizeof(request) - 1));
+
+	PausingSocket socket(fd, loop,
+			     threaded ? io_thread.GetEventLoop() : loop,
+			     fds[1]);
+
+	loop.Run();
+
+	EXPECT_EQ(socket.n_lines, 1U);
+	EXPECT_TRUE(socket.closed);
+}
+
+TEST(ThreadedSocket, HangupWhilePausedDirect)
+{
+	RunHangupWhilePaused(false);
+}
+
+TEST(ThreadedSocket, HangupWhilePausedThreaded)
+{
+	RunHangupWhilePaused(true);
+}
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * This program measures the cost of broadcasting encoded data to
+ * many local httpd listeners: the old per-client page queues (one
+ * send() per page and client) versus the #StreamRing shared by all
+ * clients (one sendmsg() per client).
+ */
+
+#include "output/plugins/httpd/Page.hxx"
+#include "output/plugins/httpd/StreamRing.hxx"
+#include "net/SocketDescriptor.hxx"
+
+#include <chrono>
+#include <list>
+#include <queue>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using std::chrono::steady_clock;
+
+/**
+ * The size of each encoder flush.
+ */
+static constexpr std::size_t PAGE_SIZE = 4096;
+
+/**
+ * The number of encoder flushes between two IOThread wakeups.
+ */
+static constexpr unsigned PAGES_PER_ROUND = 4;
+
+static constexpr unsigned N_ROUNDS = 100;
+
+struct Listener {
+	SocketDescriptor server, peer;
+
+	std::queue<PagePtr, std::list<PagePtr>> pages;
+
+	StreamRing::Position position = 0;
+};
+
+static void
+Drain(std::vector<Listener> &listeners) noexcept
+{
+	static std::byte buffer[65536];
+
+	for (auto &l : listeners)
+		while (l.peer.ReadNoWait(buffer) > 0) {}
+}
+
+static steady_clock::duration
+RunQueue(std::vector<Listener> &listeners, std::span<const std::byte> data)
+{
+	steady_clock::duration duration{};
+
+	for (unsigned round = 0; round < N_ROUNDS; ++round) {
+		const auto start = steady_clock::now();
+
+		for (unsigned i = 0; i < PAGES_PER_ROUND; ++i) {
+			auto page = std::make_shared<Page>(data);
+			for (auto &l : listeners)
+				l.pages.push(page);
+		}
+
+		for (auto &l : listeners) {
+			while (!l.pages.empty()) {
+				const auto &page = *l.pages.front();
+				if (l.server.WriteNoWait(page) < 0)
+					break;
+				l.pages.pop();
+			}
+		}
+
+		duration += steady_clock::now() - start;
+
+		Drain(listeners);
+	}
+
+	return duration;
+}
+
+static steady_clock::duration
+RunRing(std::vector<Listener> &listeners, std::span<const std::byte> data)
+{
+	StreamRing ring(256 * 1024);
+
+	steady_clock::duration duration{};
+
+	for (unsigned round = 0; round < N_ROUNDS; ++round) {
+		const auto start = steady_clock::now();
+
+		for (unsigned i = 0; i < PAGES_PER_ROUND; ++i)
+			ring.Append(data);
+
+		for (auto &l : listeners) {
+			if (!ring.IsValid(l.position))
+				l.position = ring.GetTail();
+
+			struct iovec v[2];
+			std::size_t n = 0;
+
+			for (auto p = l.position; n < 2 && p < ring.GetHead();) {
+				const auto chunk = ring.Read(p);
+				v[n++] = {
+					.iov_base = const_cast<std::byte *>(chunk.data()),
+					.iov_len = chunk.size(),
+				};
+				p += chunk.size();
+			}
+
+			const auto nbytes =
+				l.server.Send(std::span{v, n}, MSG_DONTWAIT);
+			if (nbytes > 0)
+				l.position += nbytes;
+		}
+
+		duration += steady_clock::now() - start;
+
+		Drain(listeners);
+	}
+
+	return duration;
+}
+
+static void
+Report(unsigned n_listeners, const char *name,
+       steady_clock::duration duration) noexcept
+{
+	const double us =
+		std::chrono::duration<double, std::micro>(duration).count();
+	printf("%6u %-6s %10.1f ms %10.3f us/listener/round\n",
+	       n_listeners, name, us / 1000,
+	       us / n_listeners / N_ROUNDS);
+}
+
+int
+main(int, char **) noexcept
+{
+	static constexpr std::byte data[PAGE_SIZE]{};
+
+	for (unsigned n_listeners : {100U, 1000U, 4000U}) {
+		std::vector<Listener> listeners(n_listeners);
+		for (auto &l : listeners) {
+			int fds[2];
+			if (socketpair(AF_LOCAL, SOCK_STREAM, 0, fds) < 0) {
+				perror("socketpair() failed");
+				return EXIT_FAILURE;
+			}
+
+			l.server = SocketDescriptor{fds[0]};
+			l.peer = SocketDescriptor{fds[1]};
+		}
+
+		Report(n_listeners, "queue", RunQueue(listeners, data));
+		Report(n_listeners, "ring", RunRing(listeners, data));
+
+		for (auto &l : listeners) {
+			l.server.Close();
+			l.peer.Close();
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * This program measures how fast #MusicChunk objects can be passed
+ * from a producer thread (the decoder) through a #MusicPipe to a
+ * consumer thread (the player/output) for various chunk sizes.  It
+ * prints the throughput in chunks per second and the CPU time
+ * consumed by the process.
+ */
+
+#include "MusicBuffer.hxx"
+#include "MusicPipe.hxx"
+#include "MusicChunk.hxx"
+#include "pcm/AudioParser.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "util/PrintException.hxx"
+#include "util/StringBuffer.hxx"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+using std::chrono::steady_clock;
+
+static constexpr std::size_t BUFFER_SIZE = 4 * 1024 * 1024;
+
+static std::chrono::microseconds
+GetCpuTime() noexcept
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	using std::chrono::seconds;
+	using std::chrono::microseconds;
+	return seconds{usage.ru_utime.tv_sec + usage.ru_stime.tv_sec} +
+		microseconds{usage.ru_utime.tv_usec + usage.ru_stime.tv_usec};
+}
+
+/**
+ * Wakes up the producer when the consumer has freed a chunk, and
+ * the consumer when the producer has pushed one.
+ */
+struct Throttle {
+	Mutex mutex;
+	Cond cond;
+	bool producer_waiting = false, consumer_waiting = false;
+	bool finished = false;
+};
+
+static void
+Produce(MusicBuffer &buffer, MusicPipe &pipe, Throttle &throttle,
+	const AudioFormat audio_format, std::size_t total_bytes) noexcept
+{
+	while (total_bytes > 0) {
+		auto chunk = buffer.Allocate();
+		if (!chunk) {
+			std::unique_lock lock{throttle.mutex};
+			throttle.producer_waiting = true;
+			throttle.cond.wait(lock, [&]{
+				return !throttle.producer_waiting ||
+					!buffer.IsFull();
+			});
+			throttle.producer_waiting = false;
+			continue;
+		}
+
+		while (total_bytes > 0) {
+			auto w = chunk->Write(audio_format, SongTime::zero(), 0);
+			if (w.empty())
+				break;
+
+			const std::size_t nbytes = std::min(w.size(), total_bytes);
+			std::memset(w.data(), 0x55, nbytes);
+			total_bytes -= nbytes;
+
+			if (chunk->Expand(audio_format, nbytes))
+				break;
+		}
+
+		pipe.Push(std::move(chunk));
+
+		const std::scoped_lock lock{throttle.mutex};
+		if (throttle.consumer_waiting) {
+			throttle.consumer_waiting = false;
+			throttle.cond.notify_all();
+		}
+	}
+
+	const std::scoped_lock lock{throttle.mutex};
+	throttle.finished = true;
+	throttle.cond.notify_all();
+}
+
+static std::size_t
+Consume(MusicPipe &pipe, Throttle &throttle) noexcept
+{
+	std::size_t n_chunks = 0;
+	unsigned checksum = 0;
+
+	while (true) {
+		auto chunk = pipe.Shift();
+		if (!chunk) {
+			std::unique_lock lock{throttle.mutex};
+			if (throttle.finished && pipe.IsEmpty())
+				break;
+
+			throttle.consumer_waiting = true;
+			throttle.cond.wait(lock, [&]{
+				return !throttle.consumer_waiting ||
+					throttle.finished || !pipe.IsEmpty();
+			});
+			throttle.consumer_waiting = false;
+			continue;
+		}
+
+		/* touch the data like an output would */
+		for (const auto b : chunk->ReadData())
+			checksum += static_cast<unsigned>(b);
+
+		chunk.reset();
+		++n_chunks;
+
+		const std::scoped_lock lock{throttle.mutex};
+		if (throttle.producer_waiting) {
+			throttle.producer_waiting = false;
+			throttle.cond.notify_all();
+		}
+	}
+
+	/* prevent the compiler from optimizing the loop away */
+	if (checksum == 42)
+		fputc(' ', stderr);
+
+	return n_chunks;
+}
+
+static void
+Run(const AudioFormat audio_format, std::chrono::seconds duration,
+    std::size_t chunk_size)
+{
+	MusicBuffer buffer(BUFFER_SIZE / chunk_size, chunk_size);
+	MusicPipe pipe;
+	Throttle throttle;
+
+	const std::size_t total_bytes = audio_format.TimeToSize(duration);
+
+	const auto start_cpu = GetCpuTime();
+	const auto start_time = steady_clock::now();
+
+	std::thread producer{Produce, std::ref(buffer), std::ref(pipe),
+		std::ref(throttle), audio_format, total_bytes};
+	const std::size_t n_chunks = Consume(pipe, throttle);
+	producer.join();
+
+	const std::chrono::duration<double> elapsed =
+		steady_clock::now() - start_time;
+	const std::chrono::duration<double> cpu =
+		GetCpuTime() - start_cpu;
+
+	printf("%6zu bytes: %8zu chunks, %10.0f chunks/s, %8.1f MB/s, %7.3f s CPU (%.1f%%)\n",
+	       chunk_size, n_chunks,
+	       n_chunks / elapsed.count(),
+	       total_bytes / elapsed.count() / (1024 * 1024),
+	       cpu.count(), 100 * cpu.count() / elapsed.count());
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc > 3) {
+		fprintf(stderr, "Usage: bench_music_pipe [FORMAT [SECONDS]]\n");
+		return EXIT_FAILURE;
+	}
+
+	AudioFormat audio_format(384000, SampleFormat::S32, 8);
+	if (argc > 1)
+		audio_format = ParseAudioFormat(argv[1], false);
+
+	std::chrono::seconds duration{60};
+	if (argc > 2)
+		duration = std::chrono::seconds{strtoul(argv[2], nullptr, 10)};
+
+	printf("%s, %lld seconds of audio\n",
+	       ToString(audio_format).c_str(),
+	       (long long)duration.count());
+
+	for (std::size_t chunk_size = MIN_CHUNK_SIZE;
+	     chunk_size <= MAX_CHUNK_SIZE; chunk_size *= 2)
+		Run(audio_format, duration, chunk_size);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
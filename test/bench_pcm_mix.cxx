@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * This program compares the throughput of pcm_mix() (which uses SIMD
+ * instructions if available) with a plain portable implementation,
+ * and verifies that both produce the same samples where this is
+ * expected, i.e. in all code paths which do not apply dithering.
+ */
+
+#include "pcm/Mix.hxx"
+#include "pcm/Dither.hxx"
+#include "pcm/Volume.hxx"
+#include "pcm/Traits.hxx"
+#include "pcm/Clamp.hxx"
+#include "util/Clamp.hxx"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include "pcm/X86Simd.hxx"
+#endif
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using std::chrono::steady_clock;
+
+/**
+ * The number of samples in each buffer; not a multiple of the SIMD
+ * block size, to exercise the portable code for the remaining
+ * samples.
+ */
+static constexpr std::size_t N_SAMPLES = 64 * 1024 + 5;
+
+static constexpr std::chrono::milliseconds DURATION{500};
+
+/**
+ * The portion used for cross-fading, see pcm_mix().
+ */
+static constexpr float PORTION = 0.3f;
+
+/**
+ * Calculate the integer volume of the first buffer like pcm_mix()
+ * does.
+ */
+static int
+PortionToVolume(float portion1) noexcept
+{
+	float s = std::sin((float)M_PI_2 * portion1);
+	s *= s;
+
+	return Clamp<int>(lround(s * PCM_VOLUME_1S), 0, PCM_VOLUME_1S);
+}
+
+template<SampleFormat F, typename Traits=SampleTraits<F>>
+static void
+ReferenceAdd(typename Traits::pointer a, typename Traits::const_pointer b,
+	     std::size_t n) noexcept
+{
+	for (std::size_t i = 0; i != n; ++i)
+		a[i] = PcmClamp<F, Traits>(typename Traits::sum_type(a[i]) +
+					   typename Traits::sum_type(b[i]));
+}
+
+template<>
+void
+ReferenceAdd<SampleFormat::FLOAT>(float *a, const float *b,
+				  std::size_t n) noexcept
+{
+	for (std::size_t i = 0; i != n; ++i)
+		a[i] += b[i];
+}
+
+static void
+ReferenceMixFloat(float *a, const float *b, std::size_t n,
+		  float portion1) noexcept
+{
+	const int vol1 = PortionToVolume(portion1);
+	const float volume1 = pcm_volume_to_float(vol1);
+	const float volume2 = pcm_volume_to_float(PCM_VOLUME_1S - vol1);
+
+	for (std::size_t i = 0; i != n; ++i)
+		a[i] = a[i] * volume1 + b[i] * volume2;
+}
+
+template<typename T>
+static std::vector<T>
+RandomBuffer(std::mt19937 &rng, T min, T max) noexcept
+{
+	std::vector<T> result(N_SAMPLES);
+
+	if constexpr (std::is_floating_point_v<T>) {
+		std::uniform_real_distribution<T> d(min, max);
+		for (auto &i : result)
+			i = d(rng);
+	} else {
+		std::uniform_int_distribution<int64_t> d(min, max);
+		for (auto &i : result)
+			i = T(d(rng));
+	}
+
+	return result;
+}
+
+/**
+ * Invoke the given function repeatedly for #DURATION and return the
+ * throughput in megabytes (of the first buffer) per second.
+ */
+template<typename F>
+static double
+Measure(std::size_t size, F &&f)
+{
+	unsigned n = 0;
+	const auto start = steady_clock::now();
+	std::chrono::duration<double> elapsed;
+
+	do {
+		f();
+		++n;
+		elapsed = steady_clock::now() - start;
+	} while (elapsed < DURATION);
+
+	return double(size) * n / elapsed.count() / (1024 * 1024);
+}
+
+/**
+ * @param reference the portable implementation; nullptr if there is
+ * none because the result is dithered (and can therefore not be
+ * compared)
+ * @return false if the results differ
+ */
+template<typename T, typename R>
+static bool
+Run(const char *name, SampleFormat format, float portion1,
+    const std::vector<T> &src1, const std::vector<T> &src2,
+    R &&reference)
+{
+	const std::size_t size = src1.size() * sizeof(T);
+
+	std::vector<T> a = src1;
+	double reference_speed = 0;
+	if constexpr (!std::is_null_pointer_v<std::decay_t<R>>)
+		reference_speed = Measure(size, [&]{
+			std::memcpy(a.data(), src1.data(), size);
+			reference(a.data(), src2.data(), a.size());
+		});
+
+	std::vector<T> b = src1;
+	PcmDither dither;
+	const double mix_speed = Measure(size, [&]{
+		std::memcpy(b.data(), src1.data(), size);
+		if (!pcm_mix(dither, b.data(), src2.data(), size,
+			     format, portion1))
+			abort();
+	});
+
+	if constexpr (std::is_null_pointer_v<std::decay_t<R>>) {
+		printf("%-14s %10s   %8.1f MB/s %8s   (dithered)\n",
+		       name, "-", mix_speed, "-");
+		return true;
+	} else {
+		const bool exact = std::memcmp(a.data(), b.data(), size) == 0;
+		printf("%-14s %8.1f MB/s %8.1f MB/s %7.2fx  %s\n",
+		       name, reference_speed, mix_speed,
+		       mix_speed / reference_speed,
+		       exact ? "bit-exact" : "MISMATCH");
+		return exact;
+	}
+}
+
+template<SampleFormat F, typename Traits=SampleTraits<F>>
+static bool
+RunInteger(std::mt19937 &rng, const char *add_name, const char *mix_name)
+{
+	using T = typename Traits::value_type;
+	const auto src1 = RandomBuffer<T>(rng, Traits::MIN, Traits::MAX);
+	const auto src2 = RandomBuffer<T>(rng, Traits::MIN, Traits::MAX);
+
+	bool success = Run(add_name, F, -1, src1, src2, ReferenceAdd<F>);
+	success = Run(mix_name, F, PORTION, src1, src2, nullptr) && success;
+	return success;
+}
+
+int
+main(int, char **)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	const char *kernel_name = PcmX86GetKernelName();
+	printf("SIMD: %s\n", kernel_name != nullptr ? kernel_name : "none");
+#endif
+
+	printf("%-14s %13s %13s %8s\n",
+	       "", "portable", "pcm_mix", "speedup");
+
+	std::mt19937 rng;
+
+	bool success = RunInteger<SampleFormat::S8>(rng, "s8 add", "s8 mix");
+	success = RunInteger<SampleFormat::S16>(rng, "s16 add", "s16 mix") && success;
+	success = RunInteger<SampleFormat::S24_P32>(rng, "s24 add", "s24 mix") && success;
+	success = RunInteger<SampleFormat::S32>(rng, "s32 add", "s32 mix") && success;
+
+	const auto src1 = RandomBuffer<float>(rng, -1, 1);
+	const auto src2 = RandomBuffer<float>(rng, -1, 1);
+	success = Run("float add", SampleFormat::FLOAT, -1, src1, src2,
+		      ReferenceAdd<SampleFormat::FLOAT>) && success;
+	success = Run("float mix", SampleFormat::FLOAT, PORTION, src1, src2,
+		      [](float *a, const float *b, std::size_t n){
+			      ReferenceMixFloat(a, b, n, PORTION);
+		      }) && success;
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * This program measures how the #Queue scales with its length: it
+ * appends songs, moves and deletes them (in random mode, where the
+ * "order" list needs to be updated) and shuffles the queue.
+ */
+
+#include "queue/Queue.hxx"
+#include "song/DetachedSong.hxx"
+#include "song/LightSong.hxx"
+
+#include <chrono>
+#include <random>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using std::chrono::steady_clock;
+
+Tag::Tag(const Tag &) noexcept {}
+void Tag::Clear() noexcept {}
+
+DetachedSong::operator LightSong() const noexcept
+{
+	return {uri.c_str(), tag};
+}
+
+/**
+ * The number of single-song operations for each "move" and "delete"
+ * benchmark.
+ */
+static constexpr unsigned N_OPERATIONS = 1000;
+
+static void
+Report(unsigned length, const char *name, unsigned n,
+       steady_clock::duration duration) noexcept
+{
+	const double us =
+		std::chrono::duration<double, std::micro>(duration).count();
+	printf("%8u %-14s %10.1f ms %10.3f us/op\n",
+	       length, name, us / 1000, us / n);
+}
+
+template<typename F>
+static void
+Measure(unsigned length, const char *name, unsigned n, F &&f) noexcept
+{
+	const auto start = steady_clock::now();
+	f();
+	Report(length, name, n, steady_clock::now() - start);
+}
+
+static void
+Run(unsigned length) noexcept
+{
+	Queue queue(length);
+	queue.random = true;
+
+	std::mt19937 rng;
+	std::uniform_int_distribution<unsigned> d(0, length - 1);
+
+	Measure(length, "append", length, [&]{
+		for (unsigned i = 0; i < length; ++i) {
+			queue.Append(DetachedSong("foo.ogg"), 0);
+			queue.ShuffleOrderLastWithPriority(0, queue.GetLength());
+		}
+	});
+
+	Measure(length, "shuffle", 1, [&]{
+		queue.ShuffleOrder();
+	});
+
+	Measure(length, "position2order", length, [&]{
+		unsigned sum = 0;
+		for (unsigned i = 0; i < length; ++i)
+			sum += queue.PositionToOrder(i);
+		if (sum == 0)
+			fputs("?\n", stderr);
+	});
+
+	Measure(length, "move", N_OPERATIONS, [&]{
+		for (unsigned i = 0; i < N_OPERATIONS; ++i) {
+			const unsigned from = d(rng), to = d(rng);
+			queue.MovePostion(from, to);
+		}
+	});
+
+	Measure(length, "move range", N_OPERATIONS, [&]{
+		for (unsigned i = 0; i < N_OPERATIONS; ++i) {
+			const unsigned start = d(rng) % (length - 10);
+			queue.MoveRange(start, start + 10,
+					d(rng) % (length - 10));
+		}
+	});
+
+	Measure(length, "priority", N_OPERATIONS, [&]{
+		for (unsigned i = 0; i < N_OPERATIONS; ++i)
+			queue.SetPriority(d(rng), 1 + i % 8, -1);
+	});
+
+	Measure(length, "delete", N_OPERATIONS, [&]{
+		for (unsigned i = 0; i < N_OPERATIONS; ++i)
+			queue.DeletePosition(d(rng) % queue.GetLength());
+	});
+
+	Measure(length, "delete range", 1, [&]{
+		queue.DeleteRange(0, queue.GetLength() / 2);
+	});
+
+	Measure(length, "clear", 1, [&]{
+		queue.Clear();
+	});
+}
+
+int
+main(int, char **) noexcept
+{
+	for (unsigned length : {10000U, 100000U, 1000000U})
+		Run(length);
+
+	return EXIT_SUCCESS;
+}
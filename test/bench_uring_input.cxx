@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+/*
+ * This program measures the throughput of reading local files with
+ * the "file" input plugin (synchronous pread()) versus the io_uring
+ * input plugin (several asynchronous reads in flight).  Run it on
+ * files on a tmpfs (to measure the overhead) and on real disks (to
+ * measure latency hiding).
+ */
+
+#include "input/InputStream.hxx"
+#include "input/plugins/FileInputPlugin.hxx"
+#include "input/plugins/UringInputPlugin.hxx"
+#include "event/Thread.hxx"
+#include "thread/Mutex.hxx"
+#include "fs/Path.hxx"
+#include "util/PrintException.hxx"
+
+#include <chrono>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using std::chrono::steady_clock;
+
+/**
+ * Simulate a decoder which reads this many bytes at a time.
+ */
+static constexpr std::size_t CHUNK_SIZE = 16384;
+
+static void
+ReadAll(InputStream &is)
+{
+	std::byte buffer[CHUNK_SIZE];
+
+	std::unique_lock lock{is.mutex};
+
+	while (!is.IsEOF())
+		is.Read(lock, buffer);
+}
+
+static void
+Report(const char *path, const char *name, InputStream::offset_type size,
+       steady_clock::duration duration) noexcept
+{
+	const double s = std::chrono::duration<double>(duration).count();
+	printf("%-6s %10.1f ms %10.1f MB/s  %s\n",
+	       name, s * 1000, size / s / (1024 * 1024), path);
+}
+
+template<typename F>
+static void
+Run(const char *path, const char *name, F &&open)
+{
+	Mutex mutex;
+
+	const auto start = steady_clock::now();
+
+	auto is = open(path, mutex);
+	if (!is) {
+		printf("%-6s (not available)\n", name);
+		return;
+	}
+
+	ReadAll(*is);
+
+	Report(path, name, is->GetSize(), steady_clock::now() - start);
+}
+
+int
+main(int argc, char **argv) noexcept
+try {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: bench_uring_input FILE...\n");
+		return EXIT_FAILURE;
+	}
+
+	EventThread io_thread;
+	io_thread.Start();
+
+	InitUringInputPlugin(io_thread.GetEventLoop());
+
+	for (int i = 1; i < argc; ++i) {
+		/* note: the second run of each file may benefit from
+		   the page cache; drop it between runs for cold-cache
+		   measurements */
+
+		Run(argv[i], "pread", [](const char *path, Mutex &mutex){
+			return OpenFileInputStream(Path::FromFS(path), mutex);
+		});
+
+		Run(argv[i], "uring", [](const char *path, Mutex &mutex){
+			return OpenUringInputStream(path, mutex);
+		});
+	}
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
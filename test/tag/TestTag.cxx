@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "tag/Tag.hxx"
+#include "tag/Builder.hxx"
+#include "tag/Pool.hxx"
+
+#include <gtest/gtest.h>
+
+static Tag
+MakeTag()
+{
+	TagBuilder builder;
+	builder.AddItem(TAG_ARTIST, "foo");
+	builder.AddItem(TAG_TITLE, "bar");
+	return builder.Commit();
+}
+
+TEST(Tag, CopySharesItems)
+{
+	const auto before = tag_pool_get_stats();
+
+	{
+		Tag a = MakeTag();
+		EXPECT_FALSE(a.IsItemsShared());
+
+		Tag b{a};
+		EXPECT_EQ(b.items, a.items);
+		EXPECT_EQ(b.num_items, 2U);
+		EXPECT_TRUE(a.IsItemsShared());
+		EXPECT_TRUE(b.IsItemsShared());
+		EXPECT_EQ(a, b);
+
+		b.Clear();
+		EXPECT_TRUE(b.IsEmpty());
+		EXPECT_FALSE(a.IsItemsShared());
+		EXPECT_STREQ(a.GetValue(TAG_ARTIST), "foo");
+	}
+
+	EXPECT_EQ(tag_pool_get_stats().n_items, before.n_items);
+}
+
+TEST(Tag, BuilderFromShared)
+{
+	const auto before = tag_pool_get_stats();
+
+	{
+		Tag a = MakeTag();
+		Tag b{a};
+
+		/* moving a shared Tag into a TagBuilder must not
+		   steal the references of the other Tag */
+		TagBuilder builder{std::move(b)};
+		builder.AddItem(TAG_ALBUM, "baz");
+		Tag c = builder.Commit();
+
+		EXPECT_EQ(c.num_items, 3U);
+		EXPECT_STREQ(c.GetValue(TAG_TITLE), "bar");
+		EXPECT_STREQ(a.GetValue(TAG_TITLE), "bar");
+		EXPECT_FALSE(a.IsItemsShared());
+
+		/* not shared: the references are moved */
+		TagBuilder builder2{std::move(a)};
+		EXPECT_TRUE(a.IsEmpty());
+		Tag d = builder2.Commit();
+		EXPECT_STREQ(d.GetValue(TAG_ARTIST), "foo");
+	}
+
+	EXPECT_EQ(tag_pool_get_stats().n_items, before.n_items);
+}
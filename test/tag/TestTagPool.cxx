@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// Copyright The Music Player Daemon Project
+
+#include "tag/Pool.hxx"
+#include "tag/Item.hxx"
+#include "tag/Type.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string_view_literals::operator""sv;
+
+TEST(TagPool, Basic)
+{
+	const auto before = tag_pool_get_stats();
+
+	TagItem *a = tag_pool_get_item(TAG_ARTIST, "foo"sv);
+	ASSERT_NE(a, nullptr);
+	EXPECT_EQ(a->type, TAG_ARTIST);
+	EXPECT_STREQ(a->value, "foo");
+
+	/* the same value is de-duplicated */
+	TagItem *b = tag_pool_get_item(TAG_ARTIST, "foo"sv);
+	EXPECT_EQ(b, a);
+
+	/* ... but not if the type differs */
+	TagItem *c = tag_pool_get_item(TAG_ALBUM, "foo"sv);
+	EXPECT_NE(c, a);
+	EXPECT_EQ(c->type, TAG_ALBUM);
+
+	EXPECT_EQ(tag_pool_dup_item(a), a);
+
+	auto stats = tag_pool_get_stats();
+	EXPECT_EQ(stats.n_items, before.n_items + 2);
+	EXPECT_GT(stats.n_bytes, before.n_bytes);
+
+	tag_pool_put_item(a);
+	tag_pool_put_item(a);
+	tag_pool_put_item(c);
+
+	stats = tag_pool_get_stats();
+	EXPECT_EQ(stats.n_items, before.n_items + 1);
+
+	tag_pool_put_item(b);
+
+	stats = tag_pool_get_stats();
+	EXPECT_EQ(stats.n_items, before.n_items);
+}
+
+TEST(TagPool, Grow)
+{
+	constexpr unsigned N = 100000;
+
+	const auto before = tag_pool_get_stats();
+
+	std::vector<TagItem *> items;
+	items.reserve(N);
+	for (unsigned i = 0; i < N; ++i)
+		items.push_back(tag_pool_get_item(TAG_TITLE,
+						  std::to_string(i)));
+
+	EXPECT_EQ(tag_pool_get_stats().n_items, before.n_items + N);
+
+	/* all items can still be found after the hash tables have
+	   grown */
+	for (unsigned i = 0; i < N; ++i) {
+		TagItem *item = tag_pool_get_item(TAG_TITLE,
+						  std::to_string(i));
+		EXPECT_EQ(item, items[i]);
+		tag_pool_put_item(item);
+	}
+
+	for (auto *i : items)
+		tag_pool_put_item(i);
+
+	EXPECT_EQ(tag_pool_get_stats().n_items, before.n_items);
+}
+
+TEST(TagPool, Threads)
+{
+	constexpr unsigned N_THREADS = 4, N_VALUES = 1000, N_LOOPS = 20;
+
+	const auto before = tag_pool_get_stats();
+
+	std::vector<std::thread> threads;
+	for (unsigned t = 0; t < N_THREADS; ++t) {
+		threads.emplace_back([]{
+			std::vector<TagItem *> items;
+			items.reserve(N_VALUES * 2);
+
+			for (unsigned l = 0; l < N_LOOPS; ++l) {
+				/* all threads use the same values */
+				for (unsigned i = 0; i < N_VALUES; ++i) {
+					TagItem *item = tag_pool_get_item(TAG_GENRE,
+									  std::to_string(i));
+					items.push_back(item);
+					items.push_back(tag_pool_dup_item(item));
+				}
+
+				for (auto *i : items)
+					tag_pool_put_item(i);
+				items.clear();
+			}
+		});
+	}
+
+	for (auto &i : threads)
+		i.join();
+
+	EXPECT_EQ(tag_pool_get_stats().n_items, before.n_items);
+}
@@ -98,6 +98,64 @@ TEST(PcmTest, FormatFloat16)
 		EXPECT_EQ(src[i], d[i]);
 }
 
+TEST(PcmTest, Format32To24)
+{
+	constexpr size_t N = 509;
+	const auto src = TestDataBuffer<int32_t, N>();
+
+	PcmBuffer buffer;
+
+	auto d = pcm_convert_to_24(buffer, SampleFormat::S32, src);
+	EXPECT_EQ(N, d.size());
+
+	for (size_t i = 0; i < N; ++i)
+		EXPECT_EQ(src[i] >> 8, d[i]);
+}
+
+TEST(PcmTest, FormatFloat24)
+{
+	constexpr size_t N = 509;
+	const auto src = TestDataBuffer<int32_t, N>(RandomInt24());
+
+	PcmBuffer buffer1, buffer2;
+
+	auto f = pcm_convert_to_float(buffer1, SampleFormat::S24_P32, src);
+	EXPECT_EQ(N, f.size());
+
+	for (size_t i = 0; i != f.size(); ++i) {
+		EXPECT_GE(f[i], -1.f);
+		EXPECT_LE(f[i], 1.f);
+	}
+
+	auto d = pcm_convert_to_24(buffer2,
+				   SampleFormat::FLOAT,
+				   std::as_bytes(f));
+	EXPECT_EQ(N, d.size());
+
+	for (size_t i = 0; i < N; ++i)
+		EXPECT_EQ(src[i], d[i]);
+
+	/* check if clamping works */
+	auto *writable = const_cast<float *>(f.data());
+	*writable++ = 1.01;
+	*writable++ = 10;
+	*writable++ = -1.01;
+	*writable++ = -10;
+
+	d = pcm_convert_to_24(buffer2,
+			      SampleFormat::FLOAT,
+			      std::as_bytes(f));
+	EXPECT_EQ(N, d.size());
+
+	EXPECT_EQ(8388607, int(d[0]));
+	EXPECT_EQ(8388607, int(d[1]));
+	EXPECT_EQ(-8388608, int(d[2]));
+	EXPECT_EQ(-8388608, int(d[3]));
+
+	for (size_t i = 4; i < N; ++i)
+		EXPECT_EQ(src[i], d[i]);
+}
+
 TEST(PcmTest, FormatFloat32)
 {
 	constexpr size_t N = 509;
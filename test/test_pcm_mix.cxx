@@ -7,6 +7,8 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 template<typename T, SampleFormat format, typename G=RandomInt<T>>
 static void
 TestPcmMix(G g=G())
@@ -65,3 +67,47 @@ TEST(PcmTest, Mix32)
 {
 	TestPcmMix<int32_t, SampleFormat::S32>();
 }
+
+template<typename T, SampleFormat format, typename G=RandomInt<T>>
+static void
+TestPcmAdd(T min, T max, G g=G())
+{
+	constexpr unsigned N = 509;
+	const auto src1 = TestDataBuffer<T, N>(g);
+	const auto src2 = TestDataBuffer<T, N>(g);
+
+	PcmDither dither;
+
+	/* negative portion1: the buffers are added */
+	auto result = src1;
+	bool success = pcm_mix(dither,
+			       result.begin(), src2.begin(), sizeof(result),
+			       format, -1);
+	ASSERT_TRUE(success);
+
+	for (unsigned i = 0; i < N; ++i)
+		EXPECT_EQ(result[i],
+			  std::clamp<int64_t>(int64_t(src1[i]) + int64_t(src2[i]),
+					      min, max));
+}
+
+TEST(PcmTest, Add8)
+{
+	TestPcmAdd<int8_t, SampleFormat::S8>(INT8_MIN, INT8_MAX);
+}
+
+TEST(PcmTest, Add16)
+{
+	TestPcmAdd<int16_t, SampleFormat::S16>(INT16_MIN, INT16_MAX);
+}
+
+TEST(PcmTest, Add24)
+{
+	TestPcmAdd<int32_t, SampleFormat::S24_P32>(-0x800000, 0x7fffff,
+						   RandomInt24());
+}
+
+TEST(PcmTest, Add32)
+{
+	TestPcmAdd<int32_t, SampleFormat::S32>(INT32_MIN, INT32_MAX);
+}
@@ -4,7 +4,10 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <iterator>
+#include <string>
+#include <vector>
 
 Tag::Tag(const Tag &) noexcept {}
 void Tag::Clear() noexcept {}
@@ -170,3 +173,77 @@ TEST(QueuePriority, Priority)
 	a_order = queue.PositionToOrder(a_position);
 	EXPECT_EQ(6u, a_order);
 }
+
+/**
+ * Return the URIs of all songs in "order" order.
+ */
+static std::vector<std::string>
+GetOrderURIs(const Queue &queue)
+{
+	std::vector<std::string> result;
+	for (unsigned i = 0; i < queue.GetLength(); ++i) {
+		/* PositionToOrder() must be the inverse of
+		   OrderToPosition() */
+		EXPECT_EQ(queue.PositionToOrder(queue.OrderToPosition(i)), i);
+		result.emplace_back(queue.GetOrder(i).GetURI());
+	}
+
+	return result;
+}
+
+TEST(QueuePriority, RandomOrder)
+{
+	Queue queue(64);
+
+	for (unsigned i = 0; i < 40; ++i)
+		queue.Append(DetachedSong(std::to_string(i)), 0);
+
+	queue.random = true;
+	queue.ShuffleOrder();
+
+	auto expected = GetOrderURIs(queue);
+
+	/* moving songs physically doesn't change the order in which
+	   they are played */
+
+	queue.MovePostion(3, 20);
+	EXPECT_EQ(GetOrderURIs(queue), expected);
+
+	queue.MovePostion(30, 1);
+	EXPECT_EQ(GetOrderURIs(queue), expected);
+
+	queue.MoveRange(5, 10, 25);
+	EXPECT_EQ(GetOrderURIs(queue), expected);
+
+	queue.MoveRange(30, 35, 2);
+	EXPECT_EQ(GetOrderURIs(queue), expected);
+
+	/* deleting songs preserves the order of the remaining
+	   ones */
+
+	std::vector<std::string> deleted;
+	for (unsigned i = 10; i < 20; ++i)
+		deleted.emplace_back(queue.Get(i).GetURI());
+	std::erase_if(expected, [&deleted](const std::string &uri){
+		return std::find(deleted.begin(), deleted.end(),
+				 uri) != deleted.end();
+	});
+
+	queue.DeleteRange(10, 20);
+	EXPECT_EQ(queue.GetLength(), 30U);
+	EXPECT_EQ(GetOrderURIs(queue), expected);
+
+	std::erase(expected, queue.Get(0).GetURI());
+	queue.DeletePosition(0);
+	EXPECT_EQ(GetOrderURIs(queue), expected);
+
+	const unsigned order = queue.PositionToOrder(7);
+	EXPECT_EQ(queue.MoveOrder(order, 0), 0U);
+	EXPECT_EQ(queue.PositionToOrder(7), 0U);
+	GetOrderURIs(queue);
+
+	queue.random = false;
+	queue.RestoreOrder();
+	for (unsigned i = 0; i < queue.GetLength(); ++i)
+		EXPECT_EQ(queue.PositionToOrder(i), i);
+}
@@ -0,0 +1,131 @@
+/*
+ * Unit tests for class SliceBuffer.
+ */
+
+#include "util/SliceBuffer.hxx"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+TEST(SliceBuffer, Basic)
+{
+	SliceBuffer<int> buffer{4};
+
+	/* the capacity may be rounded up to the page size */
+	const unsigned capacity = buffer.GetCapacity();
+	EXPECT_GE(capacity, 4U);
+	EXPECT_TRUE(buffer.empty());
+	EXPECT_FALSE(buffer.IsFull());
+
+	std::vector<int *> values;
+	for (unsigned i = 0; i < capacity; ++i) {
+		int *v = buffer.Allocate(i);
+		ASSERT_NE(v, nullptr);
+		values.push_back(v);
+	}
+
+	for (unsigned i = 0; i < capacity; ++i)
+		EXPECT_EQ(*values[i], int(i));
+
+	EXPECT_FALSE(buffer.empty());
+	EXPECT_TRUE(buffer.IsFull());
+
+	EXPECT_EQ(buffer.Allocate(-1), nullptr);
+	EXPECT_EQ(buffer.GetAllocationFailures(), 1U);
+	EXPECT_EQ(buffer.GetHighWaterMark(), capacity);
+
+	buffer.Free(values[1]);
+	EXPECT_FALSE(buffer.IsFull());
+
+	/* the slice is reused */
+	int *v = buffer.Allocate(42);
+	EXPECT_EQ(v, values[1]);
+	EXPECT_EQ(*v, 42);
+
+	for (auto *i : values)
+		buffer.Free(i);
+	EXPECT_TRUE(buffer.empty());
+
+	/* after the memory was discarded, all slices can be
+	   allocated again */
+	for (auto &i : values) {
+		i = buffer.Allocate(0);
+		EXPECT_NE(i, nullptr);
+	}
+
+	EXPECT_EQ(buffer.Allocate(0), nullptr);
+	EXPECT_EQ(buffer.GetAllocationFailures(), 2U);
+
+	for (auto *i : values)
+		buffer.Free(i);
+}
+
+TEST(SliceBuffer, Threads)
+{
+	constexpr unsigned N_THREADS = 4, N_LOOPS = 2000;
+
+	SliceBuffer<unsigned> buffer{64};
+	const unsigned n_slices = buffer.GetCapacity();
+	std::atomic<unsigned> n_errors{0};
+
+	std::vector<std::thread> threads;
+	for (unsigned t = 0; t < N_THREADS; ++t) {
+		threads.emplace_back([&buffer, &n_errors, n_slices, t]{
+			std::vector<unsigned *> values(n_slices / N_THREADS);
+
+			for (unsigned i = 0; i < N_LOOPS; ++i) {
+				for (auto &v : values) {
+					v = buffer.Allocate(t);
+					if (v == nullptr)
+						++n_errors;
+				}
+
+				for (auto *v : values) {
+					if (v == nullptr)
+						continue;
+
+					if (*v != t)
+						++n_errors;
+					buffer.Free(v);
+				}
+			}
+		});
+	}
+
+	for (auto &i : threads)
+		i.join();
+
+	EXPECT_EQ(n_errors.load(), 0U);
+	EXPECT_EQ(buffer.GetAllocationFailures(), 0U);
+	EXPECT_LE(buffer.GetHighWaterMark(), n_slices);
+	EXPECT_TRUE(buffer.empty());
+}
+
+TEST(SliceBuffer, SliceSize)
+{
+	/* each slice has room for a variable-length payload after
+	   the object */
+	SliceBuffer<int> buffer{8, 100};
+	EXPECT_GE(buffer.GetSliceSize(), 100U);
+	EXPECT_GE(buffer.GetCapacity(), 8U);
+
+	std::vector<int *> values;
+	while (int *v = buffer.Allocate(0)) {
+		std::memset(v + 1, 0xff, 100 - sizeof(*v));
+		values.push_back(v);
+	}
+
+	EXPECT_EQ(values.size(), buffer.GetCapacity());
+
+	for (std::size_t i = 1; i < values.size(); ++i)
+		EXPECT_GE(std::size_t(reinterpret_cast<std::byte *>(values[i]) -
+				      reinterpret_cast<std::byte *>(values[i - 1])),
+			  buffer.GetSliceSize());
+
+	for (auto *i : values)
+		buffer.Free(i);
+}